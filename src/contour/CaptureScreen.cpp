@@ -229,10 +229,22 @@ namespace
     };
 
     auto constexpr ReplyPrefix = "\033]314;"sv; // DCS 314 ;
+    auto constexpr LatencyStatsReplyPrefix = "\033]889;"sv; // OSC 889 ;
+    auto constexpr MemoryUsageReplyPrefix = "\033]890;"sv; // OSC 890 ;
     auto constexpr ReplySuffix = "\033\\"sv;    // ST
 
+    timeval toTimeval(double _seconds)
+    {
+        auto constexpr MicrosPerSecond = 1'000'000;
+        auto const micros = int(_seconds * MicrosPerSecond);
+        auto result = timeval{};
+        result.tv_sec = micros / MicrosPerSecond;
+        result.tv_usec = micros % MicrosPerSecond;
+        return result;
+    }
+
     // Reads a *single* response chunk.
-    bool readCaptureChunk(TTY& _input, timeval* _timeout, string& _reply)
+    bool readCaptureChunk(TTY& _input, timeval* _timeout, string& _reply, string_view _replyPrefix = ReplyPrefix)
     {
         timeval timeout = *_timeout;
         // Response is of format: OSC 314 ; <screen capture> ST`
@@ -247,7 +259,7 @@ namespace
             }
             else if (rv == 0)
             {
-                cerr << "VTE did not respond to CAPTURE `CSI > Ps ; Ps t`.\n";
+                cerr << "VTE did not respond in time.\n";
                 return false;
             }
 
@@ -261,7 +273,7 @@ namespace
 
             copy_n(buf, rv, back_inserter(_reply));
 
-            if (n == 0 && !crispy::startsWith(string_view(_reply), ReplyPrefix))
+            if (n == 0 && !crispy::startsWith(string_view(_reply), _replyPrefix))
             {
                 cerr << fmt::format("Invalid response from terminal received. Does not start with expected reply prefix.\n");
                 return false;
@@ -282,11 +294,7 @@ bool captureScreen(CaptureSettings const& _settings)
     if (!tty.configured)
         return false;
 
-    auto constexpr MicrosPerSecond = 1'000'000;
-    auto const timeoutMicros = int(_settings.timeout * MicrosPerSecond);
-    auto timeout = timeval{};
-    timeout.tv_sec = timeoutMicros / MicrosPerSecond;
-    timeout.tv_usec = timeoutMicros % MicrosPerSecond;
+    auto timeout = toTimeval(_settings.timeout);
 
     auto const screenSizeOpt = tty.screenSize(&timeout);
     if (!screenSizeOpt.has_value())
@@ -335,4 +343,57 @@ bool captureScreen(CaptureSettings const& _settings)
     }
 }
 
+bool reportLatencyStats(LatencyStatsSettings const& _settings)
+{
+    auto reply = string{};
+    {
+        auto tty = TTY{};
+        if (!tty.configured)
+            return false;
+
+        auto timeout = toTimeval(_settings.timeout);
+
+        tty.write(fmt::format("\033]889;{}\033\\", _settings.json ? "json" : "text"));
+
+        if (!readCaptureChunk(tty, &timeout, reply, LatencyStatsReplyPrefix))
+            return false;
+
+        if (_settings.reset)
+            tty.write("\033]889;reset\033\\");
+    }
+
+    // Print with the terminal modes restored.
+    auto const payload = string_view(reply.data() + LatencyStatsReplyPrefix.size(),
+                                     reply.size() - LatencyStatsReplyPrefix.size() - ReplySuffix.size());
+    cout << payload;
+    if (_settings.json)
+        cout << '\n';
+    return true;
+}
+
+bool reportMemoryUsage(MemoryUsageSettings const& _settings)
+{
+    auto reply = string{};
+    {
+        auto tty = TTY{};
+        if (!tty.configured)
+            return false;
+
+        auto timeout = toTimeval(_settings.timeout);
+
+        tty.write(fmt::format("\033]890;{}\033\\", _settings.json ? "json" : "text"));
+
+        if (!readCaptureChunk(tty, &timeout, reply, MemoryUsageReplyPrefix))
+            return false;
+    }
+
+    // Print with the terminal modes restored.
+    auto const payload = string_view(reply.data() + MemoryUsageReplyPrefix.size(),
+                                     reply.size() - MemoryUsageReplyPrefix.size() - ReplySuffix.size());
+    cout << payload;
+    if (_settings.json)
+        cout << '\n';
+    return true;
+}
+
 } // end namespace
@@ -28,4 +28,23 @@ struct CaptureSettings
 
 bool captureScreen(CaptureSettings const& _settings);
 
+struct LatencyStatsSettings
+{
+    bool json = false;                  // --json
+    bool reset = false;                 // --reset
+    double timeout = 1.0;               // --timeout <timeout in seconds>
+};
+
+/// Queries the latency statistics of the currently running terminal and prints them.
+bool reportLatencyStats(LatencyStatsSettings const& _settings);
+
+struct MemoryUsageSettings
+{
+    bool json = false;                  // --json
+    double timeout = 1.0;               // --timeout <timeout in seconds>
+};
+
+/// Queries the memory usage of the currently running terminal session and prints it.
+bool reportMemoryUsage(MemoryUsageSettings const& _settings);
+
 }
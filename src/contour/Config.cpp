@@ -1338,6 +1338,20 @@ TerminalProfile loadTerminalProfile(UsedKeys& _usedKeys,
     else
         profile.maxHistoryLineCount = intValue;
 
+    intValue = profile.inMemoryHistoryLineCount.value_or(LineCount(-1));
+    tryLoadChild(_usedKeys, _doc, basePath, "history.in_memory_limit", intValue);
+    if (unbox<int>(intValue) < 0)
+        profile.inMemoryHistoryLineCount = nullopt;
+    else
+        profile.inMemoryHistoryLineCount = intValue;
+
+    auto memoryBudgetMB = profile.memoryBudget ? static_cast<int>(*profile.memoryBudget >> 20) : -1;
+    tryLoadChild(_usedKeys, _doc, basePath, "history.memory_budget", memoryBudgetMB);
+    if (memoryBudgetMB <= 0)
+        profile.memoryBudget = nullopt;
+    else
+        profile.memoryBudget = static_cast<size_t>(memoryBudgetMB) << 20;
+
     strValue = fmt::format("{}", ScrollBarPosition::Right);
     if (tryLoadChild(_usedKeys, _doc, basePath, "scrollbar.position", strValue))
     {
@@ -1472,6 +1486,8 @@ void loadConfigFromFile(Config& _config, FileSystem::path const& _fileName)
     }
 
     tryLoadValue(usedKeys, doc, "read_buffer_size", _config.ptyReadBufferSize);
+    tryLoadValue(usedKeys, doc, "max_osc_length", _config.maxOscLength);
+    tryLoadValue(usedKeys, doc, "io_reactor_workers", _config.ioReactorWorkers);
 
     tryLoadValue(usedKeys, doc, "reflow_on_resize", _config.reflowOnResize);
 
@@ -138,6 +138,8 @@ struct TerminalProfile {
     terminal::VTType terminalId = terminal::VTType::VT525;
 
     std::optional<terminal::LineCount> maxHistoryLineCount;
+    std::optional<terminal::LineCount> inMemoryHistoryLineCount; // older lines go to disk
+    std::optional<size_t> memoryBudget; // in bytes, trimming history when exceeded
     terminal::LineCount historyScrollMultiplier;
     ScrollBarPosition scrollbarPosition = ScrollBarPosition::Right;
     bool hideScrollbarInAltScreen = true;
@@ -178,6 +180,11 @@ struct Config {
     // Configures the size of the PTY read buffer.
     // Changing this value may result in better or worse throughput performance.
     int ptyReadBufferSize = 16384;
+    int maxOscLength = 8 * 1024 * 1024;
+
+    // Number of worker threads of the I/O reactor shared by all terminal sessions,
+    // or 0 to process each session's input on a dedicated thread.
+    int ioReactorWorkers = 0;
 
     bool reflowOnResize = true;
 
@@ -0,0 +1,147 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <contour/ConfigWatcher.h>
+
+#include <crispy/logstore.h>
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+using std::cerr;
+using std::exception;
+using std::exchange;
+using std::lock_guard;
+using std::make_shared;
+using std::move;
+using std::string;
+using std::unique_lock;
+
+namespace contour {
+
+namespace
+{
+    auto const ConfigWatchLog = logstore::Category("gui.configwatch", "Logs live configuration reloading.");
+}
+
+// {{{ Subscription
+ConfigWatcher::Subscription::Subscription(Subscription&& _other) noexcept:
+    watcher_{ exchange(_other.watcher_, nullptr) },
+    path_{ move(_other.path_) },
+    id_{ exchange(_other.id_, 0) }
+{
+}
+
+ConfigWatcher::Subscription& ConfigWatcher::Subscription::operator=(Subscription&& _other) noexcept
+{
+    if (this != &_other)
+    {
+        reset();
+        watcher_ = exchange(_other.watcher_, nullptr);
+        path_ = move(_other.path_);
+        id_ = exchange(_other.id_, 0);
+    }
+    return *this;
+}
+
+void ConfigWatcher::Subscription::reset()
+{
+    if (!watcher_)
+        return;
+
+    watcher_->unsubscribe(path_, id_);
+    watcher_ = nullptr;
+    id_ = 0;
+}
+// }}}
+
+ConfigWatcher& ConfigWatcher::instance()
+{
+    // Construct the file watcher first, so that it is destroyed last.
+    (void) FileChangeWatcher::instance();
+    static ConfigWatcher watcher;
+    return watcher;
+}
+
+ConfigWatcher::Subscription ConfigWatcher::subscribe(FileSystem::path const& _configPath, Listener _listener)
+{
+    auto path = _configPath.string();
+    auto const _ = lock_guard{lock_};
+
+    auto const id = nextId_++;
+    WatchedConfig& config = configs_[path];
+    config.listeners.emplace(id, move(_listener));
+
+    if (!config.fileSubscription)
+        config.fileSubscription = FileChangeWatcher::instance().watch(
+            _configPath,
+            [this, path](FileChangeWatcher::Event _event) { reload(path, _event); }
+        );
+
+    LOGSTORE(ConfigWatchLog)("{} listeners to {}.", config.listeners.size(), path);
+    return Subscription{this, move(path), id};
+}
+
+void ConfigWatcher::unsubscribe(string const& _path, uint64_t _id)
+{
+    auto lock = unique_lock{lock_};
+
+    auto i = configs_.find(_path);
+    if (i == configs_.end())
+        return;
+
+    i->second.listeners.erase(_id);
+    if (!i->second.listeners.empty())
+        return;
+
+    // Stop watching without holding the lock, as this waits for a reload in progress.
+    auto fileSubscription = move(i->second.fileSubscription);
+    configs_.erase(i);
+    lock.unlock();
+    fileSubscription.reset();
+}
+
+void ConfigWatcher::reload(string const& _path, FileChangeWatcher::Event _event)
+{
+    if (_event == FileChangeWatcher::Event::Erased)
+    {
+        LOGSTORE(ConfigWatchLog)("Configuration file {} has been erased. Keeping current configuration.", _path);
+        return;
+    }
+
+    auto newConfig = make_shared<config::Config>();
+    try
+    {
+        config::loadConfigFromFile(*newConfig, _path);
+    }
+    catch (exception const& e)
+    {
+        cerr << "Configuration failure. " << e.what() << '\n';
+        cerr << "Failed to load configuration.\n";
+        return;
+    }
+
+    auto const _ = lock_guard{lock_};
+    auto i = configs_.find(_path);
+    if (i == configs_.end())
+        return;
+
+    LOGSTORE(ConfigWatchLog)("Reloaded {} for {} listeners.", _path, i->second.listeners.size());
+
+    auto const sharedConfig = ConfigPtr(move(newConfig));
+    for (auto const& listener: i->second.listeners)
+        listener.second(sharedConfig);
+}
+
+} // end namespace
@@ -0,0 +1,89 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <contour/Config.h>
+#include <contour/FileChangeWatcher.h>
+
+#include <crispy/stdfs.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace contour {
+
+/**
+ * Reloads configuration files on behalf of all terminal sessions of the process.
+ *
+ * Each configuration file is watched only once, and parsed only once per change,
+ * no matter how many sessions are using it. The resulting configuration is shared
+ * among all listeners of that file.
+ */
+class ConfigWatcher {
+  public:
+    using ConfigPtr = std::shared_ptr<config::Config const>;
+
+    /// Invoked on the file watcher thread with the newly loaded configuration.
+    ///
+    /// Listeners must not subscribe or unsubscribe from within.
+    using Listener = std::function<void(ConfigPtr const&)>;
+
+    /// Keeps listening to configuration changes until destroyed.
+    class Subscription {
+      public:
+        Subscription() = default;
+        Subscription(Subscription&& _other) noexcept;
+        Subscription& operator=(Subscription&& _other) noexcept;
+        Subscription(Subscription const&) = delete;
+        Subscription& operator=(Subscription const&) = delete;
+        ~Subscription() { reset(); }
+
+        void reset();
+
+        explicit operator bool() const noexcept { return watcher_ != nullptr; }
+
+      private:
+        friend class ConfigWatcher;
+        Subscription(ConfigWatcher* _watcher, std::string _path, uint64_t _id):
+            watcher_{ _watcher }, path_{ std::move(_path) }, id_{ _id } {}
+
+        ConfigWatcher* watcher_ = nullptr;
+        std::string path_;
+        uint64_t id_ = 0;
+    };
+
+    /// @returns the configuration watcher shared by the whole process.
+    static ConfigWatcher& instance();
+
+    [[nodiscard]] Subscription subscribe(FileSystem::path const& _configPath, Listener _listener);
+
+  private:
+    struct WatchedConfig {
+        FileChangeWatcher::Subscription fileSubscription;
+        std::map<uint64_t, Listener> listeners;
+    };
+
+    void unsubscribe(std::string const& _path, uint64_t _id);
+    void reload(std::string const& _path, FileChangeWatcher::Event _event);
+
+    std::mutex lock_;
+    std::map<std::string, WatchedConfig> configs_;
+    uint64_t nextId_ = 1;
+};
+
+}
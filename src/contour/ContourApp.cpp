@@ -22,6 +22,7 @@
 
 #include <crispy/App.h>
 #include <crispy/StackTrace.h>
+#include <crispy/logstore.h>
 #include <crispy/utils.h>
 
 #include <fmt/format.h>
@@ -32,6 +33,7 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <sstream>
 
 #include <signal.h>
 
@@ -105,6 +107,16 @@ namespace // {{{ helper
         auto symbols = stackTrace.symbols();
         for (size_t i = 0; i < symbols.size(); ++i)
             out << symbols[i] << "\r\n";
+
+        auto flightRecorder = std::stringstream{};
+        logstore::Sink::console().dump_flight_recorder(flightRecorder);
+        if (!flightRecorder.str().empty())
+        {
+            out << "\r\n"
+                << "Flight Recorder:\r\n"
+                << "----------------\r\n"
+                << flightRecorder.str();
+        }
     }
 
     // Have this directory string already pre-created, as in case of a SEGV
@@ -198,6 +210,8 @@ ContourApp::ContourApp() :
 #endif
 
     link("contour.capture", bind(&ContourApp::captureAction, this));
+    link("contour.latency", bind(&ContourApp::latencyAction, this));
+    link("contour.memory", bind(&ContourApp::memoryAction, this));
     link("contour.list-debug-tags", bind(&ContourApp::listDebugTagsAction, this));
     link("contour.set.profile", bind(&ContourApp::profileAction, this));
     link("contour.parser-table", bind(&ContourApp::parserTableAction, this));
@@ -269,6 +283,31 @@ int ContourApp::captureAction()
         return EXIT_FAILURE;
 }
 
+int ContourApp::latencyAction()
+{
+    auto settings = contour::LatencyStatsSettings{};
+    settings.json = parameters().get<bool>("contour.latency.json");
+    settings.reset = parameters().get<bool>("contour.latency.reset");
+    settings.timeout = parameters().get<double>("contour.latency.timeout");
+
+    if (contour::reportLatencyStats(settings))
+        return EXIT_SUCCESS;
+    else
+        return EXIT_FAILURE;
+}
+
+int ContourApp::memoryAction()
+{
+    auto settings = contour::MemoryUsageSettings{};
+    settings.json = parameters().get<bool>("contour.memory.json");
+    settings.timeout = parameters().get<double>("contour.memory.timeout");
+
+    if (contour::reportMemoryUsage(settings))
+        return EXIT_SUCCESS;
+    else
+        return EXIT_FAILURE;
+}
+
 int ContourApp::parserTableAction()
 {
     terminal::parser::dot(std::cout, terminal::parser::ParserTable::get());
@@ -364,6 +403,23 @@ crispy::cli::Command ContourApp::parameterDefinition() const
                     CLI::Option{"to", CLI::Value{""s}, "Output file name to store the screen capture to. If - (dash) is given, the capture will be written to standard output.", "FILE", CLI::Presence::Required},
                 }
             },
+            CLI::Command{
+                "latency",
+                "Reports the latency statistics of the currently running terminal, from reading PTY output until it is on the screen.",
+                {
+                    CLI::Option{"json", CLI::Value{false}, "Reports the statistics as JSON object, with durations in microseconds."},
+                    CLI::Option{"reset", CLI::Value{false}, "Resets the statistics after reporting them."},
+                    CLI::Option{"timeout", CLI::Value{1.0}, "Sets timeout seconds to wait for terminal to respond.", "SECONDS"},
+                }
+            },
+            CLI::Command{
+                "memory",
+                "Reports the memory usage of the currently running terminal session by category, such as history, images, and caches.",
+                {
+                    CLI::Option{"json", CLI::Value{false}, "Reports the usage as JSON object, in bytes."},
+                    CLI::Option{"timeout", CLI::Value{1.0}, "Sets timeout seconds to wait for terminal to respond.", "SECONDS"},
+                }
+            },
             CLI::Command{
                 "set",
                 "Sets various aspects of the connected terminal.",
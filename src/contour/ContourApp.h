@@ -29,6 +29,8 @@ class ContourApp : public crispy::App
 
   private:
     int captureAction();
+    int latencyAction();
+    int memoryAction();
     int listDebugTagsAction();
     int parserTableAction();
     int profileAction();
@@ -73,8 +73,10 @@ crispy::cli::Command ContourGuiApp::parameterDefinition() const
                 CLI::Option{"config", CLI::Value{contour::config::defaultConfigFilePath()}, "Path to configuration file to load at startup.", "FILE"},
                 CLI::Option{"profile", CLI::Value{""s}, "Terminal Profile to load (overriding config).", "NAME"},
                 CLI::Option{"debug", CLI::Value{""s}, "Enables debug logging, using a comma (,) seperated list of tags.", "TAGS"},
+                CLI::Option{"flight-recorder", CLI::Value{0u}, "Keeps the most recent MB of debug log messages in memory instead of printing them, to be written into the crash log.", "MB"},
                 CLI::Option{"live-config", CLI::Value{false}, "Enables live config reloading."},
                 CLI::Option{"dump-state-at-exit", CLI::Value{""s}, "Dumps internal state at exit into the given directory. This is for debugging contour.", "PATH"},
+                CLI::Option{"vt-capture", CLI::Value{""s}, "Records everything the terminal received into the given file, to be replayed with bench-replay.", "FILE"},
                 CLI::Option{"early-exit-threshold", CLI::Value{6u}, "If the spawned process exits earlier than the given threshold seconds, an error message will be printed and the window not closed immediately."},
                 CLI::Option{"working-directory", CLI::Value{""s}, "Sets initial working directory (overriding config).", "DIRECTORY"},
                 CLI::Option{"class", CLI::Value{""s}, "Sets the class part of the WM_CLASS property for the window (overriding config).", "WM_CLASS"},
@@ -126,6 +128,12 @@ int terminalGUI(int argc, char const* argv[], CLI::FlagStore const& _flags)
                 }));
             }
         }
+
+        // Keep the terminal responsive even with chatty categories enabled.
+        if (auto const flightRecorderSize = _flags.get<unsigned>("contour.terminal.flight-recorder"))
+            logstore::Sink::console().set_flight_recorder(size_t(flightRecorderSize) * 1024 * 1024);
+        else
+            logstore::Sink::console().set_async(true);
     }
 
     auto const configPath = QString::fromStdString(_flags.get<string>("contour.terminal.config"));
@@ -174,6 +182,10 @@ int terminalGUI(int argc, char const* argv[], CLI::FlagStore const& _flags)
     if (!dumpStateAtExitStr.empty())
         dumpStateAtExit = FileSystem::path(dumpStateAtExitStr);
 
+    std::optional<FileSystem::path> vtCapturePath;
+    if (auto const path = _flags.get<string>("contour.terminal.vt-capture"); !path.empty())
+        vtCapturePath = FileSystem::path(path);
+
     std::chrono::seconds earlyExitThreshold(_flags.get<unsigned>("contour.terminal.early-exit-threshold"));
 
     // Possibly override shell to be executed
@@ -228,7 +240,7 @@ int terminalGUI(int argc, char const* argv[], CLI::FlagStore const& _flags)
 
     QSurfaceFormat::setDefaultFormat(contour::opengl::TerminalWidget::surfaceFormat());
 
-    contour::Controller controller(qtArgsPtr[0], earlyExitThreshold, config, liveConfig, profileName, dumpStateAtExit);
+    contour::Controller controller(qtArgsPtr[0], earlyExitThreshold, config, liveConfig, profileName, dumpStateAtExit, vtCapturePath);
     controller.start();
 
     // auto const HTS = "\033H";
@@ -19,6 +19,8 @@
 #include <QtCore/QProcess>
 #include <QtGui/QGuiApplication>
 
+#include <fmt/format.h>
+
 using namespace std;
 
 namespace contour {
@@ -30,13 +32,15 @@ Controller::Controller(std::string _programPath,
                        config::Config _config,
                        bool _liveConfig,
                        std::string _profileName,
-                       std::optional<FileSystem::path> _dumpStateAtExit):
+                       std::optional<FileSystem::path> _dumpStateAtExit,
+                       std::optional<FileSystem::path> _vtCapturePath):
     programPath_{ move(_programPath) },
     earlyExitThreshold_{ _earlyExitThreshold },
     config_{ move(_config) },
     liveConfig_{ _liveConfig },
     profileName_{ move(_profileName) },
-    dumpStateAtExit_{ _dumpStateAtExit }
+    dumpStateAtExit_{ _dumpStateAtExit },
+    vtCapturePath_{ move(_vtCapturePath) }
 {
     // systrayIcon_ = new QSystemTrayIcon(nullptr);
     // systrayIcon_->show();
@@ -61,6 +65,20 @@ void Controller::onExit(TerminalSession& _session)
     exitStatus_ = pty->process().checkStatus();
 }
 
+optional<FileSystem::path> Controller::nextVTCapturePath()
+{
+    if (!vtCapturePath_)
+        return nullopt;
+
+    auto const n = vtCaptureCount_++;
+    if (n == 0)
+        return vtCapturePath_;
+
+    auto path = *vtCapturePath_;
+    path.replace_filename(fmt::format("{}-{}{}", path.stem().string(), n, path.extension().string()));
+    return path;
+}
+
 void Controller::newWindow(contour::config::Config const& _config)
 {
     auto mainWindow = new TerminalWindow{
@@ -38,7 +38,8 @@ class Controller : public QThread {
                contour::config::Config _config,
                bool _liveConfig,
                std::string _profileName,
-               std::optional<FileSystem::path> _dumpStateAtExit);
+               std::optional<FileSystem::path> _dumpStateAtExit,
+               std::optional<FileSystem::path> _vtCapturePath);
 
     ~Controller();
 
@@ -47,6 +48,11 @@ class Controller : public QThread {
     std::optional<terminal::Process::ExitStatus> exitStatus() const noexcept { return exitStatus_; }
     std::optional<FileSystem::path> const& dumpStateAtExit() const noexcept { return dumpStateAtExit_; }
 
+    /// @returns the file to record the next terminal session's VT capture into, if requested.
+    ///
+    /// The first session is recorded into the given file, later ones get a numeric suffix.
+    std::optional<FileSystem::path> nextVTCapturePath();
+
     void onExit(TerminalSession& _session);
 
   public slots:
@@ -66,6 +72,8 @@ class Controller : public QThread {
     bool const liveConfig_;
     std::string profileName_;
     std::optional<FileSystem::path> dumpStateAtExit_;
+    std::optional<FileSystem::path> vtCapturePath_;
+    unsigned vtCaptureCount_ = 0;
 
     std::list<TerminalWindow*> terminalWindows_;
 
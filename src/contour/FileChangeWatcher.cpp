@@ -12,44 +12,332 @@
  * limitations under the License.
  */
 #include "FileChangeWatcher.h"
-#include <thread>
+
+#include <crispy/logstore.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-FileChangeWatcher::FileChangeWatcher(FileSystem::path _filePath, Notifier _notifier) :
-    filePath_{ move(_filePath) },
-    notifier_{ move(_notifier) },
-    exit_{ false },
-    watcher_{ [this]() { watch(); } }
+namespace // {{{ helper
+{
+    auto const FileWatchLog = logstore::Category("gui.filewatch", "Logs watching files for changes.");
+
+    using Clock = chrono::steady_clock;
+
+    /// Resolves symbolic links, so that the file that is actually edited gets watched.
+    string watchedPathOf(FileSystem::path const& _path)
+    {
+        auto ec = FileSystemError{};
+        auto canonical = FileSystem::weakly_canonical(_path, ec);
+        return ec ? _path.string() : canonical.string();
+    }
+
+#if defined(__linux__)
+    // Editors save in different ways: in place (truncate and write), or by writing a
+    // temporary file and renaming it over the original (sometimes after deleting it).
+    constexpr uint32_t WatchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB
+                                 | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+#endif
+} // }}}
+
+// {{{ Subscription
+FileChangeWatcher::Subscription::Subscription(Subscription&& _other) noexcept:
+    watcher_{ exchange(_other.watcher_, nullptr) },
+    id_{ exchange(_other.id_, 0) }
 {
 }
 
+FileChangeWatcher::Subscription& FileChangeWatcher::Subscription::operator=(Subscription&& _other) noexcept
+{
+    if (this != &_other)
+    {
+        reset();
+        watcher_ = exchange(_other.watcher_, nullptr);
+        id_ = exchange(_other.id_, 0);
+    }
+    return *this;
+}
+
+void FileChangeWatcher::Subscription::reset()
+{
+    if (!watcher_)
+        return;
+
+    watcher_->unwatch(id_);
+    watcher_ = nullptr;
+    id_ = 0;
+}
+// }}}
+
+FileChangeWatcher& FileChangeWatcher::instance()
+{
+    static FileChangeWatcher watcher;
+    return watcher;
+}
+
+FileChangeWatcher::FileChangeWatcher(chrono::milliseconds _debounceDelay):
+    debounceDelay_{ _debounceDelay }
+{
+#if defined(__linux__)
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0)
+        LOGSTORE(FileWatchLog)("inotify not available, falling back to polling. {}", strerror(errno));
+    if (pipe2(wakeupPipe_.data(), O_NONBLOCK | O_CLOEXEC) < 0)
+        wakeupPipe_ = {-1, -1};
+#endif
+
+    thread_ = std::thread([this]() { run(); });
+}
+
 FileChangeWatcher::~FileChangeWatcher()
 {
-    stop();
-    watcher_.join();
+    {
+        auto const _ = lock_guard{lock_};
+        quit_ = true;
+    }
+    wakeup();
+    thread_.join();
+
+#if defined(__linux__)
+    for (auto const fd: {inotifyFd_, wakeupPipe_[0], wakeupPipe_[1]})
+        if (fd >= 0)
+            close(fd);
+#endif
+}
+
+FileChangeWatcher::Subscription FileChangeWatcher::watch(FileSystem::path const& _filePath, Notifier _notifier)
+{
+    auto const path = watchedPathOf(_filePath);
+    auto const _ = lock_guard{lock_};
+
+    auto const id = nextId_++;
+    auto [i, inserted] = files_.try_emplace(path);
+    WatchedFile& file = i->second;
+    file.notifiers.emplace(id, move(_notifier));
+
+    if (inserted)
+    {
+        auto ec = FileSystemError{};
+        file.existed = FileSystem::exists(path, ec);
+        if (file.existed)
+            file.lastWriteTime = FileSystem::last_write_time(path, ec);
+
+#if defined(__linux__)
+        if (inotifyFd_ >= 0)
+        {
+            auto const directory = FileSystem::path(path).parent_path().string();
+            file.watchDescriptor = inotify_add_watch(inotifyFd_, directory.c_str(), WatchMask);
+            if (file.watchDescriptor < 0)
+                LOGSTORE(FileWatchLog)("Failed to watch directory {}. {}", directory, strerror(errno));
+        }
+#endif
+        LOGSTORE(FileWatchLog)("Watching {}.", path);
+    }
+
+    return Subscription{this, id};
+}
+
+void FileChangeWatcher::unwatch(uint64_t _id)
+{
+    auto lock = unique_lock{lock_};
+
+    // Make sure the notifier is not running anymore when returning, unless called from it.
+    if (this_thread::get_id() != thread_.get_id())
+        notified_.wait(lock, [&]() { return notifyingId_ != _id; });
+
+    for (auto i = files_.begin(); i != files_.end(); ++i)
+    {
+        if (!i->second.notifiers.erase(_id))
+            continue;
+
+        if (i->second.notifiers.empty())
+        {
+#if defined(__linux__)
+            // Files in the same directory share the same watch descriptor.
+            auto const wd = i->second.watchDescriptor;
+            auto const shared = any_of(files_.begin(), files_.end(), [&](auto const& _file) {
+                return &_file.second != &i->second && _file.second.watchDescriptor == wd;
+            });
+            if (wd >= 0 && !shared)
+                inotify_rm_watch(inotifyFd_, wd);
+#endif
+            LOGSTORE(FileWatchLog)("Stopped watching {}.", i->first);
+            files_.erase(i);
+        }
+        break;
+    }
+}
+
+void FileChangeWatcher::wakeup()
+{
+#if defined(__linux__)
+    if (wakeupPipe_[1] >= 0)
+    {
+        char const dummy = 0;
+        auto const rv = ::write(wakeupPipe_[1], &dummy, sizeof(dummy));
+        (void) rv;
+        return;
+    }
+#endif
+    notified_.notify_all();
 }
 
-void FileChangeWatcher::watch()
+void FileChangeWatcher::run()
 {
-    auto lastWriteTime = FileSystem::last_write_time(filePath_);
-    while (!exit_)
+    for (;;)
     {
-        if (!FileSystem::exists(filePath_))
-            notifier_(Event::Erased);
+        auto lock = unique_lock{lock_};
+        if (quit_)
+            break;
 
-        auto lwt = FileSystem::last_write_time(filePath_);
-        if (lwt != lastWriteTime)
+        auto settleTime = Clock::time_point::max();
+        for (auto const& [path, file]: files_)
+            if (file.changed)
+                settleTime = min(settleTime, file.settleTime);
+
+        // Without inotify, files are checked at least once a second. Otherwise, wait for
+        // events indefinitely, unless some file is about to settle down.
+        auto const polling = inotifyFd_ < 0;
+        auto timeout = chrono::milliseconds(polling ? 1000 : -1);
+        if (settleTime != Clock::time_point::max())
+        {
+            auto const remaining = chrono::duration_cast<chrono::milliseconds>(settleTime - Clock::now());
+            timeout = clamp(remaining + chrono::milliseconds(1), chrono::milliseconds(0), chrono::milliseconds(1000));
+        }
+
+#if defined(__linux__)
+        if (!polling)
+        {
+            lock.unlock();
+            auto fds = array<pollfd, 2>{ pollfd{inotifyFd_, POLLIN, 0}, pollfd{wakeupPipe_[0], POLLIN, 0} };
+            auto const count = poll(fds.data(), wakeupPipe_[0] >= 0 ? 2 : 1, static_cast<int>(timeout.count()));
+            if (count > 0 && fds[1].revents)
+            {
+                char buf[64];
+                while (::read(wakeupPipe_[0], buf, sizeof(buf)) > 0)
+                    ;
+            }
+            if (count > 0 && fds[0].revents)
+                processEvents();
+        }
+        else
+#endif
         {
-            lastWriteTime = lwt;
-            notifier_(Event::Modified);
+            notified_.wait_for(lock, timeout, [this]() { return quit_; });
+            lock.unlock();
+            pollFiles();
         }
-        this_thread::sleep_for(1s);
+
+        notifySettledFiles();
     }
 }
 
-void FileChangeWatcher::stop()
+void FileChangeWatcher::processEvents()
 {
-    exit_ = true;
+#if defined(__linux__)
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        auto const length = ::read(inotifyFd_, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+
+        auto const _ = lock_guard{lock_};
+        auto const settleTime = Clock::now() + debounceDelay_;
+        for (char const* p = buffer; p < buffer + length; )
+        {
+            auto const* event = reinterpret_cast<inotify_event const*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            auto const overflow = (event->mask & IN_Q_OVERFLOW) != 0;
+            auto const name = event->len ? string_view(event->name) : string_view{};
+            for (auto& [path, file]: files_)
+            {
+                auto const matches = overflow
+                    || (file.watchDescriptor == event->wd
+                        && (name.empty() || FileSystem::path(path).filename().string() == name));
+                if (!matches)
+                    continue;
+
+                file.changed = true;
+                file.settleTime = settleTime;
+            }
+        }
+    }
+#endif
+}
+
+void FileChangeWatcher::pollFiles()
+{
+    auto const _ = lock_guard{lock_};
+    auto const settleTime = Clock::now() + debounceDelay_;
+    for (auto& [path, file]: files_)
+    {
+        auto ec = FileSystemError{};
+        auto const exists = FileSystem::exists(path, ec);
+        auto const lastWriteTime = exists ? FileSystem::last_write_time(path, ec) : FileSystem::file_time_type{};
+        // Keep postponing while the file keeps changing.
+        if (exists != file.existed || lastWriteTime != file.lastWriteTime)
+        {
+            file.settleTime = settleTime;
+            file.changed = true;
+            file.existed = exists;
+            file.lastWriteTime = lastWriteTime;
+        }
+    }
+}
+
+void FileChangeWatcher::notifySettledFiles()
+{
+    auto lock = unique_lock{lock_};
+    auto const now = Clock::now();
+
+    auto pending = vector<pair<uint64_t, Event>>{};
+    for (auto& [path, file]: files_)
+    {
+        if (!file.changed || file.settleTime > now)
+            continue;
+
+        file.changed = false;
+        auto ec = FileSystemError{};
+        file.existed = FileSystem::exists(path, ec);
+        file.lastWriteTime = file.existed ? FileSystem::last_write_time(path, ec) : FileSystem::file_time_type{};
+
+        auto const event = file.existed ? Event::Modified : Event::Erased;
+        LOGSTORE(FileWatchLog)("{} {}.", path, file.existed ? "modified" : "erased");
+        for (auto const& notifier: file.notifiers)
+            pending.emplace_back(notifier.first, event);
+    }
+
+    for (auto const& [id, event]: pending)
+    {
+        // The subscription may have been cancelled by a previous notifier.
+        auto notifier = Notifier{};
+        for (auto const& [path, file]: files_)
+            if (auto i = file.notifiers.find(id); i != file.notifiers.end())
+                notifier = i->second;
+        if (!notifier)
+            continue;
+
+        notifyingId_ = id;
+        lock.unlock();
+        notifier(event);
+        lock.lock();
+        notifyingId_ = 0;
+        notified_.notify_all();
+    }
 }
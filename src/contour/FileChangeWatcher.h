@@ -15,9 +15,27 @@
 
 #include <crispy/stdfs.h>
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <string>
 #include <thread>
 
+/**
+ * Process-wide service watching files for changes on behalf of any number of subscribers,
+ * using a single thread (inotify on Linux, polling once a second elsewhere).
+ *
+ * The directory of a watched file is observed rather than the file itself, so that
+ * editors replacing the file (write to a temporary file, then rename over) are noticed.
+ * Events for the same path are coalesced and only reported once things settled down for
+ * the debounce delay, so that multi-step saves (truncate, then write) notify only once.
+ *
+ * Notifiers are invoked on the watcher thread.
+ */
 class FileChangeWatcher {
   public:
     enum class Event {
@@ -26,18 +44,69 @@ class FileChangeWatcher {
     };
     using Notifier = std::function<void(Event)>;
 
-    FileChangeWatcher(FileSystem::path _filePath, Notifier _notifier);
+    /// Keeps a file watched until destroyed.
+    class Subscription {
+      public:
+        Subscription() = default;
+        Subscription(Subscription&& _other) noexcept;
+        Subscription& operator=(Subscription&& _other) noexcept;
+        Subscription(Subscription const&) = delete;
+        Subscription& operator=(Subscription const&) = delete;
+        ~Subscription() { reset(); }
+
+        /// Stops watching early.
+        ///
+        /// When invoked while the notifier runs on another thread, this waits for it to return.
+        void reset();
+
+        explicit operator bool() const noexcept { return watcher_ != nullptr; }
+
+      private:
+        friend class FileChangeWatcher;
+        Subscription(FileChangeWatcher* _watcher, uint64_t _id): watcher_{ _watcher }, id_{ _id } {}
+
+        FileChangeWatcher* watcher_ = nullptr;
+        uint64_t id_ = 0;
+    };
+
+    /// @returns the watcher shared by the whole process.
+    static FileChangeWatcher& instance();
+
+    explicit FileChangeWatcher(std::chrono::milliseconds _debounceDelay = std::chrono::milliseconds(150));
     ~FileChangeWatcher();
 
-    // stop watching on that file early
-    void stop();
+    FileChangeWatcher(FileChangeWatcher const&) = delete;
+    FileChangeWatcher& operator=(FileChangeWatcher const&) = delete;
 
-  private:
-    void watch();
+    [[nodiscard]] Subscription watch(FileSystem::path const& _filePath, Notifier _notifier);
 
   private:
-    FileSystem::path filePath_;
-    Notifier notifier_;
-    bool exit_;
-    std::thread watcher_;
+    struct WatchedFile {
+        std::map<uint64_t, Notifier> notifiers;
+        int watchDescriptor = -1;   //!< inotify watch of the file's directory
+        bool changed = false;       //!< events arrived, waiting for them to settle down
+        std::chrono::steady_clock::time_point settleTime;
+        FileSystem::file_time_type lastWriteTime{};
+        bool existed = false;
+    };
+
+    void unwatch(uint64_t _id);
+    void run();
+    void processEvents();
+    void pollFiles();
+    void notifySettledFiles();
+    void wakeup();
+
+    std::chrono::milliseconds const debounceDelay_;
+
+    std::mutex lock_;
+    std::condition_variable notified_;
+    std::map<std::string, WatchedFile> files_; //!< watched files by path
+    uint64_t nextId_ = 1;
+    uint64_t notifyingId_ = 0;                 //!< subscription whose notifier currently runs
+    bool quit_ = false;
+
+    int inotifyFd_ = -1;
+    std::array<int, 2> wakeupPipe_{-1, -1};
+    std::thread thread_;
 };
@@ -79,6 +79,7 @@ public:
     // terminal events
     virtual void bufferChanged(terminal::ScreenType) = 0; // primary/alt buffer has flipped
     virtual void discardImage(terminal::Image const&) = 0; // the given image is not in use anymore
+    virtual void evictCaches() = 0; // the session exceeds its memory budget
     virtual void onSelectionCompleted() = 0; // a visual selection has completed
     virtual void renderBufferUpdated() = 0; // notify on RenderBuffer updates
     virtual void scheduleRedraw() = 0; //!< forced redraw of the screen
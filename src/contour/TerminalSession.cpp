@@ -15,11 +15,13 @@
 #include <contour/TerminalSession.h>
 #include <contour/helper.h>
 
+#include <terminal/IOReactor.h>
 #include <terminal/MatchModes.h>
 #include <terminal/Terminal.h>
 #include <terminal/pty/Pty.h>
 #include <terminal/pty/PtyProcess.h>
 
+#include <crispy/App.h>
 #include <crispy/StackTrace.h>
 
 #include <range/v3/all.hpp>
@@ -75,6 +77,15 @@ namespace // {{{ helper
         return fmt::format("{}: Unhandled exception caught ({}). {}", where, typeid(e).name(), e.what());
     }
 
+#if !defined(_WIN32)
+    /// I/O reactor shared by all terminal sessions of this process, created on first use.
+    IOReactor& sharedIOReactor(int _workerCount)
+    {
+        static IOReactor reactor(static_cast<size_t>(_workerCount));
+        return reactor;
+    }
+#endif
+
 } //  }}}
 
 TerminalSession::TerminalSession(unique_ptr<Pty> _pty,
@@ -119,8 +130,23 @@ TerminalSession::TerminalSession(unique_ptr<Pty> _pty,
     {
         LOGSTORE(SessionLog)("Enable live configuration reloading of file {}.",
                              config_.backingFilePath.generic_string());
-        configFileChangeWatcher_.emplace(config_.backingFilePath,
-                                         [this](FileChangeWatcher::Event event) { onConfigReload(event); });
+        configSubscription_ = ConfigWatcher::instance().subscribe(
+            config_.backingFilePath,
+            [this](ConfigWatcher::ConfigPtr const& _config) { onConfigReload(_config); }
+        );
+    }
+
+    if (auto const capturePath = controller_.nextVTCapturePath(); capturePath.has_value())
+    {
+        try
+        {
+            terminal_.setCapture(make_unique<terminal::CaptureWriter>(*capturePath));
+            LOGSTORE(SessionLog)("Recording VT capture into {}.", capturePath->string());
+        }
+        catch (std::exception const& e)
+        {
+            LOGSTORE(SessionLog)("Failed to record VT capture. {}", e.what());
+        }
     }
 
     sanitizeConfig(_config);
@@ -160,6 +186,13 @@ void TerminalSession::displayInitialized()
 
 void TerminalSession::start()
 {
+#if !defined(_WIN32)
+    if (config_.ioReactorWorkers > 0)
+    {
+        terminal().start(sharedIOReactor(config_.ioReactorWorkers));
+        return;
+    }
+#endif
     terminal().start();
 }
 
@@ -399,6 +432,12 @@ void TerminalSession::discardImage(terminal::Image const& _image)
     display_->discardImage(_image);
 }
 
+void TerminalSession::evictCaches()
+{
+    if (display_)
+        display_->evictCaches();
+}
+
 // }}}
 // {{{ Input Events
 void TerminalSession::sendKeyPressEvent(Key _key,
@@ -595,7 +634,7 @@ void TerminalSession::operator()(actions::FollowHyperlink)
     };
     if (terminal().screen().contains(currentMousePosition))
     {
-        if (auto hyperlink = terminal().screen().at(currentMousePositionRel).hyperlink(); hyperlink != nullptr)
+        if (auto hyperlink = terminal().screen().cellAt(currentMousePositionRel).hyperlink(); hyperlink != nullptr)
         {
             followHyperlink(*hyperlink);
             return;
@@ -686,8 +725,11 @@ void TerminalSession::operator()(actions::ResetFontSize)
 
 void TerminalSession::operator()(actions::ScreenshotVT)
 {
-    auto _l = lock_guard{ terminal() };
-    auto const screenshot = terminal().screen().screenshot();
+    auto const snapshot = [this]() {
+        auto _l = lock_guard{ terminal() };
+        return terminal().screen().grid().snapshot(0);
+    }();
+    auto const screenshot = terminal::Screen::screenshot(snapshot);
     ofstream ofs{ "screenshot.vt", ios::trunc | ios::binary };
     ofs << screenshot;
 }
@@ -911,6 +953,7 @@ void TerminalSession::configureTerminal()
     screen.setTerminalId(profile_.terminalId);
     screen.setSixelCursorConformance(config_.sixelCursorConformance);
     screen.setMaxImageColorRegisters(config_.maxImageColorRegisters);
+    screen.setMaxOscLength(static_cast<size_t>(config_.maxOscLength));
     screen.setMaxImageSize(config_.maxImageSize);
     LOGSTORE(SessionLog)("maxImageSize={}, sixelScrolling={}",
             config_.maxImageSize, config_.sixelScrolling ? "yes" : "no");
@@ -921,6 +964,21 @@ void TerminalSession::configureTerminal()
     //     return;
 
     screen.setMaxHistoryLineCount(profile_.maxHistoryLineCount);
+    try
+    {
+        if (profile_.inMemoryHistoryLineCount)
+            screen.setColdHistory(ColdHistorySettings{
+                crispy::App::instance()->localStateDir() / "history",
+                *profile_.inMemoryHistoryLineCount
+            });
+        else
+            screen.setColdHistory(nullopt);
+    }
+    catch (std::system_error const& e)
+    {
+        errorlog()("Could not enable disk-backed scrollback history. {}", e.what());
+    }
+    terminal_.setMemoryBudget(profile_.memoryBudget);
     terminal_.setCursorBlinkingInterval(profile_.cursorBlinkInterval);
     terminal_.setCursorDisplay(profile_.cursorDisplay);
     terminal_.setCursorShape(profile_.cursorShape);
@@ -1078,10 +1136,17 @@ bool TerminalSession::requestPermission(config::Permission _allowedByConfig, str
     return display_->requestPermission(_allowedByConfig, _topicText);
 }
 
-void TerminalSession::onConfigReload(FileChangeWatcher::Event /*_event*/)
+void TerminalSession::onConfigReload(ConfigWatcher::ConfigPtr _config)
 {
-    display_->post([this]() {
-        reloadConfigWithProfile(profileName_);
+    // The configuration has been loaded once for all sessions already.
+    display_->post([this, config = move(_config)]() {
+        if (!config->profile(profileName_))
+        {
+            cerr << fmt::format("Configuration failure. Currently active profile with name '{}' gone.\n",
+                                profileName_);
+            return;
+        }
+        reloadConfig(*config, profileName_);
     });
 
     // TODO: needed still?
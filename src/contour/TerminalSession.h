@@ -16,7 +16,7 @@
 #include <contour/Controller.h>
 #include <contour/Config.h>
 #include <contour/TerminalDisplay.h>
-#include <contour/FileChangeWatcher.h>
+#include <contour/ConfigWatcher.h>
 
 #include <terminal/Terminal.h>
 
@@ -95,6 +95,7 @@ class TerminalSession: public terminal::Terminal::Events
     void setWindowTitle(std::string_view _title) override;
     void setTerminalProfile(std::string const& _configProfileName) override;
     void discardImage(terminal::Image const&) override;
+    void evictCaches() override;
 
     // Input Events
     using Timestamp = std::chrono::steady_clock::time_point;
@@ -164,7 +165,7 @@ class TerminalSession: public terminal::Terminal::Events
     void followHyperlink(terminal::HyperlinkInfo const& _hyperlink);
     bool requestPermission(config::Permission _allowedByConfig, std::string_view _topicText);
     void setFontSize(text::font_size _size);
-    void onConfigReload(FileChangeWatcher::Event _event);
+    void onConfigReload(ConfigWatcher::ConfigPtr _config);
     void setDefaultCursor();
     void configureTerminal();
     void configureDisplay();
@@ -187,7 +188,7 @@ class TerminalSession: public terminal::Terminal::Events
     bool terminatedAndWaitingForKeyPress_ = false;
     std::unique_ptr<TerminalDisplay> display_;
 
-    std::optional<FileChangeWatcher> configFileChangeWatcher_;
+    ConfigWatcher::Subscription configSubscription_;
 
     // state vars
     //
@@ -90,13 +90,13 @@ struct OpenGLRenderer::TextureScheduler : public atlas::AtlasBackend
 {
     struct RenderBatch
     {
-        std::vector<atlas::RenderTexture> renderTextures;
+        size_t textureCount = 0;
         std::vector<GLfloat> buffer;
         int user = 0;
 
         void clear()
         {
-            renderTextures.clear();
+            textureCount = 0;
             buffer.clear();
         }
     };
@@ -144,23 +144,79 @@ struct OpenGLRenderer::TextureScheduler : public atlas::AtlasBackend
         addRenderTextureToBatch(_render, renderBatches.at(_render.texture.get().atlas.value));
     }
 
+    void renderBatch(atlas::RenderBatch const& _batch) override
+    {
+        RenderBatch& target = renderBatches.at(_batch.atlas.value);
+        auto const count = _batch.size();
+        auto const offset = target.buffer.size();
+        target.buffer.resize(offset + count * 6 * 11);
+        target.textureCount += count;
+
+        GLfloat const i = 0;
+        GLfloat const u = _batch.user;
+        GLfloat* out = target.buffer.data() + offset;
+
+        for (size_t k = 0; k < count; ++k)
+        {
+            GLfloat const x = _batch.x[k];
+            GLfloat const y = _batch.y[k];
+            GLfloat const z = _batch.z[k];
+            GLfloat const r = _batch.width[k];
+            GLfloat const s = _batch.height[k];
+            GLfloat const rx = _batch.atlasX[k];
+            GLfloat const ry = _batch.atlasY[k];
+            GLfloat const w = _batch.atlasWidth[k];
+            GLfloat const h = _batch.atlasHeight[k];
+            GLfloat const cr = _batch.red[k];
+            GLfloat const cg = _batch.green[k];
+            GLfloat const cb = _batch.blue[k];
+            GLfloat const ca = _batch.alpha[k];
+
+            // Same vertex layout as in addRenderTextureToBatch().
+            GLfloat const vertices[6 * 11] = {
+                x,     y + s, z,  rx,     ry + h, i, u,  cr, cg, cb, ca, // left top
+                x,     y,     z,  rx,     ry,     i, u,  cr, cg, cb, ca, // left bottom
+                x + r, y,     z,  rx + w, ry,     i, u,  cr, cg, cb, ca, // right bottom
+                x,     y + s, z,  rx,     ry + h, i, u,  cr, cg, cb, ca, // left top
+                x + r, y,     z,  rx + w, ry,     i, u,  cr, cg, cb, ca, // right bottom
+                x + r, y + s, z,  rx + w, ry + h, i, u,  cr, cg, cb, ca, // right top
+            };
+            out = std::copy(std::begin(vertices), std::end(vertices), out);
+        }
+    }
+
     static void addRenderTextureToBatch(atlas::RenderTexture _render, RenderBatch& _batch)
     {
         // Vertices
+        atlas::TextureInfo const& texture = _render.texture.get();
+
+        // Portion of the texture to render, relative to its bitmap size.
+        GLfloat fx = 0.0f;
+        GLfloat fy = 0.0f;
+        GLfloat fw = _render.cropWidth;
+        GLfloat fh = 1.0f;
+        if (_render.sourceWidth)
+        {
+            fx = GLfloat(_render.sourceX) / GLfloat(*texture.bitmapSize.width);
+            fy = GLfloat(_render.sourceY) / GLfloat(*texture.bitmapSize.height);
+            fw = GLfloat(_render.sourceWidth) / GLfloat(*texture.bitmapSize.width);
+            fh = GLfloat(_render.sourceHeight) / GLfloat(*texture.bitmapSize.height);
+        }
+
         GLfloat const x = _render.x;
         GLfloat const y = _render.y;
         GLfloat const z = _render.z;
-      //GLfloat const w = _render.w;
-        GLfloat const r = *_render.texture.get().targetSize.width;
-        GLfloat const s = *_render.texture.get().targetSize.height;
+        GLfloat const r = _render.targetWidth ? GLfloat(_render.targetWidth)
+                                              : GLfloat(*texture.targetSize.width) * fw;
+        GLfloat const s = GLfloat(*texture.targetSize.height) * fh;
 
         // TexCoords
-        GLfloat const rx = _render.texture.get().relativeX;
-        GLfloat const ry = _render.texture.get().relativeY;
-        GLfloat const w = _render.texture.get().relativeWidth;
-        GLfloat const h = _render.texture.get().relativeHeight;
-        GLfloat const i = 0; // _render.texture.get().z;
-        GLfloat const u = _render.texture.get().user;
+        GLfloat const rx = texture.relativeX + texture.relativeWidth * fx;
+        GLfloat const ry = texture.relativeY + texture.relativeHeight * fy;
+        GLfloat const w = texture.relativeWidth * fw;
+        GLfloat const h = texture.relativeHeight * fh;
+        GLfloat const i = 0; // texture.z;
+        GLfloat const u = texture.user;
 
         // color
         GLfloat const cr = _render.color[0];
@@ -186,7 +242,7 @@ struct OpenGLRenderer::TextureScheduler : public atlas::AtlasBackend
             // - 4 color values (RGBA)
         };
 
-        _batch.renderTextures.emplace_back(_render);
+        ++_batch.textureCount;
         crispy::copy(vertices, back_inserter(_batch.buffer));
     }
 
@@ -713,7 +769,7 @@ void OpenGLRenderer::executeRenderTextures()
     for (size_t i = 0; i < textureScheduler_->renderBatches.size(); ++i)
     {
         auto& batch = textureScheduler_->renderBatches[i];
-        if (batch.renderTextures.empty())
+        if (batch.textureCount == 0)
             continue;
 
         glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + batch.user));
@@ -726,7 +782,7 @@ void OpenGLRenderer::executeRenderTextures()
                      batch.buffer.size() * sizeof(GLfloat),
                      batch.buffer.data(),
                      GL_STREAM_DRAW);
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(batch.renderTextures.size() * 6));
+        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(batch.textureCount * 6));
 
         batch.clear();
     }
@@ -447,6 +447,14 @@ void TerminalWidget::paintGL()
                 : RGBAColor(profile().colors.defaultBackground, uint8_t(renderer_.backgroundOpacity()))
         );
         renderer_.render(terminal(), renderingPressure_);
+
+        // Accounts the frame actually rendered, which may just have been refreshed by render().
+        // Frames may be rendered more than once (e.g. for cursor blinking), account only once.
+        if (auto const frameID = renderer_.renderedFrameID(); frameID != renderedFrame_.id)
+        {
+            renderedFrame_ = RenderedFrame{frameID, renderer_.renderedFrameTimestamps(), steady_clock::now(), false};
+            terminal().setFrontendMemoryUsage(renderer_.memoryUsage());
+        }
     }
     catch (exception const& e)
     {
@@ -456,6 +464,14 @@ void TerminalWidget::paintGL()
 
 void TerminalWidget::onFrameSwapped()
 {
+    if (!renderedFrame_.swapped)
+    {
+        renderedFrame_.swapped = true;
+        terminal().latencyStats().recordDisplayed(renderedFrame_.timestamps,
+                                                  renderedFrame_.rendered,
+                                                  steady_clock::now());
+    }
+
     if (!state_.finish())
         update();
     else if (auto timeout = terminal().nextRender(); timeout.has_value())
@@ -1055,6 +1071,15 @@ void TerminalWidget::discardImage(terminal::Image const& _image)
 {
     renderer_.discardImage(_image);
 }
+
+void TerminalWidget::evictCaches()
+{
+    post([this]() {
+        renderer_.clearTextShapingCache();
+        terminal().setFrontendMemoryUsage(renderer_.memoryUsage());
+        update();
+    });
+}
 // }}}
 
 } // namespace contour
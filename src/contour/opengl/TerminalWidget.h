@@ -126,6 +126,7 @@ public:
     void onSelectionCompleted() override;
     void bufferChanged(terminal::ScreenType) override;
     void discardImage(terminal::Image const&) override;
+    void evictCaches() override;
     // }}}
 
   public Q_SLOTS:
@@ -180,6 +181,15 @@ public:
 
     RenderStateManager state_;
 
+    // Latency accounting of the most recently rendered frame, completed when swapped.
+    struct RenderedFrame {
+        uint64_t id = 0;
+        terminal::FrameTimestamps timestamps{};
+        std::chrono::steady_clock::time_point rendered{};
+        bool swapped = true;
+    };
+    RenderedFrame renderedFrame_{};
+
     // ======================================================================
 
 #if defined(CONTOUR_PERF_STATS)
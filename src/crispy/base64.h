@@ -13,6 +13,8 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <iterator>
 #include <string>
 #include <string_view>
 
@@ -208,4 +210,85 @@ inline std::string decode(const std::string_view& input)
     return output;
 }
 
+/// State of an incremental decode of input that arrives in chunks.
+///
+/// @see decode(decoder_state&, std::string_view, Output)
+/// @see finish(decoder_state&, Output)
+struct decoder_state
+{
+    unsigned char sextets[4] = {};
+    unsigned count = 0;     //!< number of sextets of the current group seen so far
+    bool finished = false;  //!< padding (or any other non-alphabet character) has been seen
+};
+
+/// Decodes the next @p chunk of a base64 encoded stream, keeping an incomplete
+/// trailing group in @p state for the next call.
+///
+/// Decoding stops at the first padding or otherwise invalid character.
+///
+/// @returns number of bytes written to @p output, at most decodeLength(chunk.size() + 3).
+template <typename Output>
+size_t decode(decoder_state& state, std::string_view chunk, Output output)
+{
+    auto out = output;
+    auto input = chunk.begin();
+    auto const end = chunk.end();
+
+    while (!state.finished && input != end)
+    {
+        // fast path: whole groups
+        if (state.count == 0)
+        {
+            while (std::distance(input, end) >= 4)
+            {
+                auto const a = detail::indexmap[static_cast<uint8_t>(input[0])];
+                auto const b = detail::indexmap[static_cast<uint8_t>(input[1])];
+                auto const c = detail::indexmap[static_cast<uint8_t>(input[2])];
+                auto const d = detail::indexmap[static_cast<uint8_t>(input[3])];
+                if ((a | b | c | d) > 63)
+                    break;
+                *out++ = static_cast<char>(a << 2 | b >> 4);
+                *out++ = static_cast<char>(b << 4 | c >> 2);
+                *out++ = static_cast<char>(c << 6 | d);
+                input += 4;
+            }
+            if (input == end)
+                break;
+        }
+
+        auto const sextet = detail::indexmap[static_cast<uint8_t>(*input++)];
+        if (sextet > 63)
+        {
+            state.finished = true;
+            break;
+        }
+
+        state.sextets[state.count++] = sextet;
+        if (state.count == 4)
+        {
+            *out++ = static_cast<char>(state.sextets[0] << 2 | state.sextets[1] >> 4);
+            *out++ = static_cast<char>(state.sextets[1] << 4 | state.sextets[2] >> 2);
+            *out++ = static_cast<char>(state.sextets[2] << 6 | state.sextets[3]);
+            state.count = 0;
+        }
+    }
+
+    return static_cast<size_t>(std::distance(output, out));
+}
+
+/// Writes the bytes of the trailing incomplete group (if any) and resets @p state.
+///
+/// @returns number of bytes written to @p output (at most 2).
+template <typename Output>
+size_t finish(decoder_state& state, Output output)
+{
+    auto out = output;
+    if (state.count > 1)
+        *out++ = static_cast<char>(state.sextets[0] << 2 | state.sextets[1] >> 4);
+    if (state.count > 2)
+        *out++ = static_cast<char>(state.sextets[1] << 4 | state.sextets[2] >> 2);
+    state = decoder_state{};
+    return static_cast<size_t>(std::distance(output, out));
+}
+
 } // end namespace xzero
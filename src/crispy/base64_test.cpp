@@ -33,3 +33,31 @@ TEST_CASE("base64.decode", "[base64]")
     CHECK("abcd" == base64::decode("YWJjZA=="));
     CHECK("foo:bar" == base64::decode("Zm9vOmJhcg=="));
 }
+
+TEST_CASE("base64.decode.incremental", "[base64]")
+{
+    auto const text = std::string("The quick brown fox jumps over the lazy dog.");
+    auto const encoded = base64::encode(text);
+
+    // Feed the encoded text in chunks of every possible size.
+    for (size_t chunkSize = 1; chunkSize <= encoded.size(); ++chunkSize)
+    {
+        auto state = base64::decoder_state{};
+        auto decoded = std::string(text.size() + 3, '\0');
+        auto out = decoded.data();
+        for (size_t i = 0; i < encoded.size(); i += chunkSize)
+            out += base64::decode(state, std::string_view(encoded).substr(i, chunkSize), out);
+        out += base64::finish(state, out);
+        decoded.resize(static_cast<size_t>(out - decoded.data()));
+        INFO("chunk size: " << chunkSize);
+        CHECK(decoded == text);
+    }
+
+    auto state = base64::decoder_state{};
+    auto decoded = std::string(8, '\0');
+    auto n = base64::decode(state, "YW", decoded.data());
+    n += base64::decode(state, "I=YWJj", decoded.data() + n);
+    CHECK(state.finished);
+    n += base64::finish(state, decoded.data() + n);
+    CHECK(decoded.substr(0, n) == "ab");
+}
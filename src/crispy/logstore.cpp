@@ -0,0 +1,399 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/logstore.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using std::atomic;
+using std::deque;
+using std::lock_guard;
+using std::make_shared;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::string_view;
+using std::unique_lock;
+using std::vector;
+
+using namespace std::chrono_literals;
+
+namespace logstore
+{
+
+namespace detail
+{
+    /// Single-producer single-consumer byte ring of length-prefixed messages.
+    class MessageRing
+    {
+      public:
+        explicit MessageRing(size_t _capacity): buffer_(_capacity) {}
+
+        size_t capacity() const noexcept { return buffer_.size(); }
+        size_t size() const noexcept { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+        static constexpr size_t recordSize(size_t _textSize) noexcept { return sizeof(Header) + _textSize; }
+
+        /// Producer side. @returns false if there is not enough space left.
+        bool push(uint64_t _sequence, string_view _text)
+        {
+            auto const head = head_.load(std::memory_order_relaxed);
+            auto const tail = tail_.load(std::memory_order_acquire);
+            if (recordSize(_text.size()) > capacity() - (head - tail))
+                return false;
+
+            auto const header = Header{_sequence, _text.size()};
+            copyIn(head, &header, sizeof(header));
+            copyIn(head + sizeof(header), _text.data(), _text.size());
+            head_.store(head + recordSize(_text.size()), std::memory_order_release);
+            return true;
+        }
+
+        /// Consumer side. Invokes @p _callback(sequence, text) for all available messages.
+        template <typename Callback>
+        void drain(Callback _callback)
+        {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            auto const head = head_.load(std::memory_order_acquire);
+            auto text = string{};
+            while (tail != head)
+            {
+                auto header = Header{};
+                copyOut(tail, &header, sizeof(header));
+                text.resize(header.size);
+                copyOut(tail + sizeof(header), text.data(), text.size());
+                tail += recordSize(header.size);
+                _callback(header.sequence, std::move(text));
+            }
+            tail_.store(tail, std::memory_order_release);
+        }
+
+        atomic<bool> detached = false; //!< the producing thread exited
+        atomic<bool> closed = false;   //!< no longer drained by the sink
+
+      private:
+        struct Header {
+            uint64_t sequence;
+            size_t size;
+        };
+
+        void copyIn(size_t _offset, void const* _data, size_t _size)
+        {
+            auto const start = _offset % capacity();
+            auto const n = std::min(_size, capacity() - start);
+            memcpy(buffer_.data() + start, _data, n);
+            memcpy(buffer_.data(), static_cast<char const*>(_data) + n, _size - n);
+        }
+
+        void copyOut(size_t _offset, void* _data, size_t _size) const
+        {
+            auto const start = _offset % capacity();
+            auto const n = std::min(_size, capacity() - start);
+            memcpy(_data, buffer_.data() + start, n);
+            memcpy(static_cast<char*>(_data) + n, buffer_.data(), _size - n);
+        }
+
+        vector<char> buffer_;
+        atomic<size_t> head_ = 0; //!< write offset, owned by the producer
+        atomic<size_t> tail_ = 0; //!< read offset, owned by the consumer
+    };
+
+    /// The rings the current thread is producing into, by writer.
+    struct ThreadRings
+    {
+        vector<pair<uint64_t, shared_ptr<MessageRing>>> rings;
+
+        ~ThreadRings()
+        {
+            for (auto& ring: rings)
+                ring.second->detached = true;
+        }
+    };
+
+    thread_local ThreadRings threadRings;
+
+    /// Background writer of a Sink in asynchronous mode.
+    class AsyncWriter
+    {
+      public:
+        static constexpr size_t RingCapacity = 512 * 1024;
+        static constexpr auto FlushInterval = 20ms;
+
+        explicit AsyncWriter(Sink::Writer& _writer):
+            writer_{ _writer },
+            thread_{ [this]() { run(); } }
+        {
+        }
+
+        ~AsyncWriter()
+        {
+            {
+                auto const _ = lock_guard{lock_};
+                quit_ = true;
+            }
+            wakeup_.notify_all();
+            thread_.join();
+
+            auto const _ = lock_guard{lock_};
+            drain();
+            for (auto& ring: rings_)
+                ring->closed = true;
+        }
+
+        std::mutex& lock() noexcept { return lock_; }
+
+        void setFlightRecorder(size_t _size)
+        {
+            auto const _ = lock_guard{lock_};
+            drain();
+            flightRecorderSize_ = _size;
+            trimFlightRecorder();
+        }
+
+        size_t flightRecorderSize() const noexcept { return flightRecorderSize_; }
+
+        void push(string _text)
+        {
+            auto& ring = ringOfThisThread();
+            auto const sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+
+            if (MessageRing::recordSize(_text.size()) > ring.capacity())
+            {
+                // Too large to ever fit: write it directly, but in order.
+                auto const _ = lock_guard{lock_};
+                drain();
+                deliver(std::move(_text));
+                return;
+            }
+
+            auto const halfFull = ring.size() > ring.capacity() / 2;
+            while (!ring.push(sequence, _text))
+            {
+                // Apply back pressure rather than losing messages.
+                wakeup_.notify_one();
+                std::this_thread::yield();
+            }
+
+            if (!halfFull && ring.size() > ring.capacity() / 2)
+                wakeup_.notify_one();
+        }
+
+        void flush()
+        {
+            auto const _ = lock_guard{lock_};
+            drain();
+        }
+
+        void dumpFlightRecorder(std::ostream& _output)
+        {
+            // Used from crash handlers, so never block for long.
+            auto lock = unique_lock{lock_, std::defer_lock};
+            for (int i = 0; i < 100 && !lock.try_lock(); ++i)
+                std::this_thread::sleep_for(1ms);
+            if (!lock.owns_lock())
+            {
+                _output << "(flight recorder busy)\n";
+                return;
+            }
+
+            drain();
+            for (auto const& message: flightRecorder_)
+                _output << message;
+        }
+
+      private:
+        MessageRing& ringOfThisThread()
+        {
+            auto& rings = threadRings.rings;
+            for (auto i = rings.begin(); i != rings.end(); )
+            {
+                if (i->first == id_)
+                    return *i->second;
+                if (i->second->closed)
+                    i = rings.erase(i);
+                else
+                    ++i;
+            }
+
+            auto ring = make_shared<MessageRing>(RingCapacity);
+            {
+                auto const _ = lock_guard{lock_};
+                rings_.emplace_back(ring);
+            }
+            rings.emplace_back(id_, ring);
+            return *ring;
+        }
+
+        void run()
+        {
+            auto lock = unique_lock{lock_};
+            while (!quit_)
+            {
+                wakeup_.wait_for(lock, FlushInterval);
+                drain();
+            }
+        }
+
+        /// Collects the pending messages of all threads, and writes them in one batch.
+        void drain()
+        {
+            pending_.clear();
+            for (auto i = rings_.begin(); i != rings_.end(); )
+            {
+                auto const detached = (*i)->detached.load();
+                (*i)->drain([this](uint64_t _sequence, string&& _text) {
+                    pending_.emplace_back(_sequence, std::move(_text));
+                });
+                if (detached)
+                    i = rings_.erase(i);
+                else
+                    ++i;
+            }
+
+            if (pending_.empty())
+                return;
+
+            std::sort(pending_.begin(), pending_.end(),
+                      [](auto const& a, auto const& b) { return a.first < b.first; });
+
+            if (flightRecorderSize_)
+            {
+                for (auto& message: pending_)
+                    record(std::move(message.second));
+                trimFlightRecorder();
+                return;
+            }
+
+            batch_.clear();
+            for (auto const& message: pending_)
+                batch_ += message.second;
+            writer_(batch_);
+        }
+
+        void deliver(string _text)
+        {
+            if (flightRecorderSize_)
+            {
+                record(std::move(_text));
+                trimFlightRecorder();
+            }
+            else
+                writer_(_text);
+        }
+
+        void record(string _text)
+        {
+            flightRecorderUsage_ += _text.size();
+            flightRecorder_.emplace_back(std::move(_text));
+        }
+
+        void trimFlightRecorder()
+        {
+            while (!flightRecorder_.empty() && flightRecorderUsage_ > flightRecorderSize_)
+            {
+                flightRecorderUsage_ -= flightRecorder_.front().size();
+                flightRecorder_.pop_front();
+            }
+        }
+
+        static inline atomic<uint64_t> nextId_ = 1;
+
+        uint64_t const id_ = nextId_++;
+        Sink::Writer& writer_;
+        atomic<uint64_t> sequence_ = 0;
+
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+        bool quit_ = false;
+        vector<shared_ptr<MessageRing>> rings_;
+        vector<pair<uint64_t, string>> pending_;
+        string batch_;
+
+        size_t flightRecorderSize_ = 0;
+        size_t flightRecorderUsage_ = 0;
+        deque<string> flightRecorder_;
+
+        std::thread thread_;
+    };
+}
+
+Sink::Sink(bool /*_enabled*/, Writer _writer):
+    writer_{ std::move(_writer) }
+{
+}
+
+Sink::Sink(bool _enabled, std::ostream& _output):
+    Sink(
+        _enabled,
+        [out = &_output](string_view text) { *out << text; out->flush(); }
+    )
+{
+}
+
+Sink::~Sink() = default;
+
+void Sink::set_writer(Writer _writer)
+{
+    if (async_)
+    {
+        auto const _ = lock_guard{async_->lock()};
+        writer_ = std::move(_writer);
+    }
+    else
+        writer_ = std::move(_writer);
+}
+
+void Sink::set_async(bool _enabled)
+{
+    if (_enabled && !async_)
+        async_ = std::make_unique<detail::AsyncWriter>(writer_);
+    else if (!_enabled)
+        async_.reset();
+}
+
+void Sink::set_flight_recorder(size_t _size)
+{
+    if (_size)
+        set_async(true);
+
+    if (async_)
+        async_->setFlightRecorder(_size);
+}
+
+void Sink::flush()
+{
+    if (async_)
+        async_->flush();
+}
+
+void Sink::dump_flight_recorder(std::ostream& _output)
+{
+    if (async_ && async_->flightRecorderSize())
+        async_->dumpFlightRecorder(_output);
+}
+
+void Sink::write_async(string _text)
+{
+    async_->push(std::move(_text));
+}
+
+}
@@ -14,8 +14,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -37,6 +39,8 @@ class Category;
 class Sink;
 
 namespace detail {
+    class AsyncWriter;
+
     class dummy_source_location {
       public:
         dummy_source_location(std::string_view _filename, int _line, std::string_view _functionName) :
@@ -104,11 +108,7 @@ public:
     }
 
     template <typename... Args>
-    MessageBuilder& append(std::string_view msg, Args... args)
-    {
-        _buffer += fmt::format(msg, std::forward<Args>(args)...);
-        return *this;
-    }
+    MessageBuilder& append(std::string_view msg, Args... args);
 
     MessageBuilder& operator()(std::string_view msg)
     {
@@ -178,27 +178,43 @@ private:
 /// Logging Sink API.
 ///
 /// Such as the console, a log file, or UDP endpoint.
+///
+/// By default, messages are written synchronously on the logging thread.
+/// In asynchronous mode, each logging thread pushes its formatted messages into its own
+/// lock-free ring buffer instead, and a background thread writes them in batches.
 class Sink
 {
 public:
     using Writer = std::function<void(std::string_view const&)>;
 
-    Sink(bool _enabled, Writer _writer) :
-        writer_{ std::move(_writer) }
-    {}
-
-    Sink(bool _enabled, std::ostream& _output) :
-        Sink(
-            _enabled,
-            [out = &_output](std::string_view text) { *out << text; out->flush(); }
-        )
-    {}
+    Sink(bool _enabled, Writer _writer);
+    Sink(bool _enabled, std::ostream& _output);
+    ~Sink();
 
     void set_writer(Writer _writer);
 
     /// Writes given built message to this sink.
     void write(MessageBuilder const& _message);
 
+    /// Enables or disables asynchronous writing.
+    ///
+    /// This must be configured before other threads start logging to this sink.
+    /// Disabling it writes all pending messages.
+    void set_async(bool _enabled);
+    bool async() const noexcept { return async_ != nullptr; }
+
+    /// Keeps the most recent @p _size bytes of messages in memory instead of writing them,
+    /// to be dumped by dump_flight_recorder() (e.g. in a crash log).
+    ///
+    /// This implies asynchronous mode. A size of zero disables the flight recorder.
+    void set_flight_recorder(size_t _size);
+
+    /// Writes all pending messages of asynchronous mode.
+    void flush();
+
+    /// Writes the messages kept by the flight recorder, including those still pending.
+    void dump_flight_recorder(std::ostream& _output);
+
     /// Retrieves reference to standard debug-logging sink.
     static inline Sink& console()
     {
@@ -213,7 +229,10 @@ public:
     }
 
   private:
+    void write_async(std::string _text);
+
     Writer writer_;
+    std::unique_ptr<detail::AsyncWriter> async_;
 };
 
 std::vector<std::reference_wrapper<Category>>& get();
@@ -280,6 +299,15 @@ inline MessageBuilder::MessageBuilder(logstore::Category const& cat, source_loca
 {
 }
 
+template <typename... Args>
+inline MessageBuilder& MessageBuilder::append(std::string_view msg, Args... args)
+{
+    // Do not pay for formatting messages that nobody is going to see.
+    if (_category.is_enabled())
+        _buffer += fmt::format(msg, std::forward<Args>(args)...);
+    return *this;
+}
+
 inline MessageBuilder::~MessageBuilder()
 {
     _category.sink().write(*this);
@@ -324,13 +352,13 @@ inline std::string Category::default_formatter(MessageBuilder const& _message)
 
 inline void Sink::write(MessageBuilder const& _message)
 {
-    if (_message.category().is_enabled())
-        writer_(_message.message());
-}
+    if (!_message.category().is_enabled())
+        return;
 
-inline void Sink::set_writer(Writer _writer)
-{
-    writer_ = std::move(_writer);
+    if (async_)
+        write_async(_message.message());
+    else
+        writer_(_message.message());
 }
 // }}}
 
@@ -0,0 +1,112 @@
+/**
+ * This file is part of the Contour terminal project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <crispy/logstore.h>
+#include <catch2/catch_all.hpp>
+#include <fmt/format.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::string_view;
+
+namespace
+{
+    auto TestLog = logstore::Category("test.logstore", "Logstore unit test.", logstore::Category::State::Enabled);
+
+    struct TestSink
+    {
+        string output;
+        int writes = 0;
+        logstore::Sink sink{true, [this](string_view _text) { output += _text; ++writes; }};
+
+        TestSink() { TestLog.set_sink(sink); }
+        ~TestSink() { TestLog.set_sink(logstore::Sink::console()); }
+    };
+}
+
+TEST_CASE("logstore.sync")
+{
+    auto test = TestSink{};
+    LOGSTORE(TestLog)("Hello {}", 42);
+    CHECK(test.output == "Hello 42\n");
+    CHECK(test.writes == 1);
+}
+
+TEST_CASE("logstore.disabled_skips_formatting")
+{
+    auto test = TestSink{};
+    TestLog.disable();
+    auto builder = LOGSTORE(TestLog)("Hello {}", 42);
+    CHECK(builder.text().empty());
+    TestLog.enable();
+}
+
+TEST_CASE("logstore.async")
+{
+    auto test = TestSink{};
+    TestLog.set_formatter([](logstore::MessageBuilder const& _msg) { return _msg.text() + '\n'; });
+    test.sink.set_async(true);
+
+    auto constexpr ThreadCount = 4;
+    auto constexpr MessageCount = 5000;
+    auto threads = std::vector<std::thread>{};
+    for (int t = 0; t < ThreadCount; ++t)
+        threads.emplace_back([t]() {
+            for (int i = 0; i < MessageCount; ++i)
+                LOGSTORE(TestLog)("{}:{}", t, i);
+        });
+    for (auto& thread: threads)
+        thread.join();
+
+    test.sink.set_async(false);
+    TestLog.set_formatter({});
+
+    // Nothing lost, and each thread's messages in order.
+    auto lastSeen = std::vector<int>(ThreadCount, -1);
+    auto lines = 0;
+    auto input = std::istringstream(test.output);
+    for (string line; std::getline(input, line); ++lines)
+    {
+        auto const colon = line.find(':');
+        auto const t = std::stoi(line.substr(0, colon));
+        auto const i = std::stoi(line.substr(colon + 1));
+        CHECK(i == lastSeen.at(t) + 1);
+        lastSeen[t] = i;
+    }
+    CHECK(lines == ThreadCount * MessageCount);
+    CHECK(test.writes < lines); // written in batches
+}
+
+TEST_CASE("logstore.flight_recorder")
+{
+    auto test = TestSink{};
+    TestLog.set_formatter([](logstore::MessageBuilder const& _msg) { return _msg.text() + '\n'; });
+    test.sink.set_flight_recorder(100);
+
+    for (int i = 0; i < 1000; ++i)
+        LOGSTORE(TestLog)("message {:04}", i);
+
+    auto dump = std::ostringstream{};
+    test.sink.dump_flight_recorder(dump);
+    test.sink.set_async(false);
+    TestLog.set_formatter({});
+
+    // Only the most recent messages are kept, and none are written.
+    CHECK(test.output.empty());
+    CHECK(dump.str() == "message 0993\nmessage 0994\nmessage 0995\nmessage 0996\n"
+                        "message 0997\nmessage 0998\nmessage 0999\n");
+}
@@ -0,0 +1,530 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <daemon/Client.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace terminal;
+using namespace terminal::mux;
+
+namespace contour::daemon {
+
+namespace // {{{ helper
+{
+    [[noreturn]] void throwErrno(char const* _what)
+    {
+        throw system_error(errno, system_category(), _what);
+    }
+
+    void writeAll(int _fd, string_view _data)
+    {
+        while (!_data.empty())
+        {
+            auto const n = ::write(_fd, _data.data(), _data.size());
+            if (n == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                throwErrno("write");
+            }
+            _data.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+
+    int connectSocket(FileSystem::path const& _path)
+    {
+        auto address = sockaddr_un{};
+        address.sun_family = AF_UNIX;
+        auto const path = _path.string();
+        if (path.size() >= sizeof(address.sun_path))
+            throw system_error(make_error_code(errc::filename_too_long), path);
+        std::copy(path.begin(), path.end(), address.sun_path);
+
+        auto const fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+            throwErrno("socket");
+        if (::connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == -1)
+        {
+            auto const error = errno;
+            ::close(fd);
+            throw system_error(error, system_category(), path);
+        }
+        return fd;
+    }
+
+    /// Runs @p _command with its standard input and output connected to the returned descriptor.
+    int spawnCommand(string const& _command)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+            throwErrno("socketpair");
+
+        auto const pid = fork();
+        if (pid == -1)
+            throwErrno("fork");
+
+        if (pid == 0)
+        {
+            dup2(fds[1], STDIN_FILENO);
+            dup2(fds[1], STDOUT_FILENO);
+            execl("/bin/sh", "sh", "-c", _command.c_str(), nullptr);
+            _exit(127);
+        }
+
+        ::close(fds[1]);
+        return fds[0];
+    }
+
+    PageSize terminalSize()
+    {
+        auto ws = winsize{};
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || !ws.ws_row || !ws.ws_col)
+            return PageSize{LineCount(25), ColumnCount(80)};
+        return PageSize{LineCount(ws.ws_row), ColumnCount(ws.ws_col)};
+    }
+
+    string pageSizePayload(PageSize _pageSize)
+    {
+        auto payload = string{};
+        auto writer = WireWriter(payload);
+        writer.varuint(_pageSize.lines.as<uint64_t>());
+        writer.varuint(_pageSize.columns.as<uint64_t>());
+        return payload;
+    }
+
+    [[noreturn]] void throwServerError(Message const& _message)
+    {
+        auto reader = WireReader(_message.payload);
+        throw runtime_error(fmt::format("Server error: {}", reader.bytes()));
+    }
+
+    int winchPipe_[2] = { -1, -1 };
+
+    void onWindowChanged(int)
+    {
+        auto const savedErrno = errno;
+        char const ch = 0;
+        auto const _ = ::write(winchPipe_[1], &ch, 1);
+        (void) _;
+        errno = savedErrno;
+    }
+
+    // {{{ rendering
+    void appendColor(string& _out, Color _color, unsigned _base, unsigned _brightBase)
+    {
+        switch (_color.type)
+        {
+            case ColorType::Bright:
+                _out += fmt::format(";{}", _brightBase + _color.index);
+                break;
+            case ColorType::Indexed:
+                if (_color.index < 8)
+                    _out += fmt::format(";{}", _base + _color.index);
+                else
+                    _out += fmt::format(";{};5;{}", _base + 8, _color.index);
+                break;
+            case ColorType::RGB:
+                _out += fmt::format(";{};2;{};{};{}", _base + 8, _color.rgb.red, _color.rgb.green, _color.rgb.blue);
+                break;
+            case ColorType::Undefined:
+            case ColorType::Default:
+                break;
+        }
+    }
+
+    string sgr(GraphicsAttributes const& _attributes)
+    {
+        static constexpr auto styles = std::array<pair<CellFlags, char const*>, 15>{{
+            { CellFlags::Bold, "1" },
+            { CellFlags::Faint, "2" },
+            { CellFlags::Italic, "3" },
+            { CellFlags::Underline, "4" },
+            { CellFlags::Blinking, "5" },
+            { CellFlags::Inverse, "7" },
+            { CellFlags::Hidden, "8" },
+            { CellFlags::CrossedOut, "9" },
+            { CellFlags::DoublyUnderlined, "4:2" },
+            { CellFlags::CurlyUnderlined, "4:3" },
+            { CellFlags::DottedUnderline, "4:4" },
+            { CellFlags::DashedUnderline, "4:5" },
+            { CellFlags::Framed, "51" },
+            { CellFlags::Encircled, "52" },
+            { CellFlags::Overline, "53" },
+        }};
+
+        auto out = string("\033[0");
+        for (auto const& [flag, code]: styles)
+            if (_attributes.styles & flag)
+                out += fmt::format(";{}", code);
+        appendColor(out, _attributes.foregroundColor, 30, 90);
+        appendColor(out, _attributes.backgroundColor, 40, 100);
+        if (_attributes.underlineColor.type == ColorType::Indexed
+            || _attributes.underlineColor.type == ColorType::RGB)
+            appendColor(out, _attributes.underlineColor, 50, 50);
+        out += 'm';
+        return out;
+    }
+
+    bool isBlank(Cell const& _cell) noexcept
+    {
+        return _cell.empty() && isDefaultColor(_cell.attributes().backgroundColor)
+            && !(_cell.attributes().styles & CellFlags::Inverse);
+    }
+
+    /// Draws a line of the replica onto the given (1-based) row of the local terminal.
+    void renderLine(string& _out, int _row, Line const& _line)
+    {
+        _out += fmt::format("\033[{}H", _row);
+
+        // Trailing blank cells are cleared rather than written.
+        auto end = unbox<size_t>(_line.size());
+        while (end > 0 && isBlank(_line[end - 1]))
+            --end;
+
+        auto lastSGR = string{};
+        for (size_t column = 0; column < end; )
+        {
+            auto const& cell = _line[column];
+            if (auto s = sgr(cell.attributes()); s != lastSGR)
+            {
+                _out += s;
+                lastSGR = std::move(s);
+            }
+            _out += cell.toUtf8();
+            column += static_cast<size_t>(std::max(cell.width(), 1));
+        }
+        _out += "\033[m\033[K";
+    }
+
+    void renderCursor(string& _out, FrameCursor const& _cursor)
+    {
+        auto const shape = [&]() {
+            switch (_cursor.shape)
+            {
+                case CursorShape::Underscore: return 4;
+                case CursorShape::Bar: return 6;
+                case CursorShape::Block:
+                case CursorShape::Rectangle: break;
+            }
+            return 2;
+        }();
+        _out += fmt::format("\033[{} q\033[{};{}H", shape, _cursor.position.row, _cursor.position.column);
+        _out += _cursor.visible ? "\033[?25h" : "\033[?25l";
+    }
+    // }}}
+
+    /// Puts the controlling terminal into raw mode and onto its alternate screen while alive.
+    class RawTerminal
+    {
+      public:
+        RawTerminal()
+        {
+            if (tcgetattr(STDIN_FILENO, &saved_) == -1)
+                throwErrno("tcgetattr");
+            auto raw = saved_;
+            cfmakeraw(&raw);
+            if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1)
+                throwErrno("tcsetattr");
+            writeAll(STDOUT_FILENO, "\033[?1049h\033[H\033[2J");
+        }
+
+        ~RawTerminal()
+        {
+            auto constexpr restore = string_view("\033[m\033[0 q\033[?25h\033[?1049l");
+            auto const _ = ::write(STDOUT_FILENO, restore.data(), restore.size());
+            (void) _;
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_);
+        }
+
+      private:
+        termios saved_{};
+    };
+} // }}}
+
+// {{{ Connection
+Connection::Connection(ClientSettings const& _settings):
+    fd_{ _settings.command.empty() ? connectSocket(_settings.socketPath) : spawnCommand(_settings.command) }
+{
+    auto payload = string{};
+    WireWriter(payload).varuint(ProtocolVersion);
+    send(MessageType::Hello, payload);
+
+    auto const reply = receive();
+    if (reply.type == MessageType::Error)
+        throwServerError(reply);
+    if (reply.type != MessageType::Welcome)
+        throw runtime_error("Unexpected reply from server.");
+}
+
+Connection::~Connection()
+{
+    ::close(fd_);
+}
+
+void Connection::send(MessageType _type, string_view _payload)
+{
+    writeAll(fd_, encodeMessage(_type, _payload));
+}
+
+bool Connection::read()
+{
+    char buf[65536];
+    for (;;)
+    {
+        auto const n = ::read(fd_, buf, sizeof(buf));
+        if (n > 0)
+        {
+            decoder_.feed(string_view(buf, static_cast<size_t>(n)));
+            return true;
+        }
+        if (n == -1 && errno == EINTR)
+            continue;
+        return false;
+    }
+}
+
+optional<Message> Connection::next()
+{
+    auto message = decoder_.next();
+    if (!message && decoder_.failed())
+        throw runtime_error("Malformed message from server.");
+    return message;
+}
+
+Message Connection::receive()
+{
+    for (;;)
+    {
+        if (auto message = next(); message)
+            return std::move(*message);
+        if (!read())
+            throw runtime_error("Connection to server closed.");
+    }
+}
+// }}}
+
+int listSessions(ClientSettings const& _settings)
+{
+    auto connection = Connection(_settings);
+    connection.send(MessageType::ListSessions);
+    auto const reply = connection.receive();
+    if (reply.type == MessageType::Error)
+        throwServerError(reply);
+
+    auto reader = WireReader(reply.payload);
+    auto const count = reader.varuint();
+    for (uint64_t i = 0; i < count && !reader.failed(); ++i)
+    {
+        auto const id = reader.varuint();
+        auto const lines = reader.varuint();
+        auto const columns = reader.varuint();
+        auto const title = reader.bytes();
+        cout << fmt::format("{:>4}: {}x{} {}\n", id, columns, lines, title);
+    }
+    return EXIT_SUCCESS;
+}
+
+int attachSession(ClientSettings const& _settings, uint64_t _session, char _detachKey)
+{
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+    {
+        cerr << "Attaching requires a terminal.\n";
+        return EXIT_FAILURE;
+    }
+
+    auto connection = Connection(_settings);
+
+    if (pipe(winchPipe_) == -1)
+        throwErrno("pipe");
+    fcntl(winchPipe_[0], F_SETFL, O_NONBLOCK);
+    fcntl(winchPipe_[1], F_SETFL, O_NONBLOCK);
+    signal(SIGWINCH, &onWindowChanged);
+
+    auto pageSize = terminalSize();
+    auto payload = string{};
+    WireWriter(payload).varuint(_session);
+    payload += pageSizePayload(pageSize);
+    connection.send(MessageType::Attach, payload);
+
+    auto rawTerminal = optional<RawTerminal>(in_place);
+    auto replica = ScreenReplica{};
+    auto exitMessage = string{};
+    auto output = string{};
+
+    for (bool running = true; running; )
+    {
+        auto fds = std::array<pollfd, 3>{{
+            { STDIN_FILENO, POLLIN, 0 },
+            { connection.fd(), POLLIN, 0 },
+            { winchPipe_[0], POLLIN, 0 },
+        }};
+        if (::poll(fds.data(), fds.size(), -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            throwErrno("poll");
+        }
+
+        if (fds[2].revents & POLLIN)
+        {
+            char buf[64];
+            while (::read(winchPipe_[0], buf, sizeof(buf)) > 0)
+                ;
+            if (auto const newPageSize = terminalSize(); newPageSize != pageSize)
+            {
+                pageSize = newPageSize;
+                connection.send(MessageType::Resize, pageSizePayload(pageSize));
+            }
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP))
+        {
+            char buf[4096];
+            auto const n = ::read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0)
+                break;
+            auto input = string_view(buf, static_cast<size_t>(n));
+            auto const detach = input.find(_detachKey);
+            if (detach != string_view::npos)
+                input = input.substr(0, detach);
+            if (!input.empty())
+            {
+                auto message = string{};
+                WireWriter(message).bytes(input);
+                connection.send(MessageType::Input, message);
+            }
+            if (detach != string_view::npos)
+            {
+                connection.send(MessageType::Detach);
+                exitMessage = "Detached.";
+                break;
+            }
+        }
+
+        if (fds[1].revents & (POLLIN | POLLHUP))
+        {
+            if (!connection.read())
+            {
+                exitMessage = "Connection to server closed.";
+                break;
+            }
+
+            while (running)
+            {
+                auto const message = connection.next();
+                if (!message)
+                    break;
+
+                switch (message->type)
+                {
+                    case MessageType::Frame:
+                        if (auto const frame = replica.applyFrame(message->payload); frame)
+                        {
+                            output += "\033[?25l";
+                            if (frame->full)
+                                output += "\033[m\033[H\033[2J";
+                            for (auto const& [row, line]: frame->lines)
+                                renderLine(output, row + 1, line.line);
+                            renderCursor(output, replica.cursor());
+                        }
+                        break;
+                    case MessageType::SessionClosed:
+                        exitMessage = "Session closed.";
+                        running = false;
+                        break;
+                    case MessageType::Error:
+                        exitMessage = fmt::format("Server error: {}", WireReader(message->payload).bytes());
+                        running = false;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            writeAll(STDOUT_FILENO, output);
+            output.clear();
+        }
+    }
+
+    signal(SIGWINCH, SIG_DFL);
+    rawTerminal.reset();
+    if (!exitMessage.empty())
+        cerr << exitMessage << '\n';
+    return EXIT_SUCCESS;
+}
+
+int proxy(FileSystem::path const& _socketPath)
+{
+    auto const fd = connectSocket(_socketPath);
+    auto closed = std::array<bool, 2>{ false, false };
+    char buf[65536];
+
+    while (!closed[0] || !closed[1])
+    {
+        auto fds = std::array<pollfd, 2>{{
+            { closed[0] ? -1 : STDIN_FILENO, POLLIN, 0 },
+            { closed[1] ? -1 : fd, POLLIN, 0 },
+        }};
+        if (::poll(fds.data(), fds.size(), -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            throwErrno("poll");
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP))
+        {
+            auto const n = ::read(STDIN_FILENO, buf, sizeof(buf));
+            if (n > 0)
+                writeAll(fd, string_view(buf, static_cast<size_t>(n)));
+            else if (n == 0 || errno != EINTR)
+            {
+                closed[0] = true;
+                shutdown(fd, SHUT_WR);
+            }
+        }
+
+        if (fds[1].revents & (POLLIN | POLLHUP))
+        {
+            auto const n = ::read(fd, buf, sizeof(buf));
+            if (n > 0)
+                writeAll(STDOUT_FILENO, string_view(buf, static_cast<size_t>(n)));
+            else if (n == 0 || errno != EINTR)
+                break; // nothing more to relay once the server hung up
+        }
+    }
+
+    ::close(fd);
+    return EXIT_SUCCESS;
+}
+
+} // end namespace
@@ -0,0 +1,83 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/MuxProtocol.h>
+
+#include <crispy/stdfs.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace contour::daemon {
+
+struct ClientSettings
+{
+    FileSystem::path socketPath;
+
+    /// If not empty, a shell command whose standard input and output are connected
+    /// to the server instead of the socket, such as "ssh HOST contour-daemon proxy".
+    std::string command;
+};
+
+/// A client's connection to the server, speaking the protocol in terminal/MuxProtocol.h.
+class Connection
+{
+  public:
+    /// Connects to the server and exchanges the protocol version.
+    ///
+    /// @throws std::system_error if the server cannot be reached.
+    /// @throws std::runtime_error if the server does not speak the protocol.
+    explicit Connection(ClientSettings const& _settings);
+    ~Connection();
+
+    Connection(Connection const&) = delete;
+    Connection& operator=(Connection const&) = delete;
+
+    int fd() const noexcept { return fd_; }
+
+    void send(terminal::mux::MessageType _type, std::string_view _payload = {});
+
+    /// Reads whatever is available without waiting for more.
+    ///
+    /// @returns false if the server closed the connection.
+    bool read();
+
+    /// @returns the next message read already, if any.
+    std::optional<terminal::mux::Message> next();
+
+    /// @returns the next message, waiting for it if needed.
+    ///
+    /// @throws std::runtime_error if the connection closed before.
+    terminal::mux::Message receive();
+
+  private:
+    int fd_ = -1;
+    terminal::mux::MessageDecoder decoder_;
+};
+
+/// Prints the server's sessions.
+int listSessions(ClientSettings const& _settings);
+
+/// Attaches the controlling terminal to the given session (or a new one if 0),
+/// until the session closes or @p _detachKey is pressed.
+int attachSession(ClientSettings const& _settings, uint64_t _session, char _detachKey);
+
+/// Relays standard input and output to the server's socket, making the server reachable
+/// through anything that runs a command, such as SSH.
+int proxy(FileSystem::path const& _socketPath);
+
+} // end namespace
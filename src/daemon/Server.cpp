@@ -0,0 +1,578 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <daemon/Server.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace terminal;
+using namespace terminal::mux;
+
+namespace contour::daemon {
+
+namespace // {{{ helper
+{
+    /// Clients whose outbox grows beyond this do not get new frames until they caught up.
+    /// As frames are diffs against what was sent last, skipped frames cost nothing.
+    constexpr size_t MaxPendingOutput = 1024 * 1024;
+
+    [[noreturn]] void throwErrno(char const* _what)
+    {
+        throw system_error(errno, system_category(), _what);
+    }
+
+    void setNonBlocking(int _fd)
+    {
+        auto const flags = fcntl(_fd, F_GETFL);
+        if (flags == -1 || fcntl(_fd, F_SETFL, flags | O_NONBLOCK) == -1)
+            throwErrno("fcntl");
+    }
+
+    void setCloseOnExec(int _fd)
+    {
+        auto const flags = fcntl(_fd, F_GETFD);
+        if (flags == -1 || fcntl(_fd, F_SETFD, flags | FD_CLOEXEC) == -1)
+            throwErrno("fcntl");
+    }
+
+    sockaddr_un socketAddress(FileSystem::path const& _path)
+    {
+        auto address = sockaddr_un{};
+        address.sun_family = AF_UNIX;
+        auto const path = _path.string();
+        if (path.size() >= sizeof(address.sun_path))
+            throw system_error(make_error_code(errc::filename_too_long), path);
+        std::copy(path.begin(), path.end(), address.sun_path);
+        return address;
+    }
+
+    /// @returns true if a server is accepting connections on the given socket.
+    bool socketAlive(sockaddr_un const& _address)
+    {
+        auto const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            return false;
+        auto const alive = ::connect(fd, reinterpret_cast<sockaddr const*>(&_address), sizeof(_address)) == 0;
+        ::close(fd);
+        return alive;
+    }
+
+    string sessionSize(PageSize _size)
+    {
+        auto payload = string{};
+        auto writer = WireWriter(payload);
+        writer.varuint(_size.lines.as<uint64_t>());
+        writer.varuint(_size.columns.as<uint64_t>());
+        return payload;
+    }
+
+    optional<PageSize> pageSizeOf(WireReader& _reader)
+    {
+        auto const lines = _reader.varuint();
+        auto const columns = _reader.varuint();
+        if (_reader.failed() || lines == 0 || columns == 0 || lines > 1000 || columns > 1000)
+            return nullopt;
+        return PageSize{LineCount::cast_from(lines), ColumnCount::cast_from(columns)};
+    }
+} // }}}
+
+FileSystem::path defaultSocketPath()
+{
+    if (auto const runtimeDir = getenv("XDG_RUNTIME_DIR"); runtimeDir && *runtimeDir)
+        return FileSystem::path(runtimeDir) / "contour" / "daemon.sock";
+
+    return FileSystem::temp_directory_path() / fmt::format("contour-{}", getuid()) / "daemon.sock";
+}
+
+// {{{ Session
+class Server::Session: public Terminal::Events
+{
+  public:
+    Session(Server& _server, uint64_t _id, PageSize _pageSize):
+        server_{ _server },
+        id_{ _id },
+        pty_{ _server.settings_.shell, _pageSize },
+        terminal_{ make_unique<Terminal>(pty_, 16384, *this, _server.settings_.maxHistoryLineCount) }
+    {
+        // Nobody consumes the render buffer, so don't let the terminal wake up for refreshing it.
+        terminal_->setRefreshRate(1.0);
+        terminal_->setMemoryBudget(_server.settings_.memoryBudget);
+        terminal_->start(_server.reactor_);
+    }
+
+    ~Session() override
+    {
+        // Stop processing its output first, then hang up the shell by closing the PTY.
+        terminal_.reset();
+        pty_.close();
+        pty_.waitForProcessExit();
+    }
+
+    uint64_t id() const noexcept { return id_; }
+    Terminal& terminal() noexcept { return *terminal_; }
+    bool closed() const noexcept { return closed_; }
+
+    /// @returns whether the screen was updated since the previous call.
+    bool takeUpdate() noexcept { return updated_.exchange(false); }
+
+    string title() const
+    {
+        auto const _l = lock_guard{*terminal_};
+        return terminal_->screen().windowTitle();
+    }
+
+    PageSize pageSize() const noexcept { return pty_.screenSize(); }
+
+    // Terminal::Events overrides, invoked on the I/O reactor's threads.
+    void screenUpdated() override { updated_ = true; server_.wakeup(); }
+    void bufferChanged(ScreenType) override { screenUpdated(); }
+    void onClosed() override { closed_ = true; server_.wakeup(); }
+
+  private:
+    Server& server_;
+    uint64_t const id_;
+    PtyProcess pty_;
+    std::unique_ptr<Terminal> terminal_;
+    std::atomic<bool> updated_ = true;
+    std::atomic<bool> closed_ = false;
+};
+// }}}
+
+Server::Server(ServerSettings _settings):
+    settings_{ std::move(_settings) },
+    reactor_{ settings_.workerCount }
+{
+    if (pipe(wakeupPipe_) == -1)
+        throwErrno("pipe");
+    for (auto const fd: wakeupPipe_)
+    {
+        setNonBlocking(fd);
+        setCloseOnExec(fd);
+    }
+}
+
+Server::~Server()
+{
+    for (auto& client: clients_)
+        ::close(client.fd);
+    clients_.clear();
+    sessions_.clear();
+
+    if (listener_ != -1)
+    {
+        ::close(listener_);
+        FileSystem::remove(settings_.socketPath);
+    }
+    for (auto const fd: wakeupPipe_)
+        ::close(fd);
+}
+
+void Server::stop() noexcept
+{
+    running_ = false;
+    wakeup();
+}
+
+void Server::wakeup() noexcept
+{
+    char const ch = 0;
+    auto const _ = ::write(wakeupPipe_[1], &ch, 1);
+    (void) _;
+}
+
+void Server::listen()
+{
+    auto const address = socketAddress(settings_.socketPath);
+    auto const directory = settings_.socketPath.parent_path();
+    // Only a directory created for the socket is restricted to its owner, never an existing one.
+    if (!directory.empty() && FileSystem::create_directories(directory))
+        FileSystem::permissions(directory, FileSystem::perms::owner_all);
+
+    if (FileSystem::exists(settings_.socketPath))
+    {
+        if (socketAlive(address))
+            throw system_error(make_error_code(errc::address_in_use), settings_.socketPath.string());
+        FileSystem::remove(settings_.socketPath); // left over by a crashed server
+    }
+
+    listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener_ == -1)
+        throwErrno("socket");
+    setNonBlocking(listener_);
+    setCloseOnExec(listener_);
+
+    auto const oldMask = umask(0077);
+    auto const bound = ::bind(listener_, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == 0;
+    umask(oldMask);
+    if (!bound)
+        throwErrno("bind");
+
+    if (::listen(listener_, 16) == -1)
+        throwErrno("listen");
+
+    LOGSTORE(DaemonLog)("Listening on {}.", settings_.socketPath.string());
+}
+
+void Server::run()
+{
+    listen();
+    running_ = true;
+
+    auto fds = vector<pollfd>{};
+    auto timeout = chrono::milliseconds(-1);
+    while (running_)
+    {
+        fds.clear();
+        fds.push_back(pollfd{ wakeupPipe_[0], POLLIN, 0 });
+        fds.push_back(pollfd{ listener_, POLLIN, 0 });
+        for (auto const& client: clients_)
+            fds.push_back(pollfd{ client.fd,
+                                  static_cast<short>(POLLIN | (client.outbox.empty() ? 0 : POLLOUT)),
+                                  0 });
+
+        if (::poll(fds.data(), fds.size(), static_cast<int>(timeout.count())) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            throwErrno("poll");
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            char buf[64];
+            while (::read(wakeupPipe_[0], buf, sizeof(buf)) > 0)
+                ;
+        }
+
+        if (fds[1].revents & POLLIN)
+            acceptClient();
+
+        auto pollIndex = size_t{2};
+        for (auto i = clients_.begin(); i != clients_.end() && pollIndex < fds.size(); ++pollIndex)
+        {
+            auto const events = fds[pollIndex].revents;
+            auto alive = !(events & (POLLERR | POLLNVAL));
+            if (alive && (events & (POLLIN | POLLHUP)))
+                alive = readFrom(*i);
+            if (alive && (events & POLLOUT))
+                alive = writeTo(*i);
+
+            if (alive)
+                ++i;
+            else
+            {
+                LOGSTORE(DaemonLog)("Client {} disconnected.", i->fd);
+                ::close(i->fd);
+                i = clients_.erase(i);
+            }
+        }
+
+        reapSessions();
+        timeout = flushFrames();
+    }
+}
+
+void Server::acceptClient()
+{
+    for (;;)
+    {
+        auto const fd = ::accept(listener_, nullptr, nullptr);
+        if (fd == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                LOGSTORE(DaemonLog)("accept failed. {}", strerror(errno));
+            return;
+        }
+        setNonBlocking(fd);
+        setCloseOnExec(fd);
+        clients_.emplace_back().fd = fd;
+        LOGSTORE(DaemonLog)("Client {} connected.", fd);
+    }
+}
+
+bool Server::readFrom(Client& _client)
+{
+    char buf[16384];
+    for (;;)
+    {
+        auto const n = ::read(_client.fd, buf, sizeof(buf));
+        if (n > 0)
+        {
+            _client.decoder.feed(string_view(buf, static_cast<size_t>(n)));
+            continue;
+        }
+        if (n == 0)
+            return false;
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return false;
+        break;
+    }
+
+    while (auto const message = _client.decoder.next())
+        if (!handleMessage(_client, *message))
+            return false;
+
+    return !_client.decoder.failed();
+}
+
+bool Server::writeTo(Client& _client)
+{
+    while (!_client.outbox.empty())
+    {
+        auto const n = ::send(_client.fd, _client.outbox.data(), _client.outbox.size(), MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        _client.outbox.erase(0, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+void Server::send(Client& _client, MessageType _type, string_view _payload)
+{
+    _client.outbox += encodeMessage(_type, _payload);
+}
+
+void Server::fail(Client& _client, string_view _text)
+{
+    auto payload = string{};
+    WireWriter(payload).bytes(_text);
+    send(_client, MessageType::Error, payload);
+    (void) writeTo(_client);
+}
+
+bool Server::handleMessage(Client& _client, Message const& _message)
+{
+    auto reader = WireReader(_message.payload);
+
+    if (!_client.greeted && _message.type != MessageType::Hello)
+    {
+        fail(_client, "Expected Hello.");
+        return false;
+    }
+
+    switch (_message.type)
+    {
+        case MessageType::Hello:
+        {
+            auto const version = reader.varuint();
+            if (version != ProtocolVersion)
+            {
+                fail(_client, fmt::format("Unsupported protocol version {} (expected {}).", version, ProtocolVersion));
+                return false;
+            }
+            _client.greeted = true;
+            auto payload = string{};
+            WireWriter(payload).varuint(ProtocolVersion);
+            send(_client, MessageType::Welcome, payload);
+            return true;
+        }
+        case MessageType::ListSessions:
+        {
+            auto payload = string{};
+            auto writer = WireWriter(payload);
+            writer.varuint(sessions_.size());
+            for (auto const& [id, session]: sessions_)
+            {
+                writer.varuint(id);
+                payload += sessionSize(session->pageSize());
+                writer.bytes(session->title());
+            }
+            send(_client, MessageType::SessionList, payload);
+            return true;
+        }
+        case MessageType::Attach:
+        {
+            auto const id = reader.varuint();
+            auto const pageSize = pageSizeOf(reader);
+            if (!pageSize)
+            {
+                fail(_client, "Invalid page size.");
+                return false;
+            }
+
+            auto* session = id ? findSession(id) : createSession(*pageSize);
+            if (!session)
+            {
+                fail(_client, fmt::format("No session {}.", id));
+                return false;
+            }
+
+            // The most recently attached client decides the size.
+            if (id && session->pageSize() != *pageSize)
+                session->terminal().resizeScreen(*pageSize, nullopt);
+
+            _client.session = session;
+            _client.encoder = FrameEncoder{};
+            _client.framePending = true;
+
+            auto payload = string{};
+            WireWriter(payload).varuint(session->id());
+            send(_client, MessageType::Attached, payload);
+            LOGSTORE(DaemonLog)("Client {} attached to session {}.", _client.fd, session->id());
+            return true;
+        }
+        case MessageType::Detach:
+            (void) writeTo(_client);
+            return false;
+        default:
+            break;
+    }
+
+    if (!_client.session)
+    {
+        fail(_client, "Not attached to a session.");
+        return false;
+    }
+
+    auto& terminal = _client.session->terminal();
+    switch (_message.type)
+    {
+        case MessageType::Input:
+            terminal.sendRaw(reader.bytes());
+            break;
+        case MessageType::Resize:
+            if (auto const pageSize = pageSizeOf(reader); pageSize && *pageSize != _client.session->pageSize())
+                terminal.resizeScreen(*pageSize, nullopt);
+            break;
+        case MessageType::RequestRedraw:
+            _client.encoder.invalidate();
+            _client.framePending = true;
+            break;
+        case MessageType::RequestHistory:
+        {
+            auto const beforeSerial = reader.varuint();
+            auto const count = reader.varuint();
+            auto const _l = lock_guard{terminal};
+            send(_client, MessageType::HistoryLines,
+                 _client.encoder.encodeHistory(terminal, beforeSerial, static_cast<size_t>(count)));
+            break;
+        }
+        case MessageType::RequestImage:
+            send(_client, MessageType::ImageData, _client.encoder.encodeImage(reader.varuint()));
+            break;
+        default:
+            fail(_client, fmt::format("Unexpected message type {}.", static_cast<unsigned>(_message.type)));
+            return false;
+    }
+
+    return !reader.failed();
+}
+
+Server::Session* Server::createSession(PageSize _pageSize)
+{
+    auto const id = nextSessionId_++;
+    auto session = make_unique<Session>(*this, id, _pageSize);
+    LOGSTORE(DaemonLog)("Created session {} ({}).", id, _pageSize);
+    return sessions_.emplace(id, std::move(session)).first->second.get();
+}
+
+Server::Session* Server::findSession(uint64_t _id)
+{
+    if (auto const i = sessions_.find(_id); i != sessions_.end())
+        return i->second.get();
+    return nullptr;
+}
+
+void Server::reapSessions()
+{
+    for (auto i = sessions_.begin(); i != sessions_.end(); )
+    {
+        auto* session = i->second.get();
+        if (!session->closed())
+        {
+            ++i;
+            continue;
+        }
+
+        // Send out what the shell printed last, then let the clients know.
+        auto payload = string{};
+        WireWriter(payload).varuint(session->id());
+        for (auto& client: clients_)
+        {
+            if (client.session != session)
+                continue;
+            auto const _l = lock_guard{session->terminal()};
+            if (auto const frame = client.encoder.encodeFrame(session->terminal()); frame)
+                send(client, MessageType::Frame, *frame);
+            send(client, MessageType::SessionClosed, payload);
+            client.session = nullptr;
+            client.framePending = false;
+        }
+
+        LOGSTORE(DaemonLog)("Session {} closed.", session->id());
+        i = sessions_.erase(i);
+    }
+}
+
+chrono::milliseconds Server::flushFrames()
+{
+    for (auto const& [id, session]: sessions_)
+        if (session->takeUpdate())
+            for (auto& client: clients_)
+                if (client.session == session.get())
+                    client.framePending = true;
+
+    // Frames are rate limited per client, so a flood of output is coalesced.
+    auto timeout = chrono::milliseconds(-1);
+    auto const now = chrono::steady_clock::now();
+    for (auto& client: clients_)
+    {
+        if (!client.framePending || client.outbox.size() > MaxPendingOutput)
+            continue;
+
+        auto const due = client.lastFrame + settings_.frameInterval;
+        if (now < due)
+        {
+            auto const wait = chrono::ceil<chrono::milliseconds>(due - now);
+            timeout = timeout.count() < 0 ? wait : std::min(timeout, wait);
+            continue;
+        }
+
+        auto& terminal = client.session->terminal();
+        auto frame = [&]() {
+            auto const _l = lock_guard{terminal};
+            return client.encoder.encodeFrame(terminal);
+        }();
+        client.framePending = false;
+        if (!frame)
+            continue;
+
+        client.lastFrame = now;
+        send(client, MessageType::Frame, *frame);
+        (void) writeTo(client);
+    }
+    return timeout;
+}
+
+} // end namespace
@@ -0,0 +1,115 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/IOReactor.h>
+#include <terminal/MuxProtocol.h>
+#include <terminal/Process.h>
+#include <terminal/Terminal.h>
+#include <terminal/pty/PtyProcess.h>
+
+#include <crispy/logstore.h>
+#include <crispy/stdfs.h>
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace contour::daemon {
+
+auto const inline DaemonLog = logstore::Category("daemon", "Logs contour-daemon events.");
+
+/// @returns the socket path used when none is given explicitly.
+FileSystem::path defaultSocketPath();
+
+struct ServerSettings
+{
+    FileSystem::path socketPath;
+    terminal::Process::ExecInfo shell;
+    terminal::LineCount maxHistoryLineCount = terminal::LineCount(100000);
+    std::optional<size_t> memoryBudget; //!< per session, in bytes
+    std::chrono::milliseconds frameInterval = std::chrono::milliseconds(16);
+    size_t workerCount = 2;
+};
+
+/**
+ * Owns terminal sessions (a shell on a headless Terminal each) and serves them to clients
+ * connecting to a local socket, speaking the protocol in terminal/MuxProtocol.h.
+ *
+ * PTY input of all sessions is processed on a shared I/O reactor, whereas accepting
+ * clients, handling their requests and encoding their frames happens on the thread
+ * calling run().
+ */
+class Server
+{
+  public:
+    explicit Server(ServerSettings _settings);
+    ~Server();
+
+    Server(Server const&) = delete;
+    Server& operator=(Server const&) = delete;
+
+    /// Serves clients until stop() is called.
+    ///
+    /// @throws std::system_error if the socket cannot be set up.
+    void run();
+
+    /// Makes run() return. Safe to call from a signal handler.
+    void stop() noexcept;
+
+  private:
+    class Session;
+
+    struct Client
+    {
+        int fd = -1;
+        terminal::mux::MessageDecoder decoder{};
+        std::string outbox{};
+        bool greeted = false;
+        Session* session = nullptr;
+        terminal::mux::FrameEncoder encoder{};
+        bool framePending = false;
+        std::chrono::steady_clock::time_point lastFrame{};
+    };
+
+    void listen();
+    void wakeup() noexcept;
+    void acceptClient();
+    bool readFrom(Client& _client);
+    bool writeTo(Client& _client);
+    bool handleMessage(Client& _client, terminal::mux::Message const& _message);
+    void send(Client& _client, terminal::mux::MessageType _type, std::string_view _payload = {});
+    void fail(Client& _client, std::string_view _text);
+
+    Session* createSession(terminal::PageSize _pageSize);
+    Session* findSession(uint64_t _id);
+    void reapSessions();
+    std::chrono::milliseconds flushFrames();
+
+    ServerSettings const settings_;
+    terminal::IOReactor reactor_;
+    int listener_ = -1;
+    int wakeupPipe_[2] = { -1, -1 };
+    std::atomic<bool> running_ = false;
+    uint64_t nextSessionId_ = 1;
+    std::map<uint64_t, std::unique_ptr<Session>> sessions_;
+    std::list<Client> clients_;
+};
+
+} // end namespace
@@ -0,0 +1,180 @@
+/**
+ * This file is part of the "contour" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <daemon/Client.h>
+#include <daemon/Server.h>
+
+#include <terminal/Process.h>
+
+#include <crispy/App.h>
+#include <crispy/CLI.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace std::string_literals;
+
+namespace CLI = crispy::cli;
+
+namespace
+{
+    contour::daemon::Server* runningServer = nullptr;
+
+    void stopServer(int)
+    {
+        if (runningServer)
+            runningServer->stop();
+    }
+
+    /// Ctrl+\ detaches from a session.
+    constexpr char DetachKey = 0x1C;
+}
+
+class ContourDaemonApp: public crispy::App
+{
+public:
+    ContourDaemonApp():
+        App("contour-daemon", "Contour Terminal Multiplexing Daemon", CONTOUR_VERSION_STRING, "Apache-2.0")
+    {
+        using Project = crispy::cli::about::Project;
+        crispy::cli::about::registerProjects(
+            Project{"range-v3", "Boost Software License 1.0", "https://github.com/ericniebler/range-v3"},
+            Project{"fmt", "MIT", "https://github.com/fmtlib/fmt"}
+        );
+        link("contour-daemon.serve", bind(&ContourDaemonApp::serve, this));
+        link("contour-daemon.list", bind(&ContourDaemonApp::list, this));
+        link("contour-daemon.attach", bind(&ContourDaemonApp::attach, this));
+        link("contour-daemon.proxy", bind(&ContourDaemonApp::proxy, this));
+    }
+
+    crispy::cli::Command parameterDefinition() const override
+    {
+        auto const socketOption = CLI::Option{"socket", CLI::Value{""s}, "Server socket path. Defaults to $XDG_RUNTIME_DIR/contour/daemon.sock.", "PATH"};
+        auto const commandOption = CLI::Option{"command", CLI::Value{""s}, "Shell command to reach the server through instead of the socket, such as \"ssh HOST contour-daemon proxy\".", "COMMAND"};
+
+        return CLI::Command{
+            "contour-daemon",
+            "Contour Terminal Emulator " CONTOUR_VERSION_STRING " - https://github.com/contour-terminal/contour/ ;-)",
+            CLI::OptionList{},
+            CLI::CommandList{
+                CLI::Command{"help", "Shows this help and exits."},
+                CLI::Command{"version", "Shows the version and exits."},
+                CLI::Command{"license", "Shows the license, and project URL of the used projects and Contour."},
+                CLI::Command{
+                    "serve",
+                    "Runs the server, keeping terminal sessions alive for clients to attach to.",
+                    CLI::OptionList{
+                        socketOption,
+                        CLI::Option{"shell", CLI::Value{""s}, "Program to run in new sessions. Defaults to the login shell.", "PROGRAM"},
+                        CLI::Option{"term", CLI::Value{"xterm-256color"s}, "Value of TERM in new sessions.", "NAME"},
+                        CLI::Option{"history", CLI::Value{100000u}, "Number of scrollback history lines per session.", "COUNT"},
+                        CLI::Option{"memory-budget", CLI::Value{0u}, "Memory budget per session in megabytes, trimming its history when exceeded. Unlimited if 0.", "MB"},
+                        CLI::Option{"frame-rate", CLI::Value{60u}, "Maximum rate of screen updates sent to each client.", "HZ"},
+                        CLI::Option{"workers", CLI::Value{2u}, "Number of threads processing the sessions' output.", "COUNT"},
+                    }
+                },
+                CLI::Command{"list", "Lists the server's sessions.", CLI::OptionList{socketOption, commandOption}},
+                CLI::Command{
+                    "attach",
+                    "Attaches this terminal to a session. Ctrl+\\ detaches again.",
+                    CLI::OptionList{
+                        socketOption,
+                        commandOption,
+                        CLI::Option{"session", CLI::Value{0u}, "Session to attach to. A new session is created if 0.", "ID"},
+                    }
+                },
+                CLI::Command{
+                    "proxy",
+                    "Relays standard input and output to the server socket, for clients on other hosts.",
+                    CLI::OptionList{socketOption}
+                },
+            }
+        };
+    }
+
+private:
+    FileSystem::path socketPath(string const& _command) const
+    {
+        auto const path = parameters().str("contour-daemon." + _command + ".socket");
+        return path.empty() ? contour::daemon::defaultSocketPath() : FileSystem::path(path);
+    }
+
+    contour::daemon::ClientSettings clientSettings(string const& _command) const
+    {
+        return contour::daemon::ClientSettings{
+            socketPath(_command),
+            parameters().str("contour-daemon." + _command + ".command")
+        };
+    }
+
+    int serve()
+    {
+        auto settings = contour::daemon::ServerSettings{};
+        settings.socketPath = socketPath("serve");
+        if (auto const shell = parameters().str("contour-daemon.serve.shell"); !shell.empty())
+            settings.shell.program = shell;
+        else
+        {
+            auto const loginShell = terminal::Process::loginShell();
+            settings.shell.program = loginShell.front();
+            settings.shell.arguments.assign(loginShell.begin() + 1, loginShell.end());
+        }
+        settings.shell.workingDirectory = terminal::Process::homeDirectory();
+        settings.shell.env["TERM"] = parameters().str("contour-daemon.serve.term");
+        settings.maxHistoryLineCount = terminal::LineCount::cast_from(parameters().uint("contour-daemon.serve.history"));
+        if (auto const memoryBudget = parameters().uint("contour-daemon.serve.memory-budget"); memoryBudget)
+            settings.memoryBudget = size_t{memoryBudget} << 20;
+        if (auto const frameRate = parameters().uint("contour-daemon.serve.frame-rate"); frameRate)
+            settings.frameInterval = chrono::milliseconds(1000 / frameRate);
+        settings.workerCount = max(parameters().uint("contour-daemon.serve.workers"), 1u);
+
+        auto server = contour::daemon::Server(std::move(settings));
+        runningServer = &server;
+        signal(SIGINT, &stopServer);
+        signal(SIGTERM, &stopServer);
+        // Not ignored (which the shells would inherit), just not terminating the server.
+        signal(SIGHUP, [](int) {});
+        signal(SIGPIPE, SIG_IGN);
+
+        server.run();
+
+        runningServer = nullptr;
+        return EXIT_SUCCESS;
+    }
+
+    int list()
+    {
+        return contour::daemon::listSessions(clientSettings("list"));
+    }
+
+    int attach()
+    {
+        return contour::daemon::attachSession(clientSettings("attach"),
+                                              parameters().uint("contour-daemon.attach.session"),
+                                              DetachKey);
+    }
+
+    int proxy()
+    {
+        return contour::daemon::proxy(socketPath("proxy"));
+    }
+};
+
+int main(int argc, char const* argv[])
+{
+    ContourDaemonApp app;
+    return app.run(argc, argv);
+}
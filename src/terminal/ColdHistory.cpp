@@ -0,0 +1,675 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/ColdHistory.h>
+#include <terminal/Grid.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <system_error>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+using std::min;
+using std::move;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal {
+
+namespace // {{{ helper
+{
+    [[noreturn]] void throwSystemError(char const* _what)
+    {
+        throw std::system_error(errno, std::system_category(), _what);
+    }
+
+    // {{{ encoding
+    void putVarUInt(string& _out, uint64_t _value)
+    {
+        while (_value >= 0x80)
+        {
+            _out.push_back(static_cast<char>((_value & 0x7F) | 0x80));
+            _value >>= 7;
+        }
+        _out.push_back(static_cast<char>(_value));
+    }
+
+    void putColor(string& _out, Color _color)
+    {
+        _out.push_back(static_cast<char>(_color.type));
+        if (_color.type == ColorType::RGB)
+        {
+            _out.push_back(static_cast<char>(_color.rgb.red));
+            _out.push_back(static_cast<char>(_color.rgb.green));
+            _out.push_back(static_cast<char>(_color.rgb.blue));
+        }
+        else
+            _out.push_back(static_cast<char>(_color.index));
+    }
+
+    void putString(string& _out, string_view _value)
+    {
+        putVarUInt(_out, _value.size());
+        _out.append(_value);
+    }
+
+    void putAttributes(string& _out, GraphicsAttributes const& _attributes)
+    {
+        putColor(_out, _attributes.foregroundColor);
+        putColor(_out, _attributes.backgroundColor);
+        putColor(_out, _attributes.underlineColor);
+        putVarUInt(_out, static_cast<uint32_t>(_attributes.styles));
+    }
+
+    class Reader {
+      public:
+        explicit Reader(string_view _data): data_{ _data } {}
+
+        size_t offset() const noexcept { return offset_; }
+
+        uint8_t byte() noexcept { return static_cast<uint8_t>(data_[offset_++]); }
+
+        uint64_t varUInt() noexcept
+        {
+            uint64_t value = 0;
+            for (unsigned shift = 0; ; shift += 7)
+            {
+                auto const b = byte();
+                value |= uint64_t(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return value;
+            }
+        }
+
+        string_view str() noexcept
+        {
+            auto const length = static_cast<size_t>(varUInt());
+            auto const value = data_.substr(offset_, length);
+            offset_ += length;
+            return value;
+        }
+
+        Color color() noexcept
+        {
+            auto const type = static_cast<ColorType>(byte());
+            if (type != ColorType::RGB)
+                return Color(type, byte());
+            auto const r = byte();
+            auto const g = byte();
+            auto const b = byte();
+            return Color(RGBColor(r, g, b));
+        }
+
+        GraphicsAttributes attributes() noexcept
+        {
+            auto attributes = GraphicsAttributes{};
+            attributes.foregroundColor = color();
+            attributes.backgroundColor = color();
+            attributes.underlineColor = color();
+            attributes.styles = static_cast<CellFlags>(varUInt());
+            return attributes;
+        }
+
+      private:
+        string_view data_;
+        size_t offset_ = 0;
+    };
+    // }}}
+
+    bool hasExtra(Cell const& _cell) noexcept
+    {
+#if defined(LIBTERMINAL_IMAGES)
+        if (_cell.imageFragment())
+            return true;
+#endif
+        (void) _cell;
+        return false;
+    }
+
+    /// Tests whether a cell is indistinguishable from a default constructed one.
+    bool isTrimmable(Cell const& _cell) noexcept
+    {
+        return _cell.codepointCount() == 0
+            && _cell.width() == 1
+            && _cell.attributes() == GraphicsAttributes{}
+#if defined(LIBTERMINAL_HYPERLINKS)
+            && !_cell.hyperlink()
+#endif
+            && !hasExtra(_cell);
+    }
+} // }}}
+
+// {{{ SpillFile
+#if defined(_WIN32)
+SpillFile::SpillFile(FileSystem::path const&)
+{
+}
+
+SpillFile::~SpillFile()
+{
+}
+
+void SpillFile::reserve(size_t _capacity)
+{
+    buffer_.reserve(_capacity);
+}
+
+size_t SpillFile::append(string_view _data)
+{
+    auto const offset = size_;
+    buffer_.append(_data);
+    size_ = buffer_.size();
+    return offset;
+}
+
+string_view SpillFile::view(size_t _offset, size_t _length) const noexcept
+{
+    return string_view(buffer_.data() + _offset, _length);
+}
+
+void SpillFile::read(size_t _offset, size_t _length, string& _output) const
+{
+    _output.assign(buffer_, _offset, _length);
+}
+
+void SpillFile::truncate(size_t _size)
+{
+    buffer_.resize(_size);
+    size_ = _size;
+}
+
+void SpillFile::discardFront(size_t _count)
+{
+    buffer_.erase(0, _count);
+    size_ = buffer_.size();
+}
+#else
+SpillFile::SpillFile(FileSystem::path const& _directory)
+{
+    auto ec = FileSystemError{};
+    FileSystem::create_directories(_directory, ec);
+
+    auto path = (_directory / "history-XXXXXX").string();
+    fd_ = mkstemp(path.data());
+    if (fd_ < 0)
+        throwSystemError("Creating history spill file");
+
+    // Nobody else needs to find this file, and it must not outlive us.
+    unlink(path.c_str());
+}
+
+SpillFile::~SpillFile()
+{
+    if (data_)
+        munmap(data_, capacity_);
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+void SpillFile::reserve(size_t _capacity)
+{
+    if (_capacity <= capacity_)
+        return;
+
+    if (ftruncate(fd_, static_cast<off_t>(_capacity)) < 0)
+        throwSystemError("Growing history spill file");
+
+    if (data_)
+        munmap(data_, capacity_);
+
+    void* data = mmap(nullptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED)
+    {
+        data_ = nullptr;
+        capacity_ = 0;
+        throwSystemError("Mapping history spill file");
+    }
+
+    data_ = static_cast<char*>(data);
+    capacity_ = _capacity;
+}
+
+size_t SpillFile::append(string_view _data)
+{
+    if (size_ + _data.size() > capacity_)
+    {
+        auto constexpr MinCapacity = size_t(1) << 20;
+        reserve(std::max({ MinCapacity, capacity_ * 2, size_ + _data.size() }));
+    }
+
+    // Written through the file descriptor rather than the mapping, so that the pages written
+    // do not count towards the process' resident memory until they are actually read back.
+    auto const offset = size_;
+    size_t done = 0;
+    while (done < _data.size())
+    {
+        auto const n = ::pwrite(fd_, _data.data() + done, _data.size() - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throwSystemError("Writing history spill file");
+        done += static_cast<size_t>(n);
+    }
+    size_ += _data.size();
+    return offset;
+}
+
+string_view SpillFile::view(size_t _offset, size_t _length) const noexcept
+{
+    return string_view(data_ + _offset, _length);
+}
+
+void SpillFile::read(size_t _offset, size_t _length, string& _output) const
+{
+    // Reads through the file descriptor, as the mapping may be replaced while growing.
+    _output.resize(_length);
+    size_t done = 0;
+    while (done < _length)
+    {
+        auto const n = ::pread(fd_, _output.data() + done, _length - done, static_cast<off_t>(_offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throwSystemError("Reading history spill file");
+        if (n == 0)
+            throw std::system_error(std::make_error_code(std::errc::io_error), "Reading history spill file");
+        done += static_cast<size_t>(n);
+    }
+}
+
+void SpillFile::truncate(size_t _size)
+{
+    size_ = min(size_, _size);
+}
+
+void SpillFile::discardFront(size_t _count)
+{
+    _count = min(_count, size_);
+    std::memmove(data_, data_ + _count, size_ - _count);
+    size_ -= _count;
+
+    // Give back the pages that are no longer needed.
+    if (capacity_ > 2 * size_ && data_)
+    {
+        munmap(data_, capacity_);
+        data_ = nullptr;
+        capacity_ = 0;
+        reserve(std::max(size_t(1) << 20, size_));
+    }
+}
+#endif
+// }}}
+
+// {{{ ColdHistory
+struct ColdHistory::Extra {
+    uint32_t line;
+    uint32_t column;
+#if defined(LIBTERMINAL_IMAGES)
+    optional<ImageFragment> image;
+#endif
+};
+
+struct ColdHistory::DecodedBlock {
+    uint64_t blockId;
+    ColumnCount columns;
+    vector<Line> lines;
+};
+
+ColdHistory::ColdHistory(FileSystem::path const& _spillDirectory):
+    spill_{ _spillDirectory }
+{
+}
+
+ColdHistory::~ColdHistory()
+{
+}
+
+void ColdHistory::push(Line const& _line)
+{
+    if (blocks_.empty() || blocks_.back().lineCount == BlockLineCount)
+    {
+        if (!blocks_.empty())
+            flush(blocks_.back());
+        blocks_.emplace_back(Block{});
+        blocks_.back().id = nextBlockId_++;
+    }
+
+    Block& block = blocks_.back();
+    invalidate(block.id);
+
+    // Reads the cells of packed lines through a copy, without unpacking the line itself.
+    auto cells = Line::Buffer{};
+    cells.reserve(unbox<size_t>(_line.size()));
+    _line.forEachCell([&](Cell const& _cell) { cells.emplace_back(_cell); });
+    while (!cells.empty() && isTrimmable(cells.back()))
+        cells.pop_back();
+    auto const cellCount = cells.size();
+
+    string& out = block.pending;
+    putVarUInt(out, static_cast<unsigned>(_line.flags()));
+    putVarUInt(out, cellCount);
+
+    // text: one header byte per cell (codepoint count and width), followed by its codepoints
+    for (size_t column = 0; column < cellCount; ++column)
+    {
+        Cell const& cell = cells[column];
+        out.push_back(static_cast<char>((cell.codepointCount() << 4) | (cell.width() & 0x0F)));
+        for (char32_t const codepoint: cell.codepoints())
+            putVarUInt(out, codepoint);
+
+        if (hasExtra(cell))
+        {
+            auto extra = Extra{};
+            extra.line = static_cast<uint32_t>(block.lineCount);
+            extra.column = static_cast<uint32_t>(column);
+#if defined(LIBTERMINAL_IMAGES)
+            extra.image = cell.imageFragment();
+#endif
+            block.extras.emplace_back(move(extra));
+        }
+    }
+
+    // graphics attributes: run-length encoded
+    size_t runCount = 0;
+    for (auto i = cells.begin(); i != cells.end(); )
+    {
+        auto const j = std::find_if(i, cells.end(), [&](Cell const& cell) { return cell.attributes() != i->attributes(); });
+        ++runCount;
+        i = j;
+    }
+    putVarUInt(out, runCount);
+    for (auto i = cells.begin(); i != cells.end(); )
+    {
+        auto const j = std::find_if(i, cells.end(), [&](Cell const& cell) { return cell.attributes() != i->attributes(); });
+        putVarUInt(out, static_cast<size_t>(std::distance(i, j)));
+        putAttributes(out, i->attributes());
+        i = j;
+    }
+
+    // hyperlinks: runs of cells sharing the same one, referring to it by its index within the block
+    // (plus one), or by zero followed by the hyperlink itself, the first time it occurs
+    auto hyperlinks = string{};
+    size_t hyperlinkRunCount = 0;
+#if defined(LIBTERMINAL_HYPERLINKS)
+    for (size_t column = 0; column < cellCount; )
+    {
+        auto const hyperlink = cells[column].hyperlink();
+        auto end = column + 1;
+        while (end < cellCount && cells[end].hyperlink() == hyperlink)
+            ++end;
+
+        if (hyperlink)
+        {
+            ++hyperlinkRunCount;
+            putVarUInt(hyperlinks, column);
+            putVarUInt(hyperlinks, end - column);
+            if (auto const k = std::find(block.hyperlinks.begin(), block.hyperlinks.end(), hyperlink);
+                k != block.hyperlinks.end())
+                putVarUInt(hyperlinks, static_cast<size_t>(std::distance(block.hyperlinks.begin(), k)) + 1);
+            else
+            {
+                putVarUInt(hyperlinks, 0);
+                putString(hyperlinks, hyperlink->id);
+                putString(hyperlinks, hyperlink->uri);
+                block.hyperlinks.emplace_back(hyperlink);
+            }
+        }
+        column = end;
+    }
+#endif
+    putVarUInt(out, hyperlinkRunCount);
+    out += hyperlinks;
+
+    ++block.lineCount;
+    ++lineCount_;
+}
+
+void ColdHistory::flush(Block& _block)
+{
+    if (_block.written)
+        return;
+
+    _block.offset = spill_.append(_block.pending);
+    _block.size = _block.pending.size();
+    _block.written = true;
+    _block.pending.clear();
+    _block.pending.shrink_to_fit();
+#if defined(LIBTERMINAL_HYPERLINKS)
+    _block.hyperlinks.clear();
+    _block.hyperlinks.shrink_to_fit();
+#endif
+}
+
+string_view ColdHistory::bytes(Block const& _block) const noexcept
+{
+    if (_block.written)
+        return spill_.view(_block.offset, _block.size);
+    return _block.pending;
+}
+
+void ColdHistory::invalidate(uint64_t _blockId)
+{
+    cache_.remove_if([=](DecodedBlock const& decoded) { return decoded.blockId == _blockId; });
+}
+
+ColdHistory::DecodedBlock& ColdHistory::decode(Block const& _block, ColumnCount _columns)
+{
+    if (auto i = std::find_if(cache_.begin(), cache_.end(),
+                              [&](DecodedBlock const& decoded) { return decoded.blockId == _block.id; });
+        i != cache_.end())
+    {
+        if (i->columns == _columns)
+        {
+            cache_.splice(cache_.begin(), cache_, i);
+            return *i;
+        }
+        cache_.erase(i);
+    }
+
+    if (cache_.size() == MaxCachedBlocks)
+        cache_.pop_back();
+
+    auto& decoded = cache_.emplace_front(DecodedBlock{ _block.id, _columns, {} });
+    decoded.lines.reserve(_block.lineCount);
+
+    auto reader = Reader(bytes(_block));
+    auto extra = _block.extras.begin();
+#if defined(LIBTERMINAL_HYPERLINKS)
+    auto hyperlinks = vector<HyperlinkRef>{};
+#endif
+
+    for (size_t lineIndex = 0; lineIndex < _block.lineCount; ++lineIndex)
+    {
+        auto const flags = static_cast<Line::Flags>(reader.varUInt());
+        auto const cellCount = static_cast<size_t>(reader.varUInt());
+
+        auto buffer = Line::Buffer(std::max(cellCount, unbox<size_t>(_columns)));
+        for (size_t column = 0; column < cellCount; ++column)
+        {
+            Cell& cell = buffer[column];
+            auto const header = reader.byte();
+            auto const codepointCount = header >> 4;
+            for (int k = 0; k < codepointCount; ++k)
+            {
+                auto const codepoint = static_cast<char32_t>(reader.varUInt());
+                if (k == 0)
+                    cell.setCharacter(codepoint);
+                else
+                    cell.appendCharacter(codepoint);
+            }
+            cell.setWidth(header & 0x0F);
+        }
+
+        auto column = size_t(0);
+        for (auto runCount = reader.varUInt(); runCount > 0; --runCount)
+        {
+            auto const length = static_cast<size_t>(reader.varUInt());
+            auto const attributes = reader.attributes();
+            for (auto const end = column + length; column < end; ++column)
+                buffer[column].setAttributes(attributes);
+        }
+
+        for (; extra != _block.extras.end() && extra->line == lineIndex; ++extra)
+        {
+#if defined(LIBTERMINAL_IMAGES)
+            if (extra->image)
+                buffer[extra->column].setImage(*extra->image);
+#endif
+        }
+
+        for (auto runCount = reader.varUInt(); runCount > 0; --runCount)
+        {
+            auto const begin = static_cast<size_t>(reader.varUInt());
+            auto const end = begin + static_cast<size_t>(reader.varUInt());
+            auto const index = static_cast<size_t>(reader.varUInt());
+#if defined(LIBTERMINAL_HYPERLINKS)
+            if (index == 0)
+            {
+                auto hyperlink = std::make_shared<HyperlinkInfo>();
+                hyperlink->id = reader.str();
+                hyperlink->uri = reader.str();
+                hyperlinks.emplace_back(move(hyperlink));
+            }
+            for (auto column = begin; column < end; ++column)
+                buffer[column].setHyperlink(hyperlinks[index ? index - 1 : hyperlinks.size() - 1]);
+#else
+            (void) begin;
+            (void) end;
+            (void) index;
+#endif
+        }
+
+        decoded.lines.emplace_back(move(buffer), flags);
+    }
+
+    return decoded;
+}
+
+Line const& ColdHistory::decodedLine(size_t _index, ColumnCount _columns)
+{
+    assert(_index < lineCount_);
+    auto const global = _index + frontSkip_;
+    Block const& block = blocks_[global / BlockLineCount];
+    return decode(block, _columns).lines[global % BlockLineCount];
+}
+
+Line ColdHistory::at(size_t _index, ColumnCount _columns)
+{
+    return decodedLine(_index, _columns);
+}
+
+Cell ColdHistory::cellAt(size_t _index, size_t _column, ColumnCount _columns)
+{
+    return decodedLine(_index, _columns)[_column];
+}
+
+vector<Line> ColdHistory::popBack(size_t _count, ColumnCount _columns)
+{
+    _count = min(_count, lineCount_);
+
+    // Collected newest block first, and reversed at the end.
+    auto lines = vector<Line>{};
+    lines.reserve(_count);
+
+    while (_count > 0)
+    {
+        Block& block = blocks_.back();
+        auto const skip = blocks_.size() == 1 ? frontSkip_ : 0;
+        auto const end = block.lineCount;
+        auto const keep = end - min(_count, end - skip);
+        auto decoded = move(decode(block, _columns).lines);
+
+        invalidate(block.id);
+        if (block.written)
+            spill_.truncate(block.offset);
+        lineCount_ -= end - skip;
+        _count -= end - keep;
+        blocks_.pop_back();
+        if (blocks_.empty())
+            frontSkip_ = 0;
+
+        for (auto i = end; i > keep; --i)
+            lines.emplace_back(move(decoded[i - 1]));
+
+        // Only the last block visited can be removed partially.
+        for (auto i = skip; i < keep; ++i)
+            push(decoded[i]);
+    }
+
+    std::reverse(lines.begin(), lines.end());
+    return lines;
+}
+
+void ColdHistory::popFront(size_t _count)
+{
+    _count = min(_count, lineCount_);
+    lineCount_ -= _count;
+    frontSkip_ += _count;
+
+    while (!blocks_.empty() && frontSkip_ >= blocks_.front().lineCount)
+    {
+        frontSkip_ -= blocks_.front().lineCount;
+        invalidate(blocks_.front().id);
+        blocks_.pop_front();
+    }
+
+    if (lineCount_ == 0)
+    {
+        clear();
+        return;
+    }
+
+    // Reclaim disk space once more than half of the spill file is dead.
+    if (auto const dead = blocks_.front().written ? blocks_.front().offset : spill_.size();
+        dead > (size_t(16) << 20) && dead > spill_.size() / 2)
+    {
+        spill_.discardFront(dead);
+        for (Block& block: blocks_)
+            if (block.written)
+                block.offset -= dead;
+    }
+}
+
+void ColdHistory::clear()
+{
+    blocks_.clear();
+    cache_.clear();
+    spill_.truncate(0);
+    frontSkip_ = 0;
+    lineCount_ = 0;
+}
+
+size_t ColdHistory::memoryUsage() const noexcept
+{
+    size_t bytes = sizeof(*this) + blocks_.size() * sizeof(Block);
+    for (Block const& block: blocks_)
+    {
+        bytes += block.pending.capacity() + block.extras.capacity() * sizeof(Extra);
+#if defined(LIBTERMINAL_HYPERLINKS)
+        bytes += block.hyperlinks.capacity() * sizeof(HyperlinkRef);
+#endif
+    }
+    return bytes;
+}
+// }}}
+
+} // end namespace
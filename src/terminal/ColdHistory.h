@@ -0,0 +1,185 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Hyperlink.h>
+#include <terminal/primitives.h>
+
+#include <crispy/stdfs.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal {
+
+class Cell;
+class Line;
+
+/// Configures the disk-backed tier of the scrollback history (see Grid::setColdHistory()).
+struct ColdHistorySettings {
+    /// Directory to create the (anonymous) spill file in.
+    FileSystem::path spillDirectory;
+
+    /// Number of most recent history lines to keep in memory as regular Line objects.
+    LineCount hotLineCount;
+};
+
+/**
+ * Append-only, memory mapped file, that is unlinked right after its creation
+ * and thus vanishes as soon as it is closed.
+ *
+ * Falls back to an in-memory buffer on platforms without mmap() support.
+ */
+class SpillFile {
+  public:
+    /// @throws std::system_error if the file could not be created.
+    explicit SpillFile(FileSystem::path const& _directory);
+    ~SpillFile();
+
+    SpillFile(SpillFile const&) = delete;
+    SpillFile& operator=(SpillFile const&) = delete;
+
+    size_t size() const noexcept { return size_; }
+
+    /// Appends @p _data to the end of the file.
+    ///
+    /// @returns the offset the data has been written to.
+    /// @throws std::system_error if the file could not be grown.
+    size_t append(std::string_view _data);
+
+    /// @returns a view into the file's contents, valid until the next mutating call.
+    std::string_view view(size_t _offset, size_t _length) const noexcept;
+
+    /// Copies @p _length bytes from offset @p _offset into @p _output.
+    ///
+    /// Other than view(), this may be called from any thread on platforms with mmap() support,
+    /// for bytes that have been appended and are neither truncated nor discarded in the meantime.
+    ///
+    /// @throws std::system_error if the file could not be read.
+    void read(size_t _offset, size_t _length, std::string& _output) const;
+
+    /// Discards all bytes from offset @p _size on.
+    void truncate(size_t _size);
+
+    /// Discards the first @p _count bytes, moving the remaining ones to the front.
+    void discardFront(size_t _count);
+
+  private:
+    void reserve(size_t _capacity);
+
+#if defined(_WIN32)
+    std::string buffer_;
+#else
+    int fd_ = -1;
+    char* data_ = nullptr;
+    size_t capacity_ = 0;
+#endif
+    size_t size_ = 0;
+};
+
+/**
+ * Compressed, disk-backed storage for the oldest lines of the scrollback history.
+ *
+ * Lines are serialized into blocks of BlockLineCount lines, storing each line's text
+ * and its graphics attributes as run-length encoded style runs, with trailing
+ * blank cells trimmed. Full blocks are written to a SpillFile, so that the memory
+ * needed does not grow with the number of lines stored.
+ *
+ * Hyperlinks are serialized as runs of cells, each hyperlink written out in full
+ * only the first time it occurs within a block. Image fragments are not serialized
+ * but kept on the side, as their pixels are held in memory by the image pool anyway.
+ *
+ * Lines are addressed by their index, with 0 being the oldest line stored.
+ */
+class ColdHistory {
+  public:
+    static constexpr size_t BlockLineCount = 256;
+
+    /// Maximum number of decoded blocks kept around for faster repeated access.
+    static constexpr size_t MaxCachedBlocks = 4;
+
+    /// @throws std::system_error if the spill file could not be created.
+    explicit ColdHistory(FileSystem::path const& _spillDirectory);
+    ~ColdHistory();
+
+    ColdHistory(ColdHistory const&) = delete;
+    ColdHistory& operator=(ColdHistory const&) = delete;
+
+    LineCount lineCount() const noexcept { return LineCount::cast_from(lineCount_); }
+    bool empty() const noexcept { return lineCount_ == 0; }
+
+    /// Appends @p _line as the most recent line.
+    void push(Line const& _line);
+
+    /// @returns a copy of the line at @p _index, padded to at least @p _columns.
+    Line at(size_t _index, ColumnCount _columns);
+
+    /// @returns a copy of the cell at @p _column of the line at @p _index.
+    Cell cellAt(size_t _index, size_t _column, ColumnCount _columns);
+
+    /// Removes the @p _count most recent lines and returns them, oldest first,
+    /// padded to at least @p _columns.
+    ///
+    /// Each affected block is decoded once and dropped as a whole,
+    /// only the remainder of a partially removed block is re-encoded.
+    std::vector<Line> popBack(size_t _count, ColumnCount _columns);
+
+    /// Removes the @p _count oldest lines.
+    void popFront(size_t _count);
+
+    void clear();
+
+    /// @returns number of bytes held in memory, excluding the decode cache.
+    size_t memoryUsage() const noexcept;
+
+    /// @returns number of bytes the spill file currently occupies.
+    size_t diskUsage() const noexcept { return spill_.size(); }
+
+  private:
+    struct Extra;
+    struct DecodedBlock;
+
+    struct Block {
+        uint64_t id;
+        size_t lineCount = 0;
+        size_t offset = 0;      //!< offset into the spill file, once written
+        size_t size = 0;        //!< encoded size in bytes, once written
+        std::string pending;    //!< encoded lines not yet written to the spill file
+        std::vector<Extra> extras;
+#if defined(LIBTERMINAL_HYPERLINKS)
+        std::vector<HyperlinkRef> hyperlinks; //!< hyperlinks already written out, until written
+#endif
+        bool written = false;
+    };
+
+    std::string_view bytes(Block const& _block) const noexcept;
+    void flush(Block& _block);
+    void invalidate(uint64_t _blockId);
+    DecodedBlock& decode(Block const& _block, ColumnCount _columns);
+    Line const& decodedLine(size_t _index, ColumnCount _columns);
+
+    SpillFile spill_;
+    std::deque<Block> blocks_;
+    uint64_t nextBlockId_ = 0;
+    size_t frontSkip_ = 0;      //!< number of lines already evicted from the first block
+    size_t lineCount_ = 0;
+    std::list<DecodedBlock> cache_;
+};
+
+} // end namespace
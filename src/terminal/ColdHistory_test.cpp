@@ -0,0 +1,254 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/ColdHistory.h>
+#include <terminal/Grid.h>
+#include <catch2/catch_all.hpp>
+#include <fmt/format.h>
+#include <string>
+
+using namespace terminal;
+using std::string;
+using std::string_view;
+
+namespace // {{{ helper
+{
+    ColdHistorySettings coldSettings(int _hotLineCount)
+    {
+        return ColdHistorySettings{FileSystem::temp_directory_path(), LineCount(_hotLineCount)};
+    }
+
+    /// Writes @p _text into the bottom line and scrolls it up by one line.
+    void pushLine(Grid& _grid, string_view _text)
+    {
+        auto const pageSize = _grid.screenSize();
+        _grid.lineAt(*pageSize.lines).setText(_text);
+        _grid.scrollUp(LineCount(1), GraphicsAttributes{}, Margin{{1, *pageSize.lines}, {1, *pageSize.columns}});
+    }
+} // }}}
+
+TEST_CASE("ColdHistory.roundtrip", "[cold]")
+{
+    auto bold = GraphicsAttributes{};
+    bold.styles |= CellFlags::Bold;
+    bold.foregroundColor = RGBColor(0x12, 0x34, 0x56);
+
+    auto line = Line(ColumnCount(10), Cell{}, Line::Flags::Wrappable | Line::Flags::Wrapped);
+    line.setText("ab  x");
+    line[0].setAttributes(bold);
+    line[1].setAttributes(bold);
+    line[5].setCharacter(U'中');
+    line[7].setAttributes(bold); // trailing blank, but not trimmable
+
+    auto cold = ColdHistory(FileSystem::temp_directory_path());
+    cold.push(line);
+    REQUIRE(*cold.lineCount() == 1);
+
+    Line const& decoded = cold.at(0, ColumnCount(10));
+    CHECK(decoded.size() == ColumnCount(10));
+    CHECK(decoded.flags() == line.flags());
+    CHECK(decoded.toUtf8() == line.toUtf8());
+    for (size_t i = 0; i < 10; ++i)
+    {
+        CHECK(decoded[i] == line[i]);
+        CHECK(decoded[i].width() == line[i].width());
+    }
+}
+
+#if defined(LIBTERMINAL_HYPERLINKS)
+TEST_CASE("ColdHistory.hyperlinks", "[cold]")
+{
+    auto const link = std::make_shared<HyperlinkInfo>(HyperlinkInfo{"id1", "https://example.com/", {}});
+    auto const other = std::make_shared<HyperlinkInfo>(HyperlinkInfo{"", "file:///tmp", {}});
+
+    auto cold = ColdHistory(FileSystem::temp_directory_path());
+    auto plain = ColdHistory(FileSystem::temp_directory_path());
+    auto constexpr Count = 2 * ColdHistory::BlockLineCount + 1;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        auto line = Line(ColumnCount(40), fmt::format("line {} with links", i), Line::Flags::None);
+        plain.push(line);
+        for (size_t column = 0; column < 20; ++column)
+            line[column].setHyperlink(link);
+        line[30].setHyperlink(other); // beyond the text, thus not trimmed
+        cold.push(line);
+    }
+
+    // Hyperlinks are serialized along with the text, rather than kept alive per cell.
+    CHECK(link.use_count() == 2);
+    CHECK(other.use_count() == 2);
+    CHECK(cold.memoryUsage() < plain.memoryUsage() + 1024);
+
+    for (auto const index: {size_t(0), size_t(ColdHistory::BlockLineCount), Count - 1})
+    {
+        auto const line = cold.at(index, ColumnCount(40));
+        CHECK(line.toUtf8Trimmed() == fmt::format("line {} with links", index));
+        REQUIRE(line.cellAt(0).hyperlink());
+        CHECK(line.cellAt(0).hyperlink()->id == "id1");
+        CHECK(line.cellAt(0).hyperlink()->uri == "https://example.com/");
+        CHECK(line.cellAt(19).hyperlink() == line.cellAt(0).hyperlink());
+        CHECK(!line.cellAt(20).hyperlink());
+        REQUIRE(line.cellAt(30).hyperlink());
+        CHECK(line.cellAt(30).hyperlink()->uri == "file:///tmp");
+        CHECK(!line.cellAt(31).hyperlink());
+    }
+
+    // lines of the same block share their decoded hyperlinks
+    CHECK(cold.cellAt(1, 0, ColumnCount(40)).hyperlink() == cold.cellAt(2, 5, ColumnCount(40)).hyperlink());
+}
+#endif
+
+TEST_CASE("ColdHistory.blocks", "[cold]")
+{
+    auto cold = ColdHistory(FileSystem::temp_directory_path());
+    auto constexpr Count = 3 * ColdHistory::BlockLineCount + 10;
+    for (size_t i = 0; i < Count; ++i)
+        cold.push(Line(ColumnCount(20), fmt::format("line {}", i), Line::Flags::None));
+
+    REQUIRE(unbox<size_t>(cold.lineCount()) == Count);
+    CHECK(cold.diskUsage() > 0);
+    CHECK(cold.at(0, ColumnCount(20)).toUtf8Trimmed() == "line 0");
+    CHECK(cold.at(Count - 1, ColumnCount(20)).toUtf8Trimmed() == fmt::format("line {}", Count - 1));
+
+    cold.popFront(ColdHistory::BlockLineCount + 5);
+    CHECK(cold.at(0, ColumnCount(20)).toUtf8Trimmed() == fmt::format("line {}", ColdHistory::BlockLineCount + 5));
+
+    CHECK(cold.popBack(1, ColumnCount(20)).at(0).toUtf8Trimmed() == fmt::format("line {}", Count - 1));
+    auto const popped = cold.popBack(21, ColumnCount(20));
+    REQUIRE(popped.size() == 21);
+    CHECK(popped.front().toUtf8Trimmed() == fmt::format("line {}", Count - 22));
+    CHECK(popped.back().toUtf8Trimmed() == fmt::format("line {}", Count - 2));
+
+    cold.push(Line(ColumnCount(20), "appended", Line::Flags::None));
+    CHECK(cold.at(unbox<size_t>(cold.lineCount()) - 1, ColumnCount(20)).toUtf8Trimmed() == "appended");
+    CHECK(cold.at(unbox<size_t>(cold.lineCount()) - 2, ColumnCount(20)).toUtf8Trimmed() == fmt::format("line {}", Count - 23));
+
+    cold.clear();
+    CHECK(cold.empty());
+    CHECK(cold.diskUsage() == 0);
+}
+
+TEST_CASE("ColdHistory.popBack", "[cold]")
+{
+    auto cold = ColdHistory(FileSystem::temp_directory_path());
+    auto constexpr Count = 10 * ColdHistory::BlockLineCount;
+    for (size_t i = 0; i < Count; ++i)
+        cold.push(Line(ColumnCount(20), fmt::format("line {}", i), Line::Flags::None));
+    cold.popFront(10);
+
+    // spanning several blocks, ending within one
+    auto const popped = cold.popBack(5 * ColdHistory::BlockLineCount + 7, ColumnCount(20));
+    REQUIRE(popped.size() == 5 * ColdHistory::BlockLineCount + 7);
+    for (size_t i = 0; i < popped.size(); ++i)
+        REQUIRE(popped[i].toUtf8Trimmed() == fmt::format("line {}", Count - popped.size() + i));
+
+    auto constexpr Left = Count - 10 - 5 * ColdHistory::BlockLineCount - 7;
+    REQUIRE(unbox<size_t>(cold.lineCount()) == Left);
+    CHECK(cold.at(0, ColumnCount(20)).toUtf8Trimmed() == "line 10");
+    CHECK(cold.at(Left - 1, ColumnCount(20)).toUtf8Trimmed() == fmt::format("line {}", Left + 9));
+
+    // more than what is left, including the partially evicted first block
+    auto const rest = cold.popBack(Count, ColumnCount(20));
+    REQUIRE(rest.size() == Left);
+    CHECK(rest.front().toUtf8Trimmed() == "line 10");
+    CHECK(rest.back().toUtf8Trimmed() == fmt::format("line {}", Left + 9));
+    CHECK(cold.empty());
+    CHECK(cold.diskUsage() == 0);
+}
+
+TEST_CASE("Grid.coldHistory", "[cold]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(10)}, false, std::nullopt);
+    grid.setColdHistory(coldSettings(10));
+
+    for (int i = 0; i < 1000; ++i)
+        pushLine(grid, fmt::format("line {}", i));
+
+    // The initial blank line of the page went into the history first.
+    REQUIRE(*grid.historyLineCount() == 1000);
+    REQUIRE(grid.coldHistory() != nullptr);
+    CHECK(*grid.coldHistory()->lineCount() >= 1000 - 10 - int(ColdHistory::BlockLineCount));
+    CHECK(grid.scrollbackLines().size() + unbox<size_t>(grid.coldHistory()->lineCount()) == 1000);
+
+    auto const coldLines = grid.coldHistory()->lineCount();
+    CHECK(grid.absoluteLineCopyAt(1).toUtf8Trimmed() == "line 0");
+    CHECK(grid.absoluteLineCopyAt(500).toUtf8Trimmed() == "line 499");
+    CHECK(grid.cellAt(Coordinate{-998, 1}).codepoint(0) == 'l');
+    CHECK(grid.coldHistory()->lineCount() == coldLines);
+    CHECK(grid.renderTextLine(0) == "line 998  ");
+    CHECK(grid.renderTextLineAbsolute(101) == "line 100  ");
+
+    // a page scrolled into the cold history
+    auto const page = grid.materializePage(100);
+    REQUIRE(page.size() == 2);
+    CHECK(page[0].toUtf8Trimmed() == "line 99");
+    CHECK(page[1].toUtf8Trimmed() == "line 100");
+
+    auto rendered = std::string{};
+    grid.render([&](Coordinate _pos, Cell const& _cell) {
+        if (_pos.row == 1)
+            rendered += _cell.toUtf8();
+    }, StaticScrollbackPosition(100));
+    CHECK(rendered == "line 99");
+
+    // writing to a cold line moves it (and all more recent ones) back into memory
+    auto const changed = unbox<int>(coldLines) - 5;
+    grid.absoluteLineAt(changed).setText("changed   ");
+    CHECK(grid.coldHistory()->lineCount() == LineCount(changed));
+    CHECK(grid.absoluteLineCopyAt(changed).toUtf8Trimmed() == "changed");
+    CHECK(grid.absoluteLineCopyAt(changed - 1).toUtf8Trimmed() == fmt::format("line {}", changed - 2));
+
+    // growing the page takes the most recent lines back
+    (void) grid.resize(PageSize{LineCount(40), ColumnCount(10)}, Coordinate{2, 1}, false);
+    CHECK(*grid.historyLineCount() == 1000 - 38);
+    CHECK(grid.lineAt(1).toUtf8Trimmed() == "line 961");
+
+    grid.setColdHistory(std::nullopt);
+    CHECK(grid.coldHistory() == nullptr);
+    CHECK(grid.scrollbackLines().size() == 1000 - 38);
+    CHECK(grid.absoluteLineAt(1).toUtf8Trimmed() == "line 0");
+    CHECK(grid.absoluteLineAt(changed).toUtf8Trimmed() == "changed");
+}
+
+TEST_CASE("Grid.coldHistory.thaw", "[cold]")
+{
+    auto constexpr Count = 100 * int(ColdHistory::BlockLineCount);
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(10)}, false, std::nullopt);
+    grid.setColdHistory(coldSettings(10));
+
+    for (int i = 0; i < Count; ++i)
+        pushLine(grid, fmt::format("{}", i));
+    REQUIRE(*grid.coldHistory()->lineCount() > Count - 2 * int(ColdHistory::BlockLineCount));
+
+    grid.setColdHistory(std::nullopt);
+    REQUIRE(grid.scrollbackLines().size() == size_t(Count));
+    for (int i = 0; i < Count; ++i)
+        REQUIRE(grid.absoluteLineAt(i + 1).toUtf8Trimmed() == fmt::format("{}", i));
+}
+
+TEST_CASE("Grid.coldHistory.limit", "[cold]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(10)}, false, LineCount(600));
+    grid.setColdHistory(coldSettings(10));
+
+    for (int i = 0; i < 2000; ++i)
+        pushLine(grid, fmt::format("line {}", i));
+
+    REQUIRE(*grid.historyLineCount() == 600);
+    CHECK(grid.absoluteLineCopyAt(0).toUtf8Trimmed() == "line 1399");
+    CHECK(grid.lineAt(0).toUtf8Trimmed() == "line 1998");
+
+    grid.clearHistory();
+    CHECK(*grid.historyLineCount() == 0);
+    CHECK(grid.coldHistory()->empty());
+}
@@ -365,6 +365,8 @@ constexpr inline auto RCOLORHIGHLIGHTFG = detail::OSC(119, "RCOLORHIGHLIGHTFG",
 constexpr inline auto RCOLORHIGHLIGHTBG = detail::OSC(117, "RCOLORHIGHLIGHTBG", "Reset highlight background color.");
 constexpr inline auto NOTIFY        = detail::OSC(777, "NOTIFY", "Send Notification.");
 constexpr inline auto DUMPSTATE     = detail::OSC(888, "DUMPSTATE", "Dumps internal state to debug stream.");
+constexpr inline auto LATENCYSTATS  = detail::OSC(889, "LATENCYSTATS", "Reports or resets latency statistics.");
+constexpr inline auto MEMORYUSAGE   = detail::OSC(890, "MEMORYUSAGE", "Reports memory usage by category.");
 
 inline auto const& functions() noexcept
 {
@@ -497,6 +499,8 @@ inline auto const& functions() noexcept
             RCOLORHIGHLIGHTBG,
             NOTIFY,
             DUMPSTATE,
+            LATENCYSTATS,
+            MEMORYUSAGE,
         };
         crispy::sort(f, [](FunctionDefinition const& a, FunctionDefinition const& b) constexpr { return compare(a, b); });
         return f;
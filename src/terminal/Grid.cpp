@@ -23,6 +23,7 @@
 #include <iostream>
 #include <optional>
 #include <sstream>
+#include <thread>
 #include <tuple>
 #include <utility>
 
@@ -64,14 +65,39 @@ namespace // {{{ helper
             _cell.codepointCount() == 0;
     }
 
-    template <typename... Args>
-    void logf([[maybe_unused]] Args&&... _args)
+    /// Renders the text of the first @p _columns cells of @p _line, with empty cells as spaces.
+    string renderTextOf(Line const& _line, ColumnCount _columns)
     {
-#if 0
-        std::cout << fmt::format(std::forward<Args>(_args)...) << '\n';
-#endif
+        string text;
+        text.reserve(unbox<size_t>(_columns));
+        auto encoder = unicode::encoder<char>{};
+        int column = 0;
+        _line.forEachCell([&](Cell const& _cell) {
+            if (column++ >= unbox<int>(_columns))
+                return;
+            if (_cell.codepointCount() == 0)
+                text.push_back(' '); // fill character
+            else
+                for (char32_t const codepoint: _cell.codepoints())
+                    encoder(codepoint, back_inserter(text));
+        });
+        for (; column < unbox<int>(_columns); ++column)
+            text.push_back(' ');
+        return text;
+    }
+
+    crispy::span<Cell const> cellsOf(Line::Buffer const& _buffer) noexcept
+    {
+        return crispy::span<Cell const>(_buffer.data(), _buffer.size());
     }
 }
+
+// Reflow tracing, compiled out along with the evaluation of its arguments.
+#if 0
+    #define LOG_REFLOW(...) (std::cout << fmt::format(__VA_ARGS__) << '\n')
+#else
+    #define LOG_REFLOW(...) do {} while (0)
+#endif
 // }}}
 // {{{ Cell impl
 string Cell::toUtf8() const
@@ -82,6 +108,243 @@ string Cell::toUtf8() const
         return " ";
 }
 // }}}
+// {{{ PackedLine impl
+namespace
+{
+    bool isDefaultCell(Cell const& _cell) noexcept
+    {
+        return _cell.codepointCount() == 0
+            && _cell.width() == 1
+            && _cell.attributes() == GraphicsAttributes{}
+#if defined(LIBTERMINAL_HYPERLINKS)
+            && !_cell.hyperlink()
+#endif
+#if defined(LIBTERMINAL_IMAGES)
+            && !_cell.imageFragment()
+#endif
+            ;
+    }
+
+    /// Tests whether the cell can be restored from its text alone, i.e. without a cell header.
+    bool isTrivialCell(Cell const& _cell) noexcept
+    {
+        switch (_cell.codepointCount())
+        {
+            case 0:
+                return _cell.width() == 1;
+            case 1:
+                if (_cell.codepoint(0) < 0x80)
+                    return _cell.width() == 1;
+                return _cell.width() == std::max(unicode::width(_cell.codepoint(0)), 1);
+            default:
+                return false;
+        }
+    }
+
+    uint8_t cellHeader(Cell const& _cell) noexcept
+    {
+        return static_cast<uint8_t>((_cell.codepointCount() << 4) | static_cast<unsigned>(_cell.width()));
+    }
+}
+
+std::shared_ptr<PackedLine const> PackedLine::pack(std::vector<Cell> const& _cells,
+                                                   std::shared_ptr<PackedLine const> _recycled)
+{
+    if (_cells.size() > 0xFFFF)
+        return nullptr;
+
+    auto cellCount = _cells.size();
+    while (cellCount != 0 && isDefaultCell(_cells[cellCount - 1]))
+        --cellCount;
+
+    auto const recycled = _recycled && _recycled.use_count() == 1
+                       && !_recycled->shared.load(std::memory_order_relaxed);
+    auto packed = recycled ? std::const_pointer_cast<PackedLine>(move(_recycled))
+                           : std::make_shared<PackedLine>();
+    if (recycled)
+        packed->clear();
+    packed->columns = static_cast<uint16_t>(_cells.size());
+    packed->cellCount = static_cast<uint16_t>(cellCount);
+    packed->text.reserve(cellCount);
+
+    auto encoder = unicode::encoder<char>{};
+    for (size_t column = 0; column < cellCount; ++column)
+    {
+        Cell const& cell = _cells[column];
+
+        if (cell.width() > 0x0F)
+            return nullptr;
+
+        if (packed->cellHeaders.empty() && !isTrivialCell(cell))
+        {
+            // Switch to explicit cell headers, with all preceding cells' NUL bytes dropped.
+            packed->cellHeaders.reserve(cellCount);
+            for (size_t i = 0; i < column; ++i)
+                packed->cellHeaders.push_back(cellHeader(_cells[i]));
+            packed->text.erase(std::remove(packed->text.begin(), packed->text.end(), '\0'), packed->text.end());
+        }
+
+        if (!packed->cellHeaders.empty())
+            packed->cellHeaders.push_back(cellHeader(cell));
+        else if (cell.codepointCount() == 0)
+            packed->text.push_back('\0');
+
+        for (char32_t const codepoint: cell.codepoints())
+            encoder(codepoint, back_inserter(packed->text));
+
+        if (packed->styles.empty()
+                || packed->styles.back().attributes != cell.attributes()
+                || packed->styles.back().length == 0xFFFF)
+            packed->styles.emplace_back(StyleRun{1, cell.attributes()});
+        else
+            ++packed->styles.back().length;
+
+        bool hasExtra = false;
+        auto extra = CellExtra{};
+        extra.column = static_cast<uint16_t>(column);
+#if defined(LIBTERMINAL_HYPERLINKS)
+        if (cell.hyperlink())
+        {
+            extra.hyperlink = cell.hyperlink();
+            hasExtra = true;
+        }
+#endif
+#if defined(LIBTERMINAL_IMAGES)
+        if (cell.imageFragment())
+        {
+            extra.imageFragment = cell.imageFragment();
+            hasExtra = true;
+        }
+#endif
+        if (hasExtra)
+            packed->extras.emplace_back(move(extra));
+
+        packed->blank = packed->blank && is_blank(cell);
+    }
+
+    // A recycled line keeps its capacity, which is bounded by the page width, to be reused again.
+    if (!recycled)
+    {
+        packed->text.shrink_to_fit();
+        packed->cellHeaders.shrink_to_fit();
+        packed->styles.shrink_to_fit();
+    }
+    return packed;
+}
+
+PackedLine::PackedLine(PackedLine const& _other):
+    columns{_other.columns},
+    cellCount{_other.cellCount},
+    blank{_other.blank},
+    text{_other.text},
+    cellHeaders{_other.cellHeaders},
+    styles{_other.styles},
+    extras{_other.extras}
+{
+}
+
+std::shared_ptr<PackedLine const> PackedLine::resized(uint16_t _columns) const
+{
+    assert(_columns >= cellCount);
+    auto copy = std::make_shared<PackedLine>(*this);
+    copy->columns = _columns;
+    return copy;
+}
+
+std::vector<Cell> PackedLine::unpack() const
+{
+    std::vector<Cell> cells;
+    unpack(cells);
+    return cells;
+}
+
+void PackedLine::unpack(std::vector<Cell>& _cells) const
+{
+    _cells.clear();
+    _cells.reserve(columns);
+    forEachCell([&](Cell const& _cell) { _cells.emplace_back(_cell); });
+}
+
+Cell PackedLine::at(uint16_t _column) const
+{
+    assert(_column < columns);
+    if (_column >= cellCount)
+        return Cell{};
+
+    auto style = styles.begin();
+    for (unsigned preceding = _column; preceding >= style->length; ++style)
+        preceding -= style->length;
+
+    // Skips the codepoints of all preceding cells.
+    auto input = reinterpret_cast<uint8_t const*>(text.data());
+    auto const skipCodepoint = [&]() { input += *input < 0x80 ? 1 : *input < 0xE0 ? 2 : *input < 0xF0 ? 3 : 4; };
+    for (uint16_t column = 0; column < _column; ++column)
+    {
+        if (cellHeaders.empty() && !*input)
+            ++input;
+        else if (cellHeaders.empty())
+            skipCodepoint();
+        else
+            for (unsigned i = 0; i < (cellHeaders[column] >> 4u); ++i)
+                skipCodepoint();
+    }
+
+    auto cell = Cell{};
+    cell.reset(style->attributes);
+    if (cellHeaders.empty())
+    {
+        if (*input)
+            cell.setCharacter(decodeUtf8(input));
+    }
+    else
+    {
+        auto const header = cellHeaders[_column];
+        for (unsigned i = 0; i < (header >> 4u); ++i)
+        {
+            if (i == 0)
+                cell.setCharacter(decodeUtf8(input));
+            else
+                cell.appendCharacter(decodeUtf8(input));
+        }
+        cell.setWidth(header & 0x0F);
+    }
+
+    auto const extra = std::find_if(extras.begin(), extras.end(),
+                                    [=](CellExtra const& _extra) { return _extra.column == _column; });
+    if (extra != extras.end())
+    {
+#if defined(LIBTERMINAL_HYPERLINKS)
+        cell.setHyperlink(extra->hyperlink);
+#endif
+#if defined(LIBTERMINAL_IMAGES)
+        if (extra->imageFragment)
+            cell.setImage(*extra->imageFragment);
+#endif
+    }
+
+    return cell;
+}
+
+void PackedLine::clear() noexcept
+{
+    columns = 0;
+    cellCount = 0;
+    blank = true;
+    text.clear();
+    cellHeaders.clear();
+    styles.clear();
+    extras.clear();
+}
+
+size_t PackedLine::memoryUsage() const noexcept
+{
+    return sizeof(PackedLine)
+         + text.capacity()
+         + cellHeaders.capacity()
+         + styles.capacity() * sizeof(StyleRun)
+         + extras.capacity() * sizeof(CellExtra);
+}
+// }}}
 // {{{ Line impl
 Line::Line(Buffer&& _init, Flags _flags) :
     buffer_{ move(_init) },
@@ -111,20 +374,21 @@ Line::Line(ColumnCount _numCols, std::string_view const& _s, Flags _flags) :
 
 string Line::toUtf8() const
 {
-    std::stringstream sstr;
-    for (Cell const& cell : crispy::range(begin(), next(begin(), unbox<long>(size()))))
-    {
+    string output;
+    output.reserve(unbox<size_t>(size()));
+    forEachCell([&](Cell const& cell) {
         if (cell.codepointCount() == 0)
         {
-            sstr << ' ';
+            output.push_back(' ');
         }
         else
         {
+            auto encoder = unicode::encoder<char>{};
             for (char32_t codepoint : cell.codepoints())
-                sstr << unicode::convert_to<char>(codepoint);
+                encoder(codepoint, back_inserter(output));
         }
-    }
-    return sstr.str();
+    });
+    return output;
 }
 
 string Line::toUtf8Trimmed() const
@@ -137,21 +401,67 @@ string Line::toUtf8Trimmed() const
 
 void Line::prepend(Buffer const& _cells)
 {
+    unpack();
     buffer_.insert(buffer_.begin(), _cells.begin(), _cells.end());
 }
 
 void Line::append(Buffer const& _cells)
 {
+    unpack();
     buffer_.insert(buffer_.end(), _cells.begin(), _cells.end());
 }
 
 void Line::append(int _count, Cell const& _initial)
 {
+    unpack();
     fill_n(back_inserter(buffer_), _count, _initial);
 }
 
-crispy::range<Line::const_iterator> Line::trim_blank_right() const
+void Line::fill(int _from, int _count, Cell const& _cell)
+{
+    unpack();
+    auto const from = std::clamp(_from, 0, static_cast<int>(buffer_.size()));
+    auto const count = std::clamp(_count, 0, static_cast<int>(buffer_.size()) - from);
+    fill_n(next(buffer_.begin(), from), count, _cell);
+}
+
+void Line::moveCells(int _from, int _count, int _to)
 {
+    unpack();
+    auto const width = static_cast<int>(buffer_.size());
+    auto const count = min(_count, width - std::max(_from, _to));
+    if (count <= 0 || _from == _to || _from < 0 || _to < 0)
+        return;
+
+    auto const first = next(buffer_.begin(), _from);
+    if (_from < _to)
+        std::move_backward(first, next(first, count), next(buffer_.begin(), _to + count));
+    else
+        std::move(first, next(first, count), next(buffer_.begin(), _to));
+}
+
+void Line::copyCells(Line const& _source, int _from, int _count, int _to)
+{
+    unpack();
+    Buffer unpackedSource;
+    if (_source.packed_)
+        _source.packed_->unpack(unpackedSource);
+    auto const& source = _source.packed_ ? unpackedSource : _source.buffer_;
+    auto const count = min(_count, min(static_cast<int>(source.size()) - _from,
+                                       static_cast<int>(buffer_.size()) - _to));
+    if (count <= 0 || _from < 0 || _to < 0 || (&_source == this && _from == _to))
+        return;
+
+    auto const first = next(source.begin(), _from);
+    if (&_source == this && _from < _to)
+        std::copy_backward(first, next(first, count), next(buffer_.begin(), _to + count));
+    else
+        std::copy(first, next(first, count), next(buffer_.begin(), _to));
+}
+
+crispy::range<Line::const_iterator> Line::trim_blank_right()
+{
+    unpack();
     auto i = buffer_.cbegin();
     auto e = buffer_.cend();
 
@@ -161,31 +471,31 @@ crispy::range<Line::const_iterator> Line::trim_blank_right() const
     return crispy::range(i, e);
 }
 
-Line::Buffer Line::shift_left(int _count, Cell const& _fill)
+void Line::shift_left(int _count, Cell const& _fill, Buffer& _shiftedOut)
 {
+    unpack();
     auto const actualShiftCount = min(_count, unbox<int>(size()));
-    auto const from = std::begin(buffer_);
     auto const to = std::next(std::begin(buffer_), actualShiftCount);
 
-    auto out = remove(from, to);
-    append(actualShiftCount, _fill);
+    _shiftedOut.assign(std::begin(buffer_), to);
+    auto const fillStart = std::move(to, std::end(buffer_), std::begin(buffer_));
+    std::fill(fillStart, std::end(buffer_), _fill);
 
     // trim trailing blanks
-    while (!out.empty() && is_blank(out.back()))
-        out.pop_back();
-
-    return out;
+    while (!_shiftedOut.empty() && is_blank(_shiftedOut.back()))
+        _shiftedOut.pop_back();
 }
 
-Line::Buffer Line::remove(iterator const& _from, iterator const& _to)
+void Line::remove(iterator const& _from, iterator const& _to, Buffer& _removed)
 {
-    auto removedColumns = Buffer(_from, _to);
+    assert(!packed_ && "Iterators must have been obtained from an unpacked line.");
+    _removed.assign(_from, _to);
     buffer_.erase(_from, _to);
-    return removedColumns;
 }
 
 void Line::setText(std::string_view _u8string)
 {
+    unpack();
     for (auto const [i, ch] : crispy::indexed(unicode::convert_to<char32_t>(_u8string)))
         buffer_.at(i).setCharacter(ch);
 }
@@ -193,16 +503,63 @@ void Line::setText(std::string_view _u8string)
 void Line::resize(ColumnCount _size)
 {
     assert(*_size >= 0);
+    if (packed_ && unbox<size_t>(_size) >= packed_->cellCount && *_size <= 0xFFFF)
+    {
+        // Stays packed, as no stored cell is cut off.
+        packed_ = packed_->resized(unbox<uint16_t>(_size));
+        return;
+    }
+    unpack();
     buffer_.resize(unbox<size_t>(_size));
 }
 
 bool Line::blank() const noexcept
 {
-    return std::all_of(cbegin(), cend(), is_blank);
+    if (packed_)
+        return packed_->blank;
+    return std::all_of(buffer_.cbegin(), buffer_.cend(), is_blank);
+}
+
+Line::Buffer Line::pack(std::shared_ptr<PackedLine const> _recycled)
+{
+    Buffer released;
+    if (!packed_)
+    {
+        packed_ = PackedLine::pack(buffer_, move(_recycled));
+        if (!packed_)
+            return released;
+    }
+    released.swap(buffer_);
+    return released;
+}
+
+std::shared_ptr<PackedLine const> Line::unpack(Buffer&& _storage)
+{
+    if (!packed_)
+        return nullptr;
+    packed_->unpack(_storage);
+    buffer_.swap(_storage);
+    return move(packed_);
+}
+
+size_t Line::memoryUsage() const noexcept
+{
+    return sizeof(Line)
+         + buffer_.capacity() * sizeof(Cell)
+         + (packed_ ? packed_->memoryUsage() : 0);
 }
 
 Line::Buffer Line::reflow(ColumnCount _newColumnCount)
 {
+    Buffer wrappedColumns;
+    reflow(_newColumnCount, wrappedColumns);
+    return wrappedColumns;
+}
+
+void Line::reflow(ColumnCount _newColumnCount, Buffer& _wrappedColumns)
+{
+    unpack();
+    _wrappedColumns.clear();
     switch (crispy::strongCompare(_newColumnCount, size()))
     {
         case Comparison::Equal:
@@ -229,21 +586,434 @@ Line::Buffer Line::reflow(ColumnCount _newColumnCount)
                     return tuple{reflowStart, reflowEnd};
                 }();
 
-                auto removedColumns = Buffer(reflowStart, reflowEnd);
+                _wrappedColumns.assign(reflowStart, reflowEnd);
                 buffer_.erase(reflowStart, buffer_.end());
                 assert(size() == _newColumnCount);
-                return removedColumns;
             }
             else
             {
                 auto const reflowStart = next(buffer_.cbegin(), *_newColumnCount);
                 buffer_.erase(reflowStart, buffer_.end());
                 assert(size() == _newColumnCount);
-                return {};
             }
+            break;
         }
     }
-    return {};
+}
+// }}}
+// {{{ LinePool impl
+namespace
+{
+    /// Resets the cells still referring to a hyperlink or an image,
+    /// whereas all others are only reset once being reused.
+    void releaseReferences([[maybe_unused]] Line::Buffer& _cells) noexcept
+    {
+#if defined(LIBTERMINAL_HYPERLINKS) || defined(LIBTERMINAL_IMAGES)
+        for (Cell& cell: _cells)
+        {
+#if defined(LIBTERMINAL_HYPERLINKS)
+            if (cell.hyperlink())
+                cell.reset();
+#endif
+#if defined(LIBTERMINAL_IMAGES)
+            if (cell.imageFragment())
+                cell.reset();
+#endif
+        }
+#endif
+    }
+}
+
+void LinePool::setCapacity(size_t _capacity)
+{
+    capacity_ = _capacity;
+    if (buffers_.size() > capacity_)
+        buffers_.resize(capacity_);
+    if (packed_.size() > capacity_)
+        packed_.resize(capacity_);
+    buffers_.reserve(capacity_);
+    packed_.reserve(capacity_);
+}
+
+Line::Buffer LinePool::acquireBuffer()
+{
+    if (buffers_.empty())
+        return {};
+    auto buffer = move(buffers_.back());
+    buffers_.pop_back();
+    buffer.clear();
+    return buffer;
+}
+
+Line::Buffer LinePool::acquireBuffer(ColumnCount _columns, GraphicsAttributes _attributes)
+{
+    if (buffers_.empty())
+        return Line::Buffer(unbox<size_t>(_columns), Cell{{}, _attributes});
+
+    auto buffer = move(buffers_.back());
+    buffers_.pop_back();
+    buffer.resize(unbox<size_t>(_columns));
+    for (Cell& cell: buffer)
+        cell.reset(_attributes);
+    return buffer;
+}
+
+std::shared_ptr<PackedLine const> LinePool::acquirePacked()
+{
+    if (packed_.empty())
+        return nullptr;
+    auto packed = move(packed_.back());
+    packed_.pop_back();
+    return packed;
+}
+
+void LinePool::recycle(Line::Buffer&& _buffer)
+{
+    if (_buffer.capacity() == 0 || buffers_.size() >= capacity_)
+        return;
+    releaseReferences(_buffer);
+    buffers_.emplace_back(move(_buffer));
+}
+
+void LinePool::recycle(std::shared_ptr<PackedLine const>&& _packed)
+{
+    // Packed lines still referenced, such as by a copied line, or ever shared with
+    // another thread, such as by a snapshot, must not be touched.
+    if (!_packed || _packed.use_count() != 1 || _packed->shared.load(std::memory_order_relaxed)
+            || packed_.size() >= capacity_)
+        return;
+    std::const_pointer_cast<PackedLine>(_packed)->clear();
+    packed_.emplace_back(move(_packed));
+}
+
+void LinePool::recycle(Line&& _line)
+{
+    auto [buffer, packed] = _line.release();
+    recycle(move(buffer));
+    recycle(move(packed));
+}
+
+size_t LinePool::memoryUsage() const noexcept
+{
+    auto bytes = buffers_.capacity() * sizeof(Line::Buffer) + packed_.capacity() * sizeof(packed_.front());
+    for (Line::Buffer const& buffer: buffers_)
+        bytes += buffer.capacity() * sizeof(Cell);
+    for (auto const& packed: packed_)
+        bytes += packed->memoryUsage();
+    return bytes;
+}
+// }}}
+// {{{ SharedHistory impl
+void SharedHistory::push(uint64_t _serial, Line const& _line)
+{
+    if (current_ && current_->endLine() != _serial)
+        seal();
+
+    if (!current_)
+    {
+        if (sealed_.empty())
+            firstLine_ = _serial;
+        current_ = std::make_shared<Chunk>();
+        current_->firstLine = _serial;
+        current_->lines.reserve(ChunkLineCount);
+    }
+
+    current_->lines.emplace_back(_line.sharedCopy());
+
+    if (current_->lines.size() == ChunkLineCount)
+        seal();
+}
+
+void SharedHistory::seal()
+{
+    if (current_ && !current_->lines.empty())
+        sealed_.emplace_back(move(current_));
+    current_.reset();
+}
+
+void SharedHistory::evict(uint64_t _serial)
+{
+    firstLine_ = std::max(firstLine_, _serial);
+
+    while (!sealed_.empty() && sealed_.front()->endLine() <= _serial)
+        sealed_.pop_front();
+
+    if (sealed_.empty() && current_ && current_->endLine() <= _serial)
+        current_.reset();
+}
+
+void SharedHistory::truncate(uint64_t _serial)
+{
+    if (current_ && current_->firstLine >= _serial)
+        current_.reset();
+
+    while (!sealed_.empty() && sealed_.back()->firstLine >= _serial)
+        sealed_.pop_back();
+
+    if (!current_ && !sealed_.empty() && sealed_.back()->endLine() > _serial)
+    {
+        // Reopen the last sealed chunk as a private copy, as snapshots may still share it.
+        current_ = std::make_shared<Chunk>(*sealed_.back());
+        sealed_.pop_back();
+    }
+
+    if (current_ && current_->endLine() > _serial)
+        current_->lines.resize(static_cast<size_t>(_serial - current_->firstLine));
+}
+
+void SharedHistory::clear()
+{
+    sealed_.clear();
+    current_.reset();
+    firstLine_ = 0;
+}
+
+uint64_t SharedHistory::endLine() const noexcept
+{
+    if (current_)
+        return current_->endLine();
+    if (!sealed_.empty())
+        return sealed_.back()->endLine();
+    return firstLine_;
+}
+
+size_t SharedHistory::memoryUsage() const noexcept
+{
+    auto const bytesOf = [](Chunk const& _chunk) {
+        return sizeof(Chunk) + _chunk.lines.capacity() * sizeof(Line);
+    };
+    size_t bytes = current_ ? bytesOf(*current_) : 0;
+    for (auto const& chunk: sealed_)
+        bytes += bytesOf(*chunk);
+    return bytes;
+}
+
+std::vector<SharedHistory::ChunkPtr> SharedHistory::snapshot() const
+{
+    std::vector<ChunkPtr> chunks;
+    chunks.reserve(sealed_.size() + 1);
+    std::copy(sealed_.begin(), sealed_.end(), std::back_inserter(chunks));
+    if (current_ && !current_->lines.empty())
+        chunks.emplace_back(std::make_shared<Chunk const>(*current_));
+    return chunks;
+}
+// }}}
+// {{{ GridSnapshot impl
+Line GridSnapshot::absoluteLineAt(int _line) const
+{
+    assert(contains(_line));
+
+    auto const historyLines = unbox<int>(historyLineCount_);
+    if (_line >= historyLines)
+        return page_[static_cast<size_t>(_line - historyLines)];
+
+    auto const serial = lineSerialBase_ + static_cast<uint64_t>(_line);
+    auto const chunk = std::upper_bound(chunks_.begin(), chunks_.end(), serial,
+                                        [](uint64_t _serial, auto const& _chunk) { return _serial < _chunk->firstLine; });
+    assert(chunk != chunks_.begin());
+    auto const& lines = (*prev(chunk))->lines;
+    return lines[static_cast<size_t>(serial - (*prev(chunk))->firstLine)].sharedCopy();
+}
+// }}}
+// {{{ LineReflow impl
+namespace
+{
+    /// Packs @p _line, recycling memory through @p _pool.
+    void packLine(Line& _line, LinePool& _pool)
+    {
+        _pool.recycle(_line.pack(_line.packed() ? nullptr : _pool.acquirePacked()));
+    }
+
+    /**
+     * Reflows a range of lines, starting at the beginning of a logical line, to a new page width.
+     *
+     * The source lines are consumed, their memory being recycled for the reflowed lines.
+     * All but the last @c _unpackedLineCount reflowed lines are certain to end up in the
+     * history, so they are packed right away and their cell buffers reused.
+     *
+     * Ranges starting at logical line boundaries do not depend on each other,
+     * so that they may be reflowed concurrently, each with its own line pool.
+     */
+    class LineReflow
+    {
+      public:
+        LineReflow(ColumnCount _newColumnCount, size_t _unpackedLineCount, LinePool& _pool):
+            newColumnCount_{_newColumnCount},
+            unpackedLineCount_{_unpackedLineCount},
+            pool_{_pool}
+        {}
+
+        /// Grows columns by joining each logical line and wrapping it at the new width.
+        void grow(crispy::range<Lines::iterator> _lines);
+
+        /// Shrinks columns by carrying the wrapped columns of a line over into the next one.
+        void shrink(crispy::range<Lines::iterator> _lines);
+
+        Lines& lines() noexcept { return lines_; }
+
+        /// Cells cut off non-wrappable lines, which may hold the last reference to an image.
+        ///
+        /// Images must only be released on the grid's thread, as ImagePool is not thread-safe.
+        Line::Buffer& discardedCells() noexcept { return discardedCells_; }
+
+      private:
+        /// Appends the logical line @p _cells, split into lines of the new width.
+        void addWrappedLines(crispy::span<Cell const> _cells, Line::Flags _baseFlags, bool _initialNoWrap);
+
+        void append(Line&& _line);
+
+        ColumnCount const newColumnCount_;
+        size_t const unpackedLineCount_;
+        LinePool& pool_;
+        Lines lines_;
+        Line::Buffer discardedCells_;
+    };
+
+    void LineReflow::grow(crispy::range<Lines::iterator> _lines)
+    {
+        Line::Buffer logicalLineBuffer; // Temporary state, representing wrapped columns from the line "below".
+        Line::Flags logicalLineFlags = Line::Flags::None;
+
+        [[maybe_unused]] auto i = 1;
+        for (Line& line : _lines)
+        {
+            LOG_REFLOW("{:>2}: line: '{}' (wrapped: '{}') {}",
+                 i++,
+                 line.toUtf8(),
+                 Line(Line::Buffer(logicalLineBuffer), line.flags()).toUtf8(),
+                 line.wrapped() ? "WRAPPED" : "");
+
+            if (line.wrapped())
+            {
+                // Read through forEachCell(), so that packed history lines are not unpacked.
+                auto const joinOffset = logicalLineBuffer.size();
+                line.forEachCell([&](Cell const& _cell) { logicalLineBuffer.emplace_back(_cell); });
+                while (logicalLineBuffer.size() > joinOffset && is_blank(logicalLineBuffer.back()))
+                    logicalLineBuffer.pop_back();
+                LOG_REFLOW(" - join: '{}'", Line(Line::Buffer(logicalLineBuffer), line.flags()).toUtf8());
+            }
+            else // line is not wrapped
+            {
+                if (!logicalLineBuffer.empty())
+                {
+                    addWrappedLines(cellsOf(logicalLineBuffer), logicalLineFlags, true);
+                    logicalLineBuffer.clear();
+                }
+
+                line.forEachCell([&](Cell const& _cell) { logicalLineBuffer.emplace_back(_cell); });
+                logicalLineFlags = line.wrappableFlag() | line.markedFlag();
+
+                LOG_REFLOW(" - start new logical line: '{}'", line.toUtf8());
+            }
+
+            // The line's cells are consumed, so its memory can go to the reflowed lines.
+            pool_.recycle(move(line));
+        }
+
+        addWrappedLines(cellsOf(logicalLineBuffer), logicalLineFlags, true);
+    }
+
+    void LineReflow::shrink(crispy::range<Lines::iterator> _lines)
+    {
+        // {{{ Shrinking progress
+        // -----------------------------------------------------------------------
+        //  (one-by-one)        | (from-5-to-2)
+        // -----------------------------------------------------------------------
+        // "ABCDE"              | "ABCDE"
+        // "abcde"              | "xy   "
+        // ->                   | "abcde"
+        // "ABCD"               | ->
+        // "E   "   Wrapped     | "AB"                  push "AB", wrap "CDE"
+        // "abcd"               | "CD"      Wrapped     push "CD", wrap "E"
+        // "e   "   Wrapped     | "E"       Wrapped     push "E",  inc line
+        // ->                   | "xy"      no-wrapped  push "xy", inc line
+        // "ABC"                | "ab"      no-wrapped  push "ab", wrap "cde"
+        // "DE "    Wrapped     | "cd"      Wrapped     push "cd", wrap "e"
+        // "abc"                | "e "      Wrapped     push "e",  inc line
+        // "de "    Wrapped
+        // ->
+        // "AB"
+        // "DE"     Wrapped
+        // "E "     Wrapped
+        // "ab"
+        // "cd"     Wrapped
+        // "e "     Wrapped
+        // }}}
+
+        Line::Buffer wrappedColumns;
+        Line::Flags previousFlags = _lines.begin()->inheritableFlags();
+
+        [[maybe_unused]] int i = 0;
+        for (Line& line : _lines)
+        {
+            LOG_REFLOW("shrink line {}: \"{}\" wrapped: \"{}\"",
+                i,
+                line.toUtf8(),
+                Line(Line::Buffer(wrappedColumns), previousFlags).toUtf8()
+            );
+
+            // Packed history lines are unpacked into (and later packed again from) recycled memory.
+            if (line.packed())
+                pool_.recycle(line.unpack(pool_.acquireBuffer()));
+
+            // do we have previous columns carried?
+            if (!wrappedColumns.empty())
+            {
+                if (line.wrapped() && line.inheritableFlags() == previousFlags)
+                {
+                    assert(previousFlags == line.inheritableFlags());
+                    // Prepend previously wrapped columns into current line.
+                    line.prepend(wrappedColumns);
+                }
+                else
+                {
+                    // Insert NEW line(s) between previous and this line with previously wrapped columns.
+                    addWrappedLines(cellsOf(wrappedColumns), previousFlags, false);
+                    previousFlags = line.inheritableFlags();
+                }
+            }
+            else
+            {
+                previousFlags = line.inheritableFlags();
+            }
+
+            if (!line.wrappable() && line.size() > newColumnCount_)
+                std::move(next(line.begin(), unbox<long>(newColumnCount_)), line.end(), back_inserter(discardedCells_));
+
+            line.reflow(newColumnCount_, wrappedColumns);
+
+            LOG_REFLOW(" - ADD LINE: '{}' ({}) wrapped: \"{}\"", line.toUtf8(), line.flags(),
+                Line(Line::Buffer(wrappedColumns), Line::Flags::None).toUtf8());
+
+            append(move(line));
+            assert(lines_.back().size() >= newColumnCount_);
+            i++;
+        }
+        addWrappedLines(cellsOf(wrappedColumns), previousFlags, false);
+    }
+
+    void LineReflow::addWrappedLines(crispy::span<Cell const> _cells, Line::Flags _baseFlags, bool _initialNoWrap)
+    {
+        auto const columns = unbox<size_t>(newColumnCount_);
+        for (size_t offset = 0; offset < _cells.size(); offset += columns)
+        {
+            auto buffer = pool_.acquireBuffer();
+            auto const from = next(_cells.begin(), static_cast<long>(offset));
+            buffer.insert(buffer.end(), from, next(from, static_cast<long>(min(columns, _cells.size() - offset))));
+            buffer.resize(columns);
+
+            auto const wrappedFlag = offset == 0 && _initialNoWrap ? Line::Flags::None : Line::Flags::Wrapped;
+            append(Line(move(buffer), _baseFlags | wrappedFlag));
+            LOG_REFLOW(" - add line: '{}' ({})", lines_.back().toUtf8(), lines_.back().flags());
+        }
+    }
+
+    void LineReflow::append(Line&& _line)
+    {
+        lines_.emplace_back(move(_line));
+        if (lines_.size() > unpackedLineCount_)
+            packLine(lines_[lines_.size() - 1 - unpackedLineCount_], pool_);
+    }
 }
 // }}}
 // {{{ Grid impl
@@ -258,51 +1028,75 @@ Grid::Grid(PageSize _screenSize, bool _reflowOnResize, optional<LineCount> _maxH
             Cell{},
             _reflowOnResize ? Line::Flags::Wrappable : Line::Flags::None
         )
-    )
+    ),
+    linePool_{unbox<size_t>(_screenSize.lines)}
 {
 }
 
-/**
- * Appends logical line by splitting into fixed-width lines.
- *
- * @param _targetLines
- * @param _newColumnCount
- * @param _logicalLineBuffer
- * @param _baseFlags
- * @param _initialNoWrap
- */
-void addNewWrappedLines(Lines& _targetLines,
-                        ColumnCount _newColumnCount,
-                        Line::Buffer&& _logicalLineBuffer, // TODO: don't move, do (c)ref instead
-                        Line::Flags _baseFlags,
-                        bool _initialNoWrap)
-{
-    // TODO: avoid unnecessary copies via erase() by incrementally updating (from, to)
-    int i = 0;
-
-    while (_logicalLineBuffer.size() >= *_newColumnCount)
-    {
-        auto from = begin(_logicalLineBuffer);
-        auto to = next(begin(_logicalLineBuffer), unbox<long>(_newColumnCount));
-        auto const wrappedFlag = i == 0 && _initialNoWrap ? Line::Flags::None : Line::Flags::Wrapped;
-        _targetLines.emplace_back(Line(from, to, _baseFlags | wrappedFlag));
-        logf(" - add line: '{}' ({})", _targetLines.back().toUtf8(), _targetLines.back().flags());
-        _logicalLineBuffer.erase(from, to);
-        ++i;
+void Grid::setMaxHistoryLineCount(optional<LineCount> _maxHistoryLineCount)
+{
+    maxHistoryLineCount_ = _maxHistoryLineCount;
+    clampHistory();
+}
+
+void Grid::setColdHistory(optional<ColdHistorySettings> const& _settings)
+{
+    if (!_settings)
+    {
+        thawHistory(coldLineCount());
+        coldHistory_.reset();
+        historyIndex_.setSpillDirectory(std::nullopt);
+        return;
     }
 
-    if (_logicalLineBuffer.size() > 0)
+    if (!coldHistory_)
+        coldHistory_ = std::make_unique<ColdHistory>(_settings->spillDirectory);
+#if !defined(_WIN32)
+    // Without mmap() support, the spill file is held in memory anyway,
+    // and it could not be read from the search thread.
+    historyIndex_.setSpillDirectory(_settings->spillDirectory);
+#endif
+
+    hotHistoryLineCount_ = _settings->hotLineCount;
+    freezeHistory();
+}
+
+void Grid::freezeHistory()
+{
+    if (!coldHistory_)
+        return;
+
+    // Lines are frozen in batches, to amortize the cost of writing out a block.
+    auto const hotLines = historyLineCount() - coldLineCount();
+    if (hotLines <= hotHistoryLineCount_ + LineCount::cast_from(ColdHistory::BlockLineCount))
+        return;
+
+    auto const count = unbox<long>(hotLines - hotHistoryLineCount_);
+    for (Line& line: crispy::range(lines_.begin(), next(lines_.begin(), count)))
     {
-        auto const wrappedFlag = i == 0 && _initialNoWrap ? Line::Flags::None : Line::Flags::Wrapped;
-        _targetLines.emplace_back(Line(_newColumnCount, move(_logicalLineBuffer), _baseFlags | wrappedFlag));
-        logf(" - add line: '{}' ({})", _targetLines.back().toUtf8(), _targetLines.back().flags());
+        coldHistory_->push(line);
+        linePool_.recycle(move(line));
     }
+    lines_.erase(lines_.begin(), next(lines_.begin(), count));
+    sharedHistory_.evict(lineSerial(unbox<int>(coldLineCount())));
+    historyIndex_.spill(lineSerial(unbox<int>(coldLineCount())));
 }
 
-void Grid::setMaxHistoryLineCount(optional<LineCount> _maxHistoryLineCount)
+void Grid::thawHistory(LineCount _count)
 {
-    maxHistoryLineCount_ = _maxHistoryLineCount;
-    clampHistory();
+    if (!coldHistory_)
+        return;
+
+    auto lines = coldHistory_->popBack(unbox<size_t>(_count), screenSize_.columns);
+    lines_.insert(lines_.begin(), std::make_move_iterator(lines.begin()), std::make_move_iterator(lines.end()));
+}
+
+Lines Grid::materializePage(int _top) const
+{
+    Lines page;
+    for (int i = 0; i < unbox<int>(screenSize_.lines); ++i)
+        page.emplace_back(absoluteLineCopyAt(_top + i));
+    return page;
 }
 
 // TODO: rename to include word Logical
@@ -345,6 +1139,8 @@ Coordinate Grid::resize(PageSize _newSize, Coordinate _currentCursorPos, bool _w
         // or create new ones until screenSize_.lines == _newHeight.
 
         auto const extendCount = _newHeight - screenSize_.lines;
+        if (coldHistory_)
+            thawHistory(extendCount - min(extendCount, historyLineCount() - coldLineCount()));
         auto const rowsToTakeFromSavedLines = min(extendCount, historyLineCount());
         auto const fillLineCount = extendCount - rowsToTakeFromSavedLines;
         auto const wrappableFlag = lines_.back().wrappableFlag();
@@ -355,10 +1151,19 @@ Coordinate Grid::resize(PageSize _newSize, Coordinate _currentCursorPos, bool _w
         generate_n(
             back_inserter(lines_),
             *fillLineCount,
-            [this, wrappableFlag]() { return Line(screenSize_.columns, Cell{}, wrappableFlag); }
+            [this, wrappableFlag]() { return Line(linePool_.acquireBuffer(screenSize_.columns, GraphicsAttributes{}), wrappableFlag); }
         );
 
         screenSize_.lines = _newHeight;
+        linePool_.setCapacity(unbox<size_t>(_newHeight));
+
+        // Page lines are never packed, so that their cells can be referred to (see Line::operator[]).
+        for (Line& line: mainPage())
+            if (line.packed())
+                linePool_.recycle(line.unpack(linePool_.acquireBuffer()));
+
+        historyIndex_.truncate(lineSerial(unbox<int>(historyLineCount())));
+        sharedHistory_.truncate(lineSerial(unbox<int>(historyLineCount())));
 
         return Coordinate{unbox<int>(rowsToTakeFromSavedLines), 0};
     };
@@ -372,14 +1177,20 @@ Coordinate Grid::resize(PageSize _newSize, Coordinate _currentCursorPos, bool _w
         {
             auto const shrinkedLinesCount = screenSize_.lines - LineCount(_newHeight);
             screenSize_.lines = _newHeight;
+            linePool_.setCapacity(unbox<size_t>(_newHeight));
             clampHistory();
+            packHistory(shrinkedLinesCount);
             return Coordinate{-unbox<int>(shrinkedLinesCount), 0};
         }
         else
         {
             // Hard-cut below cursor by the number of lines to shrink.
-            lines_.resize(unbox<size_t>(historyLineCount() + _newHeight));
+            auto const newLineCount = lines_.size() - unbox<size_t>(screenSize_.lines - _newHeight);
             screenSize_.lines = _newHeight;
+            linePool_.setCapacity(unbox<size_t>(_newHeight));
+            for (Line& line: crispy::range(next(lines_.begin(), static_cast<long>(newLineCount)), lines_.end()))
+                linePool_.recycle(move(line));
+            lines_.resize(newLineCount);
             return Coordinate{0, 0};
         }
     };
@@ -402,49 +1213,9 @@ Coordinate Grid::resize(PageSize _newSize, Coordinate _currentCursorPos, bool _w
             auto const extendCount = _newColumnCount - screenSize_.columns;
             assert(*extendCount > 0);
 
-            logf("Growing by {} cols", extendCount);
-
-            Lines grownLines;
-            Line::Buffer logicalLineBuffer; // Temporary state, representing wrapped columns from the line "below".
-            Line::Flags logicalLineFlags = Line::Flags::None;
-
-            [[maybe_unused]] auto i = 1;
-            for (Line& line : lines_)
-            {
-                logf("{:>2}: line: '{}' (wrapped: '{}') {}",
-                     i++,
-                     line.toUtf8(),
-                     Line(Line::Buffer(logicalLineBuffer), line.flags()).toUtf8(),
-                     line.wrapped() ? "WRAPPED" : "");
-                assert(line.size() >= screenSize_.columns);
-
-                if (line.wrapped())
-                {
-                    crispy::copy(line.trim_blank_right(), back_inserter(logicalLineBuffer));
-                    logf(" - join: '{}'", Line(Line::Buffer(logicalLineBuffer), line.flags()).toUtf8());
-                }
-                else // line is not wrapped
-                {
-                    if (!logicalLineBuffer.empty())
-                    {
-                        addNewWrappedLines(grownLines, _newColumnCount, move(logicalLineBuffer), logicalLineFlags, true);
-                        logicalLineBuffer.clear();
-                    }
-
-                    crispy::copy(line, back_inserter(logicalLineBuffer));
-                    logicalLineFlags = line.wrappableFlag() | line.markedFlag();
-
-                    logf(" - start new logical line: '{}'", line.toUtf8());
-                }
-            }
-
-            if (!logicalLineBuffer.empty())
-            {
-                addNewWrappedLines(grownLines, _newColumnCount, move(logicalLineBuffer), logicalLineFlags, true);
-                logicalLineBuffer.clear();
-            }
+            LOG_REFLOW("Growing by {} cols", extendCount);
 
-            lines_ = move(grownLines);
+            assignReflowedLines(reflowLines(_newColumnCount));
             screenSize_.columns = _newColumnCount;
 
             //auto diff = int(lines_.size()) - unbox<int>(screenSize_.lines);
@@ -472,77 +1243,7 @@ Coordinate Grid::resize(PageSize _newSize, Coordinate _currentCursorPos, bool _w
         }
         else
         {
-            // {{{ Shrinking progress
-            // -----------------------------------------------------------------------
-            //  (one-by-one)        | (from-5-to-2)
-            // -----------------------------------------------------------------------
-            // "ABCDE"              | "ABCDE"
-            // "abcde"              | "xy   "
-            // ->                   | "abcde"
-            // "ABCD"               | ->
-            // "E   "   Wrapped     | "AB"                  push "AB", wrap "CDE"
-            // "abcd"               | "CD"      Wrapped     push "CD", wrap "E"
-            // "e   "   Wrapped     | "E"       Wrapped     push "E",  inc line
-            // ->                   | "xy"      no-wrapped  push "xy", inc line
-            // "ABC"                | "ab"      no-wrapped  push "ab", wrap "cde"
-            // "DE "    Wrapped     | "cd"      Wrapped     push "cd", wrap "e"
-            // "abc"                | "e "      Wrapped     push "e",  inc line
-            // "de "    Wrapped
-            // ->
-            // "AB"
-            // "DE"     Wrapped
-            // "E "     Wrapped
-            // "ab"
-            // "cd"     Wrapped
-            // "e "     Wrapped
-            // }}}
-
-            Lines shrinkedLines;
-            Line::Buffer wrappedColumns;
-            Line::Flags previousFlags = lines_.front().inheritableFlags();
-
-            int i = 0;
-            for (Line& line : lines_)
-            {
-                logf("shrink line {}: \"{}\" wrapped: \"{}\"",
-                    i,
-                    line.toUtf8(),
-                    Line(Line::Buffer(wrappedColumns), previousFlags).toUtf8()
-                );
-                // do we have previous columns carried?
-                if (!wrappedColumns.empty())
-                {
-                    if (line.wrapped() && line.inheritableFlags() == previousFlags)
-                    {
-                        assert(previousFlags == line.inheritableFlags());
-                        // Prepend previously wrapped columns into current line.
-                        line.prepend(wrappedColumns);
-                    }
-                    else
-                    {
-                        // Insert NEW line(s) between previous and this line with previously wrapped columns.
-                        addNewWrappedLines(shrinkedLines, _newColumnCount, move(wrappedColumns), previousFlags, false);
-                        previousFlags = line.inheritableFlags();
-                    }
-                }
-                else
-                {
-                    previousFlags = line.inheritableFlags();
-                }
-
-                wrappedColumns = line.reflow(_newColumnCount);
-
-                auto const wrappedLine = Line(Line::Buffer(wrappedColumns), Line::Flags::None);
-                logf(" - ADD LINE: '{}' ({}) wrapped: \"{}\"", line.toUtf8(), line.flags(),
-                    Line(Line::Buffer(wrappedColumns), Line::Flags::None).toUtf8());
-
-                shrinkedLines.emplace_back(move(line));
-                assert(shrinkedLines.back().size() >= _newColumnCount);
-                i++;
-            }
-            addNewWrappedLines(shrinkedLines, _newColumnCount, move(wrappedColumns), previousFlags, false);
-
-            lines_ = move(shrinkedLines);
+            assignReflowedLines(reflowLines(_newColumnCount));
             screenSize_.columns = _newColumnCount;
 
             return _cursor; // TODO
@@ -584,18 +1285,25 @@ void Grid::appendNewLines(LineCount _count, GraphicsAttributes _attr)
 {
     auto const wrappableFlag = lines_.back().wrappableFlag();
 
-    if (historyLineCount() == maxHistoryLineCount().value_or(std::numeric_limits<LineCount>::max()))
+    if (historyLineCount() == maxHistoryLineCount().value_or(std::numeric_limits<LineCount>::max())
+        && coldLineCount() == LineCount(0))
     {
         // We've reached to history line count limit already.
-        // Rotate lines that would fall off down to the bottom again in a clean state.
-        // We do save quite some overhead due to avoiding unnecessary memory allocations.
+        // The line falling off the top hands its memory over, via the line pool,
+        // to the top page line moving into the history in packed form, which in turn
+        // hands its cell buffer over to the new line appended at the bottom.
+        auto const historyLines = unbox<size_t>(historyLineCount());
         for (int i = 0; i < unbox<int>(_count); ++i)
         {
-            Line line = move(lines_.front());
+            linePool_.recycle(move(lines_.front()));
             lines_.pop_front();
-            line.reset(_attr);
-            lines_.emplace_back(move(line));
+            if (historyLines != 0)
+                packLine(lines_[historyLines - 1], linePool_);
+            lines_.emplace_back(linePool_.acquireBuffer(screenSize_.columns, _attr), wrappableFlag);
         }
+        lineSerialBase_ += unbox<uint64_t>(_count);
+        historyIndex_.evict(lineSerialBase_);
+        sharedHistory_.evict(lineSerialBase_);
         return;
     }
 
@@ -604,16 +1312,188 @@ void Grid::appendNewLines(LineCount _count, GraphicsAttributes _attr)
         generate_n(
             back_inserter(lines_),
             *n,
-            [&]() { return Line(screenSize_.columns, Cell{{}, _attr}, wrappableFlag); }
+            [&]() { return Line(linePool_.acquireBuffer(screenSize_.columns, _attr), wrappableFlag); }
         );
         clampHistory();
+        packHistory(n);
+        freezeHistory();
+    }
+}
+
+void Grid::packHistory(LineCount _count)
+{
+    auto const hotLines = lines_.size() - unbox<size_t>(screenSize_.lines);
+    for (auto i = hotLines - min(hotLines, unbox<size_t>(_count)); i < hotLines; ++i)
+        packLine(lines_[i], linePool_);
+}
+
+LineCount Grid::updateHistoryIndex(optional<LineCount> _limit)
+{
+    auto const historyEnd = lineSerial(std::max(unbox<int>(historyLineCount()), 0));
+    auto serial = std::max(historyIndex_.endLine(), lineSerialBase_);
+    auto const end = _limit ? std::min(historyEnd, serial + unbox<uint64_t>(*_limit)) : historyEnd;
+
+    // Reads through the const interface, so that cold history lines are not thawed.
+    auto const& self = std::as_const(*this);
+    auto const coldLines = unbox<int>(coldLineCount());
+    for (; serial < end; ++serial)
+    {
+        auto const line = static_cast<int>(serial - lineSerialBase_);
+        if (line < coldLines)
+            historyIndex_.push(serial, absoluteLineCopyAt(line));
+        else
+            historyIndex_.push(serial, self.absoluteLineAt(line));
+    }
+    historyIndex_.spill(lineSerial(coldLines));
+
+    return LineCount::cast_from(historyEnd - end);
+}
+
+GridSnapshot Grid::snapshot(int _firstLine) const
+{
+    auto const coldLines = unbox<int>(coldLineCount());
+    auto const historyLines = unbox<int>(historyLineCount());
+
+    // Catch up with the lines that scrolled into the in-memory history since the last snapshot.
+    auto const hotBegin = lineSerial(coldLines);
+    auto const hotEnd = lineSerial(historyLines);
+    if (sharedHistory_.firstLine() > hotBegin)
+        sharedHistory_.clear(); // lines thawed from the cold history
+    sharedHistory_.evict(hotBegin);
+    for (auto serial = std::max(sharedHistory_.endLine(), hotBegin); serial < hotEnd; ++serial)
+        sharedHistory_.push(serial, absoluteLineAt(static_cast<int>(serial - lineSerialBase_)));
+
+    auto snapshot = GridSnapshot{};
+    snapshot.pageSize_ = screenSize_;
+    snapshot.historyLineCount_ = historyLineCount();
+    snapshot.firstLine_ = std::clamp(_firstLine, 0, coldLines);
+    snapshot.lineSerialBase_ = lineSerialBase_;
+
+    if (snapshot.firstLine_ < coldLines)
+    {
+        auto cold = std::make_shared<SharedHistory::Chunk>();
+        cold->firstLine = lineSerial(snapshot.firstLine_);
+        cold->lines.reserve(static_cast<size_t>(coldLines - snapshot.firstLine_));
+        for (int line = snapshot.firstLine_; line < coldLines; ++line)
+            cold->lines.emplace_back(absoluteLineCopyAt(line));
+        snapshot.chunks_.emplace_back(move(cold));
+    }
+
+    auto hot = sharedHistory_.snapshot();
+    move(hot.begin(), hot.end(), back_inserter(snapshot.chunks_));
+
+    auto const page = mainPage();
+    snapshot.page_.reserve(page.size());
+    for (Line const& line: page)
+        snapshot.page_.emplace_back(line.sharedCopy());
+
+    return snapshot;
+}
+
+void Grid::assignReflowedLines(Lines&& _lines)
+{
+    // Reflowed lines are new lines, so never hand out their old serial numbers again.
+    lineSerialBase_ += unbox<uint64_t>(coldLineCount()) + lines_.size();
+    lines_ = move(_lines);
+    historyIndex_.clear();
+    sharedHistory_.clear();
+    packHistory(LineCount::cast_from(lines_.size()));
+}
+
+Lines Grid::reflowLines(ColumnCount _newColumnCount)
+{
+    auto const grow = _newColumnCount > screenSize_.columns;
+    auto const pageLines = unbox<size_t>(screenSize_.lines);
+    auto const reflow = [grow](LineReflow& _reflow, Lines::iterator _begin, Lines::iterator _end) {
+        if (grow)
+            _reflow.grow(crispy::range(_begin, _end));
+        else
+            _reflow.shrink(crispy::range(_begin, _end));
+    };
+
+    // Split the lines into chunks at logical line boundaries, i.e. at lines not being wrapped.
+    auto const threadLimit = reflowThreadLimit_ ? reflowThreadLimit_ : std::max(std::thread::hardware_concurrency(), 1u);
+    auto const chunkCount = std::clamp(lines_.size() / MinReflowChunkLineCount, size_t{1}, size_t{threadLimit});
+    auto chunkStarts = std::vector<Lines::iterator>{lines_.begin()};
+    for (size_t i = 1; i < chunkCount; ++i)
+    {
+        auto start = next(lines_.begin(), static_cast<long>(i * lines_.size() / chunkCount));
+        if (start < chunkStarts.back())
+            start = chunkStarts.back();
+        while (start != lines_.end() && start->wrapped())
+            ++start;
+        if (start != chunkStarts.back() && start != lines_.end())
+            chunkStarts.push_back(start);
+    }
+    chunkStarts.push_back(lines_.end());
+
+    // The last chunk, holding the page, is reflowed by the calling thread, all others
+    // by one worker thread each. The lines of those end up in the history, so they are all packed.
+    auto const workerCount = chunkStarts.size() - 2;
+    auto pools = std::vector<LinePool>(workerCount, LinePool(pageLines));
+    auto reflows = std::vector<LineReflow>{};
+    reflows.reserve(workerCount + 1);
+    for (size_t i = 0; i < workerCount; ++i)
+        reflows.emplace_back(_newColumnCount, 0, pools[i]);
+    reflows.emplace_back(_newColumnCount, pageLines, linePool_);
+
+    auto errors = std::vector<std::exception_ptr>(workerCount);
+    auto workers = std::vector<std::thread>{};
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back([&, i]() {
+            try
+            {
+                reflow(reflows[i], chunkStarts[i], chunkStarts[i + 1]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
     }
+    reflow(reflows.back(), chunkStarts[workerCount], chunkStarts[workerCount + 1]);
+    for (std::thread& worker: workers)
+        worker.join();
+    for (auto const& error: errors)
+        if (error)
+            std::rethrow_exception(error);
+
+    // Splice the reflowed chunks.
+    auto lines = move(reflows.front().lines());
+    for (LineReflow& chunk: crispy::range(next(reflows.begin()), reflows.end()))
+        lines.insert(lines.end(), std::make_move_iterator(chunk.lines().begin()),
+                                  std::make_move_iterator(chunk.lines().end()));
+
+    // Page lines might still be packed, if the last chunk was reflowed into fewer lines than a page.
+    for (Line& line: crispy::range(next(lines.begin(), static_cast<long>(lines.size() - min(lines.size(), pageLines))), lines.end()))
+        if (line.packed())
+            linePool_.recycle(line.unpack(linePool_.acquireBuffer()));
+
+    return lines;
+}
+
+optional<int> Grid::absoluteLineOfSerial(uint64_t _serial) const noexcept
+{
+    if (_serial < lineSerialBase_ || _serial - lineSerialBase_ >= unbox<uint64_t>(coldLineCount()) + lines_.size())
+        return nullopt;
+    return static_cast<int>(_serial - lineSerialBase_);
 }
 
 void Grid::clearHistory()
 {
     if (*historyLineCount())
-        lines_.erase(begin(lines_), next(begin(lines_), *historyLineCount()));
+    {
+        lineSerialBase_ += unbox<uint64_t>(historyLineCount());
+        auto const hotLines = next(begin(lines_), *historyLineCount() - *coldLineCount());
+        for (Line& line: crispy::range(begin(lines_), hotLines))
+            linePool_.recycle(move(line));
+        lines_.erase(begin(lines_), hotLines);
+        if (coldHistory_)
+            coldHistory_->clear();
+    }
+    historyIndex_.clear();
+    sharedHistory_.clear();
 }
 
 void Grid::clampHistory()
@@ -629,7 +1509,7 @@ void Grid::clampHistory()
     auto const diff = actual - maxHistoryLines;
 
     // any line that moves into history is using the default Wrappable flag.
-    for (auto& line: lines(boxed_cast<LinePosition>(historyLineCount() - diff),
+    for (auto& line: lines(boxed_cast<LinePosition>(std::max(historyLineCount() - diff, coldLineCount())),
                            boxed_cast<LinePosition>(historyLineCount())))
     {
         auto const wrappable = true;
@@ -641,7 +1521,64 @@ void Grid::clampHistory()
         line.setFlag(Line::Flags::Wrappable, wrappable);
     }
 
-    lines_.erase(begin(lines_), next(begin(lines_), unbox<long>(diff)));
+    trimHistory(diff);
+}
+
+LineCount Grid::trimHistory(LineCount _count)
+{
+    auto const count = min(_count, historyLineCount());
+    if (!*count)
+        return count;
+
+    auto const coldCount = min(count, coldLineCount());
+    if (*coldCount)
+        coldHistory_->popFront(unbox<size_t>(coldCount));
+    auto const hotLines = next(begin(lines_), unbox<long>(count - coldCount));
+    for (Line& line: crispy::range(begin(lines_), hotLines))
+        linePool_.recycle(move(line));
+    lines_.erase(begin(lines_), hotLines);
+    lineSerialBase_ += unbox<uint64_t>(count);
+    historyIndex_.evict(lineSerialBase_);
+    sharedHistory_.evict(lineSerialBase_);
+    return count;
+}
+
+MemoryUsage Grid::memoryUsage() const
+{
+    auto usage = MemoryUsage{};
+    auto const pageTop = lines_.size() - unbox<size_t>(screenSize_.lines);
+    for (size_t i = 0; i < lines_.size(); ++i)
+        usage[i < pageTop ? MemoryCategory::History : MemoryCategory::Screen] += lines_[i].memoryUsage();
+    usage[MemoryCategory::Screen] += linePool_.memoryUsage();
+    if (coldHistory_)
+        usage[MemoryCategory::ColdHistory] = coldHistory_->memoryUsage();
+    usage[MemoryCategory::History] += sharedHistory_.memoryUsage();
+    usage[MemoryCategory::SearchIndex] = historyIndex_.memoryUsage();
+    return usage;
+}
+
+void Grid::fillArea(Margin const& _area, Cell const& _cell)
+{
+    for (int row = _area.vertical.from; row <= _area.vertical.to; ++row)
+        lineAt(row).fill(_area.horizontal.from - 1, _area.horizontal.length(), _cell);
+}
+
+void Grid::copyArea(Margin const& _source, Coordinate _target)
+{
+    auto const copyRow = [&](int _offset) {
+        lineAt(_target.row + _offset).copyCells(lineAt(_source.vertical.from + _offset),
+                                                 _source.horizontal.from - 1,
+                                                 _source.horizontal.length(),
+                                                 _target.column - 1);
+    };
+
+    // Rows are copied in the order that never overwrites a source row before it has been copied.
+    if (_target.row > _source.vertical.from)
+        for (int offset = _source.vertical.length() - 1; offset >= 0; --offset)
+            copyRow(offset);
+    else
+        for (int offset = 0; offset < _source.vertical.length(); ++offset)
+            copyRow(offset);
 }
 
 void Grid::scrollUp(LineCount _n, GraphicsAttributes const& _defaultAttributes, Margin const& _margin)
@@ -833,28 +1770,12 @@ void Grid::scrollDown(LineCount v_n, GraphicsAttributes const& _defaultAttribute
 
 string Grid::renderTextLineAbsolute(int row) const
 {
-    string line;
-    line.reserve(*screenSize_.columns);
-    for (int col = 1; col <= *screenSize_.columns; ++col)
-        if (auto const& cell = at({row - unbox<int>(historyLineCount()) + 1, col}); cell.codepointCount())
-            line += cell.toUtf8();
-        else
-            line += " "; // fill character
-
-    return line;
+    return renderTextOf(absoluteLineCopyAt(row), screenSize_.columns);
 }
 
 string Grid::renderTextLine(int row) const
 {
-    string line;
-    line.reserve(*screenSize_.columns);
-    for (int col = 1; col <= *screenSize_.columns; ++col)
-        if (auto const& cell = at({row, col}); cell.codepointCount())
-            line += cell.toUtf8();
-        else
-            line += " "; // fill character
-
-    return line;
+    return renderTextOf(lineCopyAt(row), screenSize_.columns);
 }
 
 string Grid::renderAllText() const
@@ -14,10 +14,13 @@
 #pragma once
 
 #include <terminal/Charset.h>
+#include <terminal/ColdHistory.h>
 #include <terminal/Color.h>
 #include <terminal/Coordinate.h>
+#include <terminal/HistoryIndex.h>
 #include <terminal/Hyperlink.h>
 #include <terminal/Image.h>
+#include <terminal/MemoryUsage.h>
 #include <terminal/primitives.h>
 
 #include <crispy/algorithm.h>
@@ -37,6 +40,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <list>
@@ -48,6 +52,7 @@
 #include <stack>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace terminal {
@@ -458,6 +463,159 @@ inline bool operator==(Cell const& a, Cell const& b) noexcept
 
 // }}}
 
+// {{{ PackedLine
+/**
+ * Compact, read-only representation of a line's cells, used for scrollback history lines.
+ *
+ * Trailing default cells are trimmed, the text is stored UTF-8 encoded and the graphics
+ * attributes as run-length encoded style runs, of which history lines usually
+ * only have a handful, rather than one per cell.
+ *
+ * Hyperlinks and image fragments are kept on the side, along with the column they belong to.
+ */
+struct PackedLine {
+    struct StyleRun {
+        uint16_t length;
+        GraphicsAttributes attributes;
+    };
+
+    struct CellExtra {
+        uint16_t column;
+#if defined(LIBTERMINAL_HYPERLINKS)
+        HyperlinkRef hyperlink;
+#endif
+#if defined(LIBTERMINAL_IMAGES)
+        std::optional<ImageFragment> imageFragment;
+#endif
+    };
+
+    uint16_t columns = 0;               //!< number of cells of the line
+    uint16_t cellCount = 0;             //!< number of cells stored, all others are default cells
+    bool blank = true;                  //!< no cell has any codepoints or image
+    std::string text;                   //!< UTF-8 encoded codepoints, with NUL for empty cells unless cellHeaders are used
+    std::vector<uint8_t> cellHeaders;   //!< (codepointCount << 4) | width per cell, only if any cell is not trivial
+    std::vector<StyleRun> styles;
+    std::vector<CellExtra> extras;      //!< ordered by column
+
+    /// Set once the line has been shared with other threads (see Line::sharedCopy()),
+    /// after which it is never modified again, and thus never recycled.
+    mutable std::atomic<bool> shared = false;
+
+    PackedLine() = default;
+
+    /// Copies the cells, but not whether they are shared.
+    PackedLine(PackedLine const& _other);
+    PackedLine& operator=(PackedLine const&) = delete;
+
+    /// Packs the given cells.
+    ///
+    /// @param _recycled a previously packed line no longer in use, whose memory is reused
+    ///                  if it is neither referenced nor has ever been shared with anyone else.
+    ///
+    /// @returns the packed cells, or nullptr if they cannot be represented in packed form.
+    static std::shared_ptr<PackedLine const> pack(std::vector<Cell> const& _cells,
+                                                  std::shared_ptr<PackedLine const> _recycled = {});
+
+    /// @returns a copy of this line resized to @p _columns, which must not cut any stored cell.
+    std::shared_ptr<PackedLine const> resized(uint16_t _columns) const;
+
+    std::vector<Cell> unpack() const;
+
+    /// Unpacks the cells into @p _cells, reusing its capacity.
+    void unpack(std::vector<Cell>& _cells) const;
+
+    /// @returns the cell at column offset @p _column, without unpacking any other cell.
+    Cell at(uint16_t _column) const;
+
+    /// Empties the line, keeping the capacity of its containers.
+    void clear() noexcept;
+
+    /// @returns the number of bytes occupied, including the heap.
+    size_t memoryUsage() const noexcept;
+
+    /// Invokes @p _visit for every cell, without unpacking the line.
+    ///
+    /// The cell passed is only valid for the duration of that call.
+    template <typename F>
+    void forEachCell(F&& _visit) const;
+
+    static char32_t decodeUtf8(uint8_t const*& _input) noexcept
+    {
+        auto const lead = *_input++;
+        if (lead < 0x80)
+            return lead;
+        if (lead < 0xE0)
+            return (char32_t(lead & 0x1F) << 6) | (*_input++ & 0x3F);
+        if (lead < 0xF0)
+        {
+            auto const codepoint = (char32_t(lead & 0x0F) << 12) | (char32_t(_input[0] & 0x3F) << 6) | (_input[1] & 0x3F);
+            _input += 2;
+            return codepoint;
+        }
+        auto const codepoint = (char32_t(lead & 0x07) << 18) | (char32_t(_input[0] & 0x3F) << 12)
+                             | (char32_t(_input[1] & 0x3F) << 6) | (_input[2] & 0x3F);
+        _input += 3;
+        return codepoint;
+    }
+};
+
+template <typename F>
+void PackedLine::forEachCell(F&& _visit) const
+{
+    auto input = reinterpret_cast<uint8_t const*>(text.data());
+    auto style = styles.begin();
+    unsigned styleCellsLeft = style != styles.end() ? style->length : 0;
+    auto extra = extras.begin();
+
+    Cell cell;
+    for (uint16_t column = 0; column < cellCount; ++column)
+    {
+        while (styleCellsLeft == 0)
+            styleCellsLeft = (++style)->length;
+        --styleCellsLeft;
+        cell.reset(style->attributes);
+
+        if (cellHeaders.empty())
+        {
+            if (*input)
+                cell.setCharacter(decodeUtf8(input));
+            else
+                ++input;
+        }
+        else
+        {
+            auto const header = cellHeaders[column];
+            for (unsigned i = 0; i < (header >> 4u); ++i)
+            {
+                if (i == 0)
+                    cell.setCharacter(decodeUtf8(input));
+                else
+                    cell.appendCharacter(decodeUtf8(input));
+            }
+            cell.setWidth(header & 0x0F);
+        }
+
+        if (extra != extras.end() && extra->column == column)
+        {
+#if defined(LIBTERMINAL_HYPERLINKS)
+            cell.setHyperlink(extra->hyperlink);
+#endif
+#if defined(LIBTERMINAL_IMAGES)
+            if (extra->imageFragment)
+                cell.setImage(*extra->imageFragment);
+#endif
+            ++extra;
+        }
+
+        _visit(static_cast<Cell const&>(cell));
+    }
+
+    auto const defaultCell = Cell{};
+    for (auto column = cellCount; column < columns; ++column)
+        _visit(defaultCell);
+}
+// }}}
+
 class Line { // {{{
   public:
     enum class Flags : uint8_t {
@@ -483,7 +641,7 @@ class Line { // {{{
     Line(ColumnCount _numCols, Buffer&& _init, Flags _flags);
     Line(ColumnCount _numCols, std::string_view const& _s, Flags _flags);
 
-    Buffer& buffer() noexcept { return buffer_; }
+    Buffer& buffer() { unpack(); return buffer_; }
 
     Line() = default;
     Line(Line const&) = default;
@@ -491,47 +649,130 @@ class Line { // {{{
     Line& operator=(Line const&) = default;
     Line& operator=(Line&&) = default;
 
-    void reset(GraphicsAttributes _attributes) noexcept
+    void reset(GraphicsAttributes _attributes)
     {
+        if (packed_)
+        {
+            buffer_.resize(packed_->columns);
+            packed_.reset();
+        }
         for (Cell& cell: buffer_)
             cell.reset(_attributes);
     }
 
-    Buffer* operator->() noexcept { return &buffer_; }
-    Buffer const* operator->() const noexcept { return &buffer_; }
-    auto& operator[](std::size_t _index) { return buffer_[_index]; }
-    auto const& operator[](std::size_t _index) const { return buffer_[_index]; }
+    Buffer* operator->() { unpack(); return &buffer_; }
+    auto& operator[](std::size_t _index) { unpack(); return buffer_[_index]; }
+
+    /// @returns the cell at column offset @p _index of an unpacked line (see cellAt()).
+    Cell const& operator[](std::size_t _index) const
+    {
+        assert(!packed_ && "Packed lines are read through cellAt() or forEachCell().");
+        return buffer_[_index];
+    }
+
+    /// @returns a copy of the cell at column offset @p _index, decoding it if packed.
+    Cell cellAt(std::size_t _index) const
+    {
+        return packed_ ? packed_->at(static_cast<uint16_t>(_index)) : buffer_[_index];
+    }
 
     void prepend(Buffer const&);
     void append(Buffer const&);
     void append(int _count, Cell const& _initial);
 
-    Buffer remove(iterator const& _from, iterator const& _to);
+    /// Removes the cells in range [@p _from, @p _to), storing them in @p _removed.
+    void remove(iterator const& _from, iterator const& _to, Buffer& _removed);
 
-    /// Shhift left by @p _count cells and fill right with cells of @p _fill.
+    /// Shifts left by @p _count cells and fills right with cells of @p _fill.
     ///
-    /// @returns sequence of cells that have been shifted out.
-    Buffer shift_left(int _count, Cell const& _fill);
+    /// @param _shiftedOut receives the cells that have been shifted out, with trailing blanks trimmed.
+    void shift_left(int _count, Cell const& _fill, Buffer& _shiftedOut);
+
+    /// Sets the @p _count cells starting at column offset @p _from to @p _cell.
+    void fill(int _from, int _count, Cell const& _cell);
 
-    crispy::range<const_iterator> trim_blank_right() const;
+    /// Moves the @p _count cells starting at column offset @p _from to column offset @p _to,
+    /// with the ranges possibly overlapping. Cells moved from are left unspecified.
+    void moveCells(int _from, int _count, int _to);
 
-    ColumnCount size() const noexcept { return ColumnCount::cast_from(buffer_.size()); }
+    /// Copies the @p _count cells of @p _source starting at column offset @p _from
+    /// to column offset @p _to of this line, which may also be @p _source itself.
+    void copyCells(Line const& _source, int _from, int _count, int _to);
+
+    crispy::range<const_iterator> trim_blank_right();
+
+    ColumnCount size() const noexcept
+    {
+        return packed_ ? ColumnCount(packed_->columns) : ColumnCount::cast_from(buffer_.size());
+    }
 
     bool blank() const noexcept;
 
     // TODO (trimmed version of size()): int maxOccupiedColumns() const noexcept { return size(); }
 
     void resize(ColumnCount _size);
+
+    /// Resizes the line to @p _column columns, in place.
+    ///
+    /// @param _wrappedColumns receives the (non-blank) columns cut off from a wrappable line,
+    ///                        reusing its capacity.
+    void reflow(ColumnCount _column, Buffer& _wrappedColumns);
     [[nodiscard]] Buffer reflow(ColumnCount _column);
 
-    iterator begin() { return buffer_.begin(); }
-    iterator end() { return buffer_.end(); }
-    const_iterator begin() const { return buffer_.begin(); }
-    const_iterator end() const { return buffer_.end(); }
-    reverse_iterator rbegin() { return buffer_.rbegin(); }
-    reverse_iterator rend() { return buffer_.rend(); }
-    const_iterator cbegin() const { return buffer_.cbegin(); }
-    const_iterator cend() const { return buffer_.cend(); }
+    // Const access does not iterate, as a packed line has no cells to refer to,
+    // use forEachCell() instead.
+    iterator begin() { unpack(); return buffer_.begin(); }
+    iterator end() { unpack(); return buffer_.end(); }
+    reverse_iterator rbegin() { unpack(); return buffer_.rbegin(); }
+    reverse_iterator rend() { unpack(); return buffer_.rend(); }
+
+    /// Invokes @p _visit for every cell, without unpacking a packed line.
+    ///
+    /// The cell passed is only guaranteed to be valid for the duration of that call.
+    template <typename F>
+    void forEachCell(F&& _visit) const
+    {
+        if (packed_)
+            packed_->forEachCell(std::forward<F>(_visit));
+        else
+            for (Cell const& cell: buffer_)
+                _visit(cell);
+    }
+
+    /// Converts the cells into their compact PackedLine form, which is
+    /// transparently unpacked again as soon as the cells are to be modified.
+    ///
+    /// @param _recycled a packed line no longer in use, for PackedLine::pack() to reuse.
+    ///
+    /// @returns the cell buffer released, so that the caller may reuse it.
+    Buffer pack(std::shared_ptr<PackedLine const> _recycled = {});
+
+    /// Unpacks a packed line into @p _storage, such as a recycled cell buffer (see LinePool).
+    ///
+    /// @returns the packed cells released, so that the caller may reuse them.
+    std::shared_ptr<PackedLine const> unpack(Buffer&& _storage);
+
+    bool packed() const noexcept { return packed_ != nullptr; }
+
+    /// @returns a copy of this line, to be shared across threads, sharing its packed cells, if packed.
+    ///
+    /// The packed cells are marked as shared, so that they are never recycled (see LinePool).
+    Line sharedCopy() const
+    {
+        if (packed_)
+            packed_->shared.store(true, std::memory_order_relaxed);
+        return *this;
+    }
+
+    /// Moves the cell buffer and the packed cells out of this line, leaving it empty,
+    /// so that their memory can be reused by other lines (see LinePool).
+    std::pair<Buffer, std::shared_ptr<PackedLine const>> release() noexcept
+    {
+        return {std::exchange(buffer_, Buffer{}), std::move(packed_)};
+    }
+
+    /// @returns the number of bytes occupied by this line, including the heap.
+    size_t memoryUsage() const noexcept;
 
     bool marked() const noexcept { return isFlagEnabled(Flags::Marked); }
     void setMarked(bool _enable) { setFlag(Flags::Marked, _enable); }
@@ -570,7 +811,17 @@ class Line { // {{{
     bool isFlagEnabled(Flags _flag) const noexcept { return (flags_ & static_cast<unsigned>(_flag)) != 0; }
 
   private:
-    Buffer buffer_;
+    /// Unpacks the cells for modification.
+    void unpack()
+    {
+        if (!packed_)
+            return;
+        packed_->unpack(buffer_);
+        packed_.reset();
+    }
+
+    Buffer buffer_;                             //!< the cells, empty if packed
+    std::shared_ptr<PackedLine const> packed_;
     unsigned flags_;
 };
 
@@ -591,10 +842,136 @@ using LineIterator = Lines::iterator;
 
 inline auto begin(Line& _line) { return _line.begin(); }
 inline auto end(Line& _line) { return _line.end(); }
-inline auto begin(Line const& _line) { return _line.cbegin(); }
-inline auto end(Line const& _line) { return _line.cend(); }
-inline Line::const_iterator cbegin(Line const& _line) { return _line.cbegin(); }
-inline Line::const_iterator cend(Line const& _line) { return _line.cend(); }
+
+/**
+ * Keeps the memory of lines dropped from a Grid, i.e. their cell buffers and packed cells,
+ * for reuse by the lines created next.
+ *
+ * Scrolling, clamping the history and reflowing on resize drop about as many lines as
+ * they create, so that they mostly get by without any heap allocation for line storage.
+ *
+ * Recycled cells are reset right away, so that they do not keep any hyperlinks or images alive.
+ */
+class LinePool {
+  public:
+    /// @param _capacity maximum number of cell buffers, and of packed lines, to keep.
+    explicit LinePool(size_t _capacity = 0) { setCapacity(_capacity); }
+
+    size_t capacity() const noexcept { return capacity_; }
+    void setCapacity(size_t _capacity);
+
+    /// @returns an empty cell buffer, with the capacity of a recycled one if available.
+    Line::Buffer acquireBuffer();
+
+    /// @returns a cell buffer of @p _columns empty cells with the given graphics attributes.
+    Line::Buffer acquireBuffer(ColumnCount _columns, GraphicsAttributes _attributes);
+
+    /// @returns an empty packed line for PackedLine::pack() to reuse, or nullptr if none available.
+    std::shared_ptr<PackedLine const> acquirePacked();
+
+    void recycle(Line::Buffer&& _buffer);
+    void recycle(std::shared_ptr<PackedLine const>&& _packed);
+    void recycle(Line&& _line);
+
+    /// @returns the number of bytes kept for reuse.
+    size_t memoryUsage() const noexcept;
+
+  private:
+    size_t capacity_ = 0;
+    std::vector<Line::Buffer> buffers_;
+    std::vector<std::shared_ptr<PackedLine const>> packed_;
+};
+
+/**
+ * Scrollback history lines in immutable, reference counted chunks, for Grid::snapshot().
+ *
+ * Lines are pushed lazily, when a snapshot is taken, and dropped as they fall off the top
+ * of the history or move into cold storage. Full chunks are shared with snapshots, so that
+ * taking one does not copy any history line, and readers never see them change.
+ */
+class SharedHistory {
+  public:
+    static constexpr size_t ChunkLineCount = 256;
+
+    struct Chunk {
+        uint64_t firstLine = 0;
+        std::vector<Line> lines;
+
+        uint64_t endLine() const noexcept { return firstLine + lines.size(); }
+    };
+
+    using ChunkPtr = std::shared_ptr<Chunk const>;
+
+    /// Shares @p _line as the line with serial number @p _serial.
+    void push(uint64_t _serial, Line const& _line);
+
+    /// Forgets all lines with a serial number lower than @p _serial.
+    ///
+    /// Chunks are dropped as a whole, once none of their lines is left.
+    void evict(uint64_t _serial);
+
+    /// Forgets all lines with a serial number of at least @p _serial.
+    void truncate(uint64_t _serial);
+
+    void clear();
+
+    /// @returns the serial number of the oldest line still available.
+    uint64_t firstLine() const noexcept { return firstLine_; }
+
+    /// @returns the serial number following the most recently pushed line.
+    uint64_t endLine() const noexcept;
+
+    /// @returns the number of bytes occupied by the chunks, not counting the packed cells
+    /// they share with the grid's lines.
+    size_t memoryUsage() const noexcept;
+
+    /// @returns all chunks in ascending order, the currently filling one copied.
+    std::vector<ChunkPtr> snapshot() const;
+
+  private:
+    void seal();
+
+    std::deque<ChunkPtr> sealed_;
+    std::shared_ptr<Chunk> current_;
+    uint64_t firstLine_ = 0;
+};
+
+/**
+ * Read-only copy of a grid's lines, as taken by Grid::snapshot().
+ *
+ * History lines are shared with the grid and only the main page is copied, so that
+ * a snapshot is cheap to take while holding the terminal's lock, and can then be read
+ * from on any thread without it, while the grid keeps on changing.
+ */
+class GridSnapshot {
+  public:
+    PageSize pageSize() const noexcept { return pageSize_; }
+
+    /// @returns the number of history lines the grid had when the snapshot was taken.
+    LineCount historyLineCount() const noexcept { return historyLineCount_; }
+
+    /// Tests whether the line at absolute line @p _line is part of this snapshot.
+    bool contains(int _line) const noexcept
+    {
+        return firstLine_ <= _line && _line < unbox<int>(historyLineCount_ + pageSize_.lines);
+    }
+
+    /// @returns a copy of the line at absolute line @p _line, which must be contained.
+    Line absoluteLineAt(int _line) const;
+
+    /// @returns a copy of the line at relative line @p _line (see Grid::lineAt()).
+    Line lineAt(int _line) const { return absoluteLineAt(unbox<int>(historyLineCount_) + _line - 1); }
+
+  private:
+    friend class Grid;
+
+    PageSize pageSize_;
+    LineCount historyLineCount_{};
+    int firstLine_ = 0;                    //!< absolute line of the oldest line contained
+    uint64_t lineSerialBase_ = 0;          //!< serial number of absolute line 0
+    std::vector<SharedHistory::ChunkPtr> chunks_;
+    std::vector<Line> page_;
+};
 
 /**
  * Manages the screen grid buffer (main screen + scrollback history).
@@ -603,9 +980,28 @@ inline Line::const_iterator cend(Line const& _line) { return _line.cend(); }
  *
  * <ul>
  *   <li>manages text reflow upon resize
- *   <li>manages underlying disk storage for very old scrollback history lines.
  * </ul>
  *
+ * <h3>Packed history</h3>
+ *
+ * Lines are packed (see PackedLine) as they scroll off the main page, and transparently
+ * unpacked again when written to, such as when they move back onto the main page.
+ *
+ * The memory of lines dropped from the grid is recycled for the ones created next (see LinePool).
+ *
+ * <h3>Snapshots</h3>
+ *
+ * Packed history lines are immutable, so that they are shared in chunks with snapshots
+ * (see snapshot()), which are read from without holding the terminal's lock.
+ *
+ * <h3>Cold history</h3>
+ *
+ * When enabled (see setColdHistory()), only the most recent history lines are kept
+ * as Line objects, older ones are moved into a compressed, disk-backed ColdHistory
+ * and decoded on demand whenever they are accessed. Cold history lines are read by value
+ * (see absoluteLineCopyAt() and cellAt()), and moved back into memory when they are
+ * about to be modified. They are not reflowed on resize.
+ *
  * <h3>Layout</h3>
  *
  * <pre>
@@ -644,25 +1040,58 @@ class Grid {
     std::optional<LineCount> maxHistoryLineCount() const noexcept { return maxHistoryLineCount_; }
     void setMaxHistoryLineCount(std::optional<LineCount> _maxHistoryLineCount);
 
+    /// Enables (or disables) moving old history lines into disk-backed cold storage.
+    ///
+    /// @throws std::system_error if the spill file could not be created.
+    void setColdHistory(std::optional<ColdHistorySettings> const& _settings);
+
+    /// @returns the cold history storage, if enabled.
+    ColdHistory const* coldHistory() const noexcept { return coldHistory_.get(); }
+
     bool reflowOnResize() const noexcept { return reflowOnResize_; }
     void setReflowOnResize(bool _enabled) { reflowOnResize_ = _enabled; }
 
+    /// Minimum number of lines for reflowing to be worth another thread.
+    static constexpr inline size_t MinReflowChunkLineCount = 8192;
+
+    /// Limits the number of threads reflowing lines on resize, or 0 for one per hardware thread.
+    void setReflowThreadLimit(unsigned _limit) noexcept { reflowThreadLimit_ = _limit; }
+
     LineCount historyLineCount() const noexcept
     {
-        return LineCount::cast_from(lines_.size()) - screenSize_.lines;
+        return coldLineCount() + LineCount::cast_from(lines_.size()) - screenSize_.lines;
     }
 
     /// Renders the full screen by passing every grid cell to the callback.
     template <typename RendererT>
     void render(RendererT && _render, std::optional<StaticScrollbackPosition> _scrollOffset = std::nullopt) const;
 
+    /// @returns reference to Line at given absolute offset @p _line.
+    ///
+    /// Cold history lines are moved back into memory first, so that modifications persist.
     Line& absoluteLineAt(int _line) noexcept;
+
+    /// @returns reference to Line at given absolute offset @p _line,
+    /// which must not be a cold history line (see absoluteLineCopyAt()).
     Line const& absoluteLineAt(int _line) const noexcept;
 
-    /// @returns reference to Line at given relative offset @p _line.
+    /// @returns reference to Line at given relative offset @p _line (see absoluteLineAt()).
     Line& lineAt(int _line) noexcept;
     Line const& lineAt(int _line) const noexcept;
 
+    /// @returns a copy of the line at given absolute offset @p _line, decoding it if it is cold.
+    Line absoluteLineCopyAt(int _line) const;
+
+    /// @returns a copy of the line at given relative offset @p _line, decoding it if it is cold.
+    Line lineCopyAt(int _line) const { return absoluteLineCopyAt(toAbsoluteLine(_line)); }
+
+    /// @returns the flags of the line at given absolute offset @p _line.
+    Line::Flags absoluteLineFlags(int _line) const;
+
+    /// Tests whether the cells of the line at relative offset @p _line can be referred to,
+    /// i.e. it is neither packed nor cold (see cellAt()).
+    bool cellsReferable(int _line) const noexcept;
+
     /// Converts a relative line number into an absolute line number.
     int toAbsoluteLine(int _relativeLine) const noexcept;
 
@@ -671,27 +1100,82 @@ class Grid {
 
     int computeRelativeLineNumberFromBottom(int _n) const noexcept;
 
+    /// @returns the serial number of the line at absolute line offset @p _absoluteLine.
+    ///
+    /// A line keeps its serial number while it scrolls through the grid, and serial
+    /// numbers are never reused, except for lines reflowed on resize, which are renumbered.
+    uint64_t lineSerial(int _absoluteLine) const noexcept
+    {
+        return lineSerialBase_ + static_cast<uint64_t>(_absoluteLine);
+    }
+
+    /// Maps a line serial number back to its absolute line offset, if that line still exists.
+    std::optional<int> absoluteLineOfSerial(uint64_t _serial) const noexcept;
+
+    /// Search index over the scrollback history lines.
+    HistoryIndex const& historyIndex() const noexcept { return historyIndex_; }
+
+    /// Indexes up to @p _limit history lines that have not been indexed yet.
+    ///
+    /// Indexing is deferred from the hot path of lines scrolling into the history,
+    /// so it can be caught up with when idle, or right before searching.
+    ///
+    /// @returns the number of history lines still waiting to be indexed.
+    LineCount updateHistoryIndex(std::optional<LineCount> _limit = std::nullopt);
+
+    /// @returns a snapshot of all lines from absolute line @p _firstLine on.
+    ///
+    /// In-memory history lines are shared with the snapshot, and always contained in full,
+    /// whereas cold history lines are decoded and copied.
+    GridSnapshot snapshot(int _firstLine) const;
+
     /// Gets a reference to the cell relative to screen origin (top left, 1:1).
     Cell& at(Coordinate const& _coord) noexcept;
 
-    /// Gets a reference to the cell relative to screen origin (top left, 1:1).
+    /// Gets a reference to the cell relative to screen origin (top left, 1:1),
+    /// which must not be on a packed or cold history line (see cellAt()).
     Cell const& at(Coordinate const& _coord) const noexcept;
 
+    /// Gets a copy of the cell relative to screen origin (top left, 1:1), decoding it if packed or cold.
+    Cell cellAt(Coordinate const& _coord) const;
+
     crispy::range<Lines::const_iterator> lines(LinePosition _start, LinePosition _end) const;
     crispy::range<Lines::iterator> lines(LinePosition _start, LinePosition _end);
     // TODO: ^^ these are actually of type HistoryLinePostiion ^^
 
+    /// @returns the lines of the page at the given scroll offset, which must not overlap
+    /// with the cold history (see materializePage()).
     crispy::range<Lines::const_iterator> pageAtScrollOffset(std::optional<StaticScrollbackPosition> _scrollOffset) const;
     crispy::range<Lines::iterator> pageAtScrollOffset(std::optional<StaticScrollbackPosition> _scrollOffset);
 
+    /// @returns a copy of the lines of the page starting at absolute line @p _top,
+    /// for when it overlaps with the cold history, whose lines are decoded on demand.
+    Lines materializePage(int _top) const;
+
     crispy::range<Lines::const_iterator> mainPage() const;
     crispy::range<Lines::iterator> mainPage();
 
+    /// @returns the history lines not moved into cold storage.
     crispy::range<Lines::const_iterator> scrollbackLines() const;
 
     /// Completely deletes all scrollback lines.
     void clearHistory();
 
+    /// Deletes up to @p _count of the oldest scrollback lines, such as to free memory.
+    ///
+    /// @returns the number of lines deleted.
+    LineCount trimHistory(LineCount _count);
+
+    /// @returns the number of bytes occupied by the lines, the cold history and the search index.
+    MemoryUsage memoryUsage() const;
+
+    /// Sets all cells within the given area of the main page to @p _cell.
+    void fillArea(Margin const& _area, Cell const& _cell);
+
+    /// Copies the cells of the given area of the main page to the area of equal size
+    /// whose top left corner is @p _target, with both areas possibly overlapping.
+    void copyArea(Margin const& _source, Coordinate _target);
+
     /// Scrolls up by @p _n lines within the given margin.
     ///
     /// @param _n number of lines to scroll up within the given margin.
@@ -716,58 +1200,124 @@ class Grid {
     std::string renderAllText() const;
 
   private:
+    LineCount coldLineCount() const noexcept
+    {
+        return coldHistory_ ? coldHistory_->lineCount() : LineCount(0);
+    }
+
+    /// Packs the @p _count most recent history lines (see Line::pack()).
+    void packHistory(LineCount _count);
+
+    /// Moves the oldest in-memory history lines into cold storage, if due.
+    void freezeHistory();
+
+    /// Moves up to @p _count most recent cold history lines back into memory.
+    void thawHistory(LineCount _count);
+
     /// Ensures the maxHistoryLineCount attribute will be satisified, potentially deleting any
     /// overflowing history line.
     void clampHistory();
     void appendNewLines(LineCount _count, GraphicsAttributes _attr);
 
+    /// Reflows all in-memory lines to @p _newColumnCount columns, consuming them.
+    ///
+    /// Large histories are split at logical line boundaries and reflowed concurrently.
+    Lines reflowLines(ColumnCount _newColumnCount);
+
+    /// Replaces all lines with their reflowed counterparts, renumbering them.
+    void assignReflowedLines(Lines&& _lines);
+
     // private fields
     //
     PageSize screenSize_;
     bool reflowOnResize_;
     std::optional<LineCount> maxHistoryLineCount_;
-    Lines lines_;
+    Lines lines_;                 //!< in-memory lines, i.e. all but the cold history lines
+    uint64_t lineSerialBase_ = 0; //!< serial number of the top-most line (cold or not)
+    HistoryIndex historyIndex_;
+    mutable SharedHistory sharedHistory_; //!< history lines shared with snapshots
+    std::unique_ptr<ColdHistory> coldHistory_;
+    LineCount hotHistoryLineCount_{};
+    LinePool linePool_;           //!< memory of dropped lines, for reuse by new ones
+    unsigned reflowThreadLimit_ = 0;
 };
 
 // {{{ inlines
 template <typename RendererT>
 inline void Grid::render(RendererT && _render, std::optional<StaticScrollbackPosition> _scrollOffset) const
 {
-    for (auto const && [rowNumber, line] : crispy::indexed(pageAtScrollOffset(_scrollOffset), 1))
-    {
-        for (auto const && [colNumber, column] : crispy::indexed(line, 1))
-            _render({rowNumber, colNumber}, column);
-
-        auto const columnCount = std::max(
-            ColumnCount(0),
-            screenSize_.columns - line.size()
-        );
-        for (auto const colNumber : crispy::times(unbox<int>(line.size()) + 1, unbox<int>(columnCount)))
-            _render({rowNumber, colNumber}, Cell{});
-    }
+    auto const renderPage = [&](auto const& _page) {
+        for (auto const && [rowNumber, line] : crispy::indexed(_page, 1))
+        {
+            auto const row = rowNumber;
+            auto colNumber = 0;
+            line.forEachCell([&](Cell const& _cell) { _render({row, ++colNumber}, _cell); });
+
+            auto const columnCount = std::max(
+                ColumnCount(0),
+                screenSize_.columns - line.size()
+            );
+            for (auto const colNumber : crispy::times(unbox<int>(line.size()) + 1, unbox<int>(columnCount)))
+                _render({rowNumber, colNumber}, Cell{});
+        }
+    };
+
+    auto const top = unbox<int>(_scrollOffset.value_or(boxed_cast<StaticScrollbackPosition>(historyLineCount())));
+    if (top < unbox<int>(coldLineCount()))
+        renderPage(materializePage(top));
+    else
+        renderPage(pageAtScrollOffset(_scrollOffset));
 }
 
 inline Line& Grid::absoluteLineAt(int _line) noexcept
 {
-    assert(crispy::ascending(0, _line, static_cast<int>(lines_.size()) - 1));
-    return *next(lines_.begin(), _line);
+    auto const coldLines = unbox<int>(coldLineCount());
+    assert(crispy::ascending(0, _line, coldLines + static_cast<int>(lines_.size()) - 1));
+    if (_line < coldLines)
+        thawHistory(LineCount::cast_from(coldLines - _line));
+    return *next(lines_.begin(), _line - unbox<int>(coldLineCount()));
 }
 
 inline Line const& Grid::absoluteLineAt(int _line) const noexcept
 {
-    return const_cast<Grid&>(*this).absoluteLineAt(_line);
+    auto const coldLines = unbox<int>(coldLineCount());
+    assert(crispy::ascending(coldLines, _line, coldLines + static_cast<int>(lines_.size()) - 1)
+           && "Cold history lines are read through absoluteLineCopyAt().");
+    return *next(lines_.begin(), _line - coldLines);
 }
 
 inline Line& Grid::lineAt(int _line) noexcept
 {
     assert(crispy::ascending(1 - *historyLineCount(), _line, *screenSize_.lines));
 
-    return *next(lines_.begin(), *historyLineCount() + _line - 1);
+    return absoluteLineAt(*historyLineCount() + _line - 1);
 }
 
 inline Line const& Grid::lineAt(int _line) const noexcept
 {
-    return const_cast<Grid&>(*this).lineAt(_line);
+    assert(crispy::ascending(1 - *historyLineCount(), _line, *screenSize_.lines));
+
+    return absoluteLineAt(*historyLineCount() + _line - 1);
+}
+
+inline Line Grid::absoluteLineCopyAt(int _line) const
+{
+    if (auto const coldLines = unbox<int>(coldLineCount()); _line < coldLines)
+        return coldHistory_->at(static_cast<size_t>(_line), screenSize_.columns);
+    return absoluteLineAt(_line);
+}
+
+inline Line::Flags Grid::absoluteLineFlags(int _line) const
+{
+    if (_line < unbox<int>(coldLineCount()))
+        return absoluteLineCopyAt(_line).flags();
+    return absoluteLineAt(_line).flags();
+}
+
+inline bool Grid::cellsReferable(int _line) const noexcept
+{
+    auto const line = toAbsoluteLine(_line);
+    return line >= unbox<int>(coldLineCount()) && !absoluteLineAt(line).packed();
 }
 
 inline int Grid::toAbsoluteLine(int _relativeLine) const noexcept
@@ -788,33 +1338,51 @@ inline Cell& Grid::at(Coordinate const& _coord) noexcept
     if (_coord.row > 0)
         return (*next(lines_.rbegin(), unbox<int>(screenSize_.lines) - _coord.row))[static_cast<size_t>(_coord.column - 1)];
     else
-        return (*next(lines_.begin(), unbox<int>(historyLineCount()) + _coord.row - 1))[static_cast<size_t>(_coord.column - 1)];
+        return absoluteLineAt(unbox<int>(historyLineCount()) + _coord.row - 1)[static_cast<size_t>(_coord.column - 1)];
 }
 
 inline Cell const& Grid::at(Coordinate const& _coord) const noexcept
 {
-    return const_cast<Grid&>(*this).at(_coord);
+    assert(crispy::ascending(1 - unbox<int>(historyLineCount()), _coord.row, unbox<int>(screenSize_.lines)));
+    assert(crispy::ascending(1, _coord.column, unbox<int>(screenSize_.columns)));
+
+    return lineAt(_coord.row)[static_cast<size_t>(_coord.column - 1)];
+}
+
+inline Cell Grid::cellAt(Coordinate const& _coord) const
+{
+    assert(crispy::ascending(1 - unbox<int>(historyLineCount()), _coord.row, unbox<int>(screenSize_.lines)));
+    assert(crispy::ascending(1, _coord.column, unbox<int>(screenSize_.columns)));
+
+    auto const column = static_cast<size_t>(_coord.column - 1);
+    if (auto const line = toAbsoluteLine(_coord.row); line < unbox<int>(coldLineCount()))
+        return coldHistory_->cellAt(static_cast<size_t>(line), column, screenSize_.columns);
+
+    // Reads through the const Line interface, so that packed history lines remain packed.
+    return lineAt(_coord.row).cellAt(column);
 }
 
 inline crispy::range<Lines::const_iterator> Grid::lines(LinePosition _start, LinePosition _end) const
 {
-    assert(crispy::ascending(0, *_start, int(lines_.size()) - 1) && "Absolute scroll offset must not be negative or overflowing.");
-    assert(crispy::ascending(_start, _end, LinePosition::cast_from(lines_.size() - 1)) && "Absolute scroll offset must not be negative or overflowing.");
+    auto const coldLines = unbox<int>(coldLineCount());
+    assert(crispy::ascending(coldLines, *_start, coldLines + int(lines_.size()) - 1) && "Absolute scroll offset must not be negative, overflowing, or cold.");
+    assert(crispy::ascending(*_start, *_end, coldLines + int(lines_.size()) - 1) && "Absolute scroll offset must not be negative or overflowing.");
 
     return crispy::range<Lines::const_iterator>(
-        next(lines_.cbegin(), unbox<long>(_start)),
-        next(lines_.cbegin(), unbox<long>(_end))
+        next(lines_.cbegin(), unbox<long>(_start) - coldLines),
+        next(lines_.cbegin(), unbox<long>(_end) - coldLines)
     );
 }
 
 inline crispy::range<Lines::iterator> Grid::lines(LinePosition _start, LinePosition _end)
 {
-    assert(crispy::ascending(LinePosition{0}, _start, LinePosition::cast_from(lines_.size())) && "Absolute scroll offset must not be negative or overflowing.");
-    assert(crispy::ascending(_start, _end, LinePosition::cast_from(lines_.size())) && "Absolute scroll offset must not be negative or overflowing.");
+    auto const coldLines = unbox<int>(coldLineCount());
+    assert(crispy::ascending(coldLines, *_start, coldLines + int(lines_.size())) && "Absolute scroll offset must not be negative, overflowing, or cold.");
+    assert(crispy::ascending(*_start, *_end, coldLines + int(lines_.size())) && "Absolute scroll offset must not be negative or overflowing.");
 
     return crispy::range<Lines::iterator>(
-        next(lines_.begin(), unbox<long>(_start)),
-        next(lines_.begin(), unbox<long>(_end))
+        next(lines_.begin(), unbox<long>(_start) - coldLines),
+        next(lines_.begin(), unbox<long>(_end) - coldLines)
     );
 }
 
@@ -829,8 +1397,10 @@ inline crispy::range<Lines::const_iterator> Grid::pageAtScrollOffset(std::option
         "Absolute scroll offset must not be negative or overflowing."
     );
 
-    auto const start = std::next(lines_.cbegin(),
-                                 unbox<long>(_scrollOffset.value_or(boxed_cast<StaticScrollbackPosition>(historyLineCount()))));
+    auto const top = unbox<int>(_scrollOffset.value_or(boxed_cast<StaticScrollbackPosition>(historyLineCount())));
+    assert(top >= unbox<int>(coldLineCount()) && "Cold history lines must be materialized.");
+
+    auto const start = std::next(lines_.cbegin(), top - unbox<int>(coldLineCount()));
     auto const end = std::next(start, unbox<long>(screenSize_.lines));
 
     return crispy::range<Lines::const_iterator>(start, end);
@@ -847,11 +1417,11 @@ inline crispy::range<Lines::iterator> Grid::pageAtScrollOffset(std::optional<Sta
         "Absolute scroll offset must not be negative or overflowing."
     );
 
+    auto const top = unbox<int>(_scrollOffset.value_or(boxed_cast<StaticScrollbackPosition>(historyLineCount())));
+    assert(top >= unbox<int>(coldLineCount()) && "Cold history lines must be materialized.");
+
     return crispy::range<Lines::iterator>(
-        std::next(
-            lines_.begin(),
-            unbox<long>(_scrollOffset.value_or(boxed_cast<StaticScrollbackPosition>(historyLineCount())))
-        ),
+        std::next(lines_.begin(), top - unbox<int>(coldLineCount())),
         lines_.end()
     );
 }
@@ -872,7 +1442,7 @@ inline crispy::range<Lines::const_iterator> Grid::scrollbackLines() const
         lines_.cbegin(),
         std::next(
             lines_.cbegin(),
-            unbox<long>(historyLineCount())
+            unbox<long>(historyLineCount() - coldLineCount())
         )
     );
 }
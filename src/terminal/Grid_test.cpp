@@ -16,6 +16,7 @@
 #include <catch2/catch_all.hpp>
 #include <fmt/format.h>
 #include <iostream>
+#include <utility>
 
 using namespace terminal;
 using namespace std::string_view_literals;
@@ -457,3 +458,249 @@ TEST_CASE("Grid.shrink_lines_with_history")
     CHECK(newCursorPos.row == 1);
     CHECK(newCursorPos.column == 2);
 }
+
+TEST_CASE("Line.pack", "[grid]")
+{
+    auto bold = GraphicsAttributes{};
+    bold.styles |= CellFlags::Bold;
+    bold.foregroundColor = RGBColor(0x12, 0x34, 0x56);
+
+    auto line = Line(ColumnCount(12), Cell{}, Line::Flags::Wrappable);
+    line.setText("ab  x");
+    line[0].setAttributes(bold);
+    line[1].setAttributes(bold);
+    line[6].setCharacter(U'中');
+    line[8].setCharacter(U'e');
+    line[8].appendCharacter(U'́');
+    line[9].setAttributes(bold); // trailing blank, but not a default cell
+
+    auto const original = line;
+    CHECK(!line.pack().empty());
+    REQUIRE(line.packed());
+    CHECK(line.size() == ColumnCount(12));
+    CHECK(line.toUtf8() == original.toUtf8());
+    CHECK(!line.blank());
+
+    // reading it decodes the cells requested, but does not unpack it
+    auto const& packed = line;
+    auto const packedSize = packed.memoryUsage();
+    for (size_t i = 0; i < 12; ++i)
+    {
+        CHECK(packed.cellAt(i) == original[i]);
+        CHECK(packed.cellAt(i).width() == original[i].width());
+    }
+    CHECK(line.packed());
+    CHECK(packed.memoryUsage() == packedSize);
+
+    // writing to it unpacks it again
+    line[11].setCharacter('z');
+    CHECK(!line.packed());
+    CHECK(line.toUtf8Trimmed() == original.toUtf8Trimmed() + "  z");
+}
+
+TEST_CASE("Line.spans", "[grid]")
+{
+    auto const makeLine = [](std::string_view _text) {
+        auto line = Line(ColumnCount(8), Cell{}, Line::Flags::None);
+        line.setText(_text);
+        return line;
+    };
+    auto const textOf = [](Line const& _line, int _from, int _count) {
+        return _line.toUtf8().substr(static_cast<size_t>(_from), static_cast<size_t>(_count));
+    };
+
+    SECTION("fill") {
+        auto line = makeLine("ABCDEFGH");
+        line.fill(2, 3, Cell{U'x', GraphicsAttributes{}});
+        CHECK(line.toUtf8() == "ABxxxFGH");
+        line.fill(6, 5, Cell{U'y', GraphicsAttributes{}}); // clamped
+        CHECK(line.toUtf8() == "ABxxxFyy");
+    }
+
+    SECTION("moveCells.right.overlapping") {
+        auto line = makeLine("ABCDEFGH");
+        line.moveCells(1, 4, 3);
+        CHECK(textOf(line, 0, 1) == "A");
+        CHECK(textOf(line, 3, 5) == "BCDEH");
+    }
+
+    SECTION("moveCells.left.overlapping") {
+        auto line = makeLine("ABCDEFGH");
+        line.moveCells(3, 4, 1);
+        CHECK(textOf(line, 0, 5) == "ADEFG");
+        CHECK(textOf(line, 7, 1) == "H");
+    }
+
+    SECTION("copyCells.self.overlapping") {
+        auto line = makeLine("ABCDEFGH");
+        line.copyCells(line, 0, 4, 2);
+        CHECK(line.toUtf8() == "ABABCDGH");
+        line.copyCells(line, 2, 4, 0);
+        CHECK(line.toUtf8() == "ABCDCDGH");
+    }
+
+    SECTION("copyCells.packed.clamped") {
+        auto source = makeLine("abcdefgh");
+        (void) source.pack();
+        REQUIRE(source.packed());
+        auto line = makeLine("ABCDEFGH");
+        line.copyCells(source, 1, 10, 5);
+        CHECK(line.toUtf8() == "ABCDEbcd");
+        CHECK(source.toUtf8() == "abcdefgh");
+    }
+}
+
+TEST_CASE("Grid.packedHistory", "[grid]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(5)}, false, LineCount(3));
+    auto const margin = Margin{{1, 2}, {1, 5}};
+
+    for (int i = 0; i < 6; ++i)
+    {
+        grid.lineAt(2).setText(fmt::format("L{}", i));
+        grid.scrollUp(LineCount(1), GraphicsAttributes{}, margin);
+    }
+
+    REQUIRE(*grid.historyLineCount() == 3);
+    for (int row = 0; row < 3; ++row)
+        CHECK(grid.absoluteLineAt(row).packed());
+    CHECK(!grid.lineAt(1).packed());
+    CHECK(grid.renderTextLine(-2) == "L2   ");
+    CHECK(grid.renderTextLine(0) == "L4   ");
+    CHECK(grid.renderTextLine(1) == "L5   ");
+    CHECK(grid.cellAt(Coordinate{0, 2}).codepoint(0) == '4');
+    CHECK(grid.absoluteLineAt(2).packed());
+
+    // growing the page moves packed lines back onto it, unpacked
+    (void) grid.resize(PageSize{LineCount(3), ColumnCount(5)}, Coordinate{2, 1}, false);
+    CHECK(!grid.lineAt(1).packed());
+    CHECK(grid.lineAt(1).toUtf8() == "L4   ");
+    CHECK(std::as_const(grid).at(Coordinate{1, 2}).codepoint(0) == '4');
+    grid.at(Coordinate{1, 3}).setCharacter('!');
+    CHECK(grid.renderTextLine(1) == "L4!  ");
+}
+
+TEST_CASE("Grid.recycledLines", "[grid]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(5)}, false, LineCount(2));
+    auto const margin = Margin{{1, 2}, {1, 5}};
+    auto const hyperlink = std::make_shared<HyperlinkInfo>(HyperlinkInfo{"id", "https://example.com/"});
+    auto bold = GraphicsAttributes{};
+    bold.styles |= CellFlags::Bold;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        grid.lineAt(2).setText(fmt::format("L{}", i));
+        if (i == 0)
+            grid.lineAt(2)[0].setHyperlink(hyperlink);
+        grid.scrollUp(LineCount(1), bold, margin);
+    }
+
+    // Lines reuse the memory of the ones dropped, which does not keep their hyperlinks alive.
+    CHECK(hyperlink.use_count() == 1);
+    CHECK(grid.renderTextLine(-1) == "L5   ");
+    CHECK(grid.renderTextLine(0) == "L6   ");
+    CHECK(grid.renderTextLine(1) == "L7   ");
+    CHECK(grid.renderTextLine(2) == "     ");
+    CHECK(grid.lineAt(2).blank());
+    for (int column = 0; column < 5; ++column)
+    {
+        CHECK(std::as_const(grid).at(Coordinate{2, column + 1}).attributes() == bold);
+        CHECK(!std::as_const(grid).at(Coordinate{2, column + 1}).hyperlink());
+    }
+}
+
+TEST_CASE("LinePool.shared", "[grid]")
+{
+    auto pool = LinePool(4);
+    auto const makePackedLine = [](std::string_view _text) {
+        auto line = Line(ColumnCount(5), Cell{}, Line::Flags::None);
+        line.setText(_text);
+        (void) line.pack();
+        return line;
+    };
+
+    pool.recycle(makePackedLine("a"));
+    CHECK(pool.acquirePacked() != nullptr);
+
+    // Packed cells once shared with another thread are never reused, even when no longer referenced.
+    auto line = makePackedLine("b");
+    (void) line.sharedCopy();
+    pool.recycle(std::move(line));
+    CHECK(pool.acquirePacked() == nullptr);
+}
+
+TEST_CASE("Grid.snapshot", "[grid]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(5)}, false, LineCount(600));
+    auto const margin = Margin{{1, 2}, {1, 5}};
+    auto const writeLines = [&](int _first, int _count) {
+        for (int i = _first; i < _first + _count; ++i)
+        {
+            grid.lineAt(2).setText(fmt::format("{}", i));
+            grid.scrollUp(LineCount(1), GraphicsAttributes{}, margin);
+        }
+    };
+    auto const textOf = [](Line const& _line) { return _line.toUtf8(); };
+
+    writeLines(0, 300);
+    auto const first = grid.snapshot(0);
+    REQUIRE(first.historyLineCount() == LineCount(300));
+    CHECK(textOf(first.lineAt(-298)) == "0    ");
+    CHECK(textOf(first.lineAt(1)) == "299  ");
+    CHECK(first.lineAt(2).blank());
+
+    // The grid keeps scrolling and trimming its history, while the snapshot stays as it was.
+    writeLines(300, 500);
+    auto const second = grid.snapshot(0);
+    for (int line = 0; line < 299; ++line)
+        CHECK(textOf(first.absoluteLineAt(line + 1)) == fmt::format("{:<5}", line));
+    CHECK(textOf(first.lineAt(1)) == "299  ");
+
+    REQUIRE(second.historyLineCount() == LineCount(600));
+    for (int line = -599; line <= 2; ++line)
+        CHECK(textOf(second.lineAt(line)) == grid.renderTextLine(line));
+
+    // Lines moving back from the history onto the main page are no longer shared.
+    (void) grid.resize(PageSize{LineCount(4), ColumnCount(5)}, Coordinate{2, 1}, false);
+    auto const third = grid.snapshot(0);
+    REQUIRE(grid.historyLineCount() < LineCount(600));
+    REQUIRE(third.historyLineCount() == grid.historyLineCount());
+    for (int line = 1 - unbox<int>(grid.historyLineCount()); line <= 4; ++line)
+        CHECK(textOf(third.lineAt(line)) == grid.renderTextLine(line));
+}
+
+TEST_CASE("Grid.reflow.parallel", "[grid]")
+{
+    // Reflowing chunks of lines concurrently yields the very same lines as reflowing sequentially.
+    auto const lineCount = 3 * static_cast<int>(Grid::MinReflowChunkLineCount);
+    auto const makeGrid = [&](unsigned _threadLimit) {
+        auto grid = Grid(PageSize{LineCount(4), ColumnCount(10)}, true, LineCount(lineCount));
+        grid.setReflowThreadLimit(_threadLimit);
+        auto const margin = Margin{{1, 4}, {1, 10}};
+        for (int i = 0; i < lineCount; ++i)
+        {
+            grid.lineAt(4).setText(fmt::format("{}", i * 7919 % 1000003));
+            grid.lineAt(4).setWrapped(i % 4 != 0);
+            grid.scrollUp(LineCount(1), GraphicsAttributes{}, margin);
+        }
+        return grid;
+    };
+
+    auto sequential = makeGrid(1);
+    auto parallel = makeGrid(4);
+    for (auto const columns: {7, 13, 10})
+    {
+        auto const pageSize = PageSize{LineCount(4), ColumnCount(columns)};
+        (void) sequential.resize(pageSize, Coordinate{4, 1}, false);
+        (void) parallel.resize(pageSize, Coordinate{4, 1}, false);
+
+        REQUIRE(parallel.historyLineCount() == sequential.historyLineCount());
+        CHECK(parallel.renderAllText() == sequential.renderAllText());
+        auto differingFlags = 0;
+        for (int row = 0; row < *sequential.historyLineCount() + 4; ++row)
+            if (parallel.absoluteLineAt(row).flags() != sequential.absoluteLineAt(row).flags())
+                ++differingFlags;
+        CHECK(differingFlags == 0);
+    }
+}
@@ -0,0 +1,460 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/HistoryIndex.h>
+#include <terminal/ColdHistory.h>
+#include <terminal/Grid.h>
+
+#include <unicode/utf8.h>
+
+#include <algorithm>
+#include <iterator>
+
+using std::make_shared;
+using std::min;
+using std::move;
+using std::optional;
+using std::shared_ptr;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal {
+
+namespace // {{{ helper
+{
+    bool isBlank(Cell const& _cell) noexcept
+    {
+        return
+#if defined(LIBTERMINAL_IMAGES)
+            !_cell.imageFragment() &&
+#endif
+            _cell.codepointCount() == 0;
+    }
+
+    // Spilled blocks are laid out as: filter bits, the three sizes of text, lines and columns,
+    // followed by their raw contents.
+    constexpr size_t FilterSize = TrigramFilter::BitCount / 8;
+    constexpr size_t HeaderSize = FilterSize + 3 * sizeof(uint64_t);
+
+    template <typename T>
+    void appendRaw(string& _output, T const* _data, size_t _count)
+    {
+        if (_count)
+            _output.append(reinterpret_cast<char const*>(_data), _count * sizeof(T));
+    }
+
+    template <typename T>
+    void readRaw(string_view _input, size_t& _offset, T* _data, size_t _count)
+    {
+        if (_count)
+            std::memcpy(_data, _input.data() + _offset, _count * sizeof(T));
+        _offset += _count * sizeof(T);
+    }
+
+    // Spill files are compacted once they are at least this large and more than half dead.
+    constexpr size_t MinCompactionSize = size_t(16) << 20;
+} // }}}
+
+vector<uint32_t> trigramsOf(string_view _text)
+{
+    vector<uint32_t> trigrams;
+    uint32_t bytes = 0;
+    for (size_t i = 0; i < _text.size(); ++i)
+    {
+        bytes = ((bytes << 8) | foldTrigramByte(_text[i])) & 0xFFFFFF;
+        if (i >= 2)
+            trigrams.push_back(bytes);
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+// {{{ HistoryBlock
+void HistoryBlock::append(Line const& _line, TrigramFilter::Window& _window)
+{
+    auto const textOffset = text.size();
+    auto const columnsOffset = columns.size();
+    bool identity = true;
+    int column = 0;
+    int skip = 0; // remaining cells covered by the preceding wide character
+
+    // State right after the last non-blank cell, to trim trailing blanks with.
+    auto trimmedText = textOffset;
+    auto trimmedColumns = columnsOffset;
+    auto trimmedIdentity = true;
+    auto trimmedColumn = 0;
+
+    // Visits the cells without unpacking packed history lines.
+    _line.forEachCell([&](Cell const& cell) {
+        if (skip)
+        {
+            --skip;
+            return;
+        }
+
+        auto const width = std::max(cell.width(), 1);
+        skip = width - 1;
+
+        if (identity && width == 1 && cell.codepointCount() <= 1 && (cell.codepointCount() == 0 || cell.codepoint(0) < 0x80))
+        {
+            // fast path: single byte, single column
+            text.push_back(cell.codepointCount() ? static_cast<char>(cell.codepoint(0)) : ' ');
+            ++column;
+        }
+        else
+        {
+            if (identity)
+            {
+                // Materialize the byte-to-column mapping for all bytes seen so far.
+                identity = false;
+                for (int k = 0; k < column; ++k)
+                    columns.push_back(static_cast<uint16_t>(k));
+            }
+
+            auto const byteOffset = text.size();
+            if (cell.codepointCount() == 0)
+                text.push_back(' ');
+            else
+            {
+                auto encoder = unicode::encoder<char>{};
+                for (char32_t const codepoint: cell.codepoints())
+                    encoder(codepoint, std::back_inserter(text));
+            }
+            std::fill_n(std::back_inserter(columns), text.size() - byteOffset, static_cast<uint16_t>(column));
+            column += width;
+        }
+
+        if (!isBlank(cell))
+        {
+            trimmedText = text.size();
+            trimmedColumns = columns.size();
+            trimmedIdentity = identity;
+            trimmedColumn = column;
+        }
+    });
+
+    text.resize(trimmedText);
+    columns.resize(trimmedColumns);
+    identity = trimmedIdentity;
+    column = trimmedColumn;
+
+    if (!_line.wrapped())
+        _window = {};
+
+    auto const textLength = text.size() - textOffset;
+    filter.insert(string_view(text.data() + textOffset, textLength), _window);
+
+    lines.emplace_back(IndexedLine{
+        static_cast<uint32_t>(textOffset),
+        static_cast<uint32_t>(textLength),
+        identity ? IndexedLine::IdentityColumns : static_cast<uint32_t>(columnsOffset),
+        static_cast<uint16_t>(column),
+        _line.wrapped()
+    });
+}
+// }}}
+
+// {{{ HistoryBlockRef
+HistoryBlockRef::HistoryBlockRef(BlockPtr _block):
+    block_{ move(_block) },
+    firstLine_{ block_->firstLine },
+    lineCount_{ block_->lines.size() },
+    continued_{ !block_->lines.empty() && block_->lines.front().wrapped }
+{
+}
+
+HistoryBlockRef::HistoryBlockRef(HistoryBlock const& _block, shared_ptr<SpillFile> const& _file):
+    firstLine_{ _block.firstLine },
+    lineCount_{ _block.lines.size() },
+    continued_{ !_block.lines.empty() && _block.lines.front().wrapped }
+{
+    uint64_t const sizes[3] = { _block.text.size(), _block.lines.size(), _block.columns.size() };
+
+    auto data = string{};
+    data.reserve(HeaderSize + _block.text.size()
+                 + _block.lines.size() * sizeof(IndexedLine)
+                 + _block.columns.size() * sizeof(uint16_t));
+    data += _block.filter.bytes();
+    appendRaw(data, sizes, 3);
+    data += _block.text;
+    appendRaw(data, _block.lines.data(), _block.lines.size());
+    appendRaw(data, _block.columns.data(), _block.columns.size());
+
+    offset_ = _file->append(data);
+    size_ = data.size();
+    file_ = _file;
+}
+
+bool HistoryBlockRef::mayContainAll(vector<uint32_t> const& _trigrams) const
+{
+    if (block_)
+        return block_->filter.mayContainAll(_trigrams);
+
+    auto data = string{};
+    file_->read(offset_, FilterSize, data);
+    auto filter = TrigramFilter{};
+    filter.assign(data);
+    return filter.mayContainAll(_trigrams);
+}
+
+HistoryBlockRef::BlockPtr HistoryBlockRef::load() const
+{
+    if (block_)
+        return block_;
+
+    auto data = string{};
+    file_->read(offset_, size_, data);
+
+    auto block = make_shared<HistoryBlock>();
+    block->firstLine = firstLine_;
+    block->filter.assign(string_view(data).substr(0, FilterSize));
+
+    uint64_t sizes[3] = {};
+    auto offset = FilterSize;
+    readRaw(data, offset, sizes, 3);
+    block->text = data.substr(offset, sizes[0]);
+    offset += sizes[0];
+    block->lines.resize(sizes[1]);
+    readRaw(data, offset, block->lines.data(), block->lines.size());
+    block->columns.resize(sizes[2]);
+    readRaw(data, offset, block->columns.data(), block->columns.size());
+    return block;
+}
+
+void HistoryBlockRef::moveTo(shared_ptr<SpillFile> const& _file)
+{
+    if (block_)
+        return;
+
+    auto data = string{};
+    file_->read(offset_, size_, data);
+    offset_ = _file->append(data);
+    file_ = _file;
+}
+
+size_t HistoryBlockRef::memoryUsage() const noexcept
+{
+    return block_ ? block_->memoryUsage() : sizeof(HistoryBlockRef);
+}
+// }}}
+
+// {{{ HistoryIndex
+HistoryIndex::HistoryIndex(HistoryIndex const& _other):
+    sealed_{ _other.sealed_ },
+    spilledCount_{ _other.spilledCount_ },
+    current_{ _other.current_ ? make_shared<HistoryBlock>(*_other.current_) : nullptr },
+    window_{ _other.window_ },
+    firstLine_{ _other.firstLine_ },
+    spillDirectory_{ _other.spillDirectory_ }
+{
+    // The spill file is not shared, so that each index only ever appends to its own one.
+}
+
+HistoryIndex& HistoryIndex::operator=(HistoryIndex const& _other)
+{
+    if (this != &_other)
+        *this = HistoryIndex(_other);
+    return *this;
+}
+
+void HistoryIndex::push(uint64_t _serial, Line const& _line)
+{
+    if (current_ && current_->endLine() != _serial)
+        seal();
+
+    if (!current_)
+    {
+        if (sealed_.empty())
+            firstLine_ = _serial;
+
+        if (sealed_.empty() || sealed_.back().endLine() != _serial)
+            window_ = {};
+
+        current_ = make_shared<HistoryBlock>();
+        current_->firstLine = _serial;
+        current_->lines.reserve(BlockLineCount);
+        current_->text.reserve(BlockLineCount * 64);
+    }
+
+    current_->append(_line, window_);
+
+    if (current_->lines.size() == BlockLineCount)
+        seal();
+}
+
+void HistoryIndex::seal()
+{
+    if (current_ && !current_->lines.empty())
+    {
+        current_->text.shrink_to_fit();
+        current_->columns.shrink_to_fit();
+        sealed_.emplace_back(BlockPtr(move(current_)));
+    }
+    current_.reset();
+}
+
+void HistoryIndex::evict(uint64_t _serial)
+{
+    firstLine_ = std::max(firstLine_, _serial);
+
+    auto const spilledCount = spilledCount_;
+    while (!sealed_.empty() && sealed_.front().endLine() <= _serial)
+    {
+        sealed_.pop_front();
+        spilledCount_ -= min(spilledCount_, size_t(1));
+    }
+
+    if (sealed_.empty() && current_ && current_->endLine() <= _serial)
+        clear();
+    else if (spilledCount_ != spilledCount)
+        compactSpill();
+}
+
+void HistoryIndex::truncate(uint64_t _serial)
+{
+    if (current_ && current_->firstLine >= _serial)
+        current_.reset();
+
+    while (!sealed_.empty() && sealed_.back().firstLine() >= _serial)
+        sealed_.pop_back();
+
+    if (!current_ && !sealed_.empty() && sealed_.back().endLine() > _serial)
+    {
+        // Reopen the last sealed block as a private copy, as snapshots may still share it.
+        current_ = make_shared<HistoryBlock>(*sealed_.back().load());
+        sealed_.pop_back();
+    }
+    spilledCount_ = min(spilledCount_, sealed_.size());
+
+    if (current_ && current_->endLine() > _serial)
+    {
+        auto const keep = static_cast<size_t>(_serial - current_->firstLine);
+        current_->text.resize(current_->lines[keep].textOffset);
+        if (auto const i = std::find_if(current_->lines.begin() + keep, current_->lines.end(),
+                                        [](auto const& line) { return line.columnsOffset != IndexedLine::IdentityColumns; });
+            i != current_->lines.end())
+            current_->columns.resize(i->columnsOffset);
+        current_->lines.resize(keep);
+        // The trigram filter cannot forget, which only costs some false positives.
+    }
+
+    window_ = {};
+}
+
+void HistoryIndex::clear()
+{
+    sealed_.clear();
+    spilledCount_ = 0;
+    current_.reset();
+    window_ = {};
+    spill_.reset(); // a fresh one is created on demand, the old one lives on with the snapshots using it
+}
+
+void HistoryIndex::setSpillDirectory(optional<FileSystem::path> const& _directory)
+{
+    if (!_directory)
+    {
+        for (size_t i = 0; i < spilledCount_; ++i)
+            sealed_[i] = HistoryBlockRef(sealed_[i].load());
+        spilledCount_ = 0;
+        spill_.reset();
+        spillDirectory_.reset();
+        return;
+    }
+
+    if (!spill_)
+        spill_ = make_shared<SpillFile>(*_directory);
+    spillDirectory_ = _directory;
+}
+
+void HistoryIndex::spill(uint64_t _serial)
+{
+    if (!spillDirectory_ || spilledCount_ == sealed_.size() || sealed_[spilledCount_].endLine() > _serial)
+        return;
+
+    if (!spill_)
+        spill_ = make_shared<SpillFile>(*spillDirectory_);
+
+    for (; spilledCount_ < sealed_.size() && sealed_[spilledCount_].endLine() <= _serial; ++spilledCount_)
+        sealed_[spilledCount_] = HistoryBlockRef(*sealed_[spilledCount_].load(), spill_);
+}
+
+void HistoryIndex::compactSpill()
+{
+    if (!spill_ || spill_->size() < MinCompactionSize)
+        return;
+
+    size_t live = 0;
+    for (size_t i = 0; i < spilledCount_; ++i)
+        live += sealed_[i].diskUsage();
+    if (live > spill_->size() / 2)
+        return;
+
+    // Snapshots still referring to the old file keep it alive until they are done with it.
+    auto file = make_shared<SpillFile>(*spillDirectory_);
+    for (size_t i = 0; i < spilledCount_; ++i)
+        sealed_[i].moveTo(file);
+    spill_ = move(file);
+}
+
+uint64_t HistoryIndex::endLine() const noexcept
+{
+    if (current_)
+        return current_->endLine();
+    if (!sealed_.empty())
+        return sealed_.back().endLine();
+    return firstLine_;
+}
+
+size_t HistoryIndex::lineCount() const noexcept
+{
+    size_t count = current_ ? current_->lines.size() : 0;
+    for (auto const& block: sealed_)
+        count += block.lineCount();
+
+    auto const front = !sealed_.empty() ? optional{sealed_.front().firstLine()}
+                     : current_ ? optional{current_->firstLine}
+                     : std::nullopt;
+    if (front && *front < firstLine_)
+        count -= static_cast<size_t>(firstLine_ - *front);
+
+    return count;
+}
+
+size_t HistoryIndex::memoryUsage() const noexcept
+{
+    size_t bytes = current_ ? current_->memoryUsage() : 0;
+    for (auto const& block: sealed_)
+        bytes += block.memoryUsage();
+    return bytes;
+}
+
+size_t HistoryIndex::diskUsage() const noexcept
+{
+    return spill_ ? spill_->size() : 0;
+}
+
+vector<HistoryBlockRef> HistoryIndex::snapshot() const
+{
+    vector<HistoryBlockRef> blocks;
+    blocks.reserve(sealed_.size() + 1);
+    std::copy(sealed_.begin(), sealed_.end(), std::back_inserter(blocks));
+    if (current_ && !current_->lines.empty())
+        blocks.emplace_back(BlockPtr(make_shared<HistoryBlock const>(*current_)));
+    return blocks;
+}
+// }}}
+
+} // end namespace
@@ -0,0 +1,310 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/stdfs.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace terminal {
+
+class Line;
+class SpillFile;
+
+/// Folds a byte for case insensitive trigram lookup (ASCII only).
+constexpr uint8_t foldTrigramByte(char _ch) noexcept
+{
+    auto const ch = static_cast<uint8_t>(_ch);
+    return 'A' <= ch && ch <= 'Z' ? static_cast<uint8_t>(ch + ('a' - 'A')) : ch;
+}
+
+/**
+ * Fixed size bloom filter over case-folded byte trigrams.
+ *
+ * A negative answer from mayContain() is definite, a positive one is not.
+ */
+class TrigramFilter {
+  public:
+    static constexpr size_t BitCount = 32 * 1024;
+
+    /// Rolling trigram state, used to carry trigrams over fragment boundaries.
+    struct Window {
+        uint32_t bytes = 0;
+        unsigned count = 0;
+    };
+
+    void insert(uint32_t _trigram) noexcept
+    {
+        auto const [a, b] = hash(_trigram);
+        bits_[a / 64] |= uint64_t(1) << (a % 64);
+        bits_[b / 64] |= uint64_t(1) << (b % 64);
+    }
+
+    bool mayContain(uint32_t _trigram) const noexcept
+    {
+        auto const [a, b] = hash(_trigram);
+        return (bits_[a / 64] & (uint64_t(1) << (a % 64)))
+            && (bits_[b / 64] & (uint64_t(1) << (b % 64)));
+    }
+
+    /// Inserts all trigrams of @p _text, continuing from (and updating) @p _window.
+    void insert(std::string_view _text, Window& _window) noexcept
+    {
+        for (char const ch: _text)
+        {
+            _window.bytes = ((_window.bytes << 8) | foldTrigramByte(ch)) & 0xFFFFFF;
+            if (++_window.count >= 3)
+                insert(_window.bytes);
+        }
+    }
+
+    /// Tests whether all trigrams of @p _trigrams may be contained.
+    bool mayContainAll(std::vector<uint32_t> const& _trigrams) const noexcept
+    {
+        for (auto const trigram: _trigrams)
+            if (!mayContain(trigram))
+                return false;
+        return true;
+    }
+
+    void clear() noexcept { bits_.fill(0); }
+
+    /// @returns the raw bits, for writing the filter out (see HistoryBlockRef).
+    std::string_view bytes() const noexcept
+    {
+        return std::string_view(reinterpret_cast<char const*>(bits_.data()), sizeof(bits_));
+    }
+
+    /// Restores the raw bits as returned by bytes().
+    void assign(std::string_view _bytes) noexcept
+    {
+        std::memcpy(bits_.data(), _bytes.data(), std::min(_bytes.size(), sizeof(bits_)));
+    }
+
+  private:
+    static std::pair<uint32_t, uint32_t> hash(uint32_t _trigram) noexcept
+    {
+        // Both bit indices are taken from a single 64-bit multiplicative hash.
+        auto const h = uint64_t(_trigram) * 0x9E3779B97F4A7C15ull;
+        return {
+            static_cast<uint32_t>(h >> 49),            // upper 15 bits, log2(BitCount) == 15
+            static_cast<uint32_t>(h >> 34) & 0x7FFFu   // next 15 bits
+        };
+    }
+
+    std::array<uint64_t, BitCount / 64> bits_{};
+};
+
+/// Computes the set of (case-folded) trigrams a text must contain.
+std::vector<uint32_t> trigramsOf(std::string_view _text);
+
+/// Plain-text representation of a single physical line in a HistoryBlock.
+struct IndexedLine {
+    static constexpr uint32_t IdentityColumns = ~uint32_t(0);
+
+    uint32_t textOffset;    //!< byte offset into HistoryBlock::text
+    uint32_t textLength;    //!< UTF-8 encoded length of the right-trimmed line
+    uint32_t columnsOffset; //!< offset into HistoryBlock::columns, or IdentityColumns if byte == column
+    uint16_t width;         //!< number of grid columns covered by the text
+    bool wrapped;           //!< continuation of the line above (part of the same logical line)
+};
+
+/**
+ * A block of consecutive history lines, stored as plain UTF-8 text for searching.
+ *
+ * Lines are addressed by their line serial number (see Grid::lineSerial()),
+ * which is stable for as long as the line remains in the grid.
+ */
+struct HistoryBlock {
+    uint64_t firstLine = 0;
+    std::string text;
+    std::vector<IndexedLine> lines;
+    std::vector<uint16_t> columns;
+    TrigramFilter filter;
+
+    uint64_t endLine() const noexcept { return firstLine + lines.size(); }
+
+    std::string_view lineText(size_t _index) const noexcept
+    {
+        auto const& line = lines[_index];
+        return std::string_view(text.data() + line.textOffset, line.textLength);
+    }
+
+    /// @returns the 0-based grid column the byte at @p _byteOffset of line @p _index belongs to.
+    int columnOf(size_t _index, size_t _byteOffset) const noexcept
+    {
+        auto const& line = lines[_index];
+        if (line.columnsOffset == IndexedLine::IdentityColumns)
+            return static_cast<int>(_byteOffset);
+        if (_byteOffset >= line.textLength)
+            return line.width;
+        return columns[line.columnsOffset + _byteOffset];
+    }
+
+    /// Appends the textual representation of @p _line, also feeding the trigram filter.
+    void append(Line const& _line, TrigramFilter::Window& _window);
+
+    /// @returns the number of bytes occupied by this block, including the heap.
+    size_t memoryUsage() const noexcept
+    {
+        return sizeof(HistoryBlock)
+             + text.capacity()
+             + lines.capacity() * sizeof(IndexedLine)
+             + columns.capacity() * sizeof(uint16_t);
+    }
+};
+
+/**
+ * A sealed HistoryBlock, either held in memory or written out to a spill file.
+ *
+ * Spilled blocks are read back on demand, which is safe to do from any thread,
+ * as the spill file is kept alive for as long as it is referred to and
+ * the bytes of a block are never overwritten.
+ */
+class HistoryBlockRef {
+  public:
+    using BlockPtr = std::shared_ptr<HistoryBlock const>;
+
+    HistoryBlockRef(BlockPtr _block);
+
+    /// Writes @p _block to the end of @p _file.
+    ///
+    /// @throws std::system_error if the file could not be grown.
+    HistoryBlockRef(HistoryBlock const& _block, std::shared_ptr<SpillFile> const& _file);
+
+    uint64_t firstLine() const noexcept { return firstLine_; }
+    uint64_t endLine() const noexcept { return firstLine_ + lineCount_; }
+    size_t lineCount() const noexcept { return lineCount_; }
+
+    /// Tests whether the first line continues the logical line of the line above.
+    bool continued() const noexcept { return continued_; }
+
+    bool spilled() const noexcept { return !block_; }
+
+    /// Tests the block's trigram filter, reading only the filter back if spilled.
+    bool mayContainAll(std::vector<uint32_t> const& _trigrams) const;
+
+    /// @returns the block, read back from the spill file if spilled.
+    BlockPtr load() const;
+
+    /// Moves a spilled block over to the end of @p _file.
+    void moveTo(std::shared_ptr<SpillFile> const& _file);
+
+    /// @returns the number of bytes occupied in memory.
+    size_t memoryUsage() const noexcept;
+
+    /// @returns the number of bytes occupied in the spill file.
+    size_t diskUsage() const noexcept { return size_; }
+
+  private:
+    BlockPtr block_;
+    std::shared_ptr<SpillFile const> file_;
+    size_t offset_ = 0;
+    size_t size_ = 0;
+    uint64_t firstLine_ = 0;
+    size_t lineCount_ = 0;
+    bool continued_ = false;
+};
+
+/**
+ * Incrementally maintained search index over the grid's scrollback history.
+ *
+ * Lines are pushed after they scrolled off the main page (see Grid::updateHistoryIndex())
+ * and dropped as they fall off the top of the history. Lines are grouped into blocks of BlockLineCount lines,
+ * each carrying a trigram bloom filter, so that searches can skip whole blocks
+ * that cannot contain a match. Full blocks are immutable and shared with
+ * snapshots, so taking a snapshot does not copy any history text.
+ *
+ * With a spill directory set, full blocks of lines that moved into the cold history
+ * are written out to a spill file (see spill()), so that the index of an unlimited
+ * scrollback history does not grow in memory beyond the cold history's bookkeeping.
+ */
+class HistoryIndex {
+  public:
+    static constexpr size_t BlockLineCount = 256;
+
+    using BlockPtr = std::shared_ptr<HistoryBlock const>;
+
+    HistoryIndex() = default;
+    HistoryIndex(HistoryIndex const& _other);
+    HistoryIndex& operator=(HistoryIndex const& _other);
+    HistoryIndex(HistoryIndex&&) noexcept = default;
+    HistoryIndex& operator=(HistoryIndex&&) noexcept = default;
+
+    /// Indexes @p _line as the line with serial number @p _serial.
+    void push(uint64_t _serial, Line const& _line);
+
+    /// Forgets all lines with a serial number lower than @p _serial.
+    void evict(uint64_t _serial);
+
+    /// Forgets all lines with a serial number of at least @p _serial.
+    void truncate(uint64_t _serial);
+
+    /// Enables writing full blocks out to a spill file in @p _directory,
+    /// or reads all spilled blocks back into memory if disabled.
+    ///
+    /// @throws std::system_error if the spill file could not be created.
+    void setSpillDirectory(std::optional<FileSystem::path> const& _directory);
+
+    /// Writes full blocks that only cover lines below serial number @p _serial
+    /// out to the spill file, if enabled.
+    ///
+    /// @throws std::system_error if the spill file could not be grown.
+    void spill(uint64_t _serial);
+
+    void clear();
+
+    /// @returns number of lines currently indexed.
+    size_t lineCount() const noexcept;
+
+    /// @returns the serial number of the oldest line still available.
+    uint64_t firstLine() const noexcept { return firstLine_; }
+
+    /// @returns the serial number following the most recently indexed line.
+    uint64_t endLine() const noexcept;
+
+    /// @returns the number of bytes occupied by the index's blocks in memory,
+    /// including those still shared with snapshots.
+    size_t memoryUsage() const noexcept;
+
+    /// @returns the number of bytes the spill file currently occupies.
+    size_t diskUsage() const noexcept;
+
+    /// @returns all blocks in ascending order, the currently filling one copied.
+    std::vector<HistoryBlockRef> snapshot() const;
+
+  private:
+    void seal();
+    void compactSpill();
+
+    std::deque<HistoryBlockRef> sealed_;     //!< spilled blocks first
+    size_t spilledCount_ = 0;                //!< number of spilled blocks at the front of sealed_
+    std::shared_ptr<HistoryBlock> current_;
+    TrigramFilter::Window window_;
+    uint64_t firstLine_ = 0;
+    std::optional<FileSystem::path> spillDirectory_;
+    std::shared_ptr<SpillFile> spill_;
+};
+
+} // end namespace
@@ -0,0 +1,365 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/IOReactor.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::exception;
+using std::lock_guard;
+using std::make_unique;
+using std::max;
+using std::min;
+using std::move;
+using std::nullopt;
+using std::optional;
+using std::runtime_error;
+using std::string;
+using std::unique_lock;
+using std::vector;
+
+using namespace std::string_literals;
+
+namespace terminal {
+
+namespace // {{{ helper
+{
+    /// Event data of the poller's own wakeup pipe. Source IDs start at 1.
+    constexpr uint64_t WakeupId = 0;
+
+    void drain(int _fd)
+    {
+        char buf[256];
+        while (::read(_fd, buf, sizeof(buf)) > 0)
+            ;
+    }
+
+    int pollTimeout(IOReactor::Clock::time_point _deadline)
+    {
+        if (_deadline == IOReactor::Clock::time_point::max())
+            return -1;
+        auto const remaining = duration_cast<milliseconds>(_deadline - IOReactor::Clock::now()).count() + 1;
+        return static_cast<int>(std::clamp<decltype(remaining)>(remaining, 0, 60'000));
+    }
+} // }}}
+
+IOReactor::IOReactor(size_t _workerCount)
+{
+    if (::pipe(wakeupPipe_.data()) < 0)
+        throw runtime_error{"Failed to create I/O reactor wakeup pipe. "s + strerror(errno)};
+
+    for (auto const fd: wakeupPipe_)
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    for (auto const fd: wakeupPipe_)
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+#if defined(__linux__)
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0)
+        throw runtime_error{"Failed to create epoll instance. "s + strerror(errno)};
+
+    auto event = epoll_event{};
+    event.events = EPOLLIN;
+    event.data.u64 = WakeupId;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupPipe_[0], &event);
+#endif
+
+    poller_ = std::thread(&IOReactor::pollLoop, this);
+    for (size_t i = 0; i < max(_workerCount, size_t(1)); ++i)
+        workers_.emplace_back(&IOReactor::workLoop, this);
+
+    LOGSTORE(IOReactorLog)("I/O reactor started with {} workers.", workers_.size());
+}
+
+IOReactor::~IOReactor()
+{
+    {
+        auto const _ = lock_guard{lock_};
+        quit_ = true;
+    }
+    queueChanged_.notify_all();
+    wakeupPoller();
+
+    poller_.join();
+    for (auto& worker: workers_)
+        worker.join();
+
+    for (auto const fd: {epollFd_, wakeupPipe_[0], wakeupPipe_[1]})
+        if (fd >= 0)
+            ::close(fd);
+}
+
+IOReactor::Id IOReactor::add(vector<int> _fds, milliseconds _timeout, Handler _handler)
+{
+    auto const _ = lock_guard{lock_};
+
+    auto const id = nextId_++;
+    auto source = make_unique<Source>();
+    source->id = id;
+    source->fds = move(_fds);
+    source->handler = move(_handler);
+    source->deadline = Clock::now() + _timeout;
+
+#if defined(__linux__)
+    for (auto const fd: source->fds)
+    {
+        auto event = epoll_event{};
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = id;
+        if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0)
+            LOGSTORE(IOReactorLog)("Failed to watch fd {}. {}", fd, strerror(errno));
+    }
+#endif
+
+    sources_.emplace(id, move(source));
+    wakeupPoller();
+    return id;
+}
+
+void IOReactor::remove(Id _id)
+{
+    auto lock = unique_lock{lock_};
+
+    auto i = sources_.find(_id);
+    if (i == sources_.end())
+        return;
+
+    Source& source = *i->second;
+    source.removed = true;
+
+    // When called from within the handler, the worker cleans up after it returned.
+    if (source.runner == std::this_thread::get_id())
+        return;
+
+    sourceFinished_.wait(lock, [&]() {
+        auto const k = sources_.find(_id);
+        return k == sources_.end() || k->second->runner == std::thread::id{};
+    });
+
+    if (auto k = sources_.find(_id); k != sources_.end())
+    {
+        queue_.erase(std::remove(queue_.begin(), queue_.end(), k->second.get()), queue_.end());
+        unregister(*k->second);
+        sources_.erase(k);
+    }
+}
+
+size_t IOReactor::sourceCount() const
+{
+    auto const _ = lock_guard{lock_};
+    return sources_.size();
+}
+
+void IOReactor::schedule(Source& _source)
+{
+    _source.armed = false;
+    _source.pending = false;
+    queue_.push_back(&_source);
+}
+
+void IOReactor::arm(Source& _source)
+{
+    _source.armed = true;
+
+#if defined(__linux__)
+    for (auto const fd: _source.fds)
+    {
+        auto event = epoll_event{};
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = _source.id;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    // The poller only needs to know if it is waiting for too long now.
+    if (_source.deadline < pollDeadline_)
+        wakeupPoller();
+#else
+    // The poller needs to include the source's descriptors in its next poll().
+    wakeupPoller();
+#endif
+}
+
+void IOReactor::unregister(Source& _source)
+{
+#if defined(__linux__)
+    // Closed descriptors have been removed from the epoll set by the kernel already.
+    for (auto const fd: _source.fds)
+        ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+#else
+    (void) _source;
+#endif
+}
+
+void IOReactor::wakeupPoller()
+{
+    char const dummy = 0;
+    auto const rv = ::write(wakeupPipe_[1], &dummy, sizeof(dummy));
+    (void) rv;
+}
+
+void IOReactor::pollLoop()
+{
+    auto readyIds = vector<Id>{};
+
+#if defined(__linux__)
+    auto events = std::array<epoll_event, 64>{};
+#else
+    auto pollFds = vector<pollfd>{};
+    auto pollIds = vector<Id>{};
+#endif
+
+    for (;;)
+    {
+        auto lock = unique_lock{lock_};
+        if (quit_)
+            break;
+
+        pollDeadline_ = Clock::time_point::max();
+        for (auto const& [id, source]: sources_)
+            if (source->armed && !source->removed)
+                pollDeadline_ = min(pollDeadline_, source->deadline);
+
+#if !defined(__linux__)
+        pollFds.clear();
+        pollIds.clear();
+        pollFds.push_back(pollfd{wakeupPipe_[0], POLLIN, 0});
+        pollIds.push_back(WakeupId);
+        for (auto const& [id, source]: sources_)
+            if (source->armed && !source->removed)
+                for (auto const fd: source->fds)
+                {
+                    pollFds.push_back(pollfd{fd, POLLIN, 0});
+                    pollIds.push_back(id);
+                }
+#endif
+
+        auto const timeout = pollTimeout(pollDeadline_);
+        lock.unlock();
+
+        readyIds.clear();
+#if defined(__linux__)
+        auto const count = ::epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), timeout);
+        for (int i = 0; i < count; ++i)
+        {
+            if (events[i].data.u64 == WakeupId)
+                drain(wakeupPipe_[0]);
+            else
+                readyIds.push_back(events[i].data.u64);
+        }
+#else
+        auto const count = ::poll(pollFds.data(), pollFds.size(), timeout);
+        for (size_t i = 0; count > 0 && i < pollFds.size(); ++i)
+        {
+            if (!pollFds[i].revents)
+                continue;
+            if (pollIds[i] == WakeupId)
+                drain(wakeupPipe_[0]);
+            else
+                readyIds.push_back(pollIds[i]);
+        }
+#endif
+        if (count < 0 && errno != EINTR)
+            LOGSTORE(IOReactorLog)("Polling failed. {}", strerror(errno));
+
+        lock.lock();
+        auto const queueSize = queue_.size();
+
+        for (auto const id: readyIds)
+        {
+            auto i = sources_.find(id);
+            if (i == sources_.end() || i->second->removed)
+                continue;
+            if (i->second->armed)
+                schedule(*i->second);
+            else
+                i->second->pending = true;
+        }
+
+        auto const now = Clock::now();
+        for (auto const& [id, source]: sources_)
+            if (source->armed && !source->removed && source->deadline <= now)
+                schedule(*source);
+
+        auto const scheduled = queue_.size() - queueSize;
+        lock.unlock();
+
+        if (scheduled == 1)
+            queueChanged_.notify_one();
+        else if (scheduled > 1)
+            queueChanged_.notify_all();
+    }
+}
+
+void IOReactor::workLoop()
+{
+    auto lock = unique_lock{lock_};
+    for (;;)
+    {
+        queueChanged_.wait(lock, [this]() { return quit_ || !queue_.empty(); });
+        if (quit_)
+            break;
+
+        Source& source = *queue_.front();
+        queue_.pop_front();
+
+        source.runner = std::this_thread::get_id();
+        lock.unlock();
+
+        optional<milliseconds> timeout;
+        try
+        {
+            timeout = source.handler();
+        }
+        catch (exception const& e)
+        {
+            LOGSTORE(IOReactorLog)("Unhandled exception in I/O handler. {}", e.what());
+            timeout = nullopt;
+        }
+
+        lock.lock();
+        source.runner = std::thread::id{};
+
+        if (!timeout || source.removed)
+        {
+            unregister(source);
+            sources_.erase(source.id);
+            sourceFinished_.notify_all();
+            continue;
+        }
+
+        sourceFinished_.notify_all();
+        source.deadline = Clock::now() + *timeout;
+        if (source.pending)
+            schedule(source);
+        else
+            arm(source);
+    }
+}
+
+} // end namespace
@@ -0,0 +1,116 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <crispy/logstore.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace terminal {
+
+/**
+ * Multiplexes the file descriptors of many sources (such as the PTY master and wakeup pipe
+ * of each terminal session) onto a single poller thread (epoll on Linux, poll() elsewhere),
+ * and dispatches the handlers of ready sources onto a small pool of worker threads.
+ *
+ * A source's handler is never run concurrently with itself, so each session's input
+ * processing stays serialized, while different sessions are processed in parallel.
+ *
+ * The descriptors of a source are not watched while its handler is queued or running.
+ * Events arriving in the meantime make the handler run once more.
+ */
+class IOReactor {
+  public:
+    using Id = uint64_t;
+    using Clock = std::chrono::steady_clock;
+
+    /// Invoked on a worker thread when any of the source's descriptors is readable,
+    /// or when its timeout expired.
+    ///
+    /// @returns the timeout until the handler is to be invoked again (if nothing becomes
+    ///          readable until then), or std::nullopt to remove the source.
+    using Handler = std::function<std::optional<std::chrono::milliseconds>()>;
+
+    explicit IOReactor(size_t _workerCount);
+    ~IOReactor();
+
+    IOReactor(IOReactor const&) = delete;
+    IOReactor& operator=(IOReactor const&) = delete;
+    IOReactor(IOReactor&&) = delete;
+    IOReactor& operator=(IOReactor&&) = delete;
+
+    /// Registers a source that is watched for readability of any of @p _fds.
+    ///
+    /// @param _timeout time until the handler is invoked if nothing becomes readable.
+    Id add(std::vector<int> _fds, std::chrono::milliseconds _timeout, Handler _handler);
+
+    /// Removes the given source, waiting for its handler to finish if currently running.
+    ///
+    /// It is safe to call this from within the source's own handler, or for a source that
+    /// has been removed already.
+    void remove(Id _id);
+
+    size_t sourceCount() const;
+    size_t workerCount() const noexcept { return workers_.size(); }
+
+  private:
+    struct Source {
+        Id id;
+        std::vector<int> fds;
+        Handler handler;
+        Clock::time_point deadline;
+        bool armed = true;       //!< waiting for events, i.e. neither queued nor running
+        bool pending = false;    //!< got ready again while queued or running
+        bool removed = false;
+        std::thread::id runner{}; //!< worker thread currently running the handler
+    };
+
+    void pollLoop();
+    void workLoop();
+
+    void schedule(Source& _source);
+    void arm(Source& _source);
+    void unregister(Source& _source);
+    void wakeupPoller();
+
+    mutable std::mutex lock_;
+    std::condition_variable queueChanged_;
+    std::condition_variable sourceFinished_;
+    std::unordered_map<Id, std::unique_ptr<Source>> sources_;
+    std::deque<Source*> queue_;
+    Id nextId_ = 1;
+    bool quit_ = false;
+    Clock::time_point pollDeadline_ = Clock::time_point::max(); //!< end of the poller's current wait
+
+    int epollFd_ = -1;
+    std::array<int, 2> wakeupPipe_{-1, -1};
+
+    std::thread poller_;
+    std::vector<std::thread> workers_;
+};
+
+auto const inline IOReactorLog = logstore::Category("vt.reactor", "Logs shared I/O reactor events.");
+
+} // end namespace
@@ -0,0 +1,191 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/IOReactor.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace terminal;
+using namespace std::chrono_literals;
+using std::atomic;
+using std::optional;
+using std::chrono::milliseconds;
+
+namespace
+{
+    struct Pipe {
+        std::array<int, 2> fds{-1, -1};
+
+        Pipe()
+        {
+            REQUIRE(pipe(fds.data()) == 0);
+            fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        }
+
+        ~Pipe()
+        {
+            close(fds[0]);
+            close(fds[1]);
+        }
+
+        void write(char _ch = 'x') { (void) ::write(fds[1], &_ch, 1); }
+
+        int drain()
+        {
+            char buf[64];
+            int total = 0;
+            for (auto n = read(fds[0], buf, sizeof(buf)); n > 0; n = read(fds[0], buf, sizeof(buf)))
+                total += static_cast<int>(n);
+            return total;
+        }
+    };
+
+    template <typename Predicate>
+    bool waitUntil(Predicate _predicate, milliseconds _timeout = 5s)
+    {
+        auto const deadline = std::chrono::steady_clock::now() + _timeout;
+        while (!_predicate())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+}
+
+TEST_CASE("IOReactor.readable", "[reactor]")
+{
+    auto reactor = IOReactor(2);
+    auto a = Pipe{};
+    auto b = Pipe{};
+    atomic<int> bytesA = 0;
+    atomic<int> bytesB = 0;
+
+    reactor.add({a.fds[0]}, 1h, [&]() -> optional<milliseconds> { bytesA += a.drain(); return 1h; });
+    reactor.add({b.fds[0]}, 1h, [&]() -> optional<milliseconds> { bytesB += b.drain(); return 1h; });
+    CHECK(reactor.sourceCount() == 2);
+
+    a.write();
+    CHECK(waitUntil([&]() { return bytesA == 1; }));
+    CHECK(bytesB == 0);
+
+    b.write();
+    b.write();
+    CHECK(waitUntil([&]() { return bytesB == 2; }));
+
+    // Re-armed after the handler ran.
+    a.write();
+    CHECK(waitUntil([&]() { return bytesA == 2; }));
+}
+
+TEST_CASE("IOReactor.serialized", "[reactor]")
+{
+    auto reactor = IOReactor(4);
+    auto input = Pipe{};
+    auto wakeup = Pipe{};
+    atomic<int> running = 0;
+    atomic<int> maxRunning = 0;
+    atomic<int> runs = 0;
+
+    reactor.add({input.fds[0], wakeup.fds[0]}, 1h, [&]() -> optional<milliseconds> {
+        auto const n = ++running;
+        maxRunning = std::max(maxRunning.load(), n);
+        input.drain();
+        wakeup.drain();
+        std::this_thread::sleep_for(2ms);
+        --running;
+        ++runs;
+        return 1h;
+    });
+
+    for (int i = 0; i < 50; ++i)
+    {
+        (i % 2 ? input : wakeup).write();
+        std::this_thread::sleep_for(std::chrono::microseconds(300));
+    }
+
+    CHECK(waitUntil([&]() { return runs > 1 && running == 0; }));
+    CHECK(maxRunning == 1);
+}
+
+TEST_CASE("IOReactor.timeout", "[reactor]")
+{
+    auto reactor = IOReactor(1);
+    auto idle = Pipe{};
+    atomic<int> runs = 0;
+
+    reactor.add({idle.fds[0]}, 0ms, [&]() -> optional<milliseconds> {
+        ++runs;
+        return 5ms;
+    });
+
+    CHECK(waitUntil([&]() { return runs >= 5; }));
+}
+
+TEST_CASE("IOReactor.remove", "[reactor]")
+{
+    auto reactor = IOReactor(2);
+    auto p = Pipe{};
+
+    SECTION("by handler") {
+        atomic<int> runs = 0;
+        reactor.add({p.fds[0]}, 1h, [&]() -> optional<milliseconds> {
+            p.drain();
+            ++runs;
+            return std::nullopt;
+        });
+        p.write();
+        CHECK(waitUntil([&]() { return reactor.sourceCount() == 0; }));
+        p.write();
+        std::this_thread::sleep_for(20ms);
+        CHECK(runs == 1);
+    }
+
+    SECTION("while running") {
+        atomic<bool> entered = false;
+        atomic<bool> finished = false;
+        auto const id = reactor.add({p.fds[0]}, 1h, [&]() -> optional<milliseconds> {
+            entered = true;
+            std::this_thread::sleep_for(50ms);
+            finished = true;
+            return 1h;
+        });
+        p.write();
+        REQUIRE(waitUntil([&]() { return entered.load(); }));
+        reactor.remove(id);
+        CHECK(finished);
+        CHECK(reactor.sourceCount() == 0);
+        reactor.remove(id); // no-op
+    }
+
+    SECTION("from within handler") {
+        IOReactor::Id id = 0;
+        atomic<bool> done = false;
+        id = reactor.add({p.fds[0]}, 1h, [&]() -> optional<milliseconds> {
+            reactor.remove(id);
+            done = true;
+            return 1h;
+        });
+        p.write();
+        CHECK(waitUntil([&]() { return done && reactor.sourceCount() == 0; }));
+    }
+}
@@ -16,73 +16,58 @@
 #include <algorithm>
 #include <memory>
 
+using std::clamp;
 using std::copy;
-using std::min;
 using std::move;
 using std::shared_ptr;
 
 namespace terminal {
 
 Image::Data RasterizedImage::fragment(Coordinate _pos) const
+{
+    return fragment(_pos, GridSize{LineCount(1), ColumnCount(1)});
+}
+
+Image::Data RasterizedImage::fragment(Coordinate _pos, GridSize _cellCount) const
 {
     // TODO: respect alignment hint
     // TODO: respect resize hint
 
     auto const xOffset = _pos.column * unbox<int>(cellSize_.width);
     auto const yOffset = _pos.row * unbox<int>(cellSize_.height);
-    auto const pixelOffset = Coordinate{yOffset, xOffset};
+    auto const width = unbox<int>(_cellCount.columns) * unbox<int>(cellSize_.width);
+    auto const height = unbox<int>(_cellCount.lines) * unbox<int>(cellSize_.height);
 
-    Image::Data fragData;
-    fragData.resize(*cellSize_.width * *cellSize_.height * 4); // RGBA
-    auto const availableWidth = min(unbox<int>(image_->width()) - pixelOffset.column, unbox<int>(cellSize_.width));
-    auto const availableHeight = min(unbox<int>(image_->height()) - pixelOffset.row, unbox<int>(cellSize_.height));
-
-    // auto const availableSize = Size{availableWidth, availableHeight};
-    // std::cout << fmt::format(
-    //     "RasterizedImage.fragment({}): pixelOffset={}, cellSize={}/{}\n",
-    //     _pos,
-    //     pixelOffset,
-    //     cellSize_,
-    //     availableSize
-    // );
-
-    // auto const fitsWidth = pixelOffset.column + cellSize_.width < image_.get().width();
-    // auto const fitsHeight = pixelOffset.row + cellSize_.height < image_.get().height();
-    // if (!fitsWidth || !fitsHeight)
-    //     std::cout << fmt::format("ImageFragment: out of bounds{}{} ({}x{}); {}\n",
-    //             fitsWidth ? "" : " (width)",
-    //             fitsHeight ? "" : " (height)",
-    //             availableWidth,
-    //             availableHeight,
-    //             *this);
+    auto const availableWidth = clamp(unbox<int>(image_->width()) - xOffset, 0, width);
+    auto const availableHeight = clamp(unbox<int>(image_->height()) - yOffset, 0, height);
 
     // TODO: if input format is (RGB | PNG), transform to RGBA
 
+    Image::Data fragData;
+    fragData.resize(static_cast<size_t>(width * height * 4)); // RGBA
     auto target = &fragData[0];
 
-    // fill horizontal gap at the bottom
-    for (int y = availableHeight * unbox<int>(cellSize_.width); y < *cellSize_.height * *cellSize_.width; ++y)
-    {
-        *target++ = defaultColor_.red();
-        *target++ = defaultColor_.green();
-        *target++ = defaultColor_.blue();
-        *target++ = defaultColor_.alpha();
-    }
+    auto const fill = [&](int _count) {
+        for (int i = 0; i < _count; ++i)
+        {
+            *target++ = defaultColor_.red();
+            *target++ = defaultColor_.green();
+            *target++ = defaultColor_.blue();
+            *target++ = defaultColor_.alpha();
+        }
+    };
+
+    // Rows are stored bottom-up, so start with the horizontal gap at the bottom.
+    fill((height - availableHeight) * width);
 
     for (int y = 0; y < availableHeight; ++y)
     {
-        auto const startOffset = ((pixelOffset.row + (availableHeight - 1 - y)) * *image_->width() + pixelOffset.column) * 4;
+        auto const startOffset = ((yOffset + (availableHeight - 1 - y)) * *image_->width() + xOffset) * 4;
         auto const source = &image_->data()[startOffset];
         target = copy(source, source + availableWidth * 4, target);
 
         // fill vertical gap on right
-        for (int x = availableWidth; x < *cellSize_.width; ++x)
-        {
-            *target++ = defaultColor_.red();
-            *target++ = defaultColor_.green();
-            *target++ = defaultColor_.blue();
-            *target++ = defaultColor_.alpha();
-        }
+        fill(width - availableWidth);
     }
 
     return fragData;
@@ -127,6 +112,15 @@ void ImagePool::removeRasterizedImage(RasterizedImage* _image)
         rasterizedImages_.erase(i);
 }
 
+size_t ImagePool::memoryUsage() const noexcept
+{
+    size_t bytes = 0;
+    for (auto const& image: images_)
+        bytes += sizeof(Image) + image.data().capacity();
+    bytes += rasterizedImages_.size() * sizeof(RasterizedImage);
+    return bytes;
+}
+
 void ImagePool::link(std::string const& _name, std::shared_ptr<Image const> _imageRef)
 {
     namedImages_[_name] = std::move(_imageRef);
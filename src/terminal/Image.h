@@ -135,6 +135,10 @@ class RasterizedImage
     /// @returns an RGBA buffer for a grid cell at given coordinate @p _pos of the rasterized image.
     Image::Data fragment(Coordinate _pos) const;
 
+    /// @returns an RGBA buffer for the block of @p _cellCount grid cells whose top left cell is at @p _pos,
+    ///          with its rows stored bottom-up, just like fragment(Coordinate) does for a single cell.
+    Image::Data fragment(Coordinate _pos, GridSize _cellCount) const;
+
   private:
     std::shared_ptr<Image const> const image_;  //!< Reference to the Image to be rasterized.
     ImageAlignment const alignmentPolicy_;      //!< Alignment policy of the image inside the raster size.
@@ -162,6 +166,7 @@ class ImageFragment {
     ImageFragment& operator=(ImageFragment&&) noexcept = default;
 
     RasterizedImage const& rasterizedImage() const noexcept { return *rasterizedImage_; }
+    std::shared_ptr<RasterizedImage const> const& rasterizedImagePtr() const noexcept { return rasterizedImage_; }
 
     /// @returns offset of this image fragment in pixels into the underlying image.
     Coordinate offset() const noexcept { return offset_; }
@@ -228,6 +233,9 @@ class ImagePool {
     size_t rasterizedImageCount() const noexcept { return rasterizedImages_.size(); }
     size_t namedImageCount() const noexcept { return namedImages_.size(); }
 
+    /// @returns the number of bytes occupied by the pooled images, including their pixel data.
+    size_t memoryUsage() const noexcept;
+
   private:
     void removeImage(Image* _image);                        //!< Removes given image from pool.
     void removeRasterizedImage(RasterizedImage* _image);    //!< Removes a rasterized image from pool.
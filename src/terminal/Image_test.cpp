@@ -0,0 +1,97 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Image.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+
+using namespace terminal;
+
+namespace
+{
+    auto constexpr DefaultColor = RGBAColor{0xFF, 0x00, 0xFF, 0x80};
+
+    /// An image of 5x3 pixels, each pixel's red/green channels holding its x/y coordinate.
+    std::shared_ptr<RasterizedImage const> rasterizeTestImage(ImagePool& _pool)
+    {
+        auto const width = 5;
+        auto const height = 3;
+        auto data = Image::Data{};
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                for (auto const value: {x, y, 0, 0xFF})
+                    data.push_back(static_cast<uint8_t>(value));
+
+        return _pool.rasterize(_pool.create(ImageFormat::RGBA, ImageSize{Width(width), Height(height)}, std::move(data)),
+                               ImageAlignment::TopStart,
+                               ImageResize::NoResize,
+                               DefaultColor,
+                               GridSize{LineCount(2), ColumnCount(3)},
+                               ImageSize{Width(2), Height(2)});
+    }
+
+    /// @returns the RGBA value at the given pixel of a bottom-up buffer of the given width.
+    std::array<uint8_t, 4> pixel(Image::Data const& _data, int _width, int _x, int _row)
+    {
+        auto const i = static_cast<size_t>((_row * _width + _x) * 4);
+        return {_data[i], _data[i + 1], _data[i + 2], _data[i + 3]};
+    }
+
+    std::array<uint8_t, 4> const defaultPixel{0xFF, 0x00, 0xFF, 0x80};
+}
+
+TEST_CASE("RasterizedImage.fragment.cell", "[image]")
+{
+    auto pool = ImagePool{};
+    auto const image = rasterizeTestImage(pool);
+
+    // Rows are bottom-up: the cell at (0, 1) holds image rows 0 and 1 of columns 2 and 3.
+    auto const cell = image->fragment(Coordinate{0, 1});
+    REQUIRE(cell.size() == 2 * 2 * 4);
+    CHECK(pixel(cell, 2, 0, 0) == std::array<uint8_t, 4>{2, 1, 0, 0xFF});
+    CHECK(pixel(cell, 2, 1, 1) == std::array<uint8_t, 4>{3, 0, 0, 0xFF});
+
+    // The cell at (1, 2) only covers pixel (4, 2) of the image, the rest is filled.
+    auto const corner = image->fragment(Coordinate{1, 2});
+    CHECK(pixel(corner, 2, 0, 1) == std::array<uint8_t, 4>{4, 2, 0, 0xFF});
+    CHECK(pixel(corner, 2, 1, 1) == defaultPixel);
+    CHECK(pixel(corner, 2, 0, 0) == defaultPixel);
+    CHECK(pixel(corner, 2, 1, 0) == defaultPixel);
+}
+
+TEST_CASE("RasterizedImage.fragment.block", "[image]")
+{
+    auto pool = ImagePool{};
+    auto const image = rasterizeTestImage(pool);
+
+    // A block beyond the image's cell span is filled, too, such as when being rounded up.
+    auto const blockSize = GridSize{LineCount(2), ColumnCount(4)};
+    auto const block = image->fragment(Coordinate{0, 0}, blockSize);
+    auto const blockWidth = 4 * 2;
+    REQUIRE(block.size() == static_cast<size_t>(blockWidth * 2 * 2 * 4));
+
+    // Every cell of the block matches the cell rasterized on its own.
+    for (int line = 0; line < 2; ++line)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            auto const cell = image->fragment(Coordinate{line, column});
+            for (int y = 0; y < 2; ++y)
+                for (int x = 0; x < 2; ++x)
+                    CHECK(pixel(block, blockWidth, column * 2 + x, (1 - line) * 2 + y)
+                          == (column < 3 ? pixel(cell, 2, x, y) : defaultPixel));
+        }
+    }
+}
@@ -0,0 +1,437 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/KittyGraphics.h>
+#include <terminal/logging.h>
+
+#include <crispy/stdfs.h>
+
+#include <unicode/convert.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::distance;
+using std::from_chars;
+using std::get;
+using std::min;
+using std::move;
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::variant;
+
+namespace terminal {
+
+namespace // {{{ helper
+{
+    /// Upper limit of the control data, which is just a few short key/value pairs.
+    constexpr size_t MaxControlDataLength = 1024;
+
+    optional<size_t> parseNumber(string_view _text)
+    {
+        size_t value = 0;
+        auto const [end, error] = from_chars(_text.data(), _text.data() + _text.size(), value);
+        if (error != std::errc{} || end != _text.data() + _text.size())
+            return nullopt;
+        return value;
+    }
+
+    KittyGraphicsError systemError(string_view _what)
+    {
+        auto const code = errno == ENOENT ? "ENOENT" : errno == EACCES ? "EPERM" : "EBADF";
+        return KittyGraphicsError{code, fmt::format("{}: {}", _what, std::strerror(errno))};
+    }
+
+    /// Reads @p _size bytes (or everything if zero) from offset @p _offset of the file @p _path.
+    variant<Image::Data, KittyGraphicsError> readFile(string const& _path, size_t _offset, size_t _size)
+    {
+#if !defined(_WIN32)
+        // Non-blocking, so that opening a FIFO does not stall the terminal before it is rejected.
+        int const fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        if (fd < 0)
+            return systemError(_path);
+
+        struct stat st{};
+        if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+        {
+            ::close(fd);
+            return KittyGraphicsError{"EINVAL", fmt::format("{}: not a regular file", _path)};
+        }
+
+        auto const fileSize = static_cast<size_t>(st.st_size);
+        auto const size = _offset < fileSize ? min(_size ? _size : fileSize, fileSize - _offset) : 0;
+        auto data = Image::Data(size);
+        size_t done = 0;
+        while (done < size)
+        {
+            auto const n = ::pread(fd, data.data() + done, size - done, static_cast<off_t>(_offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            done += static_cast<size_t>(n);
+        }
+        ::close(fd);
+        data.resize(done);
+        return data;
+#else
+        auto file = std::ifstream(_path, std::ios::binary);
+        if (!file.good() || !FileSystem::is_regular_file(_path))
+            return KittyGraphicsError{"ENOENT", fmt::format("{}: cannot open regular file", _path)};
+
+        file.seekg(0, std::ios::end);
+        auto const fileSize = static_cast<size_t>(file.tellg());
+        auto const size = _offset < fileSize ? min(_size ? _size : fileSize, fileSize - _offset) : 0;
+        auto data = Image::Data(size);
+        file.seekg(static_cast<std::streamoff>(_offset));
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+        data.resize(static_cast<size_t>(file.gcount()));
+        return data;
+#endif
+    }
+
+    /// Tests whether @p _path names a temporary file the client may ask us to delete.
+    ///
+    /// Same safety measure as in kitty: the file must reside directly in a temporary directory,
+    /// and its file name must contain "tty-graphics-protocol".
+    ///
+    /// @returns the canonical path of the temporary file, or nullopt if it is not one.
+    optional<FileSystem::path> temporaryFilePath(string const& _path)
+    {
+        auto error = FileSystemError{};
+        auto const path = FileSystem::canonical(_path, error);
+        if (error || path.filename().string().find("tty-graphics-protocol") == string::npos)
+            return nullopt;
+
+        auto directories = std::vector<FileSystem::path>{FileSystem::temp_directory_path(error)};
+#if !defined(_WIN32)
+        directories.emplace_back("/tmp");
+        directories.emplace_back("/dev/shm");
+        if (auto const tmpdir = getenv("TMPDIR"); tmpdir && *tmpdir)
+            directories.emplace_back(tmpdir);
+#endif
+        for (auto const& directory: directories)
+            if (auto const canonical = FileSystem::canonical(directory, error); !error && canonical == path.parent_path())
+                return path;
+
+        return nullopt;
+    }
+
+    /// Copies the contents of the POSIX shared memory object @p _name and unlinks it.
+    variant<Image::Data, KittyGraphicsError> readSharedMemory(string const& _name, size_t _offset, size_t _size)
+    {
+#if !defined(_WIN32)
+        int const fd = ::shm_open(_name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return systemError(_name);
+
+        struct stat st{};
+        if (::fstat(fd, &st) < 0)
+        {
+            auto error = systemError(_name);
+            ::close(fd);
+            return error;
+        }
+
+        auto const objectSize = static_cast<size_t>(st.st_size);
+        auto const size = _offset < objectSize ? min(_size ? _size : objectSize, objectSize - _offset) : 0;
+        auto data = Image::Data(size);
+        if (size != 0)
+        {
+            void* mapping = ::mmap(nullptr, _offset + size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                auto error = systemError(_name);
+                ::close(fd);
+                return error;
+            }
+            std::memcpy(data.data(), static_cast<uint8_t const*>(mapping) + _offset, size);
+            ::munmap(mapping, _offset + size);
+        }
+        ::close(fd);
+        ::shm_unlink(_name.c_str());
+        return data;
+#else
+        (void) _offset;
+        (void) _size;
+        return KittyGraphicsError{"EINVAL", fmt::format("{}: shared memory transmission is not supported", _name)};
+#endif
+    }
+} // }}}
+
+// {{{ KittyGraphicsCommand
+optional<KittyGraphicsCommand> KittyGraphicsCommand::parse(string_view _controlData)
+{
+    auto command = KittyGraphicsCommand{};
+
+    while (!_controlData.empty())
+    {
+        auto const end = min(_controlData.find(','), _controlData.size());
+        auto const item = _controlData.substr(0, end);
+        _controlData.remove_prefix(min(end + 1, _controlData.size()));
+
+        if (item.size() < 3 || item[1] != '=')
+            return nullopt;
+
+        auto const key = item[0];
+        auto const value = item.substr(2);
+        auto const number = parseNumber(value);
+
+        switch (key)
+        {
+            case 'a':
+                if (value.size() != 1 || string_view("tTqpd").find(value[0]) == string_view::npos)
+                    return nullopt;
+                command.action = static_cast<Action>(value[0]);
+                break;
+            case 't':
+                if (value.size() != 1 || string_view("dfts").find(value[0]) == string_view::npos)
+                    return nullopt;
+                command.medium = static_cast<Medium>(value[0]);
+                break;
+            case 'o':
+                command.compression = value[0];
+                break;
+            case 'd':
+                command.deleteTarget = value[0];
+                break;
+            case 'f': case 's': case 'v': case 'S': case 'O': case 'i': case 'I':
+            case 'p': case 'm': case 'c': case 'r': case 'q': case 'C':
+            {
+                if (!number)
+                    return nullopt;
+                auto const n = *number;
+                switch (key)
+                {
+                    case 'f': command.format = static_cast<unsigned>(n); break;
+                    case 's': command.width = static_cast<unsigned>(n); break;
+                    case 'v': command.height = static_cast<unsigned>(n); break;
+                    case 'S': command.dataSize = n; break;
+                    case 'O': command.dataOffset = n; break;
+                    case 'i': command.imageId = static_cast<unsigned>(n); break;
+                    case 'I': command.imageNumber = static_cast<unsigned>(n); break;
+                    case 'p': command.placementId = static_cast<unsigned>(n); break;
+                    case 'm': command.more = n != 0; break;
+                    case 'c': command.columns = static_cast<unsigned>(n); break;
+                    case 'r': command.rows = static_cast<unsigned>(n); break;
+                    case 'q': command.quiet = static_cast<unsigned>(n); break;
+                    case 'C': command.moveCursor = n == 0; break;
+                }
+                break;
+            }
+            default:
+                // Keys for source rectangles, pixel offsets, z-index, and animation are not supported.
+                break;
+        }
+    }
+
+    return command;
+}
+// }}}
+
+variant<KittyGraphicsImage, KittyGraphicsError> loadKittyGraphicsImage(KittyGraphicsCommand const& _command,
+                                                                       Image::Data&& _payload,
+                                                                       ImageSize _maxSize)
+{
+    using Medium = KittyGraphicsCommand::Medium;
+
+    if (_command.format != 24 && _command.format != 32)
+        return KittyGraphicsError{"EINVAL", fmt::format("Unsupported image format {}", _command.format)};
+
+    if (_command.compression)
+        return KittyGraphicsError{"EINVAL", "Compressed image data is not supported"};
+
+    if (!_command.width || !_command.height)
+        return KittyGraphicsError{"EINVAL", "Image size not specified"};
+
+    if (*_maxSize.width && *_maxSize.height
+            && (_command.width > *_maxSize.width || _command.height > *_maxSize.height))
+        return KittyGraphicsError{"EFBIG", fmt::format("Image exceeds maximum size of {}", _maxSize)};
+
+    auto const pixelCount = size_t(_command.width) * _command.height;
+    auto const bytesPerPixel = size_t(_command.format / 8);
+
+    auto pixels = Image::Data{};
+    if (_command.medium == Medium::Direct)
+        pixels = move(_payload);
+    else
+    {
+        auto const name = string(_payload.begin(), _payload.end());
+        auto const minimumSize = _command.dataSize ? _command.dataSize : pixelCount * bytesPerPixel;
+        auto result = variant<Image::Data, KittyGraphicsError>{};
+        switch (_command.medium)
+        {
+            case Medium::File:
+                result = readFile(name, _command.dataOffset, minimumSize);
+                break;
+            case Medium::TemporaryFile:
+            {
+                // Only ever delete files that are certain to be temporary ones.
+                auto const path = temporaryFilePath(name);
+                if (!path)
+                    return KittyGraphicsError{"EPERM", fmt::format("{}: not a temporary file", name)};
+                result = readFile(path->string(), _command.dataOffset, minimumSize);
+                if (std::holds_alternative<Image::Data>(result))
+                {
+                    auto error = FileSystemError{};
+                    FileSystem::remove(*path, error);
+                }
+                break;
+            }
+            case Medium::SharedMemory:
+                result = readSharedMemory(name, _command.dataOffset, minimumSize);
+                break;
+            case Medium::Direct:
+                break;
+        }
+        if (std::holds_alternative<KittyGraphicsError>(result))
+            return get<KittyGraphicsError>(move(result));
+        pixels = get<Image::Data>(move(result));
+    }
+
+    if (pixels.size() < pixelCount * bytesPerPixel)
+        return KittyGraphicsError{"ENODATA", fmt::format("Insufficient image data: {} of {} bytes",
+                                                         pixels.size(), pixelCount * bytesPerPixel)};
+
+    pixels.resize(pixelCount * bytesPerPixel);
+
+    if (bytesPerPixel == 3)
+    {
+        // Expand RGB to RGBA in place, back to front.
+        pixels.resize(pixelCount * 4);
+        for (size_t i = pixelCount; i-- > 0; )
+        {
+            pixels[i * 4 + 3] = 0xFF;
+            pixels[i * 4 + 2] = pixels[i * 3 + 2];
+            pixels[i * 4 + 1] = pixels[i * 3 + 1];
+            pixels[i * 4 + 0] = pixels[i * 3 + 0];
+        }
+    }
+
+    return KittyGraphicsImage{ImageSize{Width(_command.width), Height(_command.height)}, move(pixels)};
+}
+
+// {{{ KittyGraphicsParser
+KittyGraphicsParser::KittyGraphicsParser(size_t _maxPayloadSize, OnCommand _onCommand):
+    maxPayloadSize_{ _maxPayloadSize },
+    onCommand_{ move(_onCommand) }
+{
+}
+
+void KittyGraphicsParser::start()
+{
+    controlData_.clear();
+    controlDataComplete_ = false;
+    if (!pending_)
+    {
+        decoder_ = {};
+        payload_.clear();
+        tooLarge_ = false;
+    }
+}
+
+void KittyGraphicsParser::pass(char32_t _char)
+{
+    char u8[4];
+    auto const count = distance(u8, unicode::encoder<char>{}(_char, u8));
+    pass(string_view(u8, static_cast<size_t>(count)));
+}
+
+void KittyGraphicsParser::pass(string_view _chars)
+{
+    if (!controlDataComplete_)
+    {
+        auto const i = _chars.find(';');
+        if (controlData_.size() + min(i, _chars.size()) <= MaxControlDataLength)
+            controlData_ += _chars.substr(0, i);
+        if (i == string_view::npos)
+            return;
+        controlDataComplete_ = true;
+        _chars.remove_prefix(i + 1);
+    }
+
+    if (tooLarge_)
+        return;
+
+    auto const offset = payload_.size();
+    payload_.resize(offset + (_chars.size() + 3) / 4 * 3);
+    payload_.resize(offset + crispy::base64::decode(decoder_, _chars, payload_.data() + offset));
+
+    if (payload_.size() > maxPayloadSize_)
+    {
+        tooLarge_ = true;
+        payload_ = Image::Data{};
+    }
+}
+
+void KittyGraphicsParser::finalize()
+{
+    auto command = KittyGraphicsCommand::parse(controlData_);
+    if (!command)
+    {
+        if (VTParserLog)
+            LOGSTORE(VTParserLog)("Invalid graphics command: {}", controlData_);
+        pending_.reset();
+        return;
+    }
+
+    if (pending_)
+    {
+        // Follow-up chunks only carry the m (and maybe q) key.
+        auto const more = command->more;
+        command = pending_;
+        command->more = more;
+    }
+
+    if (command->more)
+    {
+        // The base64 decoder state is carried over, so chunks need not be a multiple of 4 bytes.
+        pending_ = command;
+        return;
+    }
+
+    pending_.reset();
+
+    if (tooLarge_)
+    {
+        if (VTParserLog)
+            LOGSTORE(VTParserLog)("Ignoring graphics data exceeding {} bytes.", maxPayloadSize_);
+        return;
+    }
+
+    auto const offset = payload_.size();
+    payload_.resize(offset + 2);
+    payload_.resize(offset + crispy::base64::finish(decoder_, payload_.data() + offset));
+
+    onCommand_(*command, move(payload_));
+    payload_ = Image::Data{};
+}
+// }}}
+
+} // end namespace
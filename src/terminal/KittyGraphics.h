@@ -0,0 +1,135 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Image.h>
+#include <terminal/ParserExtension.h>
+#include <terminal/primitives.h>
+
+#include <crispy/base64.h>
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace terminal {
+
+/**
+ * Control data of a command of the kitty graphics protocol.
+ *
+ *     APC G <key>=<value>{,<key>=<value>} [ ; <payload> ] ST
+ *
+ * @see https://sw.kovidgoyal.net/kitty/graphics-protocol/
+ */
+struct KittyGraphicsCommand {
+    enum class Action : char {
+        Transmit = 't',
+        TransmitAndDisplay = 'T',
+        Query = 'q',
+        Display = 'p',
+        Delete = 'd',
+    };
+
+    enum class Medium : char {
+        Direct = 'd',        //!< base64 encoded pixels in the payload, possibly sent in chunks
+        File = 'f',          //!< payload is the path of a regular file holding the pixels
+        TemporaryFile = 't', //!< like File, but the file is deleted after reading
+        SharedMemory = 's',  //!< payload is the name of a POSIX shared memory object, unlinked after reading
+    };
+
+    Action action = Action::Transmit;
+    unsigned format = 32;           //!< 24 (RGB), 32 (RGBA) or 100 (PNG)
+    Medium medium = Medium::Direct;
+    char compression = 0;           //!< 'z' for zlib compressed pixels
+    unsigned width = 0;             //!< image width in pixels
+    unsigned height = 0;            //!< image height in pixels
+    size_t dataSize = 0;            //!< number of bytes to read from a file or shared memory object (0 for all)
+    size_t dataOffset = 0;          //!< offset into the file or shared memory object to start reading at
+    unsigned imageId = 0;
+    unsigned imageNumber = 0;
+    unsigned placementId = 0;
+    bool more = false;              //!< more chunks of this transmission follow
+    unsigned columns = 0;           //!< number of columns to display the image in (0 derives it from the image)
+    unsigned rows = 0;              //!< number of rows to display the image in (0 derives it from the image)
+    unsigned quiet = 0;             //!< 1 suppresses OK responses, 2 suppresses error responses, too
+    bool moveCursor = true;
+    char deleteTarget = 'a';
+
+    /// @returns the parsed control data, or std::nullopt if it is malformed.
+    static std::optional<KittyGraphicsCommand> parse(std::string_view _controlData);
+};
+
+/// Error to report back to the client, such as {"ENOENT", "No such file"}.
+struct KittyGraphicsError {
+    std::string code;
+    std::string message;
+};
+
+/// Pixels of a completely received transmission, converted to RGBA.
+struct KittyGraphicsImage {
+    ImageSize size;
+    Image::Data rgba;
+};
+
+/**
+ * Resolves the pixels of a transmission.
+ *
+ * Directly transmitted pixels are taken from @p _payload as is. Files and shared memory
+ * objects are read straight into the returned buffer, without any text encoding
+ * involved, bypassing the PTY entirely.
+ *
+ * @param _payload  decoded payload: the pixels, or the file path or shared memory object name.
+ * @param _maxSize  maximum image size accepted, or a zero area for no limit.
+ */
+std::variant<KittyGraphicsImage, KittyGraphicsError> loadKittyGraphicsImage(KittyGraphicsCommand const& _command,
+                                                                            Image::Data&& _payload,
+                                                                            ImageSize _maxSize);
+
+/**
+ * Receives the body of APC G sequences (following the G), decoding the base64 payload
+ * while it arrives, and assembles transmissions that are sent in chunks (m=1).
+ *
+ * The control data of the first chunk applies to the whole transmission.
+ */
+class KittyGraphicsParser : public ParserExtension {
+  public:
+    using OnCommand = std::function<void(KittyGraphicsCommand const&, Image::Data&&)>;
+
+    KittyGraphicsParser(size_t _maxPayloadSize, OnCommand _onCommand);
+
+    void setMaxPayloadSize(size_t _value) noexcept { maxPayloadSize_ = _value; }
+
+    // ParserExtension overrides
+    void start() override;
+    void pass(char32_t _char) override;
+    void pass(std::string_view _chars) override;
+    void finalize() override;
+
+  private:
+    size_t maxPayloadSize_;
+    OnCommand onCommand_;
+
+    std::string controlData_;
+    bool controlDataComplete_ = false;
+    crispy::base64::decoder_state decoder_;
+    Image::Data payload_;
+    bool tooLarge_ = false;
+
+    std::optional<KittyGraphicsCommand> pending_; //!< first chunk of an incomplete transmission
+};
+
+} // end namespace
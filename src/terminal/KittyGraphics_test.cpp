@@ -0,0 +1,271 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/KittyGraphics.h>
+#include <terminal/Screen.h>
+#include <terminal/ScreenEvents.h>
+
+#include <crispy/base64.h>
+#include <crispy/escape.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <fmt/format.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace terminal;
+using std::string;
+using std::string_view;
+
+namespace
+{
+    class MockScreen : public MockScreenEvents,
+                       public Screen {
+      public:
+        explicit MockScreen(PageSize _size): Screen{_size, *this}
+        {
+            setCellPixelSize(ImageSize{Width(10), Height(20)});
+        }
+    };
+
+    string testPixels(unsigned _width, unsigned _height, unsigned _bytesPerPixel)
+    {
+        auto pixels = string(_width * _height * _bytesPerPixel, '\0');
+        for (size_t i = 0; i < pixels.size(); ++i)
+            pixels[i] = static_cast<char>(i * 13 + i / 7);
+        return pixels;
+    }
+
+    auto e(string const& s)
+    {
+        return crispy::escape(s);
+    }
+
+    string asString(Image::Data const& _data)
+    {
+        return string(_data.begin(), _data.end());
+    }
+}
+
+TEST_CASE("KittyGraphics.parse", "[kitty]")
+{
+    using Action = KittyGraphicsCommand::Action;
+    using Medium = KittyGraphicsCommand::Medium;
+
+    auto const command = KittyGraphicsCommand::parse("a=T,f=24,t=s,s=640,v=480,i=42,m=1,c=3,r=2,C=1,q=2,S=100,O=8");
+    REQUIRE(command.has_value());
+    CHECK(command->action == Action::TransmitAndDisplay);
+    CHECK(command->format == 24);
+    CHECK(command->medium == Medium::SharedMemory);
+    CHECK(command->width == 640);
+    CHECK(command->height == 480);
+    CHECK(command->imageId == 42);
+    CHECK(command->more);
+    CHECK(command->columns == 3);
+    CHECK(command->rows == 2);
+    CHECK_FALSE(command->moveCursor);
+    CHECK(command->quiet == 2);
+    CHECK(command->dataSize == 100);
+    CHECK(command->dataOffset == 8);
+
+    auto const defaults = KittyGraphicsCommand::parse("");
+    REQUIRE(defaults.has_value());
+    CHECK(defaults->action == Action::Transmit);
+    CHECK(defaults->format == 32);
+    CHECK(defaults->medium == Medium::Direct);
+    CHECK(defaults->moveCursor);
+
+    CHECK_FALSE(KittyGraphicsCommand::parse("a=x").has_value());
+    CHECK_FALSE(KittyGraphicsCommand::parse("s=abc").has_value());
+    CHECK_FALSE(KittyGraphicsCommand::parse("s").has_value());
+    CHECK(KittyGraphicsCommand::parse("z=-1,X=2").has_value()); // unsupported keys are ignored
+}
+
+TEST_CASE("KittyGraphics.rgb", "[kitty]")
+{
+    auto command = KittyGraphicsCommand{};
+    command.format = 24;
+    command.width = 3;
+    command.height = 2;
+
+    auto const rgb = testPixels(3, 2, 3);
+    auto const result = loadKittyGraphicsImage(command, Image::Data(rgb.begin(), rgb.end()), ImageSize{});
+    REQUIRE(std::holds_alternative<KittyGraphicsImage>(result));
+    auto const& image = std::get<KittyGraphicsImage>(result);
+    REQUIRE(image.rgba.size() == 6 * 4);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        CHECK(image.rgba[i * 4 + 0] == static_cast<uint8_t>(rgb[i * 3 + 0]));
+        CHECK(image.rgba[i * 4 + 1] == static_cast<uint8_t>(rgb[i * 3 + 1]));
+        CHECK(image.rgba[i * 4 + 2] == static_cast<uint8_t>(rgb[i * 3 + 2]));
+        CHECK(image.rgba[i * 4 + 3] == 0xFF);
+    }
+
+    command.width = 4; // more pixels than transmitted
+    auto const tooShort = loadKittyGraphicsImage(command, Image::Data(rgb.begin(), rgb.end()), ImageSize{});
+    REQUIRE(std::holds_alternative<KittyGraphicsError>(tooShort));
+    CHECK(std::get<KittyGraphicsError>(tooShort).code == "ENODATA");
+}
+
+TEST_CASE("KittyGraphics.direct", "[kitty]")
+{
+    auto screen = MockScreen{PageSize{LineCount(5), ColumnCount(10)}};
+    auto const pixels = testPixels(20, 20, 4);
+    auto const data = crispy::base64::encode(pixels);
+
+    SECTION("chunked") {
+        // Chunk sizes that are no multiple of four, so that base64 groups are split, too.
+        auto const split = data.size() / 3 + 1;
+        screen.write(fmt::format("\033_Ga=T,s=20,v=20,i=7,m=1;{}\033\\", data.substr(0, split)));
+        screen.write(fmt::format("\033_Gm=1;{}\033\\", data.substr(split, split)));
+        CHECK(screen.replyData.empty());
+        screen.write(fmt::format("\033_Gm=0;{}\033\\", data.substr(2 * split)));
+        CHECK(e(screen.replyData) == e("\033_Gi=7;OK\033\\"));
+
+        auto const image = screen.findImageByName("kitty:7");
+        REQUIRE(image);
+        CHECK(*image->width() == 20);
+        CHECK(*image->height() == 20);
+        CHECK(asString(image->data()) == pixels);
+
+        // 20x20 pixels span 2 columns and 1 line, with the cursor placed behind.
+        CHECK(screen.at(Coordinate{1, 1}).imageFragment().has_value());
+        CHECK(screen.at(Coordinate{1, 2}).imageFragment().has_value());
+        CHECK_FALSE(screen.at(Coordinate{1, 3}).imageFragment().has_value());
+        CHECK(screen.cursorPosition() == Coordinate{1, 3});
+    }
+
+    SECTION("transmit, then display") {
+        screen.write(fmt::format("\033_Gi=3,s=20,v=20,q=1;{}\033\\", data));
+        CHECK(screen.replyData.empty());
+        CHECK_FALSE(screen.at(Coordinate{1, 1}).imageFragment().has_value());
+
+        screen.write("\033[2;4H\033_Ga=p,i=3,c=4,r=2,C=1\033\\");
+        CHECK(e(screen.replyData) == e("\033_Gi=3;OK\033\\"));
+        CHECK(screen.at(Coordinate{2, 4}).imageFragment().has_value());
+        CHECK(screen.at(Coordinate{3, 7}).imageFragment().has_value());
+        CHECK(screen.cursorPosition() == Coordinate{2, 4});
+
+        screen.write("\033_Ga=d,d=i,i=3\033\\");
+        CHECK_FALSE(screen.findImageByName("kitty:3"));
+    }
+
+    SECTION("errors") {
+        screen.write(fmt::format("\033_Gi=1,v=20;{}\033\\", data));
+        CHECK(e(screen.replyData) == e("\033_Gi=1;EINVAL:Image size not specified\033\\"));
+        CHECK_FALSE(screen.findImageByName("kitty:1"));
+
+        screen.replyData.clear();
+        screen.write("\033_Ga=p,i=99\033\\");
+        CHECK(e(screen.replyData) == e("\033_Gi=99;ENOENT:No such image\033\\"));
+
+        screen.replyData.clear();
+        screen.write("\033_Ga=p,i=99,q=2\033\\");
+        CHECK(screen.replyData.empty());
+
+        // No reply without an image ID or number.
+        screen.write("\033_Ga=p\033\\");
+        CHECK(screen.replyData.empty());
+    }
+
+    SECTION("too large") {
+        screen.setMaxImageSize(ImageSize{Width(10), Height(10)});
+        screen.write(fmt::format("\033_Gi=2,s=20,v=20;{}\033\\", data));
+        CHECK_FALSE(screen.findImageByName("kitty:2"));
+    }
+}
+
+#if !defined(_WIN32)
+TEST_CASE("KittyGraphics.file", "[kitty]")
+{
+    auto screen = MockScreen{PageSize{LineCount(5), ColumnCount(10)}};
+    auto const pixels = testPixels(16, 8, 4);
+
+    auto const path = fmt::format("/tmp/tty-graphics-protocol-test-{}.rgba", getpid());
+    std::ofstream(path, std::ios::binary) << pixels;
+
+    SECTION("file") {
+        screen.write(fmt::format("\033_Ga=T,t=f,s=16,v=8,i=5;{}\033\\", crispy::base64::encode(path)));
+        CHECK(e(screen.replyData) == e("\033_Gi=5;OK\033\\"));
+        auto const image = screen.findImageByName("kitty:5");
+        REQUIRE(image);
+        CHECK(asString(image->data()) == pixels);
+        CHECK(access(path.c_str(), F_OK) == 0);
+    }
+
+    SECTION("temporary file") {
+        screen.write(fmt::format("\033_Gt=t,s=16,v=8,i=5;{}\033\\", crispy::base64::encode(path)));
+        CHECK(e(screen.replyData) == e("\033_Gi=5;OK\033\\"));
+        auto const image = screen.findImageByName("kitty:5");
+        REQUIRE(image);
+        CHECK(asString(image->data()) == pixels);
+        CHECK(access(path.c_str(), F_OK) != 0);
+    }
+
+    SECTION("temporary file outside of temporary directory") {
+        auto const directory = fmt::format("/tmp/tty-graphics-protocol-test-{}", getpid());
+        auto const victim = directory + "/victim.rgba";
+        mkdir(directory.c_str(), 0700);
+        std::ofstream(victim, std::ios::binary) << pixels;
+        screen.write(fmt::format("\033_Gt=t,s=16,v=8,i=5;{}\033\\", crispy::base64::encode(victim)));
+        CHECK(screen.replyData.find("\033_Gi=5;EPERM:") == 0);
+        CHECK(access(victim.c_str(), F_OK) == 0);
+        std::remove(victim.c_str());
+        rmdir(directory.c_str());
+    }
+
+    SECTION("fifo") {
+        auto const fifo = path + ".fifo";
+        REQUIRE(mkfifo(fifo.c_str(), 0600) == 0);
+        screen.write(fmt::format("\033_Gt=f,s=16,v=8,i=5;{}\033\\", crispy::base64::encode(fifo)));
+        CHECK(screen.replyData.find("\033_Gi=5;EINVAL:") == 0);
+        std::remove(fifo.c_str());
+    }
+
+    SECTION("missing file") {
+        screen.write(fmt::format("\033_Gt=f,s=16,v=8,i=5;{}\033\\", crispy::base64::encode(path + ".missing")));
+        CHECK(screen.replyData.find("\033_Gi=5;ENOENT:") == 0);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("KittyGraphics.shm", "[kitty]")
+{
+    auto screen = MockScreen{PageSize{LineCount(5), ColumnCount(10)}};
+    auto const pixels = testPixels(16, 8, 4);
+    auto const name = fmt::format("/contour-kitty-test-{}", getpid());
+
+    int const fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, pixels.data(), pixels.size()) == static_cast<ssize_t>(pixels.size()));
+    close(fd);
+
+    screen.write(fmt::format("\033_Gt=s,s=16,v=8,I=9;{}\033\\", crispy::base64::encode(name)));
+    CHECK(screen.replyData.find(";OK\033\\") != string::npos);
+    CHECK(screen.replyData.find(",I=9;") != string::npos);
+
+    // The shared memory object is unlinked once read.
+    CHECK(shm_open(name.c_str(), O_RDONLY, 0) < 0);
+}
+#endif
@@ -0,0 +1,208 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/LatencyStats.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+
+using std::chrono::duration_cast;
+using std::max;
+using std::min;
+using std::string;
+
+namespace terminal {
+
+namespace // {{{ helper
+{
+    unsigned mostSignificantBit(uint64_t _value) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(_value));
+#else
+        auto bit = 0u;
+        while (_value >>= 1)
+            ++bit;
+        return bit;
+#endif
+    }
+
+    double micros(LatencyHistogram::Duration _value) noexcept
+    {
+        return static_cast<double>(_value.count()) / 1000.0;
+    }
+
+    template <typename Clock>
+    LatencyHistogram::Duration elapsed(Clock _from, Clock _to) noexcept
+    {
+        return duration_cast<LatencyHistogram::Duration>(max(_to - _from, typename Clock::duration{}));
+    }
+} // }}}
+
+// {{{ LatencyHistogram
+size_t LatencyHistogram::bucketIndex(uint64_t _value) noexcept
+{
+    _value = std::min(_value, (uint64_t(1) << MaxValueBits) - 1);
+    if (_value < SubBucketCount)
+        return static_cast<size_t>(_value);
+
+    auto const magnitude = mostSignificantBit(_value) - SubBucketBits;
+    auto const subBucket = (_value >> magnitude) & (SubBucketCount - 1);
+    return SubBucketCount + magnitude * SubBucketCount + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t _index) noexcept
+{
+    if (_index < SubBucketCount)
+        return _index;
+
+    auto const magnitude = (_index - SubBucketCount) / SubBucketCount;
+    auto const subBucket = (_index - SubBucketCount) % SubBucketCount;
+    return ((SubBucketCount + subBucket + 1) << magnitude) - 1;
+}
+
+void LatencyHistogram::record(Duration _value) noexcept
+{
+    auto const value = static_cast<uint64_t>(std::max(_value.count(), Duration::rep(0)));
+
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    auto current = min_.load(std::memory_order_relaxed);
+    while (value < current && !min_.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+    current = max_.load(std::memory_order_relaxed);
+    while (value > current && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+}
+
+void LatencyHistogram::reset() noexcept
+{
+    for (auto& bucket: buckets_)
+        bucket.store(0, std::memory_order_relaxed);
+    count_ = 0;
+    sum_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+}
+
+LatencyHistogram::Duration LatencyHistogram::min() const noexcept
+{
+    auto const value = min_.load(std::memory_order_relaxed);
+    return value == UINT64_MAX ? Duration::zero() : Duration(value);
+}
+
+LatencyHistogram::Duration LatencyHistogram::mean() const noexcept
+{
+    auto const n = count();
+    return n ? Duration(sum_.load(std::memory_order_relaxed) / n) : Duration::zero();
+}
+
+LatencyHistogram::Duration LatencyHistogram::percentile(double _percentile) const noexcept
+{
+    auto const n = count();
+    if (!n)
+        return Duration::zero();
+
+    auto const rank = std::max(uint64_t(1), static_cast<uint64_t>(std::ceil(_percentile / 100.0 * double(n))));
+    auto seen = uint64_t(0);
+    for (size_t i = 0; i < BucketCount; ++i)
+    {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::clamp(Duration(bucketUpperBound(i)), min(), max());
+    }
+    return max();
+}
+// }}}
+
+// {{{ LatencyStats
+void LatencyStats::recordRefreshed(FrameTimestamps const& _frame) noexcept
+{
+    if (!_frame.valid())
+        return;
+
+    record(LatencyStage::Parse, elapsed(_frame.ptyRead, _frame.parsed));
+    record(LatencyStage::RenderBuffer, elapsed(_frame.parsed, _frame.refreshed));
+}
+
+void LatencyStats::recordDisplayed(FrameTimestamps const& _frame,
+                                   FrameTimestamps::TimePoint _rendered,
+                                   FrameTimestamps::TimePoint _swapped) noexcept
+{
+    if (!_frame.valid())
+        return;
+
+    record(LatencyStage::Render, elapsed(_frame.refreshed, _rendered));
+    record(LatencyStage::Swap, elapsed(_rendered, _swapped));
+    record(LatencyStage::Total, elapsed(_frame.ptyRead, _swapped));
+}
+
+void LatencyStats::reset() noexcept
+{
+    for (auto& histogram: histograms_)
+        histogram.reset();
+}
+
+string LatencyStats::json() const
+{
+    auto result = string{"{"};
+    for (size_t i = 0; i < LatencyStageCount; ++i)
+    {
+        auto const stage = static_cast<LatencyStage>(i);
+        auto const& h = histogram(stage);
+        result += fmt::format(
+            "{}\"{}\":{{\"count\":{},\"min\":{:.1f},\"mean\":{:.1f},\"p50\":{:.1f},\"p90\":{:.1f},"
+            "\"p99\":{:.1f},\"p999\":{:.1f},\"max\":{:.1f}}}",
+            i ? "," : "",
+            to_string(stage),
+            h.count(),
+            micros(h.min()),
+            micros(h.mean()),
+            micros(h.percentile(50)),
+            micros(h.percentile(90)),
+            micros(h.percentile(99)),
+            micros(h.percentile(99.9)),
+            micros(h.max())
+        );
+    }
+    result += '}';
+    return result;
+}
+
+string LatencyStats::summary() const
+{
+    auto result = fmt::format("{:<14} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+                              "stage [us]", "count", "min", "mean", "p50", "p99", "p999", "max");
+    for (size_t i = 0; i < LatencyStageCount; ++i)
+    {
+        auto const stage = static_cast<LatencyStage>(i);
+        auto const& h = histogram(stage);
+        result += fmt::format("{:<14} {:>8} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}\n",
+                              to_string(stage),
+                              h.count(),
+                              micros(h.min()),
+                              micros(h.mean()),
+                              micros(h.percentile(50)),
+                              micros(h.percentile(99)),
+                              micros(h.percentile(99.9)),
+                              micros(h.max()));
+    }
+    return result;
+}
+// }}}
+
+} // end namespace
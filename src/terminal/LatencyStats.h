@@ -0,0 +1,137 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace terminal {
+
+/// Stages of getting PTY output onto the screen.
+///
+/// Each stage spans from the end of the previous one, so that they add up to the total.
+enum class LatencyStage
+{
+    Parse,        //!< first PTY read of a frame until its last output has been processed
+    RenderBuffer, //!< until the render buffer has been refreshed (including refresh rate throttling)
+    Render,       //!< until the frontend finished rendering the frame
+    Swap,         //!< until the frame has been swapped onto the screen
+    Total,        //!< first PTY read of a frame until it has been swapped onto the screen
+};
+
+constexpr inline size_t LatencyStageCount = 5;
+
+constexpr std::string_view to_string(LatencyStage _stage) noexcept
+{
+    switch (_stage)
+    {
+        case LatencyStage::Parse: return "parse";
+        case LatencyStage::RenderBuffer: return "render_buffer";
+        case LatencyStage::Render: return "render";
+        case LatencyStage::Swap: return "swap";
+        case LatencyStage::Total: return "total";
+    }
+    return "unknown";
+}
+
+/// Monotonic timestamps of a frame's way through the terminal.
+struct FrameTimestamps
+{
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    TimePoint ptyRead{};   //!< first PTY read whose output is contained in this frame
+    TimePoint parsed{};    //!< last PTY output of this frame processed
+    TimePoint refreshed{}; //!< render buffer refreshed
+
+    /// Whether or not the frame contains any PTY output.
+    bool valid() const noexcept { return ptyRead != TimePoint{}; }
+};
+
+/// Histogram of durations with logarithmic buckets of linear sub-buckets (like HdrHistogram),
+/// recording values up to about 18 minutes with a relative precision of 1/16.
+///
+/// Recording is lock-free and may happen concurrently from multiple threads.
+class LatencyHistogram
+{
+  public:
+    using Duration = std::chrono::nanoseconds;
+
+    void record(Duration _value) noexcept;
+    void reset() noexcept;
+
+    uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    Duration min() const noexcept;
+    Duration max() const noexcept { return Duration(max_.load(std::memory_order_relaxed)); }
+    Duration mean() const noexcept;
+
+    /// @returns the value that @p _percentile percent of the recorded values are not greater than,
+    ///          with the histogram's precision.
+    Duration percentile(double _percentile) const noexcept;
+
+    static constexpr size_t SubBucketBits = 4;
+    static constexpr size_t SubBucketCount = 1 << SubBucketBits;
+    static constexpr size_t MaxValueBits = 40;
+    static constexpr size_t BucketCount = SubBucketCount * (MaxValueBits - SubBucketBits + 1);
+
+    static size_t bucketIndex(uint64_t _value) noexcept;
+    static uint64_t bucketUpperBound(size_t _index) noexcept;
+
+  private:
+    std::array<std::atomic<uint64_t>, BucketCount> buckets_{};
+    std::atomic<uint64_t> count_ = 0;
+    std::atomic<uint64_t> sum_ = 0;
+    std::atomic<uint64_t> min_ = UINT64_MAX;
+    std::atomic<uint64_t> max_ = 0;
+};
+
+/// Latency histograms of all stages of a terminal.
+class LatencyStats
+{
+  public:
+    void record(LatencyStage _stage, LatencyHistogram::Duration _duration) noexcept
+    {
+        histograms_[static_cast<size_t>(_stage)].record(_duration);
+    }
+
+    /// Records the stages up to the render buffer of a frame.
+    void recordRefreshed(FrameTimestamps const& _frame) noexcept;
+
+    /// Records the frontend stages of a frame, that has been rendered at @p _rendered
+    /// and swapped onto the screen at @p _swapped.
+    void recordDisplayed(FrameTimestamps const& _frame,
+                         FrameTimestamps::TimePoint _rendered,
+                         FrameTimestamps::TimePoint _swapped) noexcept;
+
+    LatencyHistogram const& histogram(LatencyStage _stage) const noexcept
+    {
+        return histograms_[static_cast<size_t>(_stage)];
+    }
+
+    void reset() noexcept;
+
+    /// @returns all histograms' summaries as a JSON object, with durations in microseconds.
+    std::string json() const;
+
+    /// @returns all histograms' summaries as a human readable table.
+    std::string summary() const;
+
+  private:
+    std::array<LatencyHistogram, LatencyStageCount> histograms_{};
+};
+
+} // end namespace
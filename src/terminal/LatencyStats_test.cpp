@@ -0,0 +1,93 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/LatencyStats.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+
+using namespace terminal;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+
+TEST_CASE("LatencyHistogram.buckets", "[latency]")
+{
+    // Exact below the sub-bucket count.
+    for (uint64_t value = 0; value < LatencyHistogram::SubBucketCount; ++value)
+        CHECK(LatencyHistogram::bucketUpperBound(LatencyHistogram::bucketIndex(value)) == value);
+
+    // Within relative precision above, and buckets are monotonic.
+    auto lastIndex = size_t(0);
+    for (uint64_t value = 16; value < (uint64_t(1) << 36); value = value * 9 / 8 + 1)
+    {
+        auto const index = LatencyHistogram::bucketIndex(value);
+        auto const upper = LatencyHistogram::bucketUpperBound(index);
+        CHECK(index >= lastIndex);
+        CHECK(value <= upper);
+        CHECK(upper - value <= value / LatencyHistogram::SubBucketCount);
+        lastIndex = index;
+    }
+
+    CHECK(LatencyHistogram::bucketIndex(UINT64_MAX) == LatencyHistogram::BucketCount - 1);
+}
+
+TEST_CASE("LatencyHistogram.percentile", "[latency]")
+{
+    auto histogram = LatencyHistogram{};
+    CHECK(histogram.percentile(50) == 0ns);
+
+    for (int i = 1; i <= 1000; ++i)
+        histogram.record(std::chrono::microseconds(i));
+
+    CHECK(histogram.count() == 1000);
+    CHECK(histogram.min() == 1us);
+    CHECK(histogram.max() == 1000us);
+    CHECK(histogram.mean() == 500500ns);
+
+    auto const near = [](nanoseconds _actual, nanoseconds _expected) {
+        return _actual >= _expected && _actual <= _expected + _expected / 16;
+    };
+    CHECK(near(histogram.percentile(50), 500us));
+    CHECK(near(histogram.percentile(99), 990us));
+    CHECK(histogram.percentile(100) == 1000us);
+
+    histogram.reset();
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.min() == 0ns);
+}
+
+TEST_CASE("LatencyStats.frame", "[latency]")
+{
+    auto const t0 = std::chrono::steady_clock::now();
+    auto frame = FrameTimestamps{};
+    CHECK(!frame.valid());
+
+    auto stats = LatencyStats{};
+    stats.recordRefreshed(frame);
+    CHECK(stats.histogram(LatencyStage::Parse).count() == 0);
+
+    frame.ptyRead = t0;
+    frame.parsed = t0 + 1ms;
+    frame.refreshed = t0 + 3ms;
+    stats.recordRefreshed(frame);
+    stats.recordDisplayed(frame, t0 + 6ms, t0 + 10ms);
+
+    CHECK(stats.histogram(LatencyStage::Parse).max() == 1ms);
+    CHECK(stats.histogram(LatencyStage::RenderBuffer).max() == 2ms);
+    CHECK(stats.histogram(LatencyStage::Render).max() == 3ms);
+    CHECK(stats.histogram(LatencyStage::Swap).max() == 4ms);
+    CHECK(stats.histogram(LatencyStage::Total).max() == 10ms);
+
+    CHECK(stats.json().find("\"total\":{\"count\":1,\"min\":10000.0,") != std::string::npos);
+}
@@ -0,0 +1,51 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/MemoryUsage.h>
+
+#include <fmt/format.h>
+
+#include <numeric>
+
+using std::string;
+
+namespace terminal {
+
+size_t MemoryUsage::total() const noexcept
+{
+    return std::accumulate(bytes.begin(), bytes.end(), size_t{0});
+}
+
+string MemoryUsage::json() const
+{
+    auto result = string{"{"};
+    for (size_t i = 0; i < MemoryCategoryCount; ++i)
+        result += fmt::format("\"{}\":{},", to_string(static_cast<MemoryCategory>(i)), bytes[i]);
+    result += fmt::format("\"total\":{}}}", total());
+    return result;
+}
+
+string MemoryUsage::summary() const
+{
+    auto const row = [](std::string_view _name, size_t _bytes) {
+        return fmt::format("{:<14} {:>12.1f}\n", _name, static_cast<double>(_bytes) / 1024.0);
+    };
+
+    auto result = fmt::format("{:<14} {:>12}\n", "category", "KB");
+    for (size_t i = 0; i < MemoryCategoryCount; ++i)
+        result += row(to_string(static_cast<MemoryCategory>(i)), bytes[i]);
+    result += row("total", total());
+    return result;
+}
+
+} // end namespace
@@ -0,0 +1,85 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace terminal {
+
+/// Categories of memory a terminal session is holding on to.
+enum class MemoryCategory
+{
+    Screen,      //!< lines of the main page of both screens
+    History,     //!< scrollback history lines kept in memory
+    ColdHistory, //!< in-memory part of the disk-backed scrollback history
+    SearchIndex, //!< search index over the scrollback history
+    Images,      //!< raw and rasterized images, such as Sixel graphics
+    Hyperlinks,  //!< hyperlinks (OSC 8)
+    TextShaping, //!< the renderer's text shaping cache
+    Textures,    //!< the renderer's texture atlases, in video memory
+};
+
+constexpr inline size_t MemoryCategoryCount = 8;
+
+constexpr std::string_view to_string(MemoryCategory _category) noexcept
+{
+    switch (_category)
+    {
+        case MemoryCategory::Screen: return "screen";
+        case MemoryCategory::History: return "history";
+        case MemoryCategory::ColdHistory: return "cold_history";
+        case MemoryCategory::SearchIndex: return "search_index";
+        case MemoryCategory::Images: return "images";
+        case MemoryCategory::Hyperlinks: return "hyperlinks";
+        case MemoryCategory::TextShaping: return "text_shaping";
+        case MemoryCategory::Textures: return "textures";
+    }
+    return "unknown";
+}
+
+/// Bytes held by a terminal session, by category.
+///
+/// The numbers are explicitly accounted for by the owners of the memory rather than
+/// hooked into the allocator, so they do not include allocator overhead.
+struct MemoryUsage
+{
+    std::array<size_t, MemoryCategoryCount> bytes{};
+
+    size_t& operator[](MemoryCategory _category) noexcept { return bytes[static_cast<size_t>(_category)]; }
+    size_t operator[](MemoryCategory _category) const noexcept { return bytes[static_cast<size_t>(_category)]; }
+
+    MemoryUsage& operator+=(MemoryUsage const& _other) noexcept
+    {
+        for (size_t i = 0; i < MemoryCategoryCount; ++i)
+            bytes[i] += _other.bytes[i];
+        return *this;
+    }
+
+    /// @returns the total number of bytes of all categories.
+    size_t total() const noexcept;
+
+    /// @returns the number of bytes of main memory, i.e. all but the video memory of textures.
+    size_t mainMemory() const noexcept { return total() - (*this)[MemoryCategory::Textures]; }
+
+    /// @returns the usage as JSON object of bytes by category.
+    std::string json() const;
+
+    /// @returns the usage as human readable table.
+    std::string summary() const;
+};
+
+} // end namespace
@@ -0,0 +1,678 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/MuxProtocol.h>
+#include <terminal/Terminal.h>
+
+#include <algorithm>
+
+using std::map;
+using std::min;
+using std::move;
+using std::nullopt;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+using std::weak_ptr;
+
+namespace terminal::mux {
+
+namespace // {{{ helper
+{
+    /// Cells are encoded as a single LEB128 value: 0 for an empty cell, the codepoint
+    /// for a cell with a single codepoint of its natural width, and otherwise
+    /// ComplexCell plus the number of codepoints, followed by the width and the codepoints.
+    constexpr uint64_t ComplexCell = 0x110000;
+
+    /// Styles only used internally by the renderer are not transmitted.
+    constexpr uint32_t TransmittedStyles = (1u << 16) - 1;
+
+    constexpr uint8_t FullFrame = 0x01;
+    constexpr uint8_t AlternateScreen = 0x02;
+
+    /// Limits the number of history lines sent in reply to a single request.
+    constexpr size_t MaxHistoryLinesPerRequest = 10'000;
+
+    void encodeColor(WireWriter& _writer, Color _color)
+    {
+        _writer.byte(static_cast<uint8_t>(_color.type));
+        switch (_color.type)
+        {
+            case ColorType::Bright:
+            case ColorType::Indexed:
+                _writer.byte(_color.index);
+                break;
+            case ColorType::RGB:
+                _writer.byte(_color.rgb.red);
+                _writer.byte(_color.rgb.green);
+                _writer.byte(_color.rgb.blue);
+                break;
+            case ColorType::Undefined:
+            case ColorType::Default:
+                break;
+        }
+    }
+
+    Color decodeColor(WireReader& _reader)
+    {
+        switch (auto const type = static_cast<ColorType>(_reader.byte()); type)
+        {
+            case ColorType::Bright:
+            case ColorType::Indexed:
+                return Color{type, _reader.byte()};
+            case ColorType::RGB:
+            {
+                auto const red = _reader.byte();
+                auto const green = _reader.byte();
+                auto const blue = _reader.byte();
+                return Color{RGBColor{red, green, blue}};
+            }
+            case ColorType::Undefined:
+                return Color::Undefined();
+            case ColorType::Default:
+                return Color::Default();
+        }
+        return Color::Default();
+    }
+
+    void encodeAttributes(WireWriter& _writer, GraphicsAttributes const& _attributes)
+    {
+        encodeColor(_writer, _attributes.foregroundColor);
+        encodeColor(_writer, _attributes.backgroundColor);
+        encodeColor(_writer, _attributes.underlineColor);
+        _writer.varuint(static_cast<uint32_t>(_attributes.styles) & TransmittedStyles);
+    }
+
+    GraphicsAttributes decodeAttributes(WireReader& _reader)
+    {
+        auto attributes = GraphicsAttributes{};
+        attributes.foregroundColor = decodeColor(_reader);
+        attributes.backgroundColor = decodeColor(_reader);
+        attributes.underlineColor = decodeColor(_reader);
+        attributes.styles = static_cast<CellFlags>(_reader.varuint() & TransmittedStyles);
+        return attributes;
+    }
+
+    bool isDefaultCell(Cell const& _cell) noexcept
+    {
+        return _cell.codepointCount() == 0
+            && _cell.attributes() == GraphicsAttributes{}
+#if defined(LIBTERMINAL_IMAGES)
+            && !_cell.imageFragment()
+#endif
+            ;
+    }
+
+    template <typename T>
+    T decodeEnum(WireReader& _reader, T _last, T _fallback)
+    {
+        auto const value = _reader.byte();
+        return value <= static_cast<uint8_t>(_last) ? static_cast<T>(value) : _fallback;
+    }
+
+#if defined(LIBTERMINAL_IMAGES)
+    void encodePlacement(WireWriter& _writer, RasterizedImage const& _image)
+    {
+        _writer.varuint(_image.image().id());
+        _writer.byte(static_cast<uint8_t>(_image.image().format()));
+        _writer.varuint(unbox<uint64_t>(_image.image().width()));
+        _writer.varuint(unbox<uint64_t>(_image.image().height()));
+        _writer.byte(static_cast<uint8_t>(_image.alignmentPolicy()));
+        _writer.byte(static_cast<uint8_t>(_image.resizePolicy()));
+        _writer.varuint(_image.defaultColor().value);
+        _writer.varuint(unbox<uint64_t>(_image.cellSpan().lines));
+        _writer.varuint(unbox<uint64_t>(_image.cellSpan().columns));
+        _writer.varuint(unbox<uint64_t>(_image.cellSize().width));
+        _writer.varuint(unbox<uint64_t>(_image.cellSize().height));
+    }
+#endif
+
+    ImagePlacement decodePlacement(WireReader& _reader)
+    {
+        auto placement = ImagePlacement{};
+        placement.image = _reader.varuint();
+        placement.format = decodeEnum(_reader, ImageFormat::PNG, ImageFormat::RGBA);
+        placement.imageSize.width = Width::cast_from(_reader.varuint());
+        placement.imageSize.height = Height::cast_from(_reader.varuint());
+        placement.alignment = decodeEnum(_reader, ImageAlignment::BottomEnd, ImageAlignment::MiddleCenter);
+        placement.resize = decodeEnum(_reader, ImageResize::StretchToFill, ImageResize::ResizeToFit);
+        placement.defaultColor = RGBAColor{static_cast<uint32_t>(_reader.varuint())};
+        placement.cellSpan.lines = LineCount::cast_from(_reader.varuint());
+        placement.cellSpan.columns = ColumnCount::cast_from(_reader.varuint());
+        placement.cellSize.width = Width::cast_from(_reader.varuint());
+        placement.cellSize.height = Height::cast_from(_reader.varuint());
+        return placement;
+    }
+
+    bool sameCursor(FrameCursor const& a, FrameCursor const& b) noexcept
+    {
+        return a.position == b.position && a.visible == b.visible && a.shape == b.shape;
+    }
+
+    Line blankLine(ColumnCount _columns)
+    {
+        return Line(_columns, Cell{}, Line::Flags::None);
+    }
+} // }}}
+
+// {{{ wire encoding
+void WireWriter::varuint(uint64_t _value)
+{
+    while (_value >= 0x80)
+    {
+        output_.push_back(static_cast<char>((_value & 0x7F) | 0x80));
+        _value >>= 7;
+    }
+    output_.push_back(static_cast<char>(_value));
+}
+
+void WireWriter::bytes(string_view _value)
+{
+    varuint(_value.size());
+    output_.append(_value);
+}
+
+uint8_t WireReader::byte()
+{
+    if (input_.empty())
+    {
+        failed_ = true;
+        return 0;
+    }
+    auto const value = static_cast<uint8_t>(input_.front());
+    input_.remove_prefix(1);
+    return value;
+}
+
+uint64_t WireReader::varuint()
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        auto const ch = byte();
+        if (failed_)
+            return 0;
+        value |= uint64_t(ch & 0x7F) << shift;
+        if (!(ch & 0x80))
+            return value;
+    }
+    failed_ = true;
+    return 0;
+}
+
+string_view WireReader::bytes()
+{
+    auto const size = varuint();
+    if (failed_ || size > input_.size())
+    {
+        failed_ = true;
+        return {};
+    }
+    auto const value = input_.substr(0, size);
+    input_.remove_prefix(size);
+    return value;
+}
+
+string encodeMessage(MessageType _type, string_view _payload)
+{
+    auto message = string{};
+    message.reserve(_payload.size() + 6);
+    auto writer = WireWriter(message);
+    writer.byte(static_cast<uint8_t>(_type));
+    writer.bytes(_payload);
+    return message;
+}
+
+optional<Message> MessageDecoder::next()
+{
+    if (failed_)
+        return nullopt;
+
+    auto reader = WireReader(string_view(buffer_).substr(offset_));
+    auto const type = reader.byte();
+    auto const size = reader.varuint();
+    if (reader.failed())
+        return nullopt; // incomplete header
+
+    if (size > MaxMessageSize)
+    {
+        failed_ = true;
+        return nullopt;
+    }
+
+    if (reader.remaining() < size)
+        return nullopt; // incomplete payload
+
+    auto const start = buffer_.size() - reader.remaining();
+    auto message = Message{static_cast<MessageType>(type), buffer_.substr(start, size)};
+    offset_ = start + size;
+
+    // Compact once the consumed part dominates.
+    if (offset_ > 4096 && offset_ * 2 > buffer_.size())
+    {
+        buffer_.erase(0, offset_);
+        offset_ = 0;
+    }
+    return message;
+}
+// }}}
+
+// {{{ lines
+void encodeLine(WireWriter& _writer, Line const& _line, map<Image::Id, weak_ptr<RasterizedImage const>>* _images)
+{
+    // Packed history lines are visited in place, rather than getting their unpacked cells cached.
+    auto cells = vector<Cell>{};
+    cells.reserve(unbox<size_t>(_line.size()));
+    _line.forEachCell([&](Cell const& _cell) { cells.emplace_back(_cell); });
+
+    auto cellCount = cells.size();
+    while (cellCount && isDefaultCell(cells[cellCount - 1]))
+        --cellCount;
+
+    _writer.varuint(static_cast<unsigned>(_line.flags()));
+    _writer.varuint(cellCount);
+
+    // style runs
+    auto runs = vector<std::pair<size_t, GraphicsAttributes>>{};
+    for (size_t i = 0; i < cellCount; ++i)
+    {
+        if (!runs.empty() && runs.back().second == cells[i].attributes())
+            ++runs.back().first;
+        else
+            runs.emplace_back(1, cells[i].attributes());
+    }
+    _writer.varuint(runs.size());
+    for (auto const& [length, attributes]: runs)
+    {
+        _writer.varuint(length);
+        encodeAttributes(_writer, attributes);
+    }
+
+    // text
+    for (size_t i = 0; i < cellCount; ++i)
+    {
+        Cell const& cell = cells[i];
+        auto const codepoints = cell.codepoints();
+        if (codepoints.empty() && cell.width() == 1)
+            _writer.varuint(0);
+        else if (codepoints.size() == 1 && cell.width() == std::max(unicode::width(codepoints[0]), 1))
+            _writer.varuint(codepoints[0]);
+        else
+        {
+            _writer.varuint(ComplexCell + codepoints.size());
+            _writer.byte(static_cast<uint8_t>(cell.width()));
+            for (char32_t const codepoint: codepoints)
+                _writer.varuint(codepoint);
+        }
+    }
+
+    // image fragments
+#if defined(LIBTERMINAL_IMAGES)
+    auto imageRuns = vector<std::pair<size_t, size_t>>{}; // first cell, length
+    for (size_t i = 0; i < cellCount; ++i)
+    {
+        auto const& fragment = cells[i].imageFragment();
+        if (!fragment)
+            continue;
+        if (!imageRuns.empty() && imageRuns.back().first + imageRuns.back().second == i)
+        {
+            auto const& previous = *cells[i - 1].imageFragment();
+            if (&previous.rasterizedImage() == &fragment->rasterizedImage()
+                && fragment->offset() == Coordinate{previous.offset().row, previous.offset().column + 1})
+            {
+                ++imageRuns.back().second;
+                continue;
+            }
+        }
+        imageRuns.emplace_back(i, 1);
+    }
+    _writer.varuint(imageRuns.size());
+    for (auto const& [column, length]: imageRuns)
+    {
+        auto const& fragment = *cells[column].imageFragment();
+        _writer.varuint(column);
+        _writer.varuint(length);
+        encodePlacement(_writer, fragment.rasterizedImage());
+        _writer.varuint(static_cast<uint64_t>(fragment.offset().row));
+        _writer.varuint(static_cast<uint64_t>(fragment.offset().column));
+        if (_images)
+            (*_images)[fragment.rasterizedImage().image().id()] = fragment.rasterizedImagePtr();
+    }
+#else
+    (void) _images;
+    _writer.varuint(0);
+#endif
+}
+
+RemoteLine decodeLine(WireReader& _reader, ColumnCount _columns)
+{
+    auto const columns = unbox<size_t>(_columns);
+    auto const flags = static_cast<Line::Flags>(_reader.varuint() & 0xFF);
+    auto const cellCount = _reader.varuint();
+    if (cellCount > columns)
+    {
+        // Never produced by encodeLine() for lines of the page size announced.
+        _reader.fail();
+        return RemoteLine{blankLine(_columns), {}};
+    }
+
+    auto cells = Line::Buffer(columns, Cell{});
+
+    auto const runCount = _reader.varuint();
+    size_t column = 0;
+    for (uint64_t run = 0; run < runCount && !_reader.failed(); ++run)
+    {
+        auto const length = _reader.varuint();
+        auto const attributes = decodeAttributes(_reader);
+        for (uint64_t i = 0; i < length && column < cellCount; ++i)
+            cells[column++].setAttributes(attributes);
+    }
+
+    for (size_t i = 0; i < cellCount && !_reader.failed(); ++i)
+    {
+        auto const value = _reader.varuint();
+        if (value == 0)
+            continue;
+        if (value < ComplexCell)
+        {
+            cells[i].setCharacter(static_cast<char32_t>(value));
+            continue;
+        }
+        auto const count = min(value - ComplexCell, uint64_t(Cell::MaxCodepoints));
+        auto const width = _reader.byte();
+        for (uint64_t k = 0; k < count; ++k)
+        {
+            auto const codepoint = static_cast<char32_t>(_reader.varuint());
+            if (k == 0)
+                cells[i].setCharacter(codepoint);
+            else
+                cells[i].appendCharacter(codepoint);
+        }
+        cells[i].setWidth(width);
+    }
+
+    auto result = RemoteLine{};
+    auto const imageRunCount = _reader.varuint();
+    for (uint64_t i = 0; i < imageRunCount && !_reader.failed(); ++i)
+    {
+        auto run = ImageRun{};
+        run.column = ColumnCount::cast_from(_reader.varuint());
+        run.length = ColumnCount::cast_from(_reader.varuint());
+        run.placement = decodePlacement(_reader);
+        run.offset.row = static_cast<int>(_reader.varuint());
+        run.offset.column = static_cast<int>(_reader.varuint());
+        result.images.emplace_back(run);
+    }
+
+    result.line = Line(_columns, move(cells), flags);
+    return result;
+}
+// }}}
+
+// {{{ FrameEncoder
+optional<string> FrameEncoder::encodeFrame(Terminal const& _terminal)
+{
+    Screen const& screen = _terminal.screen();
+    Grid const& grid = screen.grid();
+    auto const pageSize = grid.screenSize();
+    auto const lineCount = unbox<size_t>(pageSize.lines);
+    auto const historyLineCount = unbox<uint64_t>(grid.historyLineCount());
+    auto const topSerial = grid.lineSerial(unbox<int>(grid.historyLineCount()));
+    auto const primary = screen.isPrimaryScreen();
+    auto const cursor = FrameCursor{screen.realCursorPosition(), screen.cursor().visible, _terminal.cursorShape()};
+
+    auto const full = full_ || pageSize != pageSize_ || primary != primary_;
+    auto scrolled = uint64_t{0};
+    if (full)
+        sentLines_.assign(lineCount, string{});
+    else if (primary && topSerial > topSerial_ && topSerial - topSerial_ < lineCount)
+    {
+        // Lines that scrolled off the page are already known to the client.
+        scrolled = topSerial - topSerial_;
+        std::rotate(sentLines_.begin(), sentLines_.begin() + static_cast<long>(scrolled), sentLines_.end());
+        for (auto i = lineCount - scrolled; i < lineCount; ++i)
+            sentLines_[i].clear();
+    }
+
+    auto changedLines = string{};
+    auto changedCount = size_t{0};
+    auto changedWriter = WireWriter(changedLines);
+    auto encoded = string{};
+    for (size_t row = 0; row < lineCount; ++row)
+    {
+        encoded.clear();
+        auto writer = WireWriter(encoded);
+        encodeLine(writer, grid.lineAt(static_cast<int>(row) + 1), &images_);
+        if (encoded == sentLines_[row])
+            continue;
+        changedWriter.varuint(row);
+        changedLines += encoded;
+        sentLines_[row].swap(encoded);
+        ++changedCount;
+    }
+
+    auto const unchanged = !full && !scrolled && !changedCount
+                        && sameCursor(cursor, cursor_)
+                        && historyLineCount == historyLineCount_
+                        && topSerial == topSerial_;
+    full_ = false;
+    pageSize_ = pageSize;
+    primary_ = primary;
+    topSerial_ = topSerial;
+    historyLineCount_ = historyLineCount;
+    cursor_ = cursor;
+    if (unchanged)
+        return nullopt;
+
+    auto payload = string{};
+    auto writer = WireWriter(payload);
+    writer.varuint(++frameId_);
+    writer.byte(static_cast<uint8_t>((full ? FullFrame : 0) | (primary ? 0 : AlternateScreen)));
+    writer.varuint(unbox<uint64_t>(pageSize.lines));
+    writer.varuint(unbox<uint64_t>(pageSize.columns));
+    writer.varuint(historyLineCount);
+    writer.varuint(topSerial);
+    writer.varuint(scrolled);
+    writer.varuint(static_cast<uint64_t>(cursor.position.row));
+    writer.varuint(static_cast<uint64_t>(cursor.position.column));
+    writer.byte(cursor.visible ? 1 : 0);
+    writer.byte(static_cast<uint8_t>(cursor.shape));
+    writer.varuint(changedCount);
+    payload += changedLines;
+    return payload;
+}
+
+string FrameEncoder::encodeHistory(Terminal const& _terminal, uint64_t _beforeSerial, size_t _count)
+{
+    Screen const& screen = _terminal.screen();
+    Grid const& grid = screen.grid();
+
+    auto payload = string{};
+    auto writer = WireWriter(payload);
+
+    auto const before = screen.isPrimaryScreen() ? grid.absoluteLineOfSerial(_beforeSerial) : nullopt;
+    if (!before)
+    {
+        writer.varuint(_beforeSerial);
+        writer.varuint(0);
+        return payload;
+    }
+
+    auto const count = static_cast<int>(min({_count, MaxHistoryLinesPerRequest, static_cast<size_t>(*before)}));
+    auto const first = *before - count;
+    writer.varuint(grid.lineSerial(first));
+    writer.varuint(static_cast<uint64_t>(count));
+    for (int line = first; line < *before; ++line)
+        encodeLine(writer, grid.absoluteLineCopyAt(line), &images_);
+    return payload;
+}
+
+string FrameEncoder::encodeImage(Image::Id _image)
+{
+    auto payload = string{};
+    auto writer = WireWriter(payload);
+    writer.varuint(_image);
+
+    auto const i = images_.find(_image);
+    auto const rasterizedImage = i != images_.end() ? i->second.lock() : nullptr;
+    if (!rasterizedImage)
+    {
+        if (i != images_.end())
+            images_.erase(i);
+        writer.byte(0);
+        return payload;
+    }
+
+    Image const& image = rasterizedImage->image();
+    writer.byte(1);
+    writer.byte(static_cast<uint8_t>(image.format()));
+    writer.varuint(unbox<uint64_t>(image.width()));
+    writer.varuint(unbox<uint64_t>(image.height()));
+    writer.bytes(string_view(reinterpret_cast<char const*>(image.data().data()), image.data().size()));
+    return payload;
+}
+// }}}
+
+// {{{ decoding
+optional<Frame> decodeFrame(string_view _payload)
+{
+    auto reader = WireReader(_payload);
+    auto frame = Frame{};
+    frame.id = reader.varuint();
+    auto const flags = reader.byte();
+    frame.full = (flags & FullFrame) != 0;
+    frame.alternateScreen = (flags & AlternateScreen) != 0;
+    frame.pageSize.lines = LineCount::cast_from(min(reader.varuint(), uint64_t(0xFFFF)));
+    frame.pageSize.columns = ColumnCount::cast_from(min(reader.varuint(), uint64_t(0xFFFF)));
+    frame.historyLineCount = reader.varuint();
+    frame.topSerial = reader.varuint();
+    frame.scrolled = LineCount::cast_from(min(reader.varuint(), uint64_t(0xFFFF)));
+    frame.cursor.position.row = static_cast<int>(reader.varuint());
+    frame.cursor.position.column = static_cast<int>(reader.varuint());
+    frame.cursor.visible = reader.byte() != 0;
+    frame.cursor.shape = decodeEnum(reader, CursorShape::Bar, CursorShape::Block);
+
+    auto const changedCount = reader.varuint();
+    for (uint64_t i = 0; i < changedCount && !reader.failed(); ++i)
+    {
+        auto const row = reader.varuint();
+        if (row >= unbox<uint64_t>(frame.pageSize.lines))
+            return nullopt;
+        frame.lines.emplace_back(static_cast<int>(row), decodeLine(reader, frame.pageSize.columns));
+    }
+
+    if (reader.failed())
+        return nullopt;
+    return frame;
+}
+
+optional<ImageData> decodeImageData(string_view _payload)
+{
+    auto reader = WireReader(_payload);
+    auto image = ImageData{};
+    image.image = reader.varuint();
+    image.available = reader.byte() != 0;
+    if (image.available)
+    {
+        image.format = decodeEnum(reader, ImageFormat::PNG, ImageFormat::RGBA);
+        image.size.width = Width::cast_from(reader.varuint());
+        image.size.height = Height::cast_from(reader.varuint());
+        auto const data = reader.bytes();
+        image.data.assign(data.begin(), data.end());
+    }
+    if (reader.failed())
+        return nullopt;
+    return image;
+}
+// }}}
+
+// {{{ ScreenReplica
+optional<Frame> ScreenReplica::applyFrame(string_view _payload)
+{
+    auto frame = decodeFrame(_payload);
+    if (!frame)
+        return nullopt;
+
+    auto const lineCount = unbox<size_t>(frame->pageSize.lines);
+    if (frame->full || frame->pageSize != pageSize_)
+    {
+        // Resizing may have reflowed (and renumbered) the history lines.
+        if (frame->pageSize != pageSize_)
+            history_.clear();
+        lines_.assign(lineCount, RemoteLine{blankLine(frame->pageSize.columns), {}});
+    }
+    else if (auto const scrolled = unbox<size_t>(frame->scrolled); scrolled)
+    {
+        for (size_t i = 0; i < scrolled; ++i)
+            history_[topSerial_ + i] = move(lines_[i]);
+        std::rotate(lines_.begin(), lines_.begin() + static_cast<long>(scrolled), lines_.end());
+        for (auto i = lineCount - scrolled; i < lineCount; ++i)
+            lines_[i] = RemoteLine{blankLine(frame->pageSize.columns), {}};
+    }
+
+    if (!frame->alternateScreen)
+    {
+        // Forget about lines no longer in the history, e.g. after it has been cleared.
+        auto const oldest = frame->topSerial - min(frame->topSerial, frame->historyLineCount);
+        history_.erase(history_.begin(), history_.lower_bound(oldest));
+        history_.erase(history_.lower_bound(frame->topSerial), history_.end());
+    }
+
+    for (auto& [row, line]: frame->lines)
+        lines_.at(static_cast<size_t>(row)) = line;
+
+    pageSize_ = frame->pageSize;
+    cursor_ = frame->cursor;
+    historyLineCount_ = frame->historyLineCount;
+    if (!frame->alternateScreen)
+        topSerial_ = frame->topSerial;
+    return frame;
+}
+
+optional<size_t> ScreenReplica::applyHistory(string_view _payload)
+{
+    auto reader = WireReader(_payload);
+    auto const firstSerial = reader.varuint();
+    auto const count = reader.varuint();
+    auto lines = vector<RemoteLine>{};
+    for (uint64_t i = 0; i < count && !reader.failed(); ++i)
+        lines.emplace_back(decodeLine(reader, pageSize_.columns));
+    if (reader.failed())
+        return nullopt;
+
+    for (size_t i = 0; i < lines.size(); ++i)
+        if (firstSerial + i < topSerial_)
+            history_[firstSerial + i] = move(lines[i]);
+    return lines.size();
+}
+
+RemoteLine const* ScreenReplica::historyLine(uint64_t _serial) const
+{
+    auto const i = history_.find(_serial);
+    return i != history_.end() ? &i->second : nullptr;
+}
+
+string ScreenReplica::renderText() const
+{
+    auto text = string{};
+    for (auto const& line: lines_)
+    {
+        text += line.line.toUtf8();
+        text += '\n';
+    }
+    return text;
+}
+// }}}
+
+} // end namespace
@@ -0,0 +1,297 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/Grid.h>
+#include <terminal/Image.h>
+#include <terminal/Sequencer.h>
+#include <terminal/primitives.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace terminal {
+    class Terminal;
+}
+
+/**
+ * Terminal multiplexing protocol, as spoken between contour-daemon and its clients
+ * (see docs/daemon-mode.md).
+ *
+ * Every message is framed as its type (1 byte), its payload size (LEB128), and the payload.
+ * Integers within payloads are LEB128 encoded, and strings are prefixed with their size.
+ *
+ * Clients attached to a session get a full redraw frame first, and then frames with
+ * only the lines that changed since. Lines scrolling off the page are announced by count,
+ * so clients can move them into their own history cache instead of getting them resent.
+ * Any older history is fetched on demand, and image data only when asked for.
+ */
+namespace terminal::mux {
+
+constexpr uint64_t ProtocolVersion = 1;
+
+/// Upper bound of a single message's payload, protecting against garbage input.
+constexpr size_t MaxMessageSize = 64 * 1024 * 1024;
+
+enum class MessageType : uint8_t
+{
+    // client to server
+    Hello = 1,          //!< protocol version
+    ListSessions = 2,   //!< (empty)
+    Attach = 3,         //!< session ID (0 for a new session), lines, columns
+    Input = 4,          //!< bytes to write to the session's PTY
+    Resize = 5,         //!< lines, columns
+    RequestRedraw = 6,  //!< (empty)
+    RequestHistory = 7, //!< serial of the line below the requested ones, line count
+    RequestImage = 8,   //!< image ID
+    Detach = 9,         //!< (empty)
+
+    // server to client
+    Welcome = 64,       //!< protocol version
+    SessionList = 65,   //!< count, and for each: session ID, lines, columns, title
+    Attached = 66,      //!< session ID
+    Frame = 67,         //!< see FrameEncoder
+    HistoryLines = 68,  //!< serial of the first line, line count, lines (oldest first)
+    ImageData = 69,     //!< image ID, availability, format, width, height, data
+    SessionClosed = 70, //!< session ID
+    Error = 71,         //!< message text
+};
+
+struct Message
+{
+    MessageType type;
+    std::string payload;
+};
+
+/// Appends LEB128 encoded integers and size-prefixed strings.
+class WireWriter
+{
+  public:
+    explicit WireWriter(std::string& _output): output_{ _output } {}
+
+    void byte(uint8_t _value) { output_.push_back(static_cast<char>(_value)); }
+    void varuint(uint64_t _value);
+    void bytes(std::string_view _value);
+
+  private:
+    std::string& output_;
+};
+
+/// Reads what WireWriter wrote. Reading past the end yields zeros and marks the reader failed.
+class WireReader
+{
+  public:
+    explicit WireReader(std::string_view _input): input_{ _input } {}
+
+    uint8_t byte();
+    uint64_t varuint();
+    std::string_view bytes();
+
+    void fail() noexcept { failed_ = true; }
+    bool failed() const noexcept { return failed_; }
+    size_t remaining() const noexcept { return input_.size(); }
+
+  private:
+    std::string_view input_;
+    bool failed_ = false;
+};
+
+/// @returns the framed message of the given type and payload.
+std::string encodeMessage(MessageType _type, std::string_view _payload = {});
+
+/// Splits a byte stream back into messages.
+class MessageDecoder
+{
+  public:
+    void feed(std::string_view _data) { buffer_.append(_data); }
+
+    /// @returns the next complete message, or std::nullopt if more data is needed
+    ///          (or the stream is malformed, see failed()).
+    std::optional<Message> next();
+
+    bool failed() const noexcept { return failed_; }
+
+  private:
+    std::string buffer_;
+    size_t offset_ = 0;
+    bool failed_ = false;
+};
+
+/// Describes how an image is placed onto the grid, without its pixel data.
+struct ImagePlacement
+{
+    Image::Id image = 0;
+    ImageFormat format = ImageFormat::RGBA;
+    ImageSize imageSize{};
+    ImageAlignment alignment = ImageAlignment::MiddleCenter;
+    ImageResize resize = ImageResize::ResizeToFit;
+    RGBAColor defaultColor{};
+    GridSize cellSpan{};
+    ImageSize cellSize{};
+};
+
+/// Consecutive cells of a line showing consecutive fragments of the same image row.
+struct ImageRun
+{
+    ColumnCount column{};  //!< 0-based column of the first cell
+    ColumnCount length{};
+    ImagePlacement placement{};
+    Coordinate offset{};   //!< fragment offset of the first cell
+};
+
+/// A line as received from the server.
+///
+/// Image fragments are kept on the side, as their pixel data is only fetched on demand.
+/// Hyperlinks are not transmitted.
+struct RemoteLine
+{
+    Line line{};
+    std::vector<ImageRun> images{};
+};
+
+/// Encodes a line's flags, cells and image fragments.
+///
+/// @param _images if not null, receives the rasterized images referenced by the line.
+void encodeLine(WireWriter& _writer,
+                Line const& _line,
+                std::map<Image::Id, std::weak_ptr<RasterizedImage const>>* _images = nullptr);
+
+/// Decodes a line encoded via encodeLine(), fitting it into @p _columns columns.
+RemoteLine decodeLine(WireReader& _reader, ColumnCount _columns);
+
+struct FrameCursor
+{
+    Coordinate position{1, 1};
+    bool visible = true;
+    CursorShape shape = CursorShape::Block;
+};
+
+/**
+ * Computes the frames to send to a single client, i.e. what changed on the terminal's
+ * active screen since the previous frame sent.
+ *
+ * The lines last sent are kept in their encoded form and compared against freshly encoded
+ * ones, so no grid modification needs to track damage. Line serial numbers tell how many
+ * lines scrolled into the history, so those are neither compared nor resent.
+ *
+ * All member functions taking the terminal expect the terminal to be locked by the caller.
+ */
+class FrameEncoder
+{
+  public:
+    /// @returns the next frame's payload, or std::nullopt if nothing changed.
+    std::optional<std::string> encodeFrame(Terminal const& _terminal);
+
+    /// Makes the next frame a full redraw.
+    void invalidate() noexcept { full_ = true; }
+
+    /// @returns the HistoryLines payload for up to @p _count lines above the line
+    ///          with the serial @p _beforeSerial.
+    std::string encodeHistory(Terminal const& _terminal, uint64_t _beforeSerial, size_t _count);
+
+    /// @returns the ImageData payload for the given image, if it has been referenced
+    ///          by any line sent to this client.
+    std::string encodeImage(Image::Id _image);
+
+    uint64_t frameCount() const noexcept { return frameId_; }
+
+  private:
+    bool full_ = true;
+    uint64_t frameId_ = 0;
+    PageSize pageSize_{};
+    bool primary_ = true;
+    uint64_t topSerial_ = 0;
+    uint64_t historyLineCount_ = 0;
+    FrameCursor cursor_{};
+    std::vector<std::string> sentLines_;
+    std::map<Image::Id, std::weak_ptr<RasterizedImage const>> images_;
+};
+
+/// A decoded frame.
+struct Frame
+{
+    uint64_t id = 0;
+    bool full = false;
+    bool alternateScreen = false;
+    PageSize pageSize{};
+    uint64_t historyLineCount = 0;
+    uint64_t topSerial = 0;        //!< serial of the page's top line
+    LineCount scrolled{};          //!< lines scrolled off the page since the previous frame
+    FrameCursor cursor{};
+    std::vector<std::pair<int, RemoteLine>> lines{}; //!< changed lines with their 0-based row
+};
+
+std::optional<Frame> decodeFrame(std::string_view _payload);
+
+struct ImageData
+{
+    Image::Id image = 0;
+    bool available = false;
+    ImageFormat format = ImageFormat::RGBA;
+    ImageSize size{};
+    Image::Data data{};
+};
+
+std::optional<ImageData> decodeImageData(std::string_view _payload);
+
+/**
+ * Client-side copy of a remote session's screen, maintained from the frames received.
+ *
+ * History lines are cached by their serial number, filled from lines scrolling off the page
+ * and from HistoryLines replies.
+ */
+class ScreenReplica
+{
+  public:
+    /// Applies a Frame payload.
+    ///
+    /// @returns the applied frame, or std::nullopt if the payload was malformed.
+    std::optional<Frame> applyFrame(std::string_view _payload);
+
+    /// Applies a HistoryLines payload.
+    ///
+    /// @returns the number of lines added to the history cache, or std::nullopt if malformed.
+    std::optional<size_t> applyHistory(std::string_view _payload);
+
+    PageSize pageSize() const noexcept { return pageSize_; }
+    FrameCursor const& cursor() const noexcept { return cursor_; }
+    uint64_t historyLineCount() const noexcept { return historyLineCount_; }
+    uint64_t topSerial() const noexcept { return topSerial_; }
+
+    /// @returns the line at the given 0-based row of the page.
+    RemoteLine const& lineAt(int _row) const { return lines_.at(static_cast<size_t>(_row)); }
+
+    /// @returns the cached history line with the given serial number, if any.
+    RemoteLine const* historyLine(uint64_t _serial) const;
+
+    size_t cachedHistoryLineCount() const noexcept { return history_.size(); }
+
+    /// Renders the page's text, with lines separated by LF.
+    std::string renderText() const;
+
+  private:
+    PageSize pageSize_{};
+    FrameCursor cursor_{};
+    uint64_t historyLineCount_ = 0;
+    uint64_t topSerial_ = 0;
+    std::vector<RemoteLine> lines_;
+    std::map<uint64_t, RemoteLine> history_;
+};
+
+} // end namespace
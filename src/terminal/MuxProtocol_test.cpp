@@ -0,0 +1,225 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/MuxProtocol.h>
+#include <terminal/Terminal.h>
+#include <terminal/pty/MockPty.h>
+
+#include <crispy/base64.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <fmt/format.h>
+
+#include <string>
+
+using namespace terminal;
+using namespace terminal::mux;
+using std::string;
+using std::string_view;
+
+namespace
+{
+    /// Compares the replica's page with the terminal's, line by line.
+    void checkPage(ScreenReplica const& _replica, Terminal const& _terminal)
+    {
+        auto const& grid = _terminal.screen().grid();
+        REQUIRE(_replica.pageSize() == grid.screenSize());
+        for (int row = 0; row < unbox<int>(grid.screenSize().lines); ++row)
+            CHECK(_replica.lineAt(row).line.toUtf8() == grid.lineAt(row + 1).toUtf8());
+    }
+}
+
+TEST_CASE("MuxProtocol.message_framing", "[mux]")
+{
+    auto const stream = encodeMessage(MessageType::Hello, "\x01")
+                      + encodeMessage(MessageType::Input, string(300, 'x'))
+                      + encodeMessage(MessageType::Detach);
+
+    // Byte by byte, as it might trickle in from a socket.
+    auto decoder = MessageDecoder{};
+    auto messages = std::vector<Message>{};
+    for (char const ch: stream)
+    {
+        decoder.feed(string_view(&ch, 1));
+        while (auto message = decoder.next())
+            messages.emplace_back(std::move(*message));
+    }
+    REQUIRE(messages.size() == 3);
+    CHECK(messages[0].type == MessageType::Hello);
+    CHECK(messages[0].payload == "\x01");
+    CHECK(messages[1].payload == string(300, 'x'));
+    CHECK(messages[2].type == MessageType::Detach);
+    CHECK(messages[2].payload.empty());
+    CHECK(!decoder.failed());
+
+    auto garbage = MessageDecoder{};
+    garbage.feed("\x04\xff\xff\xff\xff\x7f");
+    CHECK(!garbage.next().has_value());
+    CHECK(garbage.failed());
+}
+
+TEST_CASE("MuxProtocol.line_roundtrip", "[mux]")
+{
+    auto pty = MockPty(PageSize{LineCount(2), ColumnCount(12)});
+    auto events = Terminal::Events{};
+    auto vt = Terminal(pty, 1024, events);
+    vt.writeToScreen("\033[1;31mRed\033[m \033[38;2;1;2;3;4mrgb\033[m 中́");
+
+    auto encoded = string{};
+    auto writer = WireWriter(encoded);
+    Line const& line = vt.screen().grid().lineAt(1);
+    encodeLine(writer, line);
+
+    auto reader = WireReader(encoded);
+    auto const decoded = decodeLine(reader, ColumnCount(12));
+    CHECK(!reader.failed());
+    CHECK(reader.remaining() == 0);
+    CHECK(decoded.line.toUtf8() == line.toUtf8());
+    for (size_t i = 0; i < 12; ++i)
+    {
+        INFO(fmt::format("column {}", i));
+        CHECK(decoded.line[i].attributes() == line[i].attributes());
+        CHECK(decoded.line[i].width() == line[i].width());
+        CHECK(decoded.line[i].codepoints() == line[i].codepoints());
+    }
+
+    // Trailing default cells are not transmitted.
+    CHECK(encoded.size() < 50);
+}
+
+TEST_CASE("MuxProtocol.incremental_frames", "[mux]")
+{
+    auto pty = MockPty(PageSize{LineCount(4), ColumnCount(10)});
+    auto events = Terminal::Events{};
+    auto vt = Terminal(pty, 1024, events, LineCount(100));
+    auto encoder = FrameEncoder{};
+    auto replica = ScreenReplica{};
+
+    vt.writeToScreen("one\r\ntwo\r\nthree");
+    auto frame = encoder.encodeFrame(vt);
+    REQUIRE(frame.has_value());
+    auto applied = replica.applyFrame(*frame);
+    REQUIRE(applied.has_value());
+    CHECK(applied->full);
+    CHECK(applied->lines.size() == 4);
+    checkPage(replica, vt);
+    CHECK(replica.cursor().position == Coordinate{3, 6});
+
+    // Nothing changed.
+    CHECK(!encoder.encodeFrame(vt).has_value());
+
+    // A single changed line.
+    vt.writeToScreen("!");
+    frame = encoder.encodeFrame(vt);
+    REQUIRE(frame.has_value());
+    applied = replica.applyFrame(*frame);
+    REQUIRE(applied.has_value());
+    CHECK(!applied->full);
+    REQUIRE(applied->lines.size() == 1);
+    CHECK(applied->lines[0].first == 2);
+    checkPage(replica, vt);
+
+    // Scrolling moves lines into the replica's history, rather than resending the page.
+    vt.writeToScreen("\r\nfour\r\nfive\r\nsix");
+    frame = encoder.encodeFrame(vt);
+    REQUIRE(frame.has_value());
+    applied = replica.applyFrame(*frame);
+    REQUIRE(applied.has_value());
+    CHECK(*applied->scrolled == 2);
+    CHECK(applied->lines.size() == 3); // "three!" moved up, "five" and "six" are new
+    checkPage(replica, vt);
+    CHECK(replica.historyLineCount() == 2);
+    REQUIRE(replica.historyLine(replica.topSerial() - 2));
+    CHECK(replica.historyLine(replica.topSerial() - 2)->line.toUtf8Trimmed() == "one");
+    CHECK(replica.historyLine(replica.topSerial() - 1)->line.toUtf8Trimmed() == "two");
+
+    // A forced redraw resends everything.
+    encoder.invalidate();
+    frame = encoder.encodeFrame(vt);
+    REQUIRE(frame.has_value());
+    applied = replica.applyFrame(*frame);
+    REQUIRE(applied.has_value());
+    CHECK(applied->full);
+    checkPage(replica, vt);
+}
+
+TEST_CASE("MuxProtocol.reattach_with_large_history", "[mux]")
+{
+    auto pty = MockPty(PageSize{LineCount(25), ColumnCount(80)});
+    auto events = Terminal::Events{};
+    auto vt = Terminal(pty, 1024, events, LineCount(20000));
+    auto text = string{};
+    for (int i = 1; i <= 20000; ++i)
+        text += fmt::format("\033[32mline {}\033[m with some text\r\n", i);
+    vt.writeToScreen(text);
+    REQUIRE(*vt.screen().historyLineCount() > 19000);
+
+    auto encoder = FrameEncoder{};
+    auto replica = ScreenReplica{};
+    auto const frame = encoder.encodeFrame(vt);
+    REQUIRE(frame.has_value());
+    CHECK(frame->size() < 2048);
+    REQUIRE(replica.applyFrame(*frame).has_value());
+    checkPage(replica, vt);
+
+    // History is fetched on demand.
+    auto const history = encoder.encodeHistory(vt, replica.topSerial(), 100);
+    CHECK(replica.applyHistory(history) == 100);
+    auto const& grid = vt.screen().grid();
+    for (int i = 1; i <= 100; ++i)
+    {
+        auto const* line = replica.historyLine(replica.topSerial() - static_cast<uint64_t>(i));
+        REQUIRE(line);
+        CHECK(line->line.toUtf8() == grid.lineAt(1 - i).toUtf8());
+    }
+
+    // Unknown serials yield no lines.
+    CHECK(replica.applyHistory(encoder.encodeHistory(vt, uint64_t(1) << 40, 10)) == 0);
+}
+
+#if defined(LIBTERMINAL_IMAGES)
+TEST_CASE("MuxProtocol.lazy_images", "[mux]")
+{
+    auto pty = MockPty(PageSize{LineCount(5), ColumnCount(10)});
+    auto events = Terminal::Events{};
+    auto vt = Terminal(pty, 1024, events);
+    vt.screen().setCellPixelSize(ImageSize{Width(10), Height(20)});
+    auto const pixels = string(20 * 20 * 4, '\x7f');
+    vt.writeToScreen(fmt::format("\033_Ga=T,s=20,v=20,i=7,q=2;{}\033\\", crispy::base64::encode(pixels)));
+
+    auto encoder = FrameEncoder{};
+    auto replica = ScreenReplica{};
+    auto const frame = encoder.encodeFrame(vt);
+    REQUIRE(frame.has_value());
+    CHECK(frame->size() < pixels.size());
+    REQUIRE(replica.applyFrame(*frame).has_value());
+
+    auto const& images = replica.lineAt(0).images;
+    REQUIRE(images.size() == 1);
+    CHECK(*images[0].column == 0);
+    CHECK(*images[0].length == 2);
+    CHECK(images[0].placement.imageSize == ImageSize{Width(20), Height(20)});
+
+    auto const data = decodeImageData(encoder.encodeImage(images[0].placement.image));
+    REQUIRE(data.has_value());
+    CHECK(data->available);
+    CHECK(data->size == ImageSize{Width(20), Height(20)});
+    CHECK(data->data.size() == pixels.size());
+
+    // Images never referenced are not handed out.
+    auto const unknown = decodeImageData(encoder.encodeImage(images[0].placement.image + 1));
+    REQUIRE(unknown.has_value());
+    CHECK(!unknown->available);
+}
+#endif
@@ -21,6 +21,7 @@
 
 #include <unicode/utf8.h>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <functional>
@@ -33,6 +34,10 @@
 
 #include <fmt/format.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace terminal::parser { // {{{ enum class types
 
 enum class State : uint8_t {
@@ -509,13 +514,13 @@ struct ParserTable {
         std::array<State, 257>{State::Ground /*XXX or Undefined?*/}};
 
     //! actions to be invoked upon state entry
-    std::array<Action, std::numeric_limits<Action>::size()> entryEvents{Action::Undefined};
+    std::array<Action, std::numeric_limits<State>::size()> entryEvents{Action::Undefined};
 
     //! actions to be invoked upon state exit
-    std::array<Action, std::numeric_limits<Action>::size()> exitEvents{Action::Undefined};
+    std::array<Action, std::numeric_limits<State>::size()> exitEvents{Action::Undefined};
 
     //! actions to be invoked for a given (State, Byte) pair.
-    std::array<std::array<Action, 257>, std::numeric_limits<Action>::size()> events;
+    std::array<std::array<Action, 257>, std::numeric_limits<State>::size()> events{};
 
     //! Standard state machine tables parsing VT225 to VT525.
     static constexpr ParserTable get();
@@ -774,6 +779,148 @@ constexpr ParserTable ParserTable::get() // {{{
     return t;
 } // }}}
 
+/// The standard state machine tables, generated at compile time.
+inline constexpr ParserTable StandardParserTable = ParserTable::get();
+
+namespace detail
+{
+    inline int countTrailingZeroBits(unsigned int _value)
+    {
+    #if defined(_WIN32)
+        return _tzcnt_u32(_value);
+    #else
+        return __builtin_ctz(_value);
+    #endif
+    }
+
+    /// @returns the number of leading printable US-ASCII characters in [_begin, _end).
+    inline size_t countAsciiTextChars(uint8_t const* _begin, uint8_t const* _end) noexcept
+    {
+        // TODO: Do move this functionality into libunicode?
+
+        auto input = _begin;
+
+    #if 0 // TODO: defined(__AVX2__)
+        // AVX2 to be implemented directly in NASM file.
+
+    #elif defined(__SSE2__)
+        __m128i const ControlCodeMax = _mm_set1_epi8(0x20);  // 0..0x1F
+        __m128i const Complex = _mm_set1_epi8(static_cast<char>(0x80));
+
+        while (input < _end - sizeof(__m128i))
+        {
+            __m128i batch = _mm_loadu_si128((__m128i *)input);
+            __m128i isControl = _mm_cmplt_epi8(batch, ControlCodeMax);
+            __m128i isComplex = _mm_and_si128(batch, Complex);
+            __m128i testPack = _mm_or_si128(isControl, isComplex);
+            if (int const check = _mm_movemask_epi8(testPack); check != 0)
+            {
+                int advance = countTrailingZeroBits(static_cast<unsigned>(check));
+                input += advance;
+                break;
+            }
+            input += 16;
+        }
+
+        return static_cast<size_t>(std::distance(_begin, input));
+    #else
+        (void) _end;
+        return 0;
+    #endif
+    }
+
+    /// Decodes the longest prefix of [_input, _end) that consists of complete and valid
+    /// UTF-8 sequences of printable characters, i.e. neither C0 nor C1 control codes,
+    /// into at most @p _capacity codepoints at @p _output.
+    ///
+    /// Blocks of printable US-ASCII are widened 16 bytes at a time. Everything that is not
+    /// accepted here (controls, invalid or overlong sequences, surrogates, and sequences
+    /// truncated at the end of the input) is left to the scalar decoder.
+    ///
+    /// @returns the number of codepoints written, with @p _input advanced past them.
+    inline size_t decodePrintableUtf8(uint8_t const*& _input, uint8_t const* _end,
+                                      char32_t* _output, size_t _capacity) noexcept
+    {
+        auto input = _input;
+        auto output = _output;
+        auto const outputEnd = _output + _capacity;
+
+        while (input != _end && output != outputEnd)
+        {
+    #if defined(__SSE2__)
+            if (_end - input >= 16 && outputEnd - output >= 16)
+            {
+                __m128i const batch = _mm_loadu_si128((__m128i const*) input);
+                __m128i const isControl = _mm_cmplt_epi8(batch, _mm_set1_epi8(0x20));
+                __m128i const isComplex = _mm_and_si128(batch, _mm_set1_epi8(static_cast<char>(0x80)));
+                if (_mm_movemask_epi8(_mm_or_si128(isControl, isComplex)) == 0)
+                {
+                    __m128i const zero = _mm_setzero_si128();
+                    __m128i const lo = _mm_unpacklo_epi8(batch, zero);
+                    __m128i const hi = _mm_unpackhi_epi8(batch, zero);
+                    _mm_storeu_si128((__m128i*) (output + 0), _mm_unpacklo_epi16(lo, zero));
+                    _mm_storeu_si128((__m128i*) (output + 4), _mm_unpackhi_epi16(lo, zero));
+                    _mm_storeu_si128((__m128i*) (output + 8), _mm_unpacklo_epi16(hi, zero));
+                    _mm_storeu_si128((__m128i*) (output + 12), _mm_unpackhi_epi16(hi, zero));
+                    input += 16;
+                    output += 16;
+                    continue;
+                }
+            }
+    #endif
+            uint8_t const lead = *input;
+            if (lead < 0x80)
+            {
+                if (lead < 0x20)
+                    break;
+                *output++ = lead;
+                ++input;
+                continue;
+            }
+
+            auto const available = _end - input;
+            char32_t codepoint = 0;
+            int length = 0;
+            if (lead >= 0xC2 && lead <= 0xDF)
+            {
+                if (available < 2 || (input[1] & 0xC0) != 0x80)
+                    break;
+                codepoint = (char32_t(lead & 0x1F) << 6) | (input[1] & 0x3F);
+                if (codepoint < 0xA0) // C1 control code
+                    break;
+                length = 2;
+            }
+            else if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                if (available < 3 || (input[1] & 0xC0) != 0x80 || (input[2] & 0xC0) != 0x80)
+                    break;
+                codepoint = (char32_t(lead & 0x0F) << 12) | (char32_t(input[1] & 0x3F) << 6) | (input[2] & 0x3F);
+                if (codepoint < 0x800 || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+                    break;
+                length = 3;
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                if (available < 4 || (input[1] & 0xC0) != 0x80 || (input[2] & 0xC0) != 0x80 || (input[3] & 0xC0) != 0x80)
+                    break;
+                codepoint = (char32_t(lead & 0x07) << 18) | (char32_t(input[1] & 0x3F) << 12)
+                          | (char32_t(input[2] & 0x3F) << 6) | (input[3] & 0x3F);
+                if (codepoint < 0x10000 || codepoint > 0x10FFFF)
+                    break;
+                length = 4;
+            }
+            else
+                break;
+
+            *output++ = codepoint;
+            input += length;
+        }
+
+        _input = input;
+        return static_cast<size_t>(output - _output);
+    }
+}
+
 /**
  * Terminal Parser.
  *
@@ -782,18 +929,23 @@ constexpr ParserTable ParserTable::get() // {{{
  *
  * The code comments for enum values have been mostly copied into this source for better
  * understanding when working with this parser.
+ *
+ * The parser is a template over its event listener, so that the per-byte actions
+ * can be dispatched (and inlined) statically when the concrete listener type is known,
+ * such as with Parser<Sequencer>. Parser<ParserEvents> dispatches through the virtual
+ * ParserEvents interface instead and is what tests and tools usually want.
  */
+template <typename EventListener>
 class Parser {
   public:
     using ParseError = std::function<void(std::string const&)>;
     using iterator = uint8_t const*;
 
-    explicit Parser(ParserEvents& _listener) :
+    explicit Parser(EventListener& _listener) :
         eventListener_{ _listener }
     {
     }
 
-
     void parseFragment(std::string_view s);
     void parseFragment(std::u32string_view s)
     {
@@ -804,6 +956,14 @@ class Parser {
     State state() const noexcept { return state_; }
 
   private:
+    static constexpr bool hasBulkPath(State _state) noexcept
+    {
+        return _state == State::Ground
+            || _state == State::OSC_String
+            || _state == State::APC_String
+            || _state == State::DCS_PassThrough;
+    }
+
     void processInput(char32_t _ch);
     void handle(ActionClass _actionClass, Action _action, char32_t _char);
 
@@ -811,14 +971,115 @@ class Parser {
     State state_ = State::Ground;
     unicode::utf8_decoder_state utf8DecoderState_{};
 
-    ParserEvents& eventListener_;
+    EventListener& eventListener_;
 };
 
-inline void Parser::processInput(char32_t _ch)
+template <typename EventListener>
+void Parser<EventListener>::parseFragment(std::string_view _data)
+{
+    auto input = reinterpret_cast<uint8_t const*>(_data.data());
+    auto end = reinterpret_cast<uint8_t const*>(_data.data() + _data.size());
+
+    do
+    {
+        if (state_ == State::Ground && !utf8DecoderState_.expectedLength)
+        {
+            if (auto count = detail::countAsciiTextChars(input, end); count > 0)
+            {
+                eventListener_.print(std::string_view{reinterpret_cast<char const*>(input), count});
+                input += count;
+
+                // This optimization is for the `cat`-people.
+                // It further optimizes the throughput performance by bypassing
+                // the FSM for the `(TEXT LF+)+`-case.
+                //
+                // As of bench-headless, the performance incrrease is about 50x.
+                if (input != end && *input == '\n')
+                {
+                    eventListener_.execute(static_cast<char>(*input++));
+                    continue;
+                }
+            }
+
+            // Non-ASCII text, such as CJK or box drawing characters, is decoded in bulk, too.
+            if (input != end && *input >= 0x80)
+            {
+                std::array<char32_t, 256> codepoints;
+                if (auto const count = detail::decodePrintableUtf8(input, end, codepoints.data(), codepoints.size()); count > 0)
+                {
+                    eventListener_.print(std::u32string_view(codepoints.data(), count));
+                    continue;
+                }
+            }
+        }
+        else if (state_ == State::OSC_String && !utf8DecoderState_.expectedLength)
+        {
+            // Payloads of OSC strings, such as base64 encoded clipboard contents, can be huge.
+            if (auto const count = detail::countAsciiTextChars(input, end); count > 0)
+            {
+                eventListener_.putOSC(std::string_view{reinterpret_cast<char const*>(input), count});
+                input += count;
+                continue;
+            }
+        }
+        else if (state_ == State::APC_String && !utf8DecoderState_.expectedLength)
+        {
+            // Same for APC strings, which carry base64 encoded images.
+            if (auto const count = detail::countAsciiTextChars(input, end); count > 0)
+            {
+                eventListener_.putAPC(std::string_view{reinterpret_cast<char const*>(input), count});
+                input += count;
+                continue;
+            }
+        }
+        else if (state_ == State::DCS_PassThrough && !utf8DecoderState_.expectedLength)
+        {
+            auto const chars = std::string_view{reinterpret_cast<char const*>(input),
+                                                detail::countAsciiTextChars(input, end)};
+            if (auto const count = std::min(chars.size(), chars.find('\x7F')); count > 0) // DEL is ignored
+            {
+                eventListener_.put(chars.substr(0, count));
+                input += count;
+                continue;
+            }
+        }
+
+        if (input == end)
+            break;
+
+        static constexpr char32_t ReplacementCharacter {0xFFFD};
+
+        // Feed the FSM until we are back in a state with a bulk path, with at least one byte consumed.
+        do
+        {
+            // US-ASCII bytes outside of a multi-byte sequence decode to themselves,
+            // which is the common case for control sequences.
+            if (*input < 0x80 && !utf8DecoderState_.expectedLength)
+            {
+                processInput(*input++);
+                continue;
+            }
+
+            unicode::ConvertResult const r = unicode::from_utf8(utf8DecoderState_, *input);
+
+            if (std::holds_alternative<unicode::Success>(r))
+                processInput(std::get<unicode::Success>(r).value);
+            else if (std::holds_alternative<unicode::Invalid>(r))
+                processInput(ReplacementCharacter);
+
+            ++input;
+        }
+        while (input != end && (utf8DecoderState_.expectedLength || !hasBulkPath(state_)));
+    }
+    while (input != end);
+}
+
+template <typename EventListener>
+inline void Parser<EventListener>::processInput(char32_t _ch)
 {
     auto const s = static_cast<size_t>(state_);
 
-    ParserTable static constexpr table = ParserTable::get();
+    auto constexpr& table = StandardParserTable;
 
     auto const ch = _ch < 0xFF ? _ch : static_cast<char32_t>(ParserTable::UnicodeCodepoint::Value);
 
@@ -841,7 +1102,8 @@ inline void Parser::processInput(char32_t _ch)
     }
 }
 
-inline void Parser::handle(ActionClass _actionClass, Action _action, char32_t _char)
+template <typename EventListener>
+inline void Parser<EventListener>::handle(ActionClass _actionClass, Action _action, char32_t _char)
 {
     (void) _actionClass;
     // if (_action != Action::Ignore && _action != Action::Undefined)
@@ -920,6 +1182,8 @@ inline void Parser::handle(ActionClass _actionClass, Action _action, char32_t _c
     }
 }
 
+extern template class Parser<ParserEvents>;
+
 void dot(std::ostream& _os, ParserTable const& _table);
 
 }  // end namespace terminal::parser
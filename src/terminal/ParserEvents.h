@@ -42,6 +42,10 @@ class ParserEvents {
     /// Optimization that passes in ASCII chars between [0x20 .. 0x7F].
     virtual void print(std::string_view _chars) = 0;
 
+    /// Optimization that passes in a run of printable codepoints, each to be treated
+    /// as if passed to print(char32_t) individually.
+    virtual void print(std::u32string_view _chars) = 0;
+
     /**
      * The C0 or C1 control function should be executed, which may have any one of a variety of
      * effects, including changing the cursor position, suspending or resuming communications or
@@ -113,6 +117,9 @@ class ParserEvents {
      */
     virtual void putOSC(char32_t _char) = 0;
 
+    /// Optimization that passes in a run of US-ASCII characters [0x20 .. 0x7F] of the OSC string.
+    virtual void putOSC(std::string_view _chars) = 0;
+
     /**
      * This action is called when the OSC string is terminated by ST, CAN, SUB or ESC,
      * to allow the OSC handler to finish neatly.
@@ -136,6 +143,10 @@ class ParserEvents {
      */
     virtual void put(char32_t _char) = 0;
 
+    /// Optimization that passes in a run of US-ASCII characters [0x20 .. 0x7E]
+    /// of the device control string's data.
+    virtual void put(std::string_view _chars) = 0;
+
     /**
      * When a device control string is terminated by ST, CAN, SUB or ESC, this action calls the
      * previously selected handler function with an “end of data” parameter. This allows the
@@ -145,6 +156,10 @@ class ParserEvents {
 
     virtual void startAPC() = 0;
     virtual void putAPC(char32_t) = 0;
+
+    /// Optimization that passes in a run of US-ASCII characters [0x20 .. 0x7F] of the APC string.
+    virtual void putAPC(std::string_view _chars) = 0;
+
     virtual void dispatchAPC() = 0;
 
     virtual void startPM() = 0;
@@ -157,6 +172,11 @@ class BasicParserEvents : public ParserEvents {
     void error(std::string_view const&) override {}
     void print(char32_t) override {}
     void print(std::string_view) override {}
+    void print(std::u32string_view _chars) override
+    {
+        for (char32_t const ch: _chars)
+            print(ch);
+    }
     void execute(char) override {}
     void clear() override {}
     void collect(char) override {}
@@ -166,12 +186,27 @@ class BasicParserEvents : public ParserEvents {
     void dispatchCSI(char) override {}
     void startOSC() override {}
     void putOSC(char32_t) override {}
+    void putOSC(std::string_view _chars) override
+    {
+        for (char const ch: _chars)
+            putOSC(static_cast<char32_t>(ch));
+    }
     void dispatchOSC() override {}
     void hook(char) override {}
     void put(char32_t) override {}
+    void put(std::string_view _chars) override
+    {
+        for (char const ch: _chars)
+            put(static_cast<char32_t>(ch));
+    }
     void unhook() override {}
     void startAPC() override {}
     void putAPC(char32_t) override {}
+    void putAPC(std::string_view _chars) override
+    {
+        for (char const ch: _chars)
+            putAPC(static_cast<char32_t>(ch));
+    }
     void dispatchAPC() override {}
     void startPM() override {}
     void putPM(char32_t) override {}
@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <string>
+#include <string_view>
 
 namespace terminal {
 
@@ -18,6 +19,13 @@ class ParserExtension
     virtual void start() = 0;
     virtual void pass(char32_t _char) = 0;
     virtual void finalize() = 0;
+
+    /// Passes a run of US-ASCII characters at once.
+    virtual void pass(std::string_view _chars)
+    {
+        for (char const ch: _chars)
+            pass(static_cast<char32_t>(ch));
+    }
 };
 
 class SimpleStringCollector : public ParserExtension
@@ -38,6 +46,11 @@ class SimpleStringCollector : public ParserExtension
         data_.push_back(_char);
     }
 
+    void pass(std::string_view _chars) override
+    {
+        data_.append(_chars.begin(), _chars.end());
+    }
+
     void finalize() override
     {
         if (done_)
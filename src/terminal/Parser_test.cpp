@@ -37,10 +37,45 @@ class MockParserEvents : public terminal::BasicParserEvents {
     void dispatchPM() override { pm += "}"; }
 };
 
+/// Records all parser events in a textual form.
+class RecordingParserEvents final : public terminal::ParserEvents {
+  public:
+    std::string events;
+    int bulkPrints = 0;
+    int bulkPuts = 0;
+
+    void error(string_view const& _msg) override { events += fmt::format("error({})\n", _msg); }
+    void print(char32_t _ch) override { events += fmt::format("print({})\n", unicode::convert_to<char>(_ch)); }
+    void print(std::string_view _chars) override { for (char const ch: _chars) print(char32_t(ch)); }
+    void print(std::u32string_view _chars) override { ++bulkPrints; for (char32_t const ch: _chars) print(ch); }
+    void execute(char _controlCode) override { events += fmt::format("execute({:02X})\n", int(_controlCode)); }
+    void clear() override { events += "clear\n"; }
+    void collect(char _char) override { events += fmt::format("collect({})\n", _char); }
+    void collectLeader(char _leader) override { events += fmt::format("collectLeader({})\n", _leader); }
+    void param(char _char) override { events += fmt::format("param({})\n", _char); }
+    void dispatchESC(char _function) override { events += fmt::format("ESC({})\n", _function); }
+    void dispatchCSI(char _function) override { events += fmt::format("CSI({})\n", _function); }
+    void startOSC() override { events += "startOSC\n"; }
+    void putOSC(char32_t _char) override { events += fmt::format("putOSC({})\n", unicode::convert_to<char>(_char)); }
+    void putOSC(std::string_view _chars) override { ++bulkPuts; for (char const ch: _chars) putOSC(char32_t(ch)); }
+    void dispatchOSC() override { events += "dispatchOSC\n"; }
+    void hook(char _function) override { events += fmt::format("hook({})\n", _function); }
+    void put(char32_t _char) override { events += fmt::format("put({})\n", unicode::convert_to<char>(_char)); }
+    void put(std::string_view _chars) override { ++bulkPuts; for (char const ch: _chars) put(char32_t(ch)); }
+    void unhook() override { events += "unhook\n"; }
+    void startAPC() override { events += "startAPC\n"; }
+    void putAPC(char32_t _char) override { events += fmt::format("putAPC({})\n", unicode::convert_to<char>(_char)); }
+    void putAPC(std::string_view _chars) override { ++bulkPuts; for (char const ch: _chars) putAPC(char32_t(ch)); }
+    void dispatchAPC() override { events += "dispatchAPC\n"; }
+    void startPM() override { events += "startPM\n"; }
+    void putPM(char32_t _char) override { events += fmt::format("putPM({})\n", unicode::convert_to<char>(_char)); }
+    void dispatchPM() override { events += "dispatchPM\n"; }
+};
+
 TEST_CASE("Parser.utf8_single", "[Parser]")
 {
     MockParserEvents textListener;
-    auto p = parser::Parser(textListener);
+    auto p = parser::Parser<ParserEvents>(textListener);
 
     p.parseFragment("\xC3\xB6");  // ö
 
@@ -50,7 +85,7 @@ TEST_CASE("Parser.utf8_single", "[Parser]")
 TEST_CASE("Parser.PM")
 {
     MockParserEvents listener;
-    auto p = parser::Parser(listener);
+    auto p = parser::Parser<ParserEvents>(listener);
     REQUIRE(p.state() == parser::State::Ground);
     p.parseFragment("ABC\033^hello\033\\DEF"sv);
     CHECK(p.state() == parser::State::Ground);
@@ -61,7 +96,7 @@ TEST_CASE("Parser.PM")
 TEST_CASE("Parser.APC")
 {
     MockParserEvents listener;
-    auto p = parser::Parser(listener);
+    auto p = parser::Parser<ParserEvents>(listener);
     REQUIRE(p.state() == parser::State::Ground);
     p.parseFragment("ABC\033\\\033_Gi=1,a=q;\033\\DEF"sv);
     REQUIRE(p.state() == parser::State::Ground);
@@ -69,3 +104,79 @@ TEST_CASE("Parser.APC")
     REQUIRE(listener.text == "ABCDEF");
 }
 
+TEST_CASE("Parser.devirtualized", "[Parser]")
+{
+    auto constexpr input = "abc\r\n\033[?1;2:3h\xC3\xB6\033(B\033]2;t\xC3\xB6\007\033Pq#0\033\\\033[ q\xFFx"sv;
+
+    // The virtual instantiation must emit the very same events as the statically dispatched one.
+    auto virtualListener = RecordingParserEvents{};
+    auto virtualParser = parser::Parser<ParserEvents>(virtualListener);
+    virtualParser.parseFragment(input);
+
+    auto staticListener = RecordingParserEvents{};
+    auto staticParser = parser::Parser<RecordingParserEvents>(staticListener);
+    staticParser.parseFragment(input);
+
+    CHECK(staticParser.state() == parser::State::Ground);
+    CHECK(staticListener.events == virtualListener.events);
+    CHECK(staticListener.events.find("collectLeader(?)\nparam(1)\nparam(;)\nparam(2)\nparam(:)\nparam(3)\nCSI(h)\n") != string::npos);
+    CHECK(staticListener.events.find("putOSC(\xC3\xB6)\n") != string::npos);
+    CHECK(staticListener.events.find("print(\xEF\xBF\xBD)\n") != string::npos); // invalid UTF-8
+}
+
+TEST_CASE("Parser.utf8_bulk", "[Parser]")
+{
+    auto constexpr input =
+        "\xE4\xB8\xAD\xE6\x96\x87 text \xE2\x94\x8C\xE2\x94\x80\xE2\x94\x90\r\n" // "中文 text ┌─┐"
+        "e\xCC\x81 \xF0\x9F\x98\x80 \xC2\xA0\xC3\xBF"                               // combining, emoji, Latin-1
+        "\xC2\x85"                                                                      // C1 control (NEL)
+        "\xC0\xAF \xED\xA0\x80 \xF4\x90\x80\x80 \xFF"                                    // overlong, surrogate, out of range
+        "\033[1m\xE2\x94\x82" "abcdefghijklmnopqrstuvwxyz\xE2\x94\x82\033[m"sv;
+
+    auto whole = RecordingParserEvents{};
+    auto wholeParser = parser::Parser<RecordingParserEvents>(whole);
+    wholeParser.parseFragment(input);
+    CHECK(whole.bulkPrints > 0);
+
+    // Splitting the input anywhere, including within multi-byte sequences,
+    // must result in the very same events.
+    for (size_t i = 1; i < input.size(); ++i)
+    {
+        auto split = RecordingParserEvents{};
+        auto splitParser = parser::Parser<RecordingParserEvents>(split);
+        splitParser.parseFragment(input.substr(0, i));
+        splitParser.parseFragment(input.substr(i));
+        INFO(fmt::format("split at {}", i));
+        CHECK(split.events == whole.events);
+    }
+
+    auto bytewise = RecordingParserEvents{};
+    auto bytewiseParser = parser::Parser<RecordingParserEvents>(bytewise);
+    for (char const ch: input)
+        bytewiseParser.parseFragment(string_view(&ch, 1));
+    CHECK(bytewise.events == whole.events);
+}
+
+TEST_CASE("Parser.bulk_strings", "[Parser]")
+{
+    auto const input = "\033]52;c;" + string(100, 'Q') + "\xC3\xB6\x01" + string(40, '=') + "\033\\"
+                     + "\033Pq" + string(50, '#') + "\x7F" + string(30, '!') + "\r\n\033\\"
+                     + "\033_Ga=T,f=24;" + string(60, 'A') + "\xC3\xB6" + string(20, 'B') + "\033\\"s;
+
+    auto whole = RecordingParserEvents{};
+    auto wholeParser = parser::Parser<RecordingParserEvents>(whole);
+    wholeParser.parseFragment(input);
+    CHECK(whole.bulkPuts > 0);
+    CHECK(whole.events.find("put(\x7F)") == string::npos);
+    CHECK(whole.events.find("putAPC(\xC3\xB6)") != string::npos);
+
+    for (size_t i = 1; i < input.size(); ++i)
+    {
+        auto split = RecordingParserEvents{};
+        auto splitParser = parser::Parser<RecordingParserEvents>(split);
+        splitParser.parseFragment(string_view(input).substr(0, i));
+        splitParser.parseFragment(string_view(input).substr(i));
+        INFO(fmt::format("split at {}", i));
+        CHECK(split.events == whole.events);
+    }
+}
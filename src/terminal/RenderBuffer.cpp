@@ -13,35 +13,22 @@
  */
 #include <terminal/RenderBuffer.h>
 
-#include <mutex>
-
-#include <fmt/format.h>
-
 namespace terminal {
 
-bool RenderDoubleBuffer::swapBuffers(std::chrono::steady_clock::time_point _now) noexcept
+RenderBufferRef RenderTripleBuffer::frontBuffer() const noexcept
 {
-    // If the terminal thread (writer) cannot try_lock (w/o wait time)
-    // the front buffer, it'll just flush back buffer instead of swapping
-    // buffers as the front buffer is apparently still in use by the
-    // renderer thread and we want to avoid render-thread imposed
-    // wait times in the terminal thread as much as possible.
-
-    if (!readerLock.try_lock())
-        return false;
+    if (readers_ == 0 && (middle_.load(std::memory_order_relaxed) & Fresh))
+        frontIndex_ = middle_.exchange(static_cast<uint8_t>(frontIndex_), std::memory_order_acq_rel) & IndexMask;
 
-    auto const _l = std::lock_guard<decltype(readerLock)>(readerLock, std::adopt_lock);
-
-    for (;;)
-    {
-        auto current = currentBackBufferIndex.load();
-        if (currentBackBufferIndex.compare_exchange_weak(current, (current + 1) % 2))
-            break;
-    }
+    return RenderBufferRef(buffers_[frontIndex_], readers_);
+}
 
+void RenderTripleBuffer::swapBuffers(std::chrono::steady_clock::time_point _now) noexcept
+{
+    // Release the back buffer's contents to the reader, and acquire the buffer
+    // the reader last released (if any), so its reads are done before we overwrite it.
+    backIndex_ = middle_.exchange(static_cast<uint8_t>(backIndex_ | Fresh), std::memory_order_acq_rel) & IndexMask;
     lastUpdate = _now;
-    state = RenderBufferState::WaitingForRefresh;
-    return true;
 }
 
 }
@@ -14,10 +14,11 @@
 #pragma once
 
 #include <terminal/Grid.h>
+#include <terminal/LatencyStats.h>
 
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <mutex>
 #include <optional>
 #include <vector>
 
@@ -46,39 +47,49 @@ struct RenderBuffer
     std::vector<RenderCell> screen{};
     std::optional<RenderCursor> cursor{};
     uint64_t frameID{};
+    FrameTimestamps timestamps{};
 
     void clear() { screen.clear(); cursor.reset(); }
 };
 
-/// Lock-guarded handle to a read-only RenderBuffer object.
+struct RenderTripleBuffer;
+
+/// Read-only handle to the front RenderBuffer of a RenderTripleBuffer.
+///
+/// The front buffer is never touched by the writer, and stays pinned
+/// (i.e. is not replaced by a newer frame) as long as a handle to it exists.
 ///
 /// @see RenderBuffer
 struct RenderBufferRef
 {
     RenderBuffer const& buffer;
-    std::mutex& guard;
 
     RenderBuffer const& get() const noexcept { return buffer; }
 
-    RenderBufferRef(RenderBuffer const& _buf, std::mutex& _lock):
-        buffer{_buf}, guard{_lock}
+    RenderBufferRef(RenderBuffer const& _buf, int& _readers):
+        buffer{_buf}, readers_{_readers}
     {
-        guard.lock();
+        ++readers_;
     }
 
+    RenderBufferRef(RenderBufferRef const&) = delete;
+    RenderBufferRef& operator=(RenderBufferRef const&) = delete;
+
     ~RenderBufferRef()
     {
-        guard.unlock();
+        --readers_;
     }
+
+  private:
+    int& readers_;
 };
 
-/// Reflects the current state of a RenderDoubleBuffer object.
+/// Reflects the current state of a RenderTripleBuffer object.
 ///
 enum class RenderBufferState
 {
     WaitingForRefresh,
-    RefreshBuffersAndTrySwap,
-    TrySwapBuffers
+    RefreshBuffers,
 };
 
 constexpr std::string_view to_string(RenderBufferState _state) noexcept
@@ -86,37 +97,50 @@ constexpr std::string_view to_string(RenderBufferState _state) noexcept
     switch (_state)
     {
         case RenderBufferState::WaitingForRefresh: return "WaitingForRefresh";
-        case RenderBufferState::RefreshBuffersAndTrySwap: return "RefreshBuffersAndTrySwap";
-        case RenderBufferState::TrySwapBuffers: return "TrySwapBuffers";
+        case RenderBufferState::RefreshBuffers: return "RefreshBuffers";
     }
     return "INVALID";
 }
 
-struct RenderDoubleBuffer
+/// Hands render buffers over from the terminal (writer) thread to the render (reader) thread
+/// without either of them ever waiting for the other.
+///
+/// Of the three buffers, the writer owns the back buffer and the reader owns the front buffer.
+/// The third one is exchanged atomically: the writer publishes its back buffer by swapping it
+/// with the middle one, and the reader takes the middle one (if it has been published since)
+/// in exchange for its front buffer. So the writer always has a free buffer to fill,
+/// and the reader always gets the latest completed frame.
+struct RenderTripleBuffer
 {
-    std::mutex mutable readerLock;
-    std::atomic<size_t> currentBackBufferIndex = 0;
-    std::array<RenderBuffer, 2> buffers{};
     std::atomic<RenderBufferState> state = RenderBufferState::WaitingForRefresh;
     std::chrono::steady_clock::time_point lastUpdate{};
 
-    RenderBuffer& backBuffer() noexcept { return buffers[currentBackBufferIndex]; }
+    /// May only be invoked by the writer thread.
+    RenderBuffer& backBuffer() noexcept { return buffers_[backIndex_]; }
 
-    RenderBufferRef frontBuffer() const
-    {
-        // if (state == RenderBufferState::TrySwapBuffers)
-        //     const_cast<RenderDoubleBuffer*>(this)->swapBuffers(lastUpdate);
-        RenderBuffer const& frontBuffer = buffers.at((currentBackBufferIndex + 1) % 2);
-        return RenderBufferRef(frontBuffer, readerLock);
-    }
+    /// Acquires the latest published frame, unless the current one is still referenced.
+    /// May only be invoked by the reader thread.
+    RenderBufferRef frontBuffer() const noexcept;
 
     void clear()
     {
         backBuffer().clear();
     }
 
-    // Swaps front with back buffer. May only be invoked by the writer thread.
-    bool swapBuffers(std::chrono::steady_clock::time_point _now) noexcept;
+    /// Publishes the back buffer, and continues with a free one. May only be invoked by the writer thread.
+    void swapBuffers(std::chrono::steady_clock::time_point _now) noexcept;
+
+  private:
+    static constexpr uint8_t IndexMask = 0x03;
+    static constexpr uint8_t Fresh = 0x04; // middle buffer published, but not yet acquired by the reader
+
+    static_assert(std::atomic<uint8_t>::is_always_lock_free);
+
+    std::array<RenderBuffer, 3> buffers_{};
+    size_t backIndex_ = 0;
+    std::atomic<uint8_t> mutable middle_ = 1;
+    size_t mutable frontIndex_ = 2;
+    int mutable readers_ = 0;
 };
 
 } // end namespace
@@ -0,0 +1,128 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/RenderBuffer.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace terminal;
+using std::chrono::steady_clock;
+
+namespace
+{
+    /// Fills the back buffer with cells that all carry the frame ID, so torn frames can be detected.
+    void publishFrame(RenderTripleBuffer& _buffer, uint64_t _frameID, size_t _cellCount = 16)
+    {
+        RenderBuffer& back = _buffer.backBuffer();
+        back.clear();
+        back.frameID = _frameID;
+        for (size_t i = 0; i < _cellCount; ++i)
+        {
+            auto& cell = back.screen.emplace_back();
+            cell.position = Coordinate{static_cast<int>(_frameID), static_cast<int>(i)};
+        }
+        _buffer.swapBuffers(steady_clock::now());
+    }
+
+    bool consistent(RenderBuffer const& _buffer)
+    {
+        for (RenderCell const& cell: _buffer.screen)
+            if (cell.position.row != static_cast<int>(_buffer.frameID))
+                return false;
+        return true;
+    }
+}
+
+TEST_CASE("RenderTripleBuffer.latest_frame", "[renderbuffer]")
+{
+    auto buffer = RenderTripleBuffer{};
+    CHECK(buffer.frontBuffer().get().frameID == 0);
+
+    publishFrame(buffer, 1);
+    publishFrame(buffer, 2);
+    publishFrame(buffer, 3);
+    CHECK(buffer.frontBuffer().get().frameID == 3);
+
+    // Nothing new published: the reader keeps its frame.
+    CHECK(buffer.frontBuffer().get().frameID == 3);
+
+    publishFrame(buffer, 4);
+    auto const front = buffer.frontBuffer();
+    CHECK(front.get().frameID == 4);
+    CHECK(consistent(front.get()));
+}
+
+TEST_CASE("RenderTripleBuffer.pinned_while_referenced", "[renderbuffer]")
+{
+    auto buffer = RenderTripleBuffer{};
+    publishFrame(buffer, 1);
+
+    {
+        auto const front = buffer.frontBuffer();
+        CHECK(front.get().frameID == 1);
+
+        // The writer keeps going without touching the referenced buffer.
+        for (uint64_t frameID = 2; frameID <= 5; ++frameID)
+            publishFrame(buffer, frameID);
+
+        CHECK(front.get().frameID == 1);
+        CHECK(consistent(front.get()));
+        CHECK(buffer.frontBuffer().get().frameID == 1);
+    }
+
+    CHECK(buffer.frontBuffer().get().frameID == 5);
+}
+
+TEST_CASE("RenderTripleBuffer.concurrent", "[renderbuffer]")
+{
+    constexpr uint64_t FrameCount = 50'000;
+    auto buffer = RenderTripleBuffer{};
+    auto writerDone = std::atomic<bool>{false};
+
+    auto writer = std::thread([&]() {
+        for (uint64_t frameID = 1; frameID <= FrameCount; ++frameID)
+            publishFrame(buffer, frameID);
+        writerDone = true;
+    });
+
+    uint64_t lastFrameID = 0;
+    uint64_t framesSeen = 0;
+    bool monotonic = true;
+    bool torn = false;
+    for (;;)
+    {
+        auto const done = writerDone.load();
+        {
+            auto const front = buffer.frontBuffer();
+            monotonic = monotonic && front.get().frameID >= lastFrameID;
+            torn = torn || !consistent(front.get());
+            if (front.get().frameID != lastFrameID)
+                ++framesSeen;
+            lastFrameID = front.get().frameID;
+        }
+        // Everything published before the writer finished must be visible now.
+        if (done)
+            break;
+    }
+    writer.join();
+
+    CHECK(monotonic);
+    CHECK(!torn);
+    CHECK(lastFrameID == FrameCount);
+    CHECK(framesSeen >= 1);
+    CHECK(framesSeen <= FrameCount);
+}
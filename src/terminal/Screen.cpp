@@ -413,6 +413,28 @@ void Screen::setMaxHistoryLineCount(optional<LineCount> _maxHistoryLineCount)
     primaryGrid().setMaxHistoryLineCount(_maxHistoryLineCount);
 }
 
+void Screen::setColdHistory(optional<ColdHistorySettings> _settings)
+{
+    primaryGrid().setColdHistory(_settings);
+    coldHistorySettings_ = std::move(_settings);
+    updateCursorIterators();
+}
+
+MemoryUsage Screen::memoryUsage() const
+{
+    auto usage = grids_[0].memoryUsage();
+    usage += grids_[1].memoryUsage();
+    usage[MemoryCategory::Images] = imagePool_.memoryUsage();
+#if defined(LIBTERMINAL_HYPERLINKS)
+    for (auto const& [id, hyperlink]: hyperlinks_)
+        usage[MemoryCategory::Hyperlinks] += id.capacity()
+                                           + sizeof(HyperlinkInfo)
+                                           + hyperlink->id.capacity()
+                                           + hyperlink->uri.capacity();
+#endif
+    return usage;
+}
+
 void Screen::resizeColumns(ColumnCount _newColumnCount, bool _clear)
 {
     // DECCOLM / DECSCPP
@@ -495,14 +517,11 @@ void Screen::verifyState() const
         fail(fmt::format("Cursor {} does not match clamp to screen {}.", cursor_, clampedCursorPos));
     // FIXME: the above triggers on tmux vertical screen split (cursor.column off-by-one)
 
-    // verify iterators
+    // verify iterators (the current column is derived from the cursor position)
     [[maybe_unused]] auto const line = next(begin(grid().mainPage()), cursor_.position.row - 1);
-    [[maybe_unused]] auto const col = columnIteratorAt(cursor_.position.column);
 
     if (line != currentLine_)
         fail(fmt::format("Calculated current line does not match."));
-    else if (col != currentColumn())
-        fail(fmt::format("Calculated current column does not match."));
 
     if (wrapPending_ && (cursor_.position.column + wrapPending_ - 1) != unbox<int>(size_.columns) && cursor_.position.column != margin_.horizontal.to)
         fail(fmt::format("wrapPending flag set when cursor is not in last column."));
@@ -661,16 +680,22 @@ void Screen::clearAndAdvance(int _offset)
 }
 
 std::string Screen::screenshot(function<string(int)> const& _postLine) const
+{
+    return screenshot(grid().snapshot(0), _postLine);
+}
+
+std::string Screen::screenshot(GridSnapshot const& _snapshot, function<string(int)> const& _postLine)
 {
     auto result = std::stringstream{};
     auto writer = VTWriter(result);
 
-    for (int const absoluteRow : crispy::times(1, *grid().historyLineCount() + *size_.lines))
+    for (int const absoluteRow : crispy::times(1, *_snapshot.historyLineCount() + *_snapshot.pageSize().lines))
     {
-        auto const row = absoluteRow - unbox<int>(grid().historyLineCount());
-        for (int const col: crispy::times(1, *size_.columns))
+        auto const row = absoluteRow - unbox<int>(_snapshot.historyLineCount());
+        auto line = _snapshot.lineAt(row); // a copy, unpacked by reading it as non-const
+        for (auto const col: crispy::times(unbox<size_t>(min(line.size(), _snapshot.pageSize().columns))))
         {
-            Cell const& cell = at({row, col});
+            Cell const& cell = line[col];
 
             if (cell.attributes().styles & CellFlags::Bold)
                 writer.sgr_add(GraphicsRendition::Bold);
@@ -712,7 +737,7 @@ optional<int> Screen::findMarkerBackward(int _currentCursorLine) const
     );
 
     for (int i = _currentCursorLine - 1; i >= 0; --i)
-        if (grid().absoluteLineAt(i).marked())
+        if (grid().absoluteLineFlags(i) & Line::Flags::Marked)
             return {i};
 
     return nullopt;
@@ -727,7 +752,7 @@ optional<int> Screen::findMarkerForward(int _currentCursorLine) const
                      unbox<int>(grid().screenSize().lines);
 
     for (int i = _currentCursorLine + 1; i < end; ++i)
-        if (grid().absoluteLineAt(i).marked())
+        if (grid().absoluteLineFlags(i) & Line::Flags::Marked)
             return {i};
 
     return nullopt;
@@ -832,6 +857,7 @@ void Screen::resetHard()
 
     grids_ = emptyGrids(size(), allowReflowOnResize_, primaryGrid().maxHistoryLineCount());
     activeGrid_ = &primaryGrid();
+    primaryGrid().setColdHistory(coldHistorySettings_);
 
     cursor_ = {};
     updateCursorIterators();
@@ -937,16 +963,7 @@ string Screen::renderTextLine(int row) const
 string Screen::renderHistoryTextLine(int _lineNumberIntoHistory) const
 {
     assert(1 <= _lineNumberIntoHistory && _lineNumberIntoHistory <= unbox<int>(historyLineCount()));
-    string line;
-    line.reserve(*size_.columns);
-
-    for (Cell const& cell : grid().lineAt(1 - _lineNumberIntoHistory))
-        if (cell.codepointCount())
-            line += cell.toUtf8();
-        else
-            line += ' '; // fill character
-
-    return line;
+    return grid().lineCopyAt(1 - _lineNumberIntoHistory).toUtf8();
 }
 // }}}
 
@@ -1099,10 +1116,10 @@ void Screen::eraseCharacters(ColumnCount _n)
     // Spec: https://vt100.net/docs/vt510-rm/ECH.html
     // It's not clear from the spec how to perform erase when inside margin and number of chars to be erased would go outside margins.
     // TODO: See what xterm does ;-)
-    size_t const n = min(
+    auto const n = min(
         unbox<int>(size_.columns) - realCursorPosition().column + 1,
         *_n == 0 ? 1 : unbox<int>(_n));
-    fill_n(currentColumn(), n, Cell{{}, cursor_.graphicsRendition});
+    currentLine_->fill(cursor_.position.column - 1, n, Cell{{}, cursor_.graphicsRendition});
 }
 
 void Screen::clearToEndOfLine()
@@ -1157,22 +1174,11 @@ void Screen::insertChars(int _lineNo, ColumnCount _n)
         margin_.horizontal.to - cursorPosition().column + 1
     );
 
-    auto && line = grid().lineAt(_lineNo);
-    auto column0 = next(begin(line), realCursorPosition().column - 1);
-    auto column1 = next(begin(line), margin_.horizontal.to - n);
-    auto column2 = next(begin(line), margin_.horizontal.to);
+    auto& line = grid().lineAt(_lineNo);
+    auto const column = realCursorPosition().column - 1;
 
-    rotate(
-        column0,
-        column1,
-        column2
-    );
-
-    fill_n(
-        columnIteratorAt(begin(line), cursor_.position.column),
-        n,
-        Cell{L' ', cursor_.graphicsRendition}
-    );
+    line.moveCells(column, margin_.horizontal.to - n - column, column + n);
+    line.fill(cursor_.position.column - 1, n, Cell{L' ', cursor_.graphicsRendition});
 }
 
 void Screen::insertLines(LineCount _n)
@@ -1214,29 +1220,7 @@ void Screen::copyArea(int _top, int _left, int _bottom, int _right, int _page,
         // Copy to its own location => no-op.
         return;
 
-    auto const [x0, xInc, xEnd] = [&]() {
-        if (_targetLeft > _left) // moving right
-            return std::tuple{_right - _left, -1, -1};
-        else
-            return std::tuple{0, +1, _right - _left + 1};
-    }();
-
-    auto const [y0, yInc, yEnd] = [&]() {
-        if (_targetTop > _top) // moving down
-            return std::tuple{_bottom - _top, -1, -1};
-        else
-            return std::tuple{0, +1, _bottom - _top + 1};
-    }();
-
-    for (auto y = y0; y != yEnd; y += yInc)
-    {
-        for (auto x = x0; x != xEnd; x += xInc)
-        {
-            Cell const& sourceCell = at({_top + y, _left + x});
-            Cell& targetCell = at({_targetTop + y, _targetLeft + x});
-            targetCell = sourceCell;
-        }
-    }
+    grid().copyArea(Margin{{_top, _bottom}, {_left, _right}}, Coordinate{_targetTop, _targetLeft});
 
     updateCursorIterators();
 }
@@ -1249,18 +1233,7 @@ void Screen::eraseArea(int _top, int _left, int _bottom, int _right)
     if (_top > _bottom || _left > _right)
         return;
 
-    for (int y = _top; y <= _bottom; ++y)
-    {
-        Line& line = grid().lineAt(y);
-        auto column = next(begin(line), _left - 1);
-        for (int x = _left; x <= _right; ++x)
-        {
-            Cell& cell = *column;
-            cell.reset();
-            cell.setCharacter(0x20);
-            ++column;
-        }
-    }
+    grid().fillArea(Margin{{_top, _bottom}, {_left, _right}}, Cell{0x20, GraphicsAttributes{}});
 }
 
 void Screen::fillArea(char32_t _ch, int _top, int _left, int _bottom, int _right)
@@ -1269,18 +1242,7 @@ void Screen::fillArea(char32_t _ch, int _top, int _left, int _bottom, int _right
     if (!(32 <= _ch && _ch <= 126) && !(160 <= _ch && _ch <= 255))
         return;
 
-    for (int y = _top; y <= _bottom; ++y)
-    {
-        Line& line = grid().lineAt(y);
-        auto column = next(begin(line), _left - 1);
-        for (int x = _left; x <= _right; ++x)
-        {
-            Cell& cell = *column;
-            cell.reset(cursor().graphicsRendition);
-            cell.setCharacter(_ch);
-            ++column;
-        }
-    }
+    grid().fillArea(Margin{{_top, _bottom}, {_left, _right}}, Cell{_ch, cursor().graphicsRendition});
 }
 
 void Screen::deleteLines(LineCount _n)
@@ -1305,26 +1267,15 @@ void Screen::deleteCharacters(ColumnCount _n)
 
 void Screen::deleteChars(int _lineNo, ColumnCount _n)
 {
-    auto line = next(begin(grid().mainPage()), _lineNo - 1);
-    auto column = next(begin(*line), realCursorPosition().column - 1);
-    auto rightMargin = next(begin(*line), margin_.horizontal.to);
-    auto const n = min(unbox<int>(_n), static_cast<int>(distance(column, rightMargin)));
+    auto& line = *next(begin(grid().mainPage()), _lineNo - 1);
+    auto const column = realCursorPosition().column - 1;
+    auto const rightMargin = margin_.horizontal.to;
+    auto const n = min(unbox<int>(_n), rightMargin - column);
 
-    rotate(
-        column,
-        next(column, n),
-        rightMargin
-    );
+    line.moveCells(column + n, rightMargin - column - n, column);
+    line.fill(rightMargin - n, n, Cell{L' ', cursor_.graphicsRendition});
 
     updateCursorIterators();
-
-    rightMargin = next(begin(*line), margin_.horizontal.to);
-
-    fill(
-        prev(rightMargin, n),
-        rightMargin,
-        Cell{L' ', cursor_.graphicsRendition}
-    );
 }
 void Screen::deleteColumns(ColumnCount _n)
 {
@@ -1527,7 +1478,7 @@ void Screen::captureBuffer(int _lineCount, bool _logicalLines)
 
     for (int const row : crispy::times(startLine, lineCount))
     {
-        auto const& lineBuffer = grid().lineAt(row);
+        auto lineBuffer = grid().lineCopyAt(row); // a copy, so that history lines stay packed and cold
 
         if (_logicalLines && lineBuffer.wrapped() && !capturedBuffer.empty())
             capturedBuffer.pop_back();
@@ -1536,7 +1487,7 @@ void Screen::captureBuffer(int _lineCount, bool _logicalLines)
         {
             for (int const col : crispy::times(1, unbox<int>(size_.columns)))
             {
-                Cell const& cell = at({row, col});
+                Cell const& cell = lineBuffer[static_cast<size_t>(col - 1)];
                 if (!cell.codepointCount())
                     writer.write(U' ');
                 else
@@ -2167,6 +2118,32 @@ void Screen::renderImage(std::shared_ptr<Image const> const& _imageRef,
 #endif
 }
 
+void Screen::placeImage(std::shared_ptr<Image const> const& _imageRef, GridSize _cellSpan, bool _moveCursor)
+{
+    auto const cellsFor = [](unsigned _pixels, unsigned _cellPixels) {
+        return _cellPixels ? (_pixels + _cellPixels - 1) / _cellPixels : 1u;
+    };
+
+    auto const imageSize = _imageRef->size();
+    auto const extent = GridSize{
+        *_cellSpan.lines ? _cellSpan.lines
+                         : LineCount::cast_from(cellsFor(*imageSize.height, *cellPixelSize_.height)),
+        *_cellSpan.columns ? _cellSpan.columns
+                           : ColumnCount::cast_from(cellsFor(*imageSize.width, *cellPixelSize_.width))
+    };
+    auto const resizePolicy = *_cellSpan.lines || *_cellSpan.columns ? ImageResize::StretchToFill
+                                                                     : ImageResize::NoResize;
+    auto const topLeft = cursorPosition();
+
+    renderImage(_imageRef, topLeft, extent,
+                Coordinate{0, 0}, imageSize,
+                ImageAlignment::TopStart, resizePolicy,
+                true);
+
+    if (!_moveCursor)
+        moveCursorTo(topLeft);
+}
+
 void Screen::setWindowTitle(std::string const& _title)
 {
     windowTitle_ = _title;
@@ -2533,6 +2510,8 @@ void Screen::dumpState(std::string const& _message, std::ostream& _os) const
         return fmt::format("| {:>4}: {}", _lineNo, grid().lineAt(_lineNo).flags());
     });
     hline();
+    _os << "Screen memory usage:\n" << memoryUsage().summary();
+    hline();
 
     // TODO: print more useful debug information
     // - screen size
@@ -158,6 +158,7 @@ class Screen : public capabilities::StaticDatabase {
     bool logRaw() const noexcept { return logRaw_; }
 
     void setMaxImageColorRegisters(unsigned _value) noexcept { sequencer_.setMaxImageColorRegisters(_value); }
+    void setMaxOscLength(size_t _value) noexcept { sequencer_.setMaxOscLength(_value); }
     void setSixelCursorConformance(bool _value) noexcept { sixelCursorConformance_ = _value; }
 
     void setRespondToTCapQuery(bool _enable) { respondToTCapQuery_ = _enable; }
@@ -175,10 +176,18 @@ class Screen : public capabilities::StaticDatabase {
     }
 
     void setMaxHistoryLineCount(std::optional<LineCount> _maxHistoryLineCount);
+
+    /// Enables (or disables) moving old primary screen history lines into disk-backed storage.
+    ///
+    /// @throws std::system_error if the spill file could not be created.
+    void setColdHistory(std::optional<ColdHistorySettings> _settings);
     std::optional<LineCount> maxHistoryLineCount() const noexcept { return grid().maxHistoryLineCount(); }
 
     LineCount historyLineCount() const noexcept { return grid().historyLineCount(); }
 
+    /// @returns the number of bytes held by both screens' lines, images and hyperlinks.
+    MemoryUsage memoryUsage() const;
+
     /// Writes given data into the screen.
     void write(std::string_view _data);
     void write(std::u32string_view _data);
@@ -207,6 +216,11 @@ class Screen : public capabilities::StaticDatabase {
     ///          including initial clear screen, and initial cursor hide.
     std::string screenshot(std::function<std::string(int)> const& _postLine = {}) const;
 
+    /// Takes a screenshot of all lines of @p _snapshot, like screenshot() above,
+    /// without requiring access to the screen.
+    static std::string screenshot(GridSnapshot const& _snapshot,
+                                  std::function<std::string(int)> const& _postLine = {});
+
     void setFocus(bool _focused) { focused_ = _focused; }
     bool focused() const noexcept { return focused_; }
 
@@ -341,6 +355,28 @@ class Screen : public capabilities::StaticDatabase {
                      ImageResize _resizePolicy,
                      bool _autoScroll);
 
+    /**
+     * Renders an image at the cursor position.
+     *
+     * @p _cellSpan number of lines and columns to stretch the image into, where zero derives
+     *              that dimension from the image's pixel size.
+     * @p _moveCursor whether the cursor is to be placed behind the image or stay where it is.
+     */
+    void placeImage(std::shared_ptr<Image const> const& _imageRef, GridSize _cellSpan, bool _moveCursor);
+
+    // named images, such as the ones transmitted with an image ID of the kitty graphics protocol.
+    void linkImage(std::string const& _name, std::shared_ptr<Image const> _imageRef)
+    {
+        imagePool_.link(_name, std::move(_imageRef));
+    }
+
+    std::shared_ptr<Image const> findImageByName(std::string const& _name) const
+    {
+        return imagePool_.findImageByName(_name);
+    }
+
+    void unlinkImage(std::string const& _name) { imagePool_.unlink(_name); }
+
     void dumpState(std::string const& _message, std::ostream& _os) const;
 
     // reset screen
@@ -445,14 +481,9 @@ class Screen : public capabilities::StaticDatabase {
         return std::next(currentLine_->begin(), cursor_.position.column - 1);
     }
 
-    auto currentColumn() const noexcept
-    {
-        return std::next(currentLine_->cbegin(), cursor_.position.column - 1);
-    }
-
     Cell const& currentCell() const noexcept
     {
-        return (*currentLine_)[cursor_.position.column - 1];
+        return std::as_const(*currentLine_)[static_cast<size_t>(cursor_.position.column - 1)];
     }
 
     Cell& currentCell() noexcept
@@ -470,9 +501,13 @@ class Screen : public capabilities::StaticDatabase {
     /// Gets a reference to the cell relative to screen origin (top left, 1:1).
     Cell& at(Coordinate const& _coord) noexcept { return grid().at(_coord); }
 
-    /// Gets a reference to the cell relative to screen origin (top left, 1:1).
+    /// Gets a reference to the cell relative to screen origin (top left, 1:1),
+    /// which must not be on a packed history line (see cellAt()).
     Cell const& at(Coordinate const& _coord) const noexcept { return grid().at(_coord); }
 
+    /// Gets a copy of the cell relative to screen origin (top left, 1:1), decoding it if packed.
+    Cell cellAt(Coordinate const& _coord) const { return grid().cellAt(_coord); }
+
     bool isPrimaryScreen() const noexcept { return activeGrid_ == &grids_[0]; }
     bool isAlternateScreen() const noexcept { return activeGrid_ == &grids_[1]; }
 
@@ -569,7 +604,7 @@ class Screen : public capabilities::StaticDatabase {
     Grid& backgroundGrid() noexcept { return isPrimaryScreen() ? alternateGrid() : primaryGrid(); }
 
     /// @returns true iff given absolute line number is wrapped, false otherwise.
-    bool lineWrapped(int _lineNumber) const { return activeGrid_->absoluteLineAt(_lineNumber).wrapped(); }
+    bool lineWrapped(int _lineNumber) const { return activeGrid_->absoluteLineFlags(_lineNumber) & Line::Flags::Wrapped; }
 
     int toAbsoluteLine(int _relativeLine) const noexcept { return activeGrid_->toAbsoluteLine(_relativeLine); }
     Coordinate toAbsolute(Coordinate _coord) const noexcept { return {activeGrid_->toAbsoluteLine(_coord.row), _coord.column}; }
@@ -654,7 +689,7 @@ class Screen : public capabilities::StaticDatabase {
     ImagePool imagePool_;
 
     Sequencer sequencer_;
-    parser::Parser parser_;
+    parser::Parser<Sequencer> parser_;
     int64_t instructionCounter_ = 0;
 
     PageSize size_;
@@ -677,6 +712,7 @@ class Screen : public capabilities::StaticDatabase {
     // Lines savedLines_{};
 
     bool allowReflowOnResize_;
+    std::optional<ColdHistorySettings> coldHistorySettings_;
     std::array<Grid, 2> grids_;
     Grid* activeGrid_;
 
@@ -52,6 +52,9 @@ class ScreenEvents {
     virtual void setFontDef(FontDef const& /*_fontDef*/) {}
     virtual void copyToClipboard(std::string_view /*_data*/) {}
     virtual void dumpState() {}
+    virtual void reportLatencyStats(bool /*_json*/) {}
+    virtual void resetLatencyStats() {}
+    virtual void reportMemoryUsage(bool /*_json*/) {}
     virtual void notify(std::string_view /*_title*/, std::string_view /*_body*/) {}
     virtual void reply(std::string_view /*_response*/) {}
     virtual void resizeWindow(PageSize) {}
@@ -84,7 +87,13 @@ class MockScreenEvents : public ScreenEvents {
         replyData += _response;
     }
 
+    void copyToClipboard(std::string_view _data) override
+    {
+        clipboardData = _data;
+    }
+
     std::string replyData;
+    std::string clipboardData;
 };
 
 } // end namespace
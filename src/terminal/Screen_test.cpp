@@ -13,6 +13,7 @@
  */
 #include <terminal/Screen.h>
 #include <terminal/Viewport.h>
+#include <crispy/base64.h>
 #include <crispy/escape.h>
 #include <catch2/catch_all.hpp>
 #include <string_view>
@@ -2352,6 +2353,50 @@ TEST_CASE("OSC.4")
     }
 }
 
+TEST_CASE("OSC.52", "[screen]")
+{
+    auto screen = MockScreen{PageSize{LineCount(2), ColumnCount(2)}};
+
+    auto data = string(3 * 1024 * 1024 + 1, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i * 7 + i / 251);
+    auto const sequence = fmt::format("\033]52;c;{}\033\\", crispy::base64::encode(data));
+
+    SECTION("streamed") {
+        // odd chunk sizes, so that base64 groups are split
+        for (size_t i = 0; i < sequence.size(); i += 4093)
+            screen.write(string_view(sequence).substr(i, 4093));
+        CHECK(screen.clipboardData.size() == data.size());
+        CHECK(screen.clipboardData == data);
+    }
+
+    SECTION("limit") {
+        screen.setMaxOscLength(data.size() - 1);
+        screen.write(sequence);
+        CHECK(screen.clipboardData.empty());
+
+        screen.write("\033]52;c;Zm9vOmJhcg==\007");
+        CHECK(screen.clipboardData == "foo:bar");
+    }
+
+    SECTION("other selection") {
+        screen.write("\033]52;p;Zm9vOmJhcg==\007");
+        CHECK(screen.clipboardData.empty());
+    }
+
+    SECTION("selection limit") {
+        // a selection never terminated by ';' is dropped rather than collected
+        screen.write("\033]52;");
+        for (int i = 0; i < 1024; ++i)
+            screen.write(string(4096, 'c'));
+        screen.write(";Zm9vOmJhcg==\007");
+        CHECK(screen.clipboardData.empty());
+
+        screen.write("\033]52;c;Zm9vOmJhcg==\007");
+        CHECK(screen.clipboardData == "foo:bar");
+    }
+}
+
 TEST_CASE("XTGETTCAP")
 {
     auto screen = MockScreen{PageSize{LineCount(2), ColumnCount(2)}};
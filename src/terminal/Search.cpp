@@ -0,0 +1,386 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Search.h>
+#include <terminal/Grid.h>
+
+#include <algorithm>
+#include <memory>
+
+using std::make_shared;
+using std::move;
+using std::pair;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace terminal {
+
+namespace // {{{ helper
+{
+    void foldInto(string_view _text, string& _output)
+    {
+        _output.resize(_text.size());
+        std::transform(_text.begin(), _text.end(), _output.begin(),
+                       [](char ch) { return static_cast<char>(foldTrigramByte(ch)); });
+    }
+
+    /// A physical line as part of the logical line currently assembled.
+    struct Segment {
+        HistoryBlock const* block;
+        size_t line;    // index into block->lines
+        size_t offset;  // byte offset into the logical line's text
+    };
+
+    /// Assembles logical lines from physical lines and matches them against the pattern.
+    class LogicalLineMatcher {
+      public:
+        LogicalLineMatcher(SearchPattern const& _pattern, SearchMatchHandler const& _onMatch, SearchStats& _stats):
+            pattern_{ _pattern },
+            onMatch_{ _onMatch },
+            stats_{ _stats }
+        {}
+
+        /// Matches the logical line made up of @p _segments (in top-down order).
+        /// @returns false if the match handler requested to stop.
+        bool match(vector<Segment> const& _segments)
+        {
+            if (_segments.empty())
+                return true;
+
+            ++stats_.logicalLines;
+
+            string_view text;
+            if (_segments.size() == 1)
+                text = _segments.front().block->lineText(_segments.front().line);
+            else
+            {
+                buffer_.clear();
+                for (Segment const& segment: _segments)
+                    buffer_ += segment.block->lineText(segment.line);
+                text = buffer_;
+            }
+
+            matches_.clear();
+            pattern_.findAll(text, scratch_, matches_);
+            if (matches_.empty())
+                return true;
+
+            if (pattern_.query().direction == SearchDirection::Backward)
+                std::reverse(matches_.begin(), matches_.end());
+
+            for (auto const& [offset, length]: matches_)
+            {
+                ++stats_.matches;
+                auto const match = SearchMatch{
+                    positionAt(_segments, offset, false),
+                    positionAt(_segments, offset + length - 1, true)
+                };
+                if (!onMatch_(match))
+                    return false;
+            }
+
+            return true;
+        }
+
+      private:
+        static SearchPosition positionAt(vector<Segment> const& _segments, size_t _offset, bool _lastColumn)
+        {
+            auto i = std::prev(std::upper_bound(_segments.begin(), _segments.end(), _offset,
+                                                [](size_t offset, Segment const& s) { return offset < s.offset; }));
+            auto const byte = _offset - i->offset;
+            auto const serial = i->block->firstLine + i->line;
+
+            if (!_lastColumn)
+                return SearchPosition{serial, i->block->columnOf(i->line, byte)};
+
+            // The last column of a match ends right before the cell following its last byte,
+            // which is relevant for wide characters.
+            auto const& line = i->block->lines[i->line];
+            auto next = byte + 1;
+            while (next < line.textLength && i->block->columnOf(i->line, next) == i->block->columnOf(i->line, byte))
+                ++next;
+            return SearchPosition{serial, i->block->columnOf(i->line, next) - 1};
+        }
+
+        SearchPattern const& pattern_;
+        SearchMatchHandler const& onMatch_;
+        SearchStats& stats_;
+        string buffer_;
+        string scratch_;
+        vector<pair<size_t, size_t>> matches_;
+    };
+
+    bool cancelled(std::atomic<bool> const* _cancel) noexcept
+    {
+        return _cancel && _cancel->load(std::memory_order_relaxed);
+    }
+} // }}}
+
+// {{{ SearchPattern
+SearchPattern::SearchPattern(SearchQuery _query):
+    query_{ move(_query) }
+{
+    if (query_.regularExpression)
+    {
+        auto flags = std::regex::ECMAScript | std::regex::optimize;
+        if (!query_.caseSensitive)
+            flags |= std::regex::icase;
+        regex_.emplace(query_.pattern, flags);
+    }
+    else
+    {
+        foldInto(query_.pattern, foldedPattern_);
+        trigrams_ = trigramsOf(query_.pattern);
+    }
+}
+
+void SearchPattern::findAll(string_view _text,
+                            string& _scratch,
+                            vector<pair<size_t, size_t>>& _matches) const
+{
+    if (regex_)
+    {
+        auto const end = std::cregex_iterator();
+        for (auto i = std::cregex_iterator(_text.data(), _text.data() + _text.size(), *regex_); i != end; ++i)
+            if (i->length() > 0)
+                _matches.emplace_back(static_cast<size_t>(i->position()), static_cast<size_t>(i->length()));
+        return;
+    }
+
+    if (query_.pattern.empty() || _text.size() < query_.pattern.size())
+        return;
+
+    string_view haystack = _text;
+    string_view needle = query_.pattern;
+    if (!query_.caseSensitive)
+    {
+        foldInto(_text, _scratch);
+        haystack = _scratch;
+        needle = foldedPattern_;
+    }
+
+    for (auto i = haystack.find(needle); i != string_view::npos; i = haystack.find(needle, i + needle.size()))
+        _matches.emplace_back(i, needle.size());
+}
+// }}}
+
+SearchSnapshot makeSearchSnapshot(Grid& _grid)
+{
+    _grid.updateHistoryIndex();
+
+    auto snapshot = SearchSnapshot{};
+    snapshot.blocks = _grid.historyIndex().snapshot();
+    snapshot.firstLine = _grid.lineSerial(0);
+
+    auto page = make_shared<HistoryBlock>();
+    page->firstLine = _grid.lineSerial(unbox<int>(_grid.historyLineCount()));
+    auto window = TrigramFilter::Window{};
+    for (Line const& line: _grid.mainPage())
+        page->append(line, window);
+    snapshot.blocks.emplace_back(move(page));
+
+    return snapshot;
+}
+
+SearchStats search(SearchSnapshot const& _snapshot,
+                   SearchPattern const& _pattern,
+                   SearchMatchHandler const& _onMatch,
+                   std::atomic<bool> const* _cancel)
+{
+    auto stats = SearchStats{};
+    auto matcher = LogicalLineMatcher{_pattern, _onMatch, stats};
+    auto const& trigrams = _pattern.requiredTrigrams();
+    auto const& blocks = _snapshot.blocks;
+    auto const forward = _pattern.query().direction == SearchDirection::Forward;
+
+    // Tests whether the first line of block @p _index continues a logical line of the block above.
+    auto const continuesAbove = [&](size_t _index) -> bool {
+        auto const& block = blocks[_index];
+        return _index > 0
+            && block.continued()
+            && blocks[_index - 1].endLine() == block.firstLine()
+            && block.firstLine() > _snapshot.firstLine;
+    };
+
+    // Blocks whose logical lines all start and end within may be ruled out entirely.
+    auto const skippable = [&](size_t _index) -> bool {
+        return !trigrams.empty()
+            && !continuesAbove(_index)
+            && !(_index + 1 < blocks.size() && continuesAbove(_index + 1))
+            && !blocks[_index].mayContainAll(trigrams);
+    };
+
+    vector<Segment> segments;
+
+    // Spilled blocks are read back as they are visited, and let go of
+    // as soon as no segment refers to them anymore.
+    vector<HistoryIndex::BlockPtr> loaded(blocks.size());
+    auto const load = [&](size_t _index) -> HistoryBlock const& {
+        if (!loaded[_index])
+            loaded[_index] = blocks[_index].load();
+        return *loaded[_index];
+    };
+    auto const pinned = [&](size_t _index) -> bool {
+        return !segments.empty() && segments.front().block == loaded[_index].get();
+    };
+
+    if (forward)
+    {
+        uint64_t previousLine = 0;
+        size_t released = 0;
+        for (size_t bi = 0; bi < blocks.size(); ++bi)
+        {
+            for (; released < bi && !pinned(released); ++released)
+                loaded[released].reset();
+
+            if (cancelled(_cancel))
+            {
+                stats.cancelled = true;
+                return stats;
+            }
+
+            if (skippable(bi))
+            {
+                ++stats.skippedBlocks;
+                continue;
+            }
+
+            HistoryBlock const& block = load(bi);
+            for (size_t li = 0; li < block.lines.size(); ++li)
+            {
+                auto const serial = block.firstLine + li;
+                if (serial < _snapshot.firstLine)
+                    continue;
+
+                bool const continuation = block.lines[li].wrapped && !segments.empty() && previousLine + 1 == serial;
+                if (!continuation)
+                {
+                    if (!matcher.match(segments))
+                        return stats;
+                    segments.clear();
+                }
+
+                auto const offset = segments.empty() ? 0 : segments.back().offset
+                                  + segments.back().block->lines[segments.back().line].textLength;
+                segments.emplace_back(Segment{&block, li, offset});
+                previousLine = serial;
+            }
+        }
+        matcher.match(segments);
+    }
+    else
+    {
+        // Physical lines are visited bottom-up, collecting them (reversed) until the
+        // head of their logical line has been reached.
+        auto const flush = [&]() -> bool {
+            std::reverse(segments.begin(), segments.end());
+            size_t offset = 0;
+            for (Segment& segment: segments)
+            {
+                segment.offset = offset;
+                offset += segment.block->lines[segment.line].textLength;
+            }
+            auto const more = matcher.match(segments);
+            segments.clear();
+            return more;
+        };
+
+        auto released = blocks.size();
+        for (size_t bi = blocks.size(); bi-- > 0; )
+        {
+            for (; released > bi + 1 && !pinned(released - 1); --released)
+                loaded[released - 1].reset();
+
+            if (cancelled(_cancel))
+            {
+                stats.cancelled = true;
+                return stats;
+            }
+
+            if (skippable(bi))
+            {
+                ++stats.skippedBlocks;
+                continue;
+            }
+
+            HistoryBlock const& block = load(bi);
+            for (size_t li = block.lines.size(); li-- > 0; )
+            {
+                auto const serial = block.firstLine + li;
+                if (serial < _snapshot.firstLine)
+                    break;
+
+                if (!segments.empty()
+                        && segments.back().block->firstLine + segments.back().line != serial + 1
+                        && !flush())
+                    return stats;
+
+                segments.emplace_back(Segment{&block, li, 0});
+
+                auto const head = !block.lines[li].wrapped
+                               || serial == _snapshot.firstLine
+                               || (li == 0 && !continuesAbove(bi));
+                if (head && !flush())
+                    return stats;
+            }
+        }
+        flush();
+    }
+
+    return stats;
+}
+
+// {{{ Searcher
+Searcher::~Searcher()
+{
+    cancel();
+}
+
+void Searcher::start(SearchSnapshot _snapshot,
+                     SearchQuery _query,
+                     SearchMatchHandler _onMatch,
+                     FinishHandler _onFinish)
+{
+    auto pattern = SearchPattern(move(_query));
+
+    cancel();
+
+    cancelled_ = false;
+    running_ = true;
+    thread_ = std::thread([this,
+                           snapshot = move(_snapshot),
+                           pattern = move(pattern),
+                           onMatch = move(_onMatch),
+                           onFinish = move(_onFinish)]() {
+        auto const stats = search(snapshot, pattern, onMatch, &cancelled_);
+        running_ = false;
+        if (onFinish)
+            onFinish(stats);
+    });
+}
+
+void Searcher::cancel()
+{
+    cancelled_ = true;
+    wait();
+}
+
+void Searcher::wait()
+{
+    if (thread_.joinable())
+        thread_.join();
+}
+// }}}
+
+} // end namespace
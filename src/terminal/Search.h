@@ -0,0 +1,178 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/HistoryIndex.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace terminal {
+
+class Grid;
+
+enum class SearchDirection {
+    /// From the top of the scrollback history downwards.
+    Forward,
+    /// From the bottom of the main page upwards, i.e. most recent output first.
+    Backward,
+};
+
+struct SearchQuery {
+    std::string pattern;
+    bool regularExpression = false;
+    bool caseSensitive = true; // case-insensitive matching only folds ASCII letters
+    SearchDirection direction = SearchDirection::Backward;
+};
+
+/// A grid cell as seen by the search, addressed by line serial number (see Grid::lineSerial())
+/// and 0-based column.
+struct SearchPosition {
+    uint64_t line;
+    int column;
+};
+
+/// A match, possibly spanning multiple physical lines of the same logical line.
+struct SearchMatch {
+    SearchPosition begin;
+    SearchPosition end;   // inclusive
+};
+
+/// Immutable text of a grid, ready to be searched without holding the terminal lock.
+struct SearchSnapshot {
+    std::vector<HistoryBlockRef> blocks;
+    uint64_t firstLine = 0;  //!< serial number of the top-most line still part of the grid
+};
+
+/// Captures the text of the grid's scrollback history and main page.
+///
+/// History lines not yet indexed are indexed first. Only the main page's text is copied,
+/// history text is shared with the grid's HistoryIndex, or read back from its spill file.
+SearchSnapshot makeSearchSnapshot(Grid& _grid);
+
+struct SearchStats {
+    size_t matches = 0;
+    size_t logicalLines = 0;   //!< number of logical lines actually matched against
+    size_t skippedBlocks = 0;  //!< number of blocks ruled out by their trigram filter
+    bool cancelled = false;
+};
+
+/// A compiled SearchQuery.
+class SearchPattern {
+  public:
+    /// @throws std::regex_error if the query is an invalid regular expression.
+    explicit SearchPattern(SearchQuery _query);
+
+    SearchQuery const& query() const noexcept { return query_; }
+
+    /// Trigrams every match must contain, or empty if nothing can be ruled out upfront.
+    std::vector<uint32_t> const& requiredTrigrams() const noexcept { return trigrams_; }
+
+    /// Appends (offset, length) of every non-empty, non-overlapping match in @p _text to @p _matches.
+    ///
+    /// @param _scratch buffer reused across calls for case folding.
+    void findAll(std::string_view _text,
+                 std::string& _scratch,
+                 std::vector<std::pair<size_t, size_t>>& _matches) const;
+
+  private:
+    SearchQuery query_;
+    std::string foldedPattern_;
+    std::vector<uint32_t> trigrams_;
+    std::optional<std::regex> regex_;
+};
+
+/// Receives matches in search direction. Returning false stops the search.
+using SearchMatchHandler = std::function<bool(SearchMatch const&)>;
+
+/// Searches @p _snapshot across logical (unwrapped) lines on the calling thread.
+///
+/// @param _cancel optional flag that aborts the search when set.
+SearchStats search(SearchSnapshot const& _snapshot,
+                   SearchPattern const& _pattern,
+                   SearchMatchHandler const& _onMatch,
+                   std::atomic<bool> const* _cancel = nullptr);
+
+/**
+ * Runs one search at a time on a background thread, streaming matches as they are found.
+ *
+ * The handlers are invoked from the search thread and must therefore not block
+ * on anything that may call cancel() or start().
+ */
+class Searcher {
+  public:
+    using FinishHandler = std::function<void(SearchStats const&)>;
+
+    Searcher() = default;
+    Searcher(Searcher const&) = delete;
+    Searcher& operator=(Searcher const&) = delete;
+    ~Searcher();
+
+    /// Starts a new search, cancelling any search still in progress.
+    ///
+    /// @throws std::regex_error if the query is an invalid regular expression.
+    void start(SearchSnapshot _snapshot,
+               SearchQuery _query,
+               SearchMatchHandler _onMatch,
+               FinishHandler _onFinish = {});
+
+    /// Cancels the current search, if any, and waits for it to finish.
+    void cancel();
+
+    /// Waits for the current search to finish.
+    void wait();
+
+    bool running() const noexcept { return running_.load(); }
+
+  private:
+    std::thread thread_;
+    std::atomic<bool> cancelled_ = false;
+    std::atomic<bool> running_ = false;
+};
+
+} // end namespace
+
+namespace fmt {
+    template <>
+    struct formatter<terminal::SearchPosition> {
+        template <typename ParseContext>
+        constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+        template <typename FormatContext>
+        auto format(terminal::SearchPosition const& _pos, FormatContext& ctx)
+        {
+            return format_to(ctx.out(), "{}:{}", _pos.line, _pos.column);
+        }
+    };
+
+    template <>
+    struct formatter<terminal::SearchMatch> {
+        template <typename ParseContext>
+        constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+        template <typename FormatContext>
+        auto format(terminal::SearchMatch const& _match, FormatContext& ctx)
+        {
+            return format_to(ctx.out(), "{}..{}", _match.begin, _match.end);
+        }
+    };
+}
@@ -0,0 +1,278 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Grid.h>
+#include <terminal/Search.h>
+#include <catch2/catch_all.hpp>
+#include <fmt/format.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace terminal;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace // {{{ helper
+{
+    /// Writes @p _text into the bottom line and scrolls it up by one line.
+    void pushLine(Grid& _grid, string_view _text, bool _wrapped = false)
+    {
+        auto const pageSize = _grid.screenSize();
+        Line& line = _grid.lineAt(*pageSize.lines);
+        line.setText(_text);
+        line.setWrapped(_wrapped);
+        _grid.scrollUp(LineCount(1), GraphicsAttributes{}, Margin{{1, *pageSize.lines}, {1, *pageSize.columns}});
+    }
+
+    vector<SearchMatch> searchAll(Grid& _grid, SearchQuery _query, SearchStats* _stats = nullptr)
+    {
+        vector<SearchMatch> matches;
+        auto const stats = search(makeSearchSnapshot(_grid),
+                                  SearchPattern(std::move(_query)),
+                                  [&](SearchMatch const& _match) { matches.push_back(_match); return true; });
+        if (_stats)
+            *_stats = stats;
+        return matches;
+    }
+
+    SearchQuery query(string _pattern, SearchDirection _direction = SearchDirection::Forward)
+    {
+        auto q = SearchQuery{};
+        q.pattern = std::move(_pattern);
+        q.direction = _direction;
+        return q;
+    }
+
+    /// @returns absolute line and column of a search position.
+    std::pair<int, int> resolve(Grid const& _grid, SearchPosition _pos)
+    {
+        return {_grid.absoluteLineOfSerial(_pos.line).value_or(-1), _pos.column};
+    }
+} // }}}
+
+TEST_CASE("Search.literal", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(3), ColumnCount(10)}, false, std::nullopt);
+    pushLine(grid, "foo bar");
+    pushLine(grid, "bar foo");
+    pushLine(grid, "baz");
+    REQUIRE(*grid.historyLineCount() == 3);
+
+    auto const forward = searchAll(grid, query("foo"));
+    REQUIRE(forward.size() == 2);
+    CHECK(resolve(grid, forward[0].begin) == std::pair{2, 0});
+    CHECK(resolve(grid, forward[0].end) == std::pair{2, 2});
+    CHECK(resolve(grid, forward[1].begin) == std::pair{3, 4});
+    CHECK(resolve(grid, forward[1].end) == std::pair{3, 6});
+
+    auto const backward = searchAll(grid, query("foo", SearchDirection::Backward));
+    REQUIRE(backward.size() == 2);
+    CHECK(resolve(grid, backward[0].begin) == std::pair{3, 4});
+    CHECK(resolve(grid, backward[1].begin) == std::pair{2, 0});
+
+    CHECK(searchAll(grid, query("FOO")).empty());
+}
+
+TEST_CASE("Search.case_insensitive_and_regex", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(20)}, false, std::nullopt);
+    pushLine(grid, "Error: disk full");
+    pushLine(grid, "error code 42");
+
+    auto q = query("ERROR");
+    q.caseSensitive = false;
+    CHECK(searchAll(grid, q).size() == 2);
+
+    auto r = query("code [0-9]+");
+    r.regularExpression = true;
+    auto const matches = searchAll(grid, r);
+    REQUIRE(matches.size() == 1);
+    CHECK(resolve(grid, matches[0].begin) == std::pair{2, 6});
+    CHECK(resolve(grid, matches[0].end) == std::pair{2, 12});
+
+    auto invalid = query("(unbalanced");
+    invalid.regularExpression = true;
+    CHECK_THROWS_AS(SearchPattern(invalid), std::regex_error);
+}
+
+TEST_CASE("Search.logical_lines", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(5)}, true, std::nullopt);
+    pushLine(grid, "hello");
+    pushLine(grid, " worl", true);
+    pushLine(grid, "d", true);
+    pushLine(grid, "world");
+
+    for (auto const direction: {SearchDirection::Forward, SearchDirection::Backward})
+    {
+        auto const matches = searchAll(grid, query("world", direction));
+        REQUIRE(matches.size() == 2);
+        auto const& wrapped = direction == SearchDirection::Forward ? matches[0] : matches[1];
+        CHECK(resolve(grid, wrapped.begin) == std::pair{2, 1});
+        CHECK(resolve(grid, wrapped.end) == std::pair{3, 0});
+    }
+}
+
+TEST_CASE("Search.wide_characters", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(1), ColumnCount(10)}, false, std::nullopt);
+    // "中" and "文" are double width each, followed by an empty continuation cell.
+    Line& line = grid.lineAt(1);
+    line[0].setCharacter(U'中');
+    line[2].setCharacter(U'文');
+    line[4].setCharacter(U'x');
+    grid.scrollUp(LineCount(1), GraphicsAttributes{}, Margin{{1, 1}, {1, 10}});
+
+    auto const matches = searchAll(grid, query("\xE6\x96\x87x")); // U+6587 "x"
+    REQUIRE(matches.size() == 1);
+    CHECK(resolve(grid, matches[0].begin) == std::pair{0, 2});
+    CHECK(resolve(grid, matches[0].end) == std::pair{0, 4});
+}
+
+TEST_CASE("Search.history_eviction", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(10)}, false, LineCount(3));
+    for (int i = 0; i < 10; ++i)
+        pushLine(grid, fmt::format("line {}", i));
+
+    REQUIRE(*grid.historyLineCount() == 3);
+    CHECK(grid.historyIndex().lineCount() == 0); // indexing is deferred
+    CHECK(*grid.updateHistoryIndex(LineCount(2)) == 1);
+    CHECK(grid.historyIndex().lineCount() == 2);
+    CHECK(*grid.updateHistoryIndex() == 0);
+    CHECK(grid.historyIndex().lineCount() == 3);
+
+    // Lines 0..5 have fallen off the history.
+    CHECK(searchAll(grid, query("line 5")).empty());
+
+    auto const matches = searchAll(grid, query("line"));
+    REQUIRE(matches.size() == 4); // lines 6 to 8 in the history, line 9 on the main page
+    CHECK(resolve(grid, matches[0].begin) == std::pair{0, 0});
+    CHECK(grid.absoluteLineAt(0).toUtf8Trimmed() == "line 6");
+
+    grid.clearHistory();
+    CHECK(grid.historyIndex().lineCount() == 0);
+    CHECK(!grid.absoluteLineOfSerial(matches[0].begin.line).has_value());
+}
+
+TEST_CASE("Search.resize", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(10)}, true, std::nullopt);
+    for (int i = 0; i < 5; ++i)
+        pushLine(grid, fmt::format("line {}", i));
+    (void) grid.updateHistoryIndex();
+    REQUIRE(grid.historyIndex().lineCount() == 5);
+
+    // growing the page takes lines back from the history
+    (void) grid.resize(PageSize{LineCount(4), ColumnCount(10)}, Coordinate{2, 1}, false);
+    CHECK(grid.historyIndex().lineCount() == unbox<size_t>(grid.historyLineCount()));
+    CHECK(searchAll(grid, query("line")).size() == 5);
+
+    // reflow renumbers all lines
+    (void) grid.resize(PageSize{LineCount(4), ColumnCount(4)}, Coordinate{4, 1}, false);
+    auto const matches = searchAll(grid, query("line"));
+    CHECK(matches.size() == 5);
+    for (auto const& match: matches)
+        CHECK(resolve(grid, match.begin).first >= 0);
+}
+
+TEST_CASE("Search.block_skipping", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(40)}, false, std::nullopt);
+    for (int i = 0; i < 10 * int(HistoryIndex::BlockLineCount); ++i)
+        pushLine(grid, i == 1000 ? string("the needle is here") : fmt::format("{} haystack", i));
+
+    auto stats = SearchStats{};
+    auto const matches = searchAll(grid, query("needle"), &stats);
+    REQUIRE(matches.size() == 1);
+    CHECK(resolve(grid, matches[0].begin) == std::pair{1001, 4});
+    CHECK(stats.skippedBlocks > 0);
+    CHECK(stats.logicalLines < unbox<size_t>(grid.historyLineCount()));
+}
+
+TEST_CASE("Search.cold_history", "[search]")
+{
+    auto constexpr Count = 50 * int(HistoryIndex::BlockLineCount);
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(40)}, false, std::nullopt);
+    grid.setColdHistory(ColdHistorySettings{FileSystem::temp_directory_path(), LineCount(10)});
+
+    auto const pushLines = [&](int _first) {
+        for (int i = _first; i < _first + Count; ++i)
+        {
+            if (i == 766) // logical line wrapping across index blocks
+                pushLine(grid, "split nee");
+            else if (i == 767)
+                pushLine(grid, "dle ending", true);
+            else
+                pushLine(grid, i == 1000 ? string("the needle is here") : fmt::format("{} haystack", i));
+        }
+        CHECK(*grid.updateHistoryIndex() == 0);
+    };
+
+    pushLines(0);
+    CHECK(grid.historyIndex().diskUsage() > 0);
+    auto const memoryUsage = grid.historyIndex().memoryUsage();
+
+    // The index grows on disk, along with the cold history, but not in memory.
+    pushLines(Count);
+    CHECK(grid.historyIndex().memoryUsage() < memoryUsage + 16 * 1024);
+    CHECK(grid.historyIndex().lineCount() == unbox<size_t>(grid.historyLineCount()));
+
+    for (auto const direction: {SearchDirection::Forward, SearchDirection::Backward})
+    {
+        auto stats = SearchStats{};
+        auto const matches = searchAll(grid, query("needle", direction), &stats);
+        REQUIRE(matches.size() == 2);
+        auto const& wrapped = direction == SearchDirection::Forward ? matches[0] : matches[1];
+        auto const& plain = direction == SearchDirection::Forward ? matches[1] : matches[0];
+        CHECK(resolve(grid, wrapped.begin) == std::pair{767, 6});
+        CHECK(resolve(grid, wrapped.end) == std::pair{768, 2});
+        CHECK(resolve(grid, plain.begin) == std::pair{1001, 4});
+        CHECK(stats.skippedBlocks > 0);
+    }
+
+    // Disabling the cold history reads the index back into memory.
+    grid.setColdHistory(std::nullopt);
+    CHECK(grid.historyIndex().diskUsage() == 0);
+    CHECK(searchAll(grid, query("needle")).size() == 2);
+}
+
+TEST_CASE("Searcher.background", "[search]")
+{
+    auto grid = Grid(PageSize{LineCount(2), ColumnCount(20)}, false, std::nullopt);
+    for (int i = 0; i < 1000; ++i)
+        pushLine(grid, fmt::format("{} match", i));
+
+    auto searcher = Searcher{};
+    size_t matchCount = 0;
+    optional<SearchStats> finished;
+
+    searcher.start(makeSearchSnapshot(grid),
+                   query("match", SearchDirection::Backward),
+                   [&](SearchMatch const&) { return ++matchCount < 10; },
+                   [&](SearchStats const& _stats) { finished = _stats; });
+    searcher.wait();
+
+    CHECK(!searcher.running());
+    REQUIRE(finished.has_value());
+    CHECK(matchCount == 10);
+    CHECK(finished->matches == 10);
+
+    // Restarting a search cancels the previous one.
+    searcher.start(makeSearchSnapshot(grid), query("match"), [](SearchMatch const&) { return true; });
+    searcher.cancel();
+    CHECK(!searcher.running());
+}
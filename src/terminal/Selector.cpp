@@ -68,15 +68,17 @@ Selector::Selector(Mode _mode,
                    Coordinate _from) :
     Selector{
         _mode,
-        [screen = std::ref(_screen)](Coordinate _pos) -> Cell const* {
+        [screen = std::ref(_screen), decoded = Cell{}](Coordinate _pos) mutable -> Cell const* {
             assert(_pos.row >= 0 && "must be absolute coordinate");
             auto const& buffer = screen.get();
             // convert line number  from absolute line to relative line number.
             auto const row = _pos.row - unbox<int>(buffer.historyLineCount()) + 1;
-            if (row <= *buffer.size().lines)
-                return &buffer.at({row, _pos.column});
-            else
+            if (row > *buffer.size().lines)
                 return nullptr;
+            // Cells of packed or cold history lines are decoded into a copy, valid until the next call.
+            if (!buffer.grid().cellsReferable(row))
+                return &(decoded = buffer.cellAt({row, _pos.column}));
+            return &buffer.at({row, _pos.column});
         },
         [screen = std::ref(_screen)](int _line) -> bool {
             return screen.get().lineWrapped(_line);
@@ -43,7 +43,7 @@ class Sequence {
   public:
     size_t constexpr static MaxParameters = 16;
     size_t constexpr static MaxSubParameters = 8;
-    size_t constexpr static MaxOscLength = 512;
+    size_t constexpr static DefaultMaxOscLength = 8 * 1024 * 1024;
 
     Sequence()
     {
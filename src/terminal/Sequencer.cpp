@@ -30,9 +30,11 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <array>
 #include <iostream>             // error logging
 #include <cstdlib>
+#include <functional>
 #include <iterator>
 #include <numeric>
 #include <optional>
@@ -92,6 +94,97 @@ namespace // {{{ helpers
         return pair{code, i};
     }
 
+    /// Streams the payload of OSC 52 (`Pc ; Pd`), decoding the base64 encoded
+    /// data Pd while it arrives.
+    class ClipboardWriter : public ParserExtension
+    {
+      public:
+        /// Maximum length of the selection parameter Pc, a handful of selector letters.
+        static constexpr size_t MaxSelectionLength = 16;
+
+        ClipboardWriter(size_t _maxLength, std::function<void(string_view)> _done):
+            maxLength_{ _maxLength },
+            done_{ std::move(_done) }
+        {}
+
+        void start() override
+        {
+            selection_.clear();
+            selectionComplete_ = false;
+            decoder_ = {};
+            data_.clear();
+            tooLong_ = false;
+        }
+
+        void pass(char32_t _char) override
+        {
+            char u8[4];
+            auto const count = distance(u8, unicode::encoder<char>{}(_char, u8));
+            pass(string_view(u8, static_cast<size_t>(count)));
+        }
+
+        void pass(string_view _chars) override
+        {
+            if (tooLong_)
+                return;
+
+            if (!selectionComplete_)
+            {
+                auto const i = _chars.find(';');
+                selection_ += _chars.substr(0, std::min(i, MaxSelectionLength + 1 - selection_.size()));
+                if (selection_.size() > MaxSelectionLength)
+                {
+                    tooLong_ = true;
+                    selection_ = string{};
+                    return;
+                }
+                if (i == _chars.npos)
+                    return;
+                selectionComplete_ = true;
+                _chars.remove_prefix(i + 1);
+            }
+
+            auto const offset = data_.size();
+            data_.resize(offset + (_chars.size() + 3) / 4 * 3);
+            data_.resize(offset + crispy::base64::decode(decoder_, _chars, data_.data() + offset));
+
+            if (data_.size() > maxLength_)
+            {
+                tooLong_ = true;
+                data_ = string{};
+            }
+        }
+
+        void finalize() override
+        {
+            if (tooLong_)
+            {
+                if (VTParserLog)
+                    LOGSTORE(VTParserLog)("Ignoring clipboard data exceeding {} bytes, or a selection exceeding {} bytes.",
+                                          maxLength_, MaxSelectionLength);
+                return;
+            }
+
+            // Only setting clipboard contents is supported, not reading.
+            if (selection_ != "c")
+                return;
+
+            auto const offset = data_.size();
+            data_.resize(offset + 2);
+            data_.resize(offset + crispy::base64::finish(decoder_, data_.data() + offset));
+            done_(data_);
+        }
+
+      private:
+        size_t maxLength_;
+        std::function<void(string_view)> done_;
+        string selection_;
+        bool selectionComplete_ = false;
+        crispy::base64::decoder_state decoder_;
+        string data_;
+        bool tooLong_ = false;
+    };
+
     // optional<CharsetTable> getCharsetTableForCode(std::string const& _intermediate)
     // {
     //     if (_intermediate.size() != 1)
@@ -696,19 +789,6 @@ namespace impl // {{{ some command generator helpers
         return ApplyResult::Ok;
     }
 
-    ApplyResult clipboard(Sequence const& _seq, Screen& _screen)
-    {
-        // Only setting clipboard contents is supported, not reading.
-        auto const& params = _seq.intermediateCharacters();
-        if (auto const splits = crispy::split(params, ';'); splits.size() == 2 && splits[0] == "c")
-        {
-            _screen.eventListener().copyToClipboard(crispy::base64::decode(splits[1]));
-            return ApplyResult::Ok;
-        }
-        else
-            return ApplyResult::Invalid;
-    }
-
     ApplyResult NOTIFY(Sequence const& _seq, Screen& _screen)
     {
         auto const& value = _seq.intermediateCharacters();
@@ -749,6 +829,45 @@ namespace impl // {{{ some command generator helpers
         return ApplyResult::Ok;
     }
 
+    ApplyResult LATENCYSTATS(Sequence const& _seq, Screen& _screen)
+    {
+        // OSC 889 ; Pt ST
+        //
+        // Pt: empty or "json" = report as JSON object: OSC 889 ; <json> ST
+        //     "text"          = report as human readable table: OSC 889 ; <text> ST
+        //     "reset"         = reset statistics, without reply
+
+        auto const& request = _seq.intermediateCharacters();
+        if (request.empty() || request == "json")
+            _screen.eventListener().reportLatencyStats(true);
+        else if (request == "text")
+            _screen.eventListener().reportLatencyStats(false);
+        else if (request == "reset")
+            _screen.eventListener().resetLatencyStats();
+        else
+            return ApplyResult::Invalid;
+
+        return ApplyResult::Ok;
+    }
+
+    ApplyResult MEMORYUSAGE(Sequence const& _seq, Screen& _screen)
+    {
+        // OSC 890 ; Pt ST
+        //
+        // Pt: empty or "json" = report as JSON object of bytes by category: OSC 890 ; <json> ST
+        //     "text"          = report as human readable table: OSC 890 ; <text> ST
+
+        auto const& request = _seq.intermediateCharacters();
+        if (request.empty() || request == "json")
+            _screen.eventListener().reportMemoryUsage(true);
+        else if (request == "text")
+            _screen.eventListener().reportMemoryUsage(false);
+        else
+            return ApplyResult::Invalid;
+
+        return ApplyResult::Ok;
+    }
+
     ApplyResult HYPERLINK(Sequence const& _seq, Screen& _screen)
     {
         auto const& value = _seq.intermediateCharacters();
@@ -916,10 +1035,17 @@ Sequencer::Sequencer(Screen& _screen,
                      RGBAColor _backgroundColor,
                      shared_ptr<SixelColorPalette> _imageColorPalette) :
     screen_{ _screen },
+    kittyGraphics_{
+        0,
+        [this](KittyGraphicsCommand const& _command, Image::Data&& _payload) {
+            handleKittyGraphics(_command, std::move(_payload));
+        }
+    },
     imageColorPalette_{ std::move(_imageColorPalette) },
     maxImageSize_{ _maxImageSize },
     backgroundColor_{ _backgroundColor }
 {
+    kittyGraphics_.setMaxPayloadSize(maxImagePayloadSize());
 }
 
 void Sequencer::error(std::string_view const& _errorString)
@@ -947,54 +1073,21 @@ void Sequencer::print(string_view _chars)
     screen_.writeText(_chars);
 }
 
-void Sequencer::execute(char _controlCode)
-{
-    executeControlFunction(_controlCode);
-}
-
-void Sequencer::clear()
+void Sequencer::print(u32string_view _chars)
 {
-    sequence_.clear();
-}
-
-void Sequencer::collect(char _char)
-{
-    sequence_.intermediateCharacters().push_back(_char);
-}
+    for (char32_t const ch: _chars)
+    {
+        instructionCounter_++;
+        screen_.writeText(ch);
+    }
 
-void Sequencer::collectLeader(char _leader)
-{
-    sequence_.setLeader(_leader);
+    if (!_chars.empty())
+        precedingGraphicCharacter_ = _chars.back();
 }
 
-void Sequencer::param(char _char)
+void Sequencer::execute(char _controlCode)
 {
-    if (sequence_.parameters().empty())
-        sequence_.parameters().push_back({0});
-
-    switch (_char)
-    {
-        case ';':
-            if (sequence_.parameters().size() < Sequence::MaxParameters)
-                sequence_.parameters().push_back({0});
-            break;
-        case ':':
-            if (sequence_.parameters().back().size() < Sequence::MaxParameters)
-                sequence_.parameters().back().push_back({0});
-            break;
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            sequence_.parameters().back().back() = sequence_.parameters().back().back() * 10 + (_char - U'0');
-            break;
-    }
+    executeControlFunction(_controlCode);
 }
 
 void Sequencer::dispatchESC(char _finalChar)
@@ -1014,19 +1107,65 @@ void Sequencer::dispatchCSI(char _finalChar)
 void Sequencer::startOSC()
 {
     sequence_.setCategory(FunctionCategory::OSC);
+    oscHandler_.reset();
+    oscTooLong_ = false;
 }
 
 void Sequencer::putOSC(char32_t _char)
 {
-    uint8_t u8[4];
-    size_t const count = distance(u8, unicode::encoder<char>{}(_char, u8));
-    if (sequence_.intermediateCharacters().size() + count < Sequence::MaxOscLength)
-        for (size_t i = 0; i < count; ++i)
-            sequence_.intermediateCharacters().push_back(u8[i]);
+    char u8[4];
+    auto const count = distance(u8, unicode::encoder<char>{}(_char, u8));
+    putOSC(string_view(u8, static_cast<size_t>(count)));
+}
+
+void Sequencer::putOSC(string_view _chars)
+{
+    if (oscHandler_)
+    {
+        oscHandler_->pass(_chars);
+        return;
+    }
+
+    auto& data = sequence_.intermediateCharacters();
+    if (oscTooLong_ || data.size() + _chars.size() > maxOscLength_)
+    {
+        oscTooLong_ = true;
+        return;
+    }
+
+    data += _chars;
+
+    // Clipboard contents can be huge, so they are decoded while they arrive.
+    if (data.size() >= 3 && string_view(data).substr(0, 3) == "52;"sv)
+    {
+        oscHandler_ = make_unique<ClipboardWriter>(
+            maxOscLength_,
+            [this](string_view _data) { screen_.eventListener().copyToClipboard(_data); }
+        );
+        oscHandler_->start();
+        oscHandler_->pass(string_view(data).substr(3));
+        data.clear();
+    }
 }
 
 void Sequencer::dispatchOSC()
 {
+    if (oscHandler_)
+    {
+        oscHandler_->finalize();
+        oscHandler_.reset();
+        sequence_.clear();
+        return;
+    }
+
+    if (oscTooLong_)
+    {
+        if (VTParserLog)
+            LOGSTORE(VTParserLog)("Ignoring OSC sequence exceeding {} bytes.", maxOscLength_);
+        sequence_.clear();
+        return;
+    }
+
     auto const [code, skipCount] = parseOSC(sequence_.intermediateCharacters());
     sequence_.parameters().push_back({static_cast<Sequence::Parameter>(code)});
     sequence_.intermediateCharacters().erase(0, skipCount);
@@ -1034,6 +1173,141 @@ void Sequencer::dispatchOSC()
     sequence_.clear();
 }
 
+void Sequencer::startAPC()
+{
+    apcHandler_ = nullptr;
+    apcIdentified_ = false;
+}
+
+void Sequencer::putAPC(char32_t _char)
+{
+    char u8[4];
+    auto const count = distance(u8, unicode::encoder<char>{}(_char, u8));
+    putAPC(string_view(u8, static_cast<size_t>(count)));
+}
+
+void Sequencer::putAPC(string_view _chars)
+{
+    if (!apcIdentified_ && !_chars.empty())
+    {
+        apcIdentified_ = true;
+        if (_chars.front() == 'G')
+        {
+            apcHandler_ = &kittyGraphics_;
+            apcHandler_->start();
+        }
+        _chars.remove_prefix(1);
+    }
+
+    if (apcHandler_)
+        apcHandler_->pass(_chars);
+}
+
+void Sequencer::dispatchAPC()
+{
+    if (apcHandler_)
+        apcHandler_->finalize();
+
+    apcHandler_ = nullptr;
+}
+
+size_t Sequencer::maxImagePayloadSize() const noexcept
+{
+    auto const pixelCount = size_t(*maxImageSize_.width) * *maxImageSize_.height;
+    return pixelCount ? pixelCount * 4 : Sequence::DefaultMaxOscLength;
+}
+
+void Sequencer::handleKittyGraphics(KittyGraphicsCommand const& _command, Image::Data&& _payload)
+{
+    using Action = KittyGraphicsCommand::Action;
+
+    auto command = _command;
+    if (!command.imageId && command.imageNumber && command.action != Action::Query)
+        command.imageId = nextKittyImageId_++;
+
+    auto const imageName = fmt::format("kitty:{}", command.imageId);
+
+    auto const respond = [&](optional<KittyGraphicsError> const& _error) {
+        if (!command.imageId && !command.imageNumber)
+            return;
+        if (command.quiet >= (_error ? 2u : 1u))
+            return;
+        auto const keys = command.imageNumber ? fmt::format("i={},I={}", command.imageId, command.imageNumber)
+                                              : fmt::format("i={}", command.imageId);
+        auto const status = _error ? fmt::format("{}:{}", _error->code, _error->message) : string("OK");
+        screen_.reply("\033_G{};{}\033\\", keys, status);
+    };
+
+    auto const cellSpan = GridSize{LineCount::cast_from(command.rows), ColumnCount::cast_from(command.columns)};
+
+    switch (command.action)
+    {
+        case Action::Query:
+        {
+            auto const result = loadKittyGraphicsImage(command, std::move(_payload), maxImageSize_);
+            if (holds_alternative<KittyGraphicsError>(result))
+                respond(get<KittyGraphicsError>(result));
+            else
+                respond(nullopt);
+            break;
+        }
+        case Action::Transmit:
+        case Action::TransmitAndDisplay:
+        {
+            auto result = loadKittyGraphicsImage(command, std::move(_payload), maxImageSize_);
+            if (holds_alternative<KittyGraphicsError>(result))
+            {
+                respond(get<KittyGraphicsError>(result));
+                break;
+            }
+
+            auto& image = get<KittyGraphicsImage>(result);
+            auto const imageRef = screen_.uploadImage(ImageFormat::RGBA, image.size, std::move(image.rgba));
+            if (command.imageId)
+            {
+                screen_.linkImage(imageName, imageRef);
+                if (std::find(kittyImageIds_.begin(), kittyImageIds_.end(), command.imageId) == kittyImageIds_.end())
+                    kittyImageIds_.push_back(command.imageId);
+            }
+            if (command.action == Action::TransmitAndDisplay)
+                screen_.placeImage(imageRef, cellSpan, command.moveCursor);
+            respond(nullopt);
+            break;
+        }
+        case Action::Display:
+            if (auto const imageRef = command.imageId ? screen_.findImageByName(imageName) : nullptr; imageRef)
+            {
+                screen_.placeImage(imageRef, cellSpan, command.moveCursor);
+                respond(nullopt);
+            }
+            else
+                respond(KittyGraphicsError{"ENOENT", "No such image"});
+            break;
+        case Action::Delete:
+            // Only the stored image data is released, placements stay on the screen until overwritten.
+            switch (command.deleteTarget)
+            {
+                case 'a':
+                case 'A':
+                    for (auto const id: kittyImageIds_)
+                        screen_.unlinkImage(fmt::format("kitty:{}", id));
+                    kittyImageIds_.clear();
+                    break;
+                case 'i':
+                case 'I':
+                    screen_.unlinkImage(imageName);
+                    kittyImageIds_.erase(std::remove(kittyImageIds_.begin(), kittyImageIds_.end(), command.imageId),
+                                         kittyImageIds_.end());
+                    break;
+                default:
+                    if (VTParserLog)
+                        LOGSTORE(VTParserLog)("Unsupported graphics delete target: {}", command.deleteTarget);
+                    break;
+            }
+            break;
+    }
+}
+
 void Sequencer::hook(char _finalChar)
 {
     instructionCounter_++;
@@ -1074,6 +1348,12 @@ void Sequencer::put(char32_t _char)
         hookedParser_->pass(_char);
 }
 
+void Sequencer::put(string_view _chars)
+{
+    if (hookedParser_)
+        hookedParser_->pass(_chars);
+}
+
 void Sequencer::unhook()
 {
     if (hookedParser_)
@@ -1526,7 +1806,7 @@ ApplyResult Sequencer::apply(FunctionDefinition const& _function, Sequence const
         case COLORMOUSEBG: return impl::setOrRequestDynamicColor(_seq, screen_, DynamicColorName::MouseBackgroundColor);
         case SETFONT: return impl::setFont(_seq, screen_);
         case SETFONTALL: return impl::setAllFont(_seq, screen_);
-        case CLIPBOARD: return impl::clipboard(_seq, screen_);
+        case CLIPBOARD: return ApplyResult::Invalid; // Payloads are streamed, see putOSC().
         // TODO: case COLORSPECIAL: return impl::setOrRequestDynamicColor(_seq, _output, DynamicColorName::HighlightForegroundColor);
         case RCOLORFG: screen_.resetDynamicColor(DynamicColorName::DefaultForegroundColor); break;
         case RCOLORBG: screen_.resetDynamicColor(DynamicColorName::DefaultBackgroundColor); break;
@@ -1537,6 +1817,8 @@ ApplyResult Sequencer::apply(FunctionDefinition const& _function, Sequence const
         case RCOLORHIGHLIGHTBG: screen_.resetDynamicColor(DynamicColorName::HighlightBackgroundColor); break;
         case NOTIFY: return impl::NOTIFY(_seq, screen_);
         case DUMPSTATE: screen_.dumpState(); break;
+        case LATENCYSTATS: return impl::LATENCYSTATS(_seq, screen_);
+        case MEMORYUSAGE: return impl::MEMORYUSAGE(_seq, screen_);
         default: return ApplyResult::Unsupported;
     }
     return ApplyResult::Ok;
@@ -17,6 +17,7 @@
 #include <terminal/ParserEvents.h>
 #include <terminal/ParserExtension.h>
 #include <terminal/Functions.h>
+#include <terminal/KittyGraphics.h>
 #include <terminal/Sequence.h>
 #include <terminal/SixelParser.h>
 #include <terminal/primitives.h>
@@ -459,7 +460,9 @@ enum class ApplyResult {
 ///
 /// Sequencer implements the translation from VT parser events, forming a higher level Sequence,
 /// that can be matched against actions to perform on the target Screen.
-class Sequencer : public ParserEvents {
+///
+/// The class is final, so that Parser<Sequencer> can dispatch parser events statically.
+class Sequencer final : public ParserEvents {
   public:
     /// Constructs the sequencer stage.
     Sequencer(Screen& _screen,
@@ -467,10 +470,18 @@ class Sequencer : public ParserEvents {
               RGBAColor _backgroundColor,
               std::shared_ptr<SixelColorPalette> _imageColorPalette);
 
-    void setMaxImageSize(ImageSize _value) { maxImageSize_ = _value; }
+    void setMaxImageSize(ImageSize _value)
+    {
+        maxImageSize_ = _value;
+        kittyGraphics_.setMaxPayloadSize(maxImagePayloadSize());
+    }
     void setMaxImageColorRegisters(unsigned _value) { maxImageRegisterCount_ = _value; }
     void setUsePrivateColorRegisters(bool _value) { usePrivateColorRegisters_ = _value; }
 
+    /// Limits the payload of OSC sequences. Longer sequences are ignored.
+    void setMaxOscLength(size_t _value) noexcept { maxOscLength_ = _value; }
+    size_t maxOscLength() const noexcept { return maxOscLength_; }
+
     int64_t instructionCounter() const noexcept { return instructionCounter_; }
     void resetInstructionCounter() noexcept { instructionCounter_ = 0; }
 
@@ -479,6 +490,7 @@ class Sequencer : public ParserEvents {
     void error(std::string_view const& _errorString) override;
     void print(char32_t _text) override;
     void print(std::string_view _chars) override;
+    void print(std::u32string_view _chars) override;
     void execute(char _controlCode) override;
     void clear() override;
     void collect(char _char) override;
@@ -488,13 +500,16 @@ class Sequencer : public ParserEvents {
     void dispatchCSI(char _function) override;
     void startOSC() override;
     void putOSC(char32_t _char) override;
+    void putOSC(std::string_view _chars) override;
     void dispatchOSC() override;
     void hook(char _function) override;
     void put(char32_t _char) override;
+    void put(std::string_view _chars) override;
     void unhook() override;
-    void startAPC() override {}
-    void putAPC(char32_t) override {}
-    void dispatchAPC() override {}
+    void startAPC() override;
+    void putAPC(char32_t _char) override;
+    void putAPC(std::string_view _chars) override;
+    void dispatchAPC() override;
     void startPM() override {}
     void putPM(char32_t) override {}
     void dispatchPM() override {}
@@ -508,6 +523,9 @@ class Sequencer : public ParserEvents {
     [[nodiscard]] std::unique_ptr<ParserExtension> hookDECRQSS(Sequence const& _ctx);
     [[nodiscard]] std::unique_ptr<ParserExtension> hookXTGETTCAP(Sequence const& /*_seq*/);
 
+    void handleKittyGraphics(KittyGraphicsCommand const& _command, Image::Data&& _payload);
+    size_t maxImagePayloadSize() const noexcept;
+
     void applyAndLog(FunctionDefinition const& _function, Sequence const& _context);
     ApplyResult apply(FunctionDefinition const& _function, Sequence const& _context);
 
@@ -519,6 +537,14 @@ class Sequencer : public ParserEvents {
     int64_t instructionCounter_ = 0;
 
     std::unique_ptr<ParserExtension> hookedParser_;
+    std::unique_ptr<ParserExtension> oscHandler_; //!< streaming handler of the current OSC payload
+    size_t maxOscLength_ = Sequence::DefaultMaxOscLength;
+    bool oscTooLong_ = false;
+    ParserExtension* apcHandler_ = nullptr; //!< handler of the current APC string, selected by its first character
+    bool apcIdentified_ = false;
+    KittyGraphicsParser kittyGraphics_;
+    std::vector<unsigned> kittyImageIds_; //!< image IDs linked by kitty graphics transmissions
+    unsigned nextKittyImageId_ = 1u << 31; //!< IDs assigned to transmissions by image number only
     std::unique_ptr<SixelImageBuilder> sixelImageBuilder_;
     std::shared_ptr<SixelColorPalette> imageColorPalette_;
     bool usePrivateColorRegisters_ = false;
@@ -527,6 +553,53 @@ class Sequencer : public ParserEvents {
     RGBAColor backgroundColor_;
 };
 
+// {{{ Sequencer inline implementation
+inline void Sequencer::clear()
+{
+    sequence_.clear();
+}
+
+inline void Sequencer::collect(char _char)
+{
+    sequence_.intermediateCharacters().push_back(_char);
+}
+
+inline void Sequencer::collectLeader(char _leader)
+{
+    sequence_.setLeader(_leader);
+}
+
+inline void Sequencer::param(char _char)
+{
+    if (sequence_.parameters().empty())
+        sequence_.parameters().push_back({0});
+
+    switch (_char)
+    {
+        case ';':
+            if (sequence_.parameters().size() < Sequence::MaxParameters)
+                sequence_.parameters().push_back({0});
+            break;
+        case ':':
+            if (sequence_.parameters().back().size() < Sequence::MaxParameters)
+                sequence_.parameters().back().push_back({0});
+            break;
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            sequence_.parameters().back().back() = sequence_.parameters().back().back() * 10 + (_char - U'0');
+            break;
+    }
+}
+// }}}
+
 }  // namespace terminal
 
 namespace fmt { // {{{
@@ -15,11 +15,13 @@
 #include <terminal/Coordinate.h>
 
 #include <algorithm>
+#include <string_view>
 
 using std::clamp;
 using std::fill;
 using std::max;
 using std::min;
+using std::string_view;
 using std::vector;
 
 namespace terminal {
@@ -302,6 +304,12 @@ void SixelParser::pass(char32_t _char)
     parse(_char);
 }
 
+void SixelParser::pass(string_view _chars)
+{
+    for (char const ch: _chars)
+        parse(static_cast<char32_t>(ch));
+}
+
 void SixelParser::finalize()
 {
     done();
@@ -107,6 +107,7 @@ class SixelParser : public ParserExtension
     // ParserExtension overrides
     void start() override;
     void pass(char32_t _char) override;
+    void pass(std::string_view _chars) override;
     void finalize() override;
 
   private:
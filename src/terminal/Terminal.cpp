@@ -14,6 +14,7 @@
 #include <terminal/Terminal.h>
 
 #include <terminal/ControlCode.h>
+#include <terminal/IOReactor.h>
 #include <terminal/InputGenerator.h>
 #include <terminal/logging.h>
 
@@ -42,6 +43,9 @@ namespace terminal {
 
 namespace // {{{ helpers
 {
+    /// Accounting the memory walks all lines, so the memory budget is not checked on every PTY read.
+    auto constexpr MemoryBudgetCheckInterval = std::chrono::seconds(1);
+
     void trimSpaceRight(string& value)
     {
         while (!value.empty() && value.back() == ' ')
@@ -85,16 +89,13 @@ namespace // {{{ helpers
         return tuple{cursorFg, cursorBg};
     }
 
-    void logRenderBufferSwap(bool _success, uint64_t _frameID)
+#if defined(CONTOUR_PERF_STATS)
+    void logRenderBufferSwap(uint64_t _frameID)
     {
-        if (!RenderBufferLog)
-            return;
-
-        if (_success)
+        if (RenderBufferLog)
             LOGSTORE(RenderBufferLog)("Render buffer {} swapped.", _frameID);
-        else
-            LOGSTORE(RenderBufferLog)("Render buffer {} swapping failed.", _frameID);
     }
+#endif
 }
 // }}}
 
@@ -152,6 +153,11 @@ Terminal::~Terminal()
 
     if (screenUpdateThread_)
         screenUpdateThread_->join();
+
+#if !defined(_WIN32)
+    if (reactor_)
+        reactor_->remove(reactorSourceId_);
+#endif
 }
 
 void Terminal::start()
@@ -159,6 +165,22 @@ void Terminal::start()
     screenUpdateThread_ = make_unique<std::thread>(bind(&Terminal::mainLoop, this));
 }
 
+void Terminal::start(IOReactor& _reactor)
+{
+#if !defined(_WIN32)
+    if (auto fds = pty_.pollDescriptors(); !fds.empty())
+    {
+        LOGSTORE(TerminalLog)("Processing PTY input on shared I/O reactor.");
+        reactor_ = &_reactor;
+        reactorSourceId_ = _reactor.add(move(fds), chrono::milliseconds(0), [this]() { return processReadyInput(); });
+        return;
+    }
+#else
+    (void) _reactor;
+#endif
+    start();
+}
+
 void Terminal::setRefreshRate(double _refreshRate)
 {
     refreshInterval_ = std::chrono::milliseconds(static_cast<long long>(1000.0 / _refreshRate));
@@ -172,7 +194,7 @@ void Terminal::mainLoop()
         "Starting main loop with thread id {}",
         [&]() {
             stringstream sstr;
-            sstr << mainLoopThreadID_;
+            sstr << mainLoopThreadID_.load();
             return sstr.str();
         }()
     );
@@ -187,13 +209,40 @@ void Terminal::mainLoop()
     eventListener_.onClosed();
 }
 
+optional<chrono::milliseconds> Terminal::processReadyInput()
+{
+    // Invoked by the I/O reactor when the PTY is readable (or woken up), or the timeout expired,
+    // so reading does not block.
+    mainLoopThreadID_ = this_thread::get_id();
+    auto const keepGoing = processInput(chrono::milliseconds(0));
+    mainLoopThreadID_ = thread::id{};
+
+    if (!keepGoing)
+    {
+        LOGSTORE(TerminalLog)("Event loop terminating (PTY {}).", pty_.isClosed() ? "closed" : "open");
+        eventListener_.onClosed();
+        return nullopt;
+    }
+
+    return inputTimeout();
+}
+
+chrono::milliseconds Terminal::inputTimeout() const noexcept
+{
+    return renderBuffer_.state == RenderBufferState::WaitingForRefresh && !screenDirty_ && !historyIndexPending_
+        ? std::chrono::seconds(4)
+        : refreshInterval_ // std::chrono::seconds(0)
+        ;
+}
+
 bool Terminal::processInputOnce()
 {
-    auto const timeout =
-        renderBuffer_.state == RenderBufferState::WaitingForRefresh && !screenDirty_
-            ? std::chrono::seconds(4)
-            : refreshInterval_ // std::chrono::seconds(0)
-            ;
+    return processInput(inputTimeout());
+}
+
+bool Terminal::processInput(chrono::milliseconds _timeout)
+{
+    auto const timeout = _timeout;
 
     auto const bufOpt = pty_.read(ptyReadBufferSize_, timeout);
     if (!bufOpt)
@@ -205,6 +254,8 @@ bool Terminal::processInputOnce()
                                   strerror(errno));
             pty_.close();
         }
+        else if (errno == EAGAIN)
+            updateHistoryIndex();
         return errno == EINTR || errno == EAGAIN;
     }
     auto const buf = *bufOpt;
@@ -216,7 +267,19 @@ bool Terminal::processInputOnce()
         return true;
     }
 
-    writeToScreen(buf);
+    {
+        auto const readTime = chrono::steady_clock::now();
+        if (capture_)
+            capture_->output(buf, readTime);
+        auto const _l = lock_guard{*this};
+        if (!pendingFrame_.valid())
+            pendingFrame_.ptyRead = readTime;
+        screen_.write(buf);
+        pendingFrame_.parsed = chrono::steady_clock::now();
+        if (memoryBudget_ && pendingFrame_.parsed - lastMemoryBudgetCheck_ >= MemoryBudgetCheckInterval)
+            enforceMemoryBudget();
+    }
+    historyIndexPending_ = true;
 
     #if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
     ensureFreshRenderBuffer();
@@ -229,7 +292,7 @@ bool Terminal::processInputOnce()
 void Terminal::breakLoopAndRefreshRenderBuffer()
 {
     changes_++;
-    renderBuffer_.state = RenderBufferState::RefreshBuffersAndTrySwap;
+    renderBuffer_.state = RenderBufferState::RefreshBuffers;
 
     if (this_thread::get_id() == mainLoopThreadID_)
         return;
@@ -239,9 +302,8 @@ void Terminal::breakLoopAndRefreshRenderBuffer()
 
 bool Terminal::refreshRenderBuffer(bool _locked)
 {
-    renderBuffer_.state = RenderBufferState::RefreshBuffersAndTrySwap;
-    ensureFreshRenderBuffer(_locked);
-    return renderBuffer_.state == RenderBufferState::WaitingForRefresh;
+    renderBuffer_.state = RenderBufferState::RefreshBuffers;
+    return ensureFreshRenderBuffer(_locked);
 }
 
 bool Terminal::ensureFreshRenderBuffer(bool _locked)
@@ -260,40 +322,33 @@ bool Terminal::ensureFreshRenderBuffer(bool _locked)
         case RenderBufferState::WaitingForRefresh:
             if (avoidRefresh)
                 break;
-            renderBuffer_.state = RenderBufferState::RefreshBuffersAndTrySwap;
-            [[fallthrough]];
-        case RenderBufferState::RefreshBuffersAndTrySwap:
-            if (!_locked)
-                refreshRenderBuffer(renderBuffer_.backBuffer());
-            else
-                refreshRenderBufferInternal(renderBuffer_.backBuffer());
-            renderBuffer_.state = RenderBufferState::TrySwapBuffers;
             [[fallthrough]];
-        case RenderBufferState::TrySwapBuffers:
+        case RenderBufferState::RefreshBuffers:
             {
-                [[maybe_unused]] auto const success = renderBuffer_.swapBuffers(currentTime_);
+                // Reset first, so that refresh requests arriving meanwhile do not get lost.
+                renderBuffer_.state = RenderBufferState::WaitingForRefresh;
 
-                #if defined(CONTOUR_PERF_STATS)
-                logRenderBufferSwap(success, lastFrameID_);
-                #endif
-
-                #if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
-                // Passively invoked by the terminal thread -> do inform render thread about updates.
-                if (success)
-                    eventListener_.renderBufferUpdated();
-                #endif
+                // Whoever holds the terminal lock acts as the render buffer's writer.
+                auto lock = unique_lock{*this, defer_lock};
+                if (!_locked)
+                    lock.lock();
+                refreshRenderBufferInternal(renderBuffer_.backBuffer());
+                renderBuffer_.swapBuffers(currentTime_);
             }
+
+            #if defined(CONTOUR_PERF_STATS)
+            logRenderBufferSwap(lastFrameID_);
+            #endif
+
+            #if defined(LIBTERMINAL_PASSIVE_RENDER_BUFFER_UPDATE)
+            // Passively invoked by the terminal thread -> do inform render thread about updates.
+            eventListener_.renderBufferUpdated();
+            #endif
             break;
     }
     return true;
 }
 
-void Terminal::refreshRenderBuffer(RenderBuffer& _output)
-{
-    auto const _l = lock_guard{*this};
-    refreshRenderBufferInternal(_output);
-}
-
 void Terminal::refreshRenderBufferInternal(RenderBuffer& _output)
 {
     auto const reverseVideo = screen_.isModeEnabled(terminal::DECMode::ReverseVideo);
@@ -329,7 +384,7 @@ void Terminal::refreshRenderBufferInternal(RenderBuffer& _output)
     #if defined(LIBTERMINAL_HYPERLINKS)
     if (renderHyperlinks)
     {
-        auto& cellAtMouse = screen_.at(currentMousePositionRel);
+        auto const cellAtMouse = screen_.cellAt(currentMousePositionRel);
         if (cellAtMouse.hyperlink())
             cellAtMouse.hyperlink()->state = HyperlinkState::Hover; // TODO: Left-Ctrl pressed?
     }
@@ -435,11 +490,19 @@ void Terminal::refreshRenderBufferInternal(RenderBuffer& _output)
     #if defined(LIBTERMINAL_HYPERLINKS)
     if (renderHyperlinks)
     {
-        auto& cellAtMouse = screen_.at(currentMousePositionRel);
+        auto const cellAtMouse = screen_.cellAt(currentMousePositionRel);
         if (cellAtMouse.hyperlink())
             cellAtMouse.hyperlink()->state = HyperlinkState::Inactive;
     }
     #endif
+
+    _output.timestamps = pendingFrame_;
+    if (pendingFrame_.valid())
+    {
+        _output.timestamps.refreshed = chrono::steady_clock::now();
+        latencyStats_.recordRefreshed(_output.timestamps);
+        pendingFrame_ = {};
+    }
 }
 
 optional<RenderCursor> Terminal::renderCursor()
@@ -679,6 +742,8 @@ void Terminal::flushInput()
         return;
 
     // XXX Should be the only location that does write to the PTY's stdin to avoid race conditions.
+    if (capture_)
+        capture_->input(string_view(pendingInput_.data(), pendingInput_.size()));
     pty_.write(pendingInput_.data(), pendingInput_.size());
     pendingInput_.clear();
 }
@@ -714,7 +779,7 @@ bool Terminal::updateCursorHoveringState()
 
     auto const newState = screen_.contains(currentMousePosition_)
 #if defined(LIBTERMINAL_HYPERLINKS)
-                        && screen_.at(relCursorPos).hyperlink()
+                        && screen_.cellAt(relCursorPos).hyperlink()
 #endif
         ;
     auto const oldState = hoveringHyperlink_.exchange(newState);
@@ -748,9 +813,26 @@ void Terminal::resizeScreen(PageSize _cells, optional<ImageSize> _pixels)
         screen_.setCellPixelSize(ImageSize{width, height});
     }
 
+    if (capture_)
+        capture_->resize(_cells, _pixels);
+
     pty_.resizeScreen(_cells, _pixels);
 }
 
+void Terminal::setCapture(unique_ptr<CaptureWriter> _capture)
+{
+    capture_ = move(_capture);
+    if (!capture_)
+        return;
+
+    auto const cellPixelSize = screen_.cellPixelSize();
+    auto pixels = optional<ImageSize>{};
+    if (*cellPixelSize.width && *cellPixelSize.height)
+        pixels = ImageSize{Width(*cellPixelSize.width * screenSize().columns.as<unsigned>()),
+                           Height(*cellPixelSize.height * screenSize().lines.as<unsigned>())};
+    capture_->resize(screenSize(), pixels);
+}
+
 void Terminal::setCursorDisplay(CursorDisplay _display)
 {
     cursorDisplay_ = _display;
@@ -769,27 +851,50 @@ void Terminal::setWordDelimiters(string const& _wordDelimiters)
 string Terminal::extractSelectionText() const
 {
     using namespace terminal;
+
+    // Only the selection ranges and a snapshot of the grid are taken while locked,
+    // so that copying a large selection does not stall the terminal.
+    auto const [ranges, snapshot] = [this]() {
+        auto const _lock = scoped_lock{ *this };
+        auto ranges = selector_ ? selector_->selection() : vector<Selector::Range>{};
+        auto const firstLine = ranges.empty() ? 0 : ranges.front().line;
+        return pair{move(ranges), screen_.grid().snapshot(firstLine)};
+    }();
+
+    auto const columnCount = snapshot.pageSize().columns.as<int>();
     int lastColumn = 0;
     string text;
     string currentLine;
 
-    renderSelection([&](Coordinate const& _pos, Cell const& _cell) {
-        auto const _lock = scoped_lock{ *this };
-        auto const isNewLine = _pos.column <= lastColumn;
-        auto const isLineWrapped = lineWrapped(_pos.row);
-        bool const touchesRightPage = _pos.row > 0
-            && isSelectedAbsolute({_pos.row - 1, screen_.size().columns.as<int>()});
-        if (isNewLine && (!isLineWrapped || !touchesRightPage))
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        auto const& range = ranges[i];
+        if (!snapshot.contains(range.line))
+            continue;
+
+        auto line = snapshot.absoluteLineAt(range.line); // a copy, unpacked by reading it as non-const
+        auto const isLineWrapped = line.wrapped();
+        // whether the selection touches the right page border of the line above
+        auto const continuesAbove = i > 0
+                                 && ranges[i - 1].line == range.line - 1
+                                 && ranges[i - 1].toColumn >= columnCount;
+        for (auto const col: crispy::times(range.fromColumn, range.length()))
         {
-            // TODO: handle logical line in word-selection (don't include LF in wrapped lines)
-            trimSpaceRight(currentLine);
-            text += currentLine;
-            text += '\n';
-            currentLine.clear();
+            if (col < 1 || col > line.size().as<int>())
+                continue;
+            auto const isNewLine = col <= lastColumn;
+            if (isNewLine && (!isLineWrapped || !continuesAbove))
+            {
+                // TODO: handle logical line in word-selection (don't include LF in wrapped lines)
+                trimSpaceRight(currentLine);
+                text += currentLine;
+                text += '\n';
+                currentLine.clear();
+            }
+            currentLine += line[static_cast<size_t>(col - 1)].toUtf8();
+            lastColumn = col;
         }
-        currentLine += _cell.toUtf8();
-        lastColumn = _pos.column;
-    });
+    }
 
     trimSpaceRight(currentLine);
     text += currentLine;
@@ -822,7 +927,7 @@ string Terminal::extractLastMarkRange() const
     for (auto lineNum = firstLine; lineNum <= lastLine; ++lineNum)
     {
         for (auto colNum = 1; colNum < colCount; ++colNum)
-            text += screen_.at({lineNum, colNum}).toUtf8();
+            text += screen_.cellAt({lineNum, colNum}).toUtf8();
         trimSpaceRight(text);
         text += '\n';
     }
@@ -830,6 +935,57 @@ string Terminal::extractLastMarkRange() const
     return text;
 }
 
+// {{{ scrollback search
+void Terminal::updateHistoryIndex()
+{
+    // Bounds the time the terminal is kept locked while catching up with a large backlog.
+    auto constexpr IdleIndexLineCount = LineCount(8192);
+
+    auto const _l = std::lock_guard{*this};
+    historyIndexPending_ = *screen_.primaryGrid().updateHistoryIndex(IdleIndexLineCount) != 0;
+}
+
+void Terminal::startSearch(SearchQuery _query, SearchMatchHandler _onMatch, Searcher::FinishHandler _onFinish)
+{
+    auto snapshot = [this]() {
+        auto const _l = std::lock_guard{*this};
+        return makeSearchSnapshot(screen_.grid());
+    }();
+
+    searcher_.start(move(snapshot), move(_query), move(_onMatch), move(_onFinish));
+}
+
+bool Terminal::revealSearchMatch(SearchMatch const& _match)
+{
+    {
+        auto const _l = std::lock_guard{*this};
+
+        auto const& grid = screen_.grid();
+        auto const top = grid.absoluteLineOfSerial(_match.begin.line);
+        auto const bottom = grid.absoluteLineOfSerial(_match.end.line);
+        if (!top || !bottom)
+            return false;
+
+        // Center the match vertically, unless it is on the main page already.
+        auto const pageTop = *top - unbox<int>(screen_.size().lines) / 2;
+        if (*top < unbox<int>(screen_.historyLineCount()))
+            viewport_.scrollToAbsolute(StaticScrollbackPosition::cast_from(std::max(pageTop, 0)));
+        else
+            viewport_.scrollToBottom();
+
+        selector_ = make_unique<Selector>(Selector::Mode::Linear,
+                                          wordDelimiters_,
+                                          screen_,
+                                          Coordinate{*top, _match.begin.column + 1});
+        selector_->extend(Coordinate{*bottom, _match.end.column + 1});
+        selector_->stop();
+    }
+
+    breakLoopAndRefreshRenderBuffer();
+    return true;
+}
+// }}}
+
 // {{{ ScreenEvents overrides
 void Terminal::requestCaptureBuffer(int _absoluteStartLine, int _lineCount)
 {
@@ -860,12 +1016,6 @@ void Terminal::screenUpdated()
     if (!renderBufferUpdateEnabled_)
         return;
 
-    if (renderBuffer_.state == RenderBufferState::TrySwapBuffers)
-    {
-        renderBuffer_.swapBuffers(renderBuffer_.lastUpdate);
-        return;
-    }
-
     screenDirty_ = true;
     eventListener_.screenUpdated();
 }
@@ -890,6 +1040,99 @@ void Terminal::dumpState()
     eventListener_.dumpState();
 }
 
+void Terminal::reportLatencyStats(bool _json)
+{
+    screen_.reply("\033]889;{}\033\\", _json ? latencyStats_.json() : latencyStats_.summary());
+}
+
+void Terminal::resetLatencyStats()
+{
+    latencyStats_.reset();
+}
+
+void Terminal::reportMemoryUsage(bool _json)
+{
+    auto const usage = memoryUsageLocked();
+    screen_.reply("\033]890;{}\033\\", _json ? usage.json() : usage.summary());
+}
+
+// {{{ memory accounting
+MemoryUsage Terminal::memoryUsage() const
+{
+    auto const _l = std::lock_guard{*this};
+    return memoryUsageLocked();
+}
+
+MemoryUsage Terminal::memoryUsageLocked() const
+{
+    auto usage = screen_.memoryUsage();
+    for (size_t i = 0; i < MemoryCategoryCount; ++i)
+        usage.bytes[i] += frontendMemoryUsage_[i].load(std::memory_order_relaxed);
+    return usage;
+}
+
+void Terminal::setFrontendMemoryUsage(MemoryUsage const& _usage) noexcept
+{
+    for (size_t i = 0; i < MemoryCategoryCount; ++i)
+        frontendMemoryUsage_[i].store(_usage.bytes[i], std::memory_order_relaxed);
+}
+
+void Terminal::enforceMemoryBudget()
+{
+    lastMemoryBudgetCheck_ = chrono::steady_clock::now();
+    if (!memoryBudget_)
+        return;
+
+    auto const budget = *memoryBudget_;
+    auto usage = memoryUsageLocked();
+    if (usage.mainMemory() <= budget)
+        return;
+
+    auto const excess = [&]() {
+        auto const used = usage.mainMemory();
+        return used > budget ? used - budget : 0;
+    };
+
+    // The size of history lines varies a lot (e.g. packed or cold lines), so lines are deleted
+    // in a few rounds, each estimating the lines to delete from the average line size.
+    auto constexpr MaxTrimRounds = 8;
+    auto& grid = screen_.primaryGrid();
+    auto trimmed = LineCount(0);
+    for (int round = 0; round < MaxTrimRounds && excess() && *grid.historyLineCount(); ++round)
+    {
+        auto const historyLines = unbox<size_t>(grid.historyLineCount());
+        auto const historyBytes = usage[MemoryCategory::History]
+                                + usage[MemoryCategory::ColdHistory]
+                                + usage[MemoryCategory::SearchIndex];
+        auto const bytesPerLine = std::max(historyBytes / historyLines, size_t{1});
+        auto const count = std::min((excess() + bytesPerLine - 1) / bytesPerLine, historyLines);
+        trimmed += grid.trimHistory(LineCount::cast_from(count));
+        usage = memoryUsageLocked();
+    }
+
+    // The frontend's text shaping cache refills on the very next frame, so evicting it
+    // is only a last resort, for when there is no history left to trim.
+    if (excess() && usage[MemoryCategory::TextShaping])
+        eventListener_.evictCaches();
+
+    if (!*trimmed)
+        return;
+
+    LOGSTORE(TerminalLog)("Memory budget of {} KB exceeded. Deleted the {} oldest history lines.",
+                          budget / 1024,
+                          trimmed);
+
+    if (screen_.isPrimaryScreen())
+    {
+        selector_.reset();
+        if (auto const offset = viewport_.absoluteScrollOffset(); offset.has_value())
+            viewport_.scrollToAbsolute(StaticScrollbackPosition::cast_from(
+                std::max(unbox<int>(*offset) - unbox<int>(trimmed), 0)));
+    }
+    breakLoopAndRefreshRenderBuffer();
+}
+// }}}
+
 void Terminal::notify(string_view _title, string_view _body)
 {
     eventListener_.notify(_title, _body);
@@ -1003,9 +1246,6 @@ void Terminal::synchronizedOutput(bool _enabled)
     if (diff < refreshInterval_)
         return;
 
-    if (renderBuffer_.state == RenderBufferState::TrySwapBuffers)
-        return;
-
     refreshRenderBuffer(true);
     eventListener_.screenUpdated();
 }
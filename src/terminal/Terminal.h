@@ -17,23 +17,29 @@
 #include <terminal/pty/Pty.h>
 #include <terminal/ScreenEvents.h>
 #include <terminal/Screen.h>
+#include <terminal/Search.h>
 #include <terminal/Selector.h>
 #include <terminal/Viewport.h>
+#include <terminal/VTCapture.h>
 #include <terminal/RenderBuffer.h>
 
 #include <fmt/format.h>
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string_view>
 #include <thread>
 #include <vector>
 
 namespace terminal {
 
+class IOReactor;
+
 /// Terminal API to manage input and output devices of a pseudo terminal, such as keyboard, mouse, and screen.
 ///
 /// With a terminal being attached to a Process, the terminal's screen
@@ -63,6 +69,7 @@ class Terminal : public ScreenEvents {
         virtual void setWindowTitle(std::string_view /*_title*/) {}
         virtual void setTerminalProfile(std::string const& /*_configProfileName*/) {}
         virtual void discardImage(Image const&) {}
+        virtual void evictCaches() {}
     };
 
     Terminal(Pty& _pty,
@@ -81,8 +88,13 @@ class Terminal : public ScreenEvents {
              bool _allowReflowOnResize = true);
     ~Terminal();
 
+    /// Starts processing PTY input on a dedicated thread.
     void start();
 
+    /// Starts processing PTY input on the given shared I/O reactor instead of a dedicated thread,
+    /// falling back to start() if the PTY cannot be polled.
+    void start(IOReactor& _reactor);
+
     void setRefreshRate(double _refreshRate);
 
     /// Retrieves the time point this terminal instance has been spawned.
@@ -154,22 +166,18 @@ class Terminal : public ScreenEvents {
     void breakLoopAndRefreshRenderBuffer();
 
     /// Refreshes the render buffer.
-    /// When this function returns, the back buffer is updated
-    /// and it is attempted to swap the back/front buffers.
-    /// but the swap has NOT been invoked yet.
+    /// When this function returns, the refreshed render buffer has been published,
+    /// i.e. the next call to renderBuffer() will acquire it.
     ///
     /// @param _locked whether or not the Terminal object's lock is already held by the caller.
     ///
-    /// @retval true   front buffer now contains the refreshed render buffer.
-    /// @retval false  back buffer contains the refreshed render buffer,
-    ///                and RenderDoubleBuffer::swapBuffers() must again
-    ///                be successfully invoked to swap back/front buffers
-    ///                in order to access the refreshed render buffer.
+    /// @retval true   the render buffer has been refreshed.
+    /// @retval false  render buffer updates are currently disabled (synchronized output).
     ///
     /// @note The current time must have been updated in order to get the
     ///       correct cursor blinking state drawn.
     ///
-    /// @see RenderDoubleBuffer::swapBuffers()
+    /// @see RenderTripleBuffer::swapBuffers()
     /// @see renderBuffer()
     ///
     bool refreshRenderBuffer(bool _locked = false);
@@ -182,14 +190,15 @@ class Terminal : public ScreenEvents {
     /// @param _now    the current time
     /// @param _locked whether or not the Terminal object's lock is already held by the caller.
     ///
-    /// @see RenderDoubleBuffer::swapBuffers()
+    /// @see RenderTripleBuffer::swapBuffers()
     /// @see renderBuffer()
     bool ensureFreshRenderBuffer(bool _locked = false);
 
-    /// Aquuires read-access handle to front render buffer.
+    /// Aquuires read-access handle to the latest published render buffer.
     ///
-    /// This also acquires the reader lock and releases it automatically
-    /// upon RenderBufferRef destruction.
+    /// This never waits for the terminal thread. The buffer stays valid
+    /// (and unchanged) until the RenderBufferRef is destroyed.
+    /// May only be invoked by the render thread.
     ///
     /// @see ensureFreshRenderBuffer()
     /// @see refreshRenderBuffer()
@@ -281,6 +290,24 @@ class Terminal : public ScreenEvents {
     std::string extractSelectionText() const;
     std::string extractLastMarkRange() const;
 
+    // {{{ scrollback search
+    /// Starts searching the active screen's history and main page on a background thread.
+    ///
+    /// Any search still in progress is cancelled first. Matches are streamed to @p _onMatch
+    /// from the search thread, in the query's direction.
+    ///
+    /// @throws std::regex_error if the query is an invalid regular expression.
+    void startSearch(SearchQuery _query, SearchMatchHandler _onMatch, Searcher::FinishHandler _onFinish = {});
+
+    /// Cancels the current search, if any.
+    void cancelSearch() { searcher_.cancel(); }
+
+    /// Scrolls the viewport to the given search match and selects it.
+    ///
+    /// @retval false the match is not available anymore, e.g. because it fell off the history.
+    bool revealSearchMatch(SearchMatch const& _match);
+    // }}}
+
     /// Tests whether or not the mouse is currently hovering a hyperlink.
     bool isMouseHoveringHyperlink() const noexcept { return hoveringHyperlink_.load(); }
 
@@ -291,14 +318,52 @@ class Terminal : public ScreenEvents {
 
     uint64_t lastFrameID() const noexcept { return lastFrameID_.load(); }
 
+    /// Latency histograms of getting PTY output onto the screen.
+    ///
+    /// The frontend is expected to record the stages after the render buffer.
+    LatencyStats& latencyStats() noexcept { return latencyStats_; }
+    LatencyStats const& latencyStats() const noexcept { return latencyStats_; }
+
+    /// @returns the memory held by this terminal session, including what the frontend last published.
+    MemoryUsage memoryUsage() const;
+
+    /// Publishes the memory held by the frontend on behalf of this terminal, such as its caches.
+    ///
+    /// May be invoked by the render thread without locking the terminal.
+    void setFrontendMemoryUsage(MemoryUsage const& _usage) noexcept;
+
+    /// Limits the main memory held by this terminal session to about @p _bytes, if set.
+    ///
+    /// When exceeded, the frontend is asked to evict its caches, and the oldest scrollback
+    /// history lines are deleted until the session is back within its budget.
+    void setMemoryBudget(std::optional<size_t> _bytes) noexcept { memoryBudget_ = _bytes; }
+    std::optional<size_t> memoryBudget() const noexcept { return memoryBudget_; }
+
+    /// Checks the memory budget right away, which is otherwise done at most once a second
+    /// while processing PTY output.
+    ///
+    /// Only invoke this when having the terminal object locked.
+    void enforceMemoryBudget();
+
+    /// Records all PTY output, input and resizes of this terminal into @p _capture,
+    /// starting with the current page size.
+    ///
+    /// Must be invoked before the terminal has been started.
+    void setCapture(std::unique_ptr<CaptureWriter> _capture);
+    CaptureWriter* capture() noexcept { return capture_.get(); }
+
   private:
+    MemoryUsage memoryUsageLocked() const;
     void flushInput();
     void mainLoop();
-    void refreshRenderBuffer(RenderBuffer& _output); // <- acquires the lock
+    std::chrono::milliseconds inputTimeout() const noexcept;
+    bool processInput(std::chrono::milliseconds _timeout);
+    std::optional<std::chrono::milliseconds> processReadyInput();
     void refreshRenderBufferInternal(RenderBuffer& _output);
     std::optional<RenderCursor> renderCursor();
     void updateCursorVisibilityState() const;
     bool updateCursorHoveringState();
+    void updateHistoryIndex(); // <- acquires the lock
 
     template <typename Renderer, typename... RemainingPasses>
     void renderPass(Renderer const& pass, RemainingPasses... remainingPasses) const
@@ -320,6 +385,9 @@ class Terminal : public ScreenEvents {
     void setFontDef(FontDef const& _fontDef) override;
     void copyToClipboard(std::string_view _data) override;
     void dumpState() override;
+    void reportLatencyStats(bool _json) override;
+    void resetLatencyStats() override;
+    void reportMemoryUsage(bool _json) override;
     void notify(std::string_view _title, std::string_view _body) override;
     void reply(std::string_view _response) override;
     void resizeWindow(PageSize) override;
@@ -346,13 +414,14 @@ class Terminal : public ScreenEvents {
     /// Boolean, indicating whether the terminal's screen buffer contains updates to be rendered.
     mutable std::atomic<uint64_t> changes_;
 
-    std::thread::id mainLoopThreadID_{};
+    std::atomic<std::thread::id> mainLoopThreadID_{}; //!< thread currently processing PTY input
     int ptyReadBufferSize_;
     Events& eventListener_;
 
     std::chrono::milliseconds refreshInterval_;
     bool screenDirty_ = false;
-    RenderDoubleBuffer renderBuffer_{};
+    bool historyIndexPending_ = false; // history lines may await indexing while idle
+    RenderTripleBuffer renderBuffer_{};
 
     Pty& pty_;
 
@@ -382,12 +451,24 @@ class Terminal : public ScreenEvents {
     std::mutex mutable outerLock_;
     std::mutex mutable innerLock_;
     std::unique_ptr<std::thread> screenUpdateThread_;
+    IOReactor* reactor_ = nullptr;   //!< shared I/O reactor processing PTY input instead of screenUpdateThread_
+    uint64_t reactorSourceId_ = 0;
     Viewport viewport_;
     std::unique_ptr<Selector> selector_;
     std::atomic<bool> hoveringHyperlink_ = false;
     std::atomic<bool> renderBufferUpdateEnabled_ = true;
 
     std::atomic<uint64_t> lastFrameID_ = 0;
+    FrameTimestamps pendingFrame_{}; //!< PTY output not yet in the render buffer
+    LatencyStats latencyStats_;
+    std::unique_ptr<CaptureWriter> capture_;
+
+    std::array<std::atomic<size_t>, MemoryCategoryCount> frontendMemoryUsage_{};
+    std::optional<size_t> memoryBudget_;
+    std::chrono::steady_clock::time_point lastMemoryBudgetCheck_{};
+
+    // Declared last so that a running search is cancelled before anything it may refer to is destroyed.
+    Searcher searcher_;
 };
 
 }  // namespace terminal
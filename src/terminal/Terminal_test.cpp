@@ -97,6 +97,10 @@ namespace // {{{ helpers
         {
         }
 
+        int evictCachesCount = 0;
+
+        void evictCaches() override { ++evictCachesCount; }
+
         terminal::MockPty& pty() noexcept { return pty_; }
         terminal::Terminal& terminal() noexcept { return terminal_; }
         terminal::Terminal const& terminal() const noexcept { return terminal_; }
@@ -212,3 +216,84 @@ TEST_CASE("Terminal.SynchronizedOutput", "[terminal]")
     mc.terminal().ensureFreshRenderBuffer();
     CHECK("Hello  World" == trimmedTextScreenshot(mc));
 }
+
+TEST_CASE("Terminal.LatencyStats", "[terminal]")
+{
+    auto mc = MockTerm{ColumnCount(20), LineCount(2)};
+    mc.writeToStdout("Hello");
+    mc.terminal().refreshRenderBuffer();
+
+    auto const& stats = mc.terminal().latencyStats();
+    CHECK(stats.histogram(terminal::LatencyStage::Parse).count() == 1);
+    CHECK(stats.histogram(terminal::LatencyStage::RenderBuffer).count() == 1);
+    CHECK(mc.terminal().renderBuffer().get().timestamps.valid());
+
+    // Refreshing without new output does not account for another frame.
+    mc.terminal().refreshRenderBuffer();
+    CHECK(stats.histogram(terminal::LatencyStage::Parse).count() == 1);
+
+    mc.writeToStdout("\033]889;json\033\\");
+    CHECK(mc.pty().stdinBuffer().rfind("\033]889;{\"parse\":{\"count\":1,", 0) == 0);
+
+    mc.pty().stdinBuffer().clear();
+    mc.writeToStdout("\033]889;reset\033\\");
+    CHECK(mc.pty().stdinBuffer().empty());
+    CHECK(stats.histogram(terminal::LatencyStage::Parse).count() == 0);
+}
+
+TEST_CASE("Terminal.MemoryBudget", "[terminal]")
+{
+    using terminal::MemoryCategory;
+
+    auto mc = MockTerm{ColumnCount(20), LineCount(4)};
+    for (int i = 1; i <= 200; ++i)
+        mc.writeToStdout(fmt::format("line {}\r\n", i));
+
+    auto frontendUsage = terminal::MemoryUsage{};
+    frontendUsage[MemoryCategory::TextShaping] = 1000;
+    frontendUsage[MemoryCategory::Textures] = 1'000'000;
+    mc.terminal().setFrontendMemoryUsage(frontendUsage);
+
+    auto const before = mc.terminal().memoryUsage();
+    auto const historyBefore = mc.terminal().screen().historyLineCount();
+    REQUIRE(historyBefore == LineCount(197));
+    CHECK(before[MemoryCategory::Screen] > 0);
+    CHECK(before[MemoryCategory::History] > 0);
+    CHECK(before[MemoryCategory::TextShaping] == 1000);
+    CHECK(before.mainMemory() == before.total() - 1'000'000);
+
+    // Within budget, nothing happens.
+    mc.terminal().setMemoryBudget(before.mainMemory());
+    {
+        auto const _l = lock_guard{mc.terminal()};
+        mc.terminal().enforceMemoryBudget();
+    }
+    CHECK(mc.evictCachesCount == 0);
+    CHECK(mc.terminal().screen().historyLineCount() == historyBefore);
+
+    // Over budget, the oldest history lines are deleted, keeping the caches.
+    auto const budget = before.mainMemory() - before[MemoryCategory::History] / 2;
+    mc.terminal().setMemoryBudget(budget);
+    {
+        auto const _l = lock_guard{mc.terminal()};
+        mc.terminal().enforceMemoryBudget();
+    }
+    CHECK(mc.evictCachesCount == 0);
+    auto const after = mc.terminal().memoryUsage();
+    CHECK(after.mainMemory() <= budget);
+    CHECK(mc.terminal().screen().historyLineCount() < historyBefore);
+    CHECK(mc.terminal().screen().historyLineCount() > LineCount(0));
+    CHECK(mc.terminal().screen().renderTextLine(1) == "line 198            ");
+
+    // Caches are only evicted when deleting all of the history does not suffice.
+    mc.terminal().setMemoryBudget(1);
+    {
+        auto const _l = lock_guard{mc.terminal()};
+        mc.terminal().enforceMemoryBudget();
+    }
+    CHECK(mc.evictCachesCount == 1);
+    CHECK(mc.terminal().screen().historyLineCount() == LineCount(0));
+
+    mc.writeToStdout("\033]890;json\033\\");
+    CHECK(mc.pty().stdinBuffer().rfind("\033]890;{\"screen\":", 0) == 0);
+}
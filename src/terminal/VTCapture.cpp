@@ -0,0 +1,289 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/VTCapture.h>
+#include <terminal/Terminal.h>
+#include <terminal/pty/MockViewPty.h>
+
+#include <cerrno>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <system_error>
+#include <thread>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::istream;
+using std::lock_guard;
+using std::make_unique;
+using std::move;
+using std::nullopt;
+using std::optional;
+using std::ostream;
+using std::string;
+using std::string_view;
+using std::unique_ptr;
+
+namespace terminal {
+
+namespace // {{{ helper
+{
+    constexpr auto Magic = string_view("VTCAP\0\0\1", 8);
+
+    void appendVarUInt(string& _output, uint64_t _value)
+    {
+        while (_value >= 0x80)
+        {
+            _output.push_back(static_cast<char>((_value & 0x7F) | 0x80));
+            _value >>= 7;
+        }
+        _output.push_back(static_cast<char>(_value));
+    }
+
+    optional<uint64_t> readVarUInt(istream& _input)
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            auto const ch = _input.get();
+            if (ch == istream::traits_type::eof())
+                return nullopt;
+            value |= uint64_t(ch & 0x7F) << shift;
+            if (!(ch & 0x80))
+                return value;
+        }
+        return nullopt;
+    }
+
+    optional<uint64_t> readVarUInt(string_view& _input)
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64 && !_input.empty(); shift += 7)
+        {
+            auto const ch = static_cast<uint8_t>(_input.front());
+            _input.remove_prefix(1);
+            value |= uint64_t(ch & 0x7F) << shift;
+            if (!(ch & 0x80))
+                return value;
+        }
+        return nullopt;
+    }
+
+    unique_ptr<ostream> createFile(FileSystem::path const& _path)
+    {
+        auto file = make_unique<std::ofstream>(_path, std::ios::binary | std::ios::trunc);
+        if (!file->is_open())
+            throw std::system_error(errno, std::system_category(), "Creating VT capture " + _path.string());
+        return file;
+    }
+} // }}}
+
+// {{{ CaptureWriter
+CaptureWriter::CaptureWriter(unique_ptr<ostream> _output):
+    output_{ move(_output) },
+    start_{ Clock::now() },
+    last_{ start_ }
+{
+    output_->write(Magic.data(), static_cast<std::streamsize>(Magic.size()));
+    size_ = Magic.size();
+}
+
+CaptureWriter::CaptureWriter(FileSystem::path const& _path):
+    CaptureWriter(createFile(_path))
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    flush();
+}
+
+void CaptureWriter::output(string_view _data, Clock::time_point _time)
+{
+    write(CaptureEvent::Output, _time, _data);
+}
+
+void CaptureWriter::input(string_view _data, Clock::time_point _time)
+{
+    write(CaptureEvent::Input, _time, _data);
+}
+
+void CaptureWriter::resize(PageSize _pageSize, optional<ImageSize> _pixels, Clock::time_point _time)
+{
+    auto payload = string{};
+    appendVarUInt(payload, unbox<uint64_t>(_pageSize.lines));
+    appendVarUInt(payload, unbox<uint64_t>(_pageSize.columns));
+    appendVarUInt(payload, _pixels ? unbox<uint64_t>(_pixels->width) : 0);
+    appendVarUInt(payload, _pixels ? unbox<uint64_t>(_pixels->height) : 0);
+    write(CaptureEvent::Resize, _time, payload);
+}
+
+void CaptureWriter::write(CaptureEvent _event, Clock::time_point _time, string_view _payload)
+{
+    auto const _ = lock_guard{lock_};
+
+    // Records are written in order, even if their timestamps were taken concurrently.
+    auto const time = std::max(_time, last_);
+    auto header = string{};
+    header.push_back(static_cast<char>(_event));
+    appendVarUInt(header, static_cast<uint64_t>(duration_cast<microseconds>(time - start_).count()
+                                              - duration_cast<microseconds>(last_ - start_).count()));
+    appendVarUInt(header, _payload.size());
+    last_ = time;
+
+    output_->write(header.data(), static_cast<std::streamsize>(header.size()));
+    output_->write(_payload.data(), static_cast<std::streamsize>(_payload.size()));
+    size_ += header.size() + _payload.size();
+}
+
+void CaptureWriter::flush()
+{
+    auto const _ = lock_guard{lock_};
+    output_->flush();
+}
+
+uint64_t CaptureWriter::size() const
+{
+    auto const _ = lock_guard{lock_};
+    return size_;
+}
+// }}}
+
+// {{{ CaptureReader
+CaptureReader::CaptureReader(istream& _input):
+    input_{ _input }
+{
+    char magic[Magic.size()];
+    input_.read(magic, sizeof(magic));
+    valid_ = input_.gcount() == sizeof(magic) && string_view(magic, sizeof(magic)) == Magic;
+}
+
+optional<CaptureRecord> CaptureReader::next()
+{
+    if (!valid_)
+        return nullopt;
+
+    // Unknown records are skipped, so that newer captures can still be replayed.
+    for (;;)
+    {
+        auto const type = input_.get();
+        if (type == istream::traits_type::eof())
+            return nullopt;
+
+        auto const delta = readVarUInt(input_);
+        auto const size = readVarUInt(input_);
+        if (!delta || !size || *size > MaxRecordSize)
+            return nullopt;
+
+        auto record = CaptureRecord{};
+        record.event = static_cast<CaptureEvent>(type);
+        record.time = time_ += microseconds(*delta);
+
+        // Read in bounded steps, so that a truncated capture cannot make us allocate
+        // much more than it actually contains.
+        auto constexpr ReadStep = uint64_t{64 * 1024};
+        while (record.data.size() < *size)
+        {
+            auto const offset = record.data.size();
+            auto const count = std::min(*size - offset, ReadStep);
+            record.data.resize(offset + count);
+            input_.read(record.data.data() + offset, static_cast<std::streamsize>(count));
+            if (static_cast<uint64_t>(input_.gcount()) != count)
+                return nullopt;
+        }
+
+        switch (record.event)
+        {
+            case CaptureEvent::Output:
+            case CaptureEvent::Input:
+                return record;
+            case CaptureEvent::Resize:
+            {
+                auto payload = string_view(record.data);
+                auto const lines = readVarUInt(payload);
+                auto const columns = readVarUInt(payload);
+                auto const width = readVarUInt(payload);
+                auto const height = readVarUInt(payload);
+                if (!lines || !columns || !width || !height)
+                    return nullopt;
+                record.pageSize = PageSize{LineCount::cast_from(*lines), ColumnCount::cast_from(*columns)};
+                if (*width && *height)
+                    record.pixels = ImageSize{Width::cast_from(*width), Height::cast_from(*height)};
+                record.data.clear();
+                return record;
+            }
+        }
+    }
+}
+// }}}
+
+// {{{ CaptureReplayer
+CaptureReplayer::CaptureReplayer(istream& _capture, Terminal& _terminal, MockViewPty& _pty, Speed _speed):
+    reader_{ _capture },
+    terminal_{ _terminal },
+    pty_{ _pty },
+    speed_{ _speed }
+{
+}
+
+optional<CaptureRecord> CaptureReplayer::waitForNext()
+{
+    auto record = reader_.next();
+    if (!record)
+        return nullopt;
+
+    if (!start_)
+        start_ = std::chrono::steady_clock::now() - record->time;
+
+    if (speed_ == Speed::RealTime)
+        std::this_thread::sleep_until(*start_ + record->time);
+
+    return record;
+}
+
+void CaptureReplayer::replay(CaptureRecord const& _record)
+{
+    switch (_record.event)
+    {
+        case CaptureEvent::Output:
+            pty_.setReadData(_record.data);
+            do terminal_.processInputOnce();
+            while (!pty_.stdoutBuffer().empty());
+            // Replies of the terminal are of no interest.
+            pty_.stdinBuffer().clear();
+            break;
+        case CaptureEvent::Resize:
+            terminal_.resizeScreen(_record.pageSize, _record.pixels);
+            break;
+        case CaptureEvent::Input:
+            break;
+    }
+}
+
+optional<CaptureRecord> CaptureReplayer::replayNext()
+{
+    auto record = waitForNext();
+    if (record)
+        replay(*record);
+    return record;
+}
+
+void CaptureReplayer::replayAll()
+{
+    while (replayNext())
+        ;
+}
+// }}}
+
+} // end namespace
@@ -0,0 +1,163 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <terminal/primitives.h>
+
+#include <crispy/stdfs.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace terminal {
+
+class MockViewPty;
+class Terminal;
+
+/**
+ * VT captures record everything a terminal session received from (and sent to) its PTY,
+ * so that the exact byte stream can be replayed later on, e.g. to reproduce slowdowns.
+ *
+ * The binary format starts with the 8 byte magic "VTCAP\0\0\1", followed by records of:
+ *
+ * - the event type (1 byte, see CaptureEvent),
+ * - the time since the previous record in microseconds (LEB128),
+ * - the payload size in bytes (LEB128),
+ * - the payload.
+ *
+ * Output and input payloads are the raw bytes. Resize payloads are the number of lines
+ * and columns, and the width and height in pixels (0 if unknown), each LEB128 encoded.
+ */
+enum class CaptureEvent : uint8_t
+{
+    Output = 1, //!< read from the PTY
+    Input = 2,  //!< written to the PTY
+    Resize = 3, //!< page size changed (the first record of a capture contains the initial one)
+};
+
+struct CaptureRecord
+{
+    CaptureEvent event = CaptureEvent::Output;
+    std::chrono::microseconds time{};  //!< since the start of the capture
+    std::string data{};                //!< Output and Input only
+    PageSize pageSize{};               //!< Resize only
+    std::optional<ImageSize> pixels{}; //!< Resize only
+};
+
+/// Writes a VT capture. All methods may be invoked from any thread.
+class CaptureWriter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CaptureWriter(std::unique_ptr<std::ostream> _output);
+
+    /// @throws std::system_error if the file could not be created.
+    explicit CaptureWriter(FileSystem::path const& _path);
+
+    ~CaptureWriter();
+
+    CaptureWriter(CaptureWriter const&) = delete;
+    CaptureWriter& operator=(CaptureWriter const&) = delete;
+
+    void output(std::string_view _data, Clock::time_point _time = Clock::now());
+    void input(std::string_view _data, Clock::time_point _time = Clock::now());
+    void resize(PageSize _pageSize, std::optional<ImageSize> _pixels, Clock::time_point _time = Clock::now());
+
+    void flush();
+
+    /// @returns number of bytes written so far, including the header.
+    uint64_t size() const;
+
+  private:
+    void write(CaptureEvent _event, Clock::time_point _time, std::string_view _payload);
+
+    mutable std::mutex lock_;
+    std::unique_ptr<std::ostream> output_;
+    Clock::time_point start_;
+    Clock::time_point last_;
+    uint64_t size_ = 0;
+};
+
+/// Reads a VT capture record by record.
+class CaptureReader
+{
+  public:
+    explicit CaptureReader(std::istream& _input);
+
+    /// Whether or not the input started with a VT capture header.
+    bool valid() const noexcept { return valid_; }
+
+    /// Upper limit of a record's size, guarding against corrupt captures.
+    static constexpr uint64_t MaxRecordSize = 64 * 1024 * 1024;
+
+    /// @returns the next record, or std::nullopt at the end of the capture
+    ///          (or where it has been truncated or is corrupt).
+    std::optional<CaptureRecord> next();
+
+  private:
+    std::istream& input_;
+    bool valid_ = false;
+    std::chrono::microseconds time_{};
+};
+
+/// Replays a VT capture into a terminal that reads from a MockViewPty.
+///
+/// Output is fed through the terminal's regular input processing, and resizes are applied
+/// to the terminal. Input events are skipped, as their effect is part of the captured output.
+class CaptureReplayer
+{
+  public:
+    enum class Speed
+    {
+        Unlimited, //!< as fast as possible
+        RealTime,  //!< waiting for each record to become due, relative to the start of the replay
+    };
+
+    CaptureReplayer(std::istream& _capture, Terminal& _terminal, MockViewPty& _pty, Speed _speed);
+
+    bool valid() const noexcept { return reader_.valid(); }
+
+    /// Reads the next record of the capture, waiting for it to become due in real-time mode,
+    /// without replaying it yet (see replay()).
+    ///
+    /// @returns the next record, or std::nullopt at the end of the capture.
+    std::optional<CaptureRecord> waitForNext();
+
+    /// Replays @p _record, as returned by waitForNext().
+    void replay(CaptureRecord const& _record);
+
+    /// Replays the next record of the capture.
+    ///
+    /// @returns the replayed record, or std::nullopt at the end of the capture.
+    std::optional<CaptureRecord> replayNext();
+
+    /// Replays the remaining records of the capture.
+    void replayAll();
+
+  private:
+    CaptureReader reader_;
+    Terminal& terminal_;
+    MockViewPty& pty_;
+    Speed speed_;
+    std::optional<std::chrono::steady_clock::time_point> start_;
+};
+
+} // end namespace
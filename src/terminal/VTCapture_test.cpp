@@ -0,0 +1,183 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <terminal/Terminal.h>
+#include <terminal/VTCapture.h>
+#include <terminal/pty/MockPty.h>
+#include <terminal/pty/MockViewPty.h>
+
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace terminal;
+using namespace std::string_literals;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace
+{
+    std::unique_ptr<CaptureWriter> captureInto(std::stringstream*& _stream)
+    {
+        auto stream = std::make_unique<std::stringstream>();
+        _stream = stream.get();
+        return std::make_unique<CaptureWriter>(std::move(stream));
+    }
+}
+
+TEST_CASE("VTCapture.roundtrip", "[capture]")
+{
+    std::stringstream* stream = nullptr;
+    auto writer = captureInto(stream);
+    auto const t0 = CaptureWriter::Clock::now();
+
+    writer->resize(PageSize{LineCount(25), ColumnCount(80)}, std::nullopt, t0);
+    writer->output("Hello\r\n", t0 + milliseconds(5));
+    writer->input("\033[A"s, t0 + milliseconds(7));
+    writer->output(std::string(300, '\0'), t0 + milliseconds(7));
+    writer->resize(PageSize{LineCount(30), ColumnCount(100)}, ImageSize{Width(1000), Height(600)}, t0 + milliseconds(9));
+    writer->flush();
+    CHECK(writer->size() == stream->str().size());
+
+    auto reader = CaptureReader(*stream);
+    REQUIRE(reader.valid());
+
+    auto record = reader.next();
+    REQUIRE(record.has_value());
+    CHECK(record->event == CaptureEvent::Resize);
+    CHECK(record->pageSize == PageSize{LineCount(25), ColumnCount(80)});
+    CHECK(!record->pixels.has_value());
+    auto const base = record->time;
+
+    record = reader.next();
+    REQUIRE(record.has_value());
+    CHECK(record->event == CaptureEvent::Output);
+    CHECK(record->data == "Hello\r\n");
+    CHECK(record->time - base == microseconds(5000));
+
+    record = reader.next();
+    REQUIRE(record.has_value());
+    CHECK(record->event == CaptureEvent::Input);
+    CHECK(record->data == "\033[A");
+    CHECK(record->time - base == microseconds(7000));
+
+    record = reader.next();
+    REQUIRE(record.has_value());
+    CHECK(record->data == std::string(300, '\0'));
+
+    record = reader.next();
+    REQUIRE(record.has_value());
+    CHECK(record->event == CaptureEvent::Resize);
+    CHECK(record->pageSize == PageSize{LineCount(30), ColumnCount(100)});
+    CHECK(record->pixels == ImageSize{Width(1000), Height(600)});
+    CHECK(record->time - base == microseconds(9000));
+
+    CHECK(!reader.next().has_value());
+}
+
+TEST_CASE("VTCapture.truncated", "[capture]")
+{
+    std::stringstream* stream = nullptr;
+    auto writer = captureInto(stream);
+    writer->output("first");
+    writer->output("second");
+    writer->flush();
+
+    auto data = stream->str();
+    data.resize(data.size() - 2);
+    auto truncated = std::stringstream(data);
+    auto reader = CaptureReader(truncated);
+    REQUIRE(reader.valid());
+    CHECK(reader.next()->data == "first");
+    CHECK(!reader.next().has_value());
+
+    auto garbage = std::stringstream("not a capture");
+    CHECK(!CaptureReader(garbage).valid());
+}
+
+TEST_CASE("VTCapture.corrupt", "[capture]")
+{
+    std::stringstream* stream = nullptr;
+    auto writer = captureInto(stream);
+    writer->output("last");
+    writer->flush();
+    auto const data = stream->str();
+    auto const header = data.substr(0, 8);
+    auto const varUInt = [](uint64_t _value) {
+        auto result = std::string{};
+        for (; _value >= 0x80; _value >>= 7)
+            result.push_back(static_cast<char>((_value & 0x7F) | 0x80));
+        result.push_back(static_cast<char>(_value));
+        return result;
+    };
+
+    SECTION("unknown records are skipped without recursion") {
+        auto const record = std::string("\x7F\0\0", 3); // unknown type, no delay, no data
+        auto unknown = std::string{};
+        for (int i = 0; i < 1'000'000; ++i)
+            unknown += record;
+        auto input = std::stringstream(header + unknown + data.substr(8));
+        auto reader = CaptureReader(input);
+        CHECK(reader.next()->data == "last");
+        CHECK(!reader.next().has_value());
+    }
+
+    SECTION("oversized record") {
+        auto input = std::stringstream(header + data[8] + varUInt(0) + varUInt(uint64_t(1) << 40) + "data");
+        CHECK(!CaptureReader(input).next().has_value());
+    }
+
+    SECTION("record size exceeding the capture") {
+        auto input = std::stringstream(header + data[8] + varUInt(0) + varUInt(CaptureReader::MaxRecordSize) + "data");
+        CHECK(!CaptureReader(input).next().has_value());
+    }
+}
+
+TEST_CASE("VTCapture.record_and_replay", "[capture]")
+{
+    auto const pageSize = PageSize{LineCount(4), ColumnCount(10)};
+    auto events = Terminal::Events{};
+    std::stringstream* stream = nullptr;
+
+    // Record
+    auto pty = MockPty(pageSize);
+    auto vt = Terminal(pty, 1024, events);
+    vt.setCapture(captureInto(stream));
+    pty.appendStdOutBuffer("\033[31mHello\r\n");
+    vt.processInputOnce();
+    vt.sendCharPressEvent('x', Modifier{}, std::chrono::steady_clock::now());
+    vt.resizeScreen(PageSize{LineCount(3), ColumnCount(8)}, std::nullopt);
+    pty.appendStdOutBuffer("World");
+    vt.processInputOnce();
+    vt.capture()->flush();
+    CHECK(pty.stdinBuffer() == "x");
+
+    // Replay
+    auto replayPty = MockViewPty(pageSize);
+    auto replayVT = Terminal(replayPty, 1024, events);
+    auto replayer = CaptureReplayer(*stream, replayVT, replayPty, CaptureReplayer::Speed::Unlimited);
+    REQUIRE(replayer.valid());
+
+    auto kinds = std::string{};
+    while (auto const record = replayer.replayNext())
+        kinds += record->event == CaptureEvent::Output ? 'o' : record->event == CaptureEvent::Input ? 'i' : 'r';
+    CHECK(kinds == "roiro");
+
+    CHECK(replayVT.screenSize() == PageSize{LineCount(3), ColumnCount(8)});
+    CHECK(replayVT.screen().renderTextLine(1) == vt.screen().renderTextLine(1));
+    CHECK(replayVT.screen().renderTextLine(2) == vt.screen().renderTextLine(2));
+    CHECK(replayVT.screen().renderTextLine(2) == "World   ");
+}
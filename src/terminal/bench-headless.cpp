@@ -12,29 +12,62 @@
  * limitations under the License.
  */
 
+#include <terminal/Search.h>
 #include <terminal/Terminal.h>
 #include <terminal/logging.h>
 #include <terminal/pty/MockViewPty.h>
+#include <terminal/pty/PtyProcess.h>
+
+#if !defined(_WIN32)
+#include <terminal/pty/UnixPty.h>
+#endif
 
 #include <crispy/App.h>
 #include <crispy/CLI.h>
+#include <crispy/base64.h>
 
 #include <libtermbench/termbench.h>
 
+#include <unicode/convert.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include <fmt/format.h>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
-class NullParserEvents: public terminal::ParserEvents
+class NullParserEvents final: public terminal::ParserEvents
 {
 public:
     void error(std::string_view const& _errorString) override {}
     void print(char32_t _text) override {}
     void print(std::string_view _chars) override {}
+    void print(std::u32string_view /*_chars*/) override {}
     void execute(char _controlCode) override {}
     void clear() override {}
     void collect(char _char) override {}
@@ -44,12 +77,15 @@ public:
     void dispatchCSI(char _function) override {}
     void startOSC() override {}
     void putOSC(char32_t _char) override {}
+    void putOSC(std::string_view /*_chars*/) override {}
     void dispatchOSC() override {}
     void hook(char _function) override {}
     void put(char32_t _char) override {}
+    void put(std::string_view /*_chars*/) override {}
     void unhook() override {}
     void startAPC() override {}
     void putAPC(char32_t) override {}
+    void putAPC(std::string_view) override {}
     void dispatchAPC() override {}
     void startPM() override {}
     void putPM(char32_t) override {}
@@ -63,12 +99,188 @@ struct BenchOptions
     bool longLines = false;
     bool sgr = false;
     bool binary = false;
+    bool cjk = false;
+    bool boxDrawing = false;
 };
 
+namespace // {{{ workloads not covered by termbench
+{
+    /// Lines of double-width CJK ideographs, filling all columns.
+    string cjkLines(unsigned _columns, unsigned _lines)
+    {
+        auto text = string{};
+        auto codepoint = char32_t{0x4E00};
+        for (unsigned line = 0; line < _lines; ++line)
+        {
+            for (unsigned column = 0; column + 1 < _columns; column += 2)
+            {
+                text += unicode::convert_to<char>(codepoint);
+                codepoint = codepoint < 0x9FFF ? codepoint + 1 : 0x4E00;
+            }
+            text += "\r\n";
+        }
+        return text;
+    }
+
+    /// Full-screen redraws of a TUI-like layout made of two framed panes with bar charts.
+    string boxDrawingScreen(unsigned _columns, unsigned _lines)
+    {
+        auto constexpr Horizontal = "\xE2\x94\x80"sv; // ─
+        auto constexpr Vertical = "\xE2\x94\x82"sv;   // │
+        auto constexpr Shades = array<string_view, 4>{
+            "\xE2\x96\x88"sv, // █
+            "\xE2\x96\x93"sv, // ▓
+            "\xE2\x96\x92"sv, // ▒
+            "\xE2\x96\x91"sv  // ░
+        };
+
+        auto const paneWidth = _columns / 2 - 2;
+        auto const border = [&](string_view _left, string_view _right) {
+            auto s = string{};
+            for (int pane = 0; pane < 2; ++pane)
+            {
+                s += _left;
+                for (unsigned i = 0; i < paneWidth; ++i)
+                    s += Horizontal;
+                s += _right;
+            }
+            return s;
+        };
+
+        auto text = string("\033[H");
+        text += border("\xE2\x94\x8C", "\xE2\x94\x90"); // ┌ ┐
+        text += "\r\n";
+        for (unsigned line = 2; line < _lines; ++line)
+        {
+            for (int pane = 0; pane < 2; ++pane)
+            {
+                text += Vertical;
+                for (unsigned i = 0; i < paneWidth; ++i)
+                    text += i < (line * 7 + unsigned(pane) * 13) % paneWidth ? Shades[(i / 4) % Shades.size()] : " "sv;
+                text += Vertical;
+            }
+            text += "\r\n";
+        }
+        text += border("\xE2\x94\x94", "\xE2\x94\x98"); // └ ┘
+        return text;
+    }
+
+    struct WorkloadResult
+    {
+        string name;
+        double seconds;
+        size_t bytes;
+    };
+
+    /// RGBA pixels of a synthetic, photo-like image: noisy gradients with a coarse checker board pattern.
+    vector<uint8_t> imagePixels(unsigned _width, unsigned _height)
+    {
+        auto pixels = vector<uint8_t>(size_t(_width) * _height * 4);
+        for (unsigned y = 0; y < _height; ++y)
+            for (unsigned x = 0; x < _width; ++x)
+            {
+                auto const noise = ((x * 73856093u) ^ (y * 19349663u)) % 48;
+                auto* pixel = &pixels[(size_t(y) * _width + x) * 4];
+                pixel[0] = static_cast<uint8_t>(x * 207 / _width + noise);
+                pixel[1] = static_cast<uint8_t>(y * 207 / _height + noise);
+                pixel[2] = static_cast<uint8_t>(((x / 64 + y / 64) % 2 ? 0xA0 : 0x40) + noise);
+                pixel[3] = 0xFF;
+            }
+        return pixels;
+    }
+
+    /// Encodes RGBA pixels as Sixel image, quantized to a 6x6x6 color cube.
+    string sixelImage(vector<uint8_t> const& _pixels, unsigned _width, unsigned _height)
+    {
+        constexpr unsigned ColorCount = 6 * 6 * 6;
+
+        auto text = fmt::format("\033Pq\"1;1;{};{}", _width, _height);
+        for (unsigned i = 0; i < ColorCount; ++i)
+            text += fmt::format("#{};2;{};{};{}", i, i / 36 * 20, i / 6 % 6 * 20, i % 6 * 20);
+
+        auto masks = vector<uint8_t>(size_t(ColorCount) * _width);
+        auto used = vector<bool>(ColorCount);
+        for (unsigned top = 0; top < _height; top += 6)
+        {
+            fill(masks.begin(), masks.end(), 0);
+            fill(used.begin(), used.end(), false);
+            for (unsigned dy = 0; dy < 6 && top + dy < _height; ++dy)
+                for (unsigned x = 0; x < _width; ++x)
+                {
+                    auto const* pixel = &_pixels[(size_t(top + dy) * _width + x) * 4];
+                    auto const color = pixel[0] * 6 / 256 * 36 + pixel[1] * 6 / 256 * 6 + pixel[2] * 6 / 256;
+                    masks[size_t(color) * _width + x] |= static_cast<uint8_t>(1 << dy);
+                    used[color] = true;
+                }
+
+            for (unsigned color = 0; color < ColorCount; ++color)
+            {
+                if (!used[color])
+                    continue;
+                text += fmt::format("#{}", color);
+                auto const* row = &masks[size_t(color) * _width];
+                for (unsigned x = 0; x < _width; )
+                {
+                    auto run = 1u;
+                    while (x + run < _width && row[x + run] == row[x])
+                        ++run;
+                    auto const sixel = static_cast<char>(63 + row[x]);
+                    if (run > 3)
+                        text += fmt::format("!{}{}", run, sixel);
+                    else
+                        text.append(run, sixel);
+                    x += run;
+                }
+                text += '$';
+            }
+            text += '-';
+        }
+        text += "\033\\";
+        return text;
+    }
+
+    /// Encodes RGBA pixels as kitty graphics transmission, split into chunks as clients do.
+    string kittyImage(vector<uint8_t> const& _pixels, unsigned _width, unsigned _height)
+    {
+        constexpr size_t ChunkSize = 4096;
+
+        auto const data = crispy::base64::encode(string_view(reinterpret_cast<char const*>(_pixels.data()), _pixels.size()));
+        auto text = string{};
+        for (size_t offset = 0; offset < data.size(); offset += ChunkSize)
+        {
+            auto const more = offset + ChunkSize < data.size() ? 1 : 0;
+            if (offset == 0)
+                text += fmt::format("\033_Ga=T,f=32,s={},v={},i=1,q=2,m={};", _width, _height, more);
+            else
+                text += fmt::format("\033_Gm={};", more);
+            text += string_view(data).substr(offset, ChunkSize);
+            text += "\033\\";
+        }
+        return text;
+    }
+
+    template <typename Writer>
+    WorkloadResult runWorkload(Writer& _writer, string _name, string const& _payload, unsigned _testSizeMB)
+    {
+        cout << fmt::format("Running test {} ...\n", _name);
+        auto const totalBytes = size_t(_testSizeMB) * 1024 * 1024;
+        auto bytes = size_t{0};
+        auto const start = chrono::steady_clock::now();
+        while (bytes < totalBytes)
+        {
+            _writer(_payload.data(), _payload.size());
+            bytes += _payload.size();
+        }
+        auto const seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return WorkloadResult{move(_name), seconds, bytes};
+    }
+} // }}}
+
 template <typename Writer>
 int baseBenchmark(Writer&& _writer, BenchOptions _options, string_view _title)
 {
-    if (!(_options.binary || _options.longLines || _options.manyLines || _options.sgr))
+    if (!(_options.binary || _options.longLines || _options.manyLines || _options.sgr
+          || _options.cjk || _options.boxDrawing))
     {
         cout << "No test cases specified. Defaulting to: cat, long, sgr.\n";
         _options.manyLines = true;
@@ -83,7 +295,7 @@ int baseBenchmark(Writer&& _writer, BenchOptions _options, string_view _title)
          << string(titleText.size(), '=') << '\n';
 
     auto tbp = contour::termbench::Benchmark{
-        std::forward<Writer>(_writer),
+        _writer,
         _options.testSizeMB,
         80,
         24,
@@ -110,15 +322,253 @@ int baseBenchmark(Writer&& _writer, BenchOptions _options, string_view _title)
 
     tbp.runAll();
 
+    auto workloads = vector<WorkloadResult>{};
+    if (_options.cjk)
+        workloads.emplace_back(runWorkload(_writer, "cjk_lines", cjkLines(80, 24), _options.testSizeMB));
+    if (_options.boxDrawing)
+        workloads.emplace_back(runWorkload(_writer, "box_drawing", boxDrawingScreen(80, 24), _options.testSizeMB));
+
     cout << '\n';
     cout << "Results\n";
     cout << "-------\n";
     tbp.summarize(cout);
+    for (auto const& workload: workloads)
+        cout << fmt::format("{:>20}: {:>8.3f} s, {:>10.2f} MB/s\n",
+                            workload.name,
+                            workload.seconds,
+                            double(workload.bytes) / 1024.0 / 1024.0 / workload.seconds);
     cout << '\n';
 
     return EXIT_SUCCESS;
 }
 
+namespace // {{{ input latency
+{
+    using LatencyClock = chrono::steady_clock;
+
+    /// Mock PTY whose "child" echoes all input immediately (just like the line discipline
+    /// in cooked mode), while other output may be appended concurrently.
+    ///
+    /// Unlike MockPty, this one is safe to be used from the terminal thread and the
+    /// input (render) thread at the same time, and read() blocks until there is output.
+    class EchoPty: public terminal::Pty
+    {
+      public:
+        /// Maximum number of pending output bytes, much like the buffer of a real PTY.
+        static constexpr size_t Capacity = 64 * 1024;
+
+        explicit EchoPty(terminal::PageSize _size): size_{ _size } {}
+
+        void close() override
+        {
+            {
+                auto const _ = lock_guard{lock_};
+                closed_ = true;
+            }
+            outputAvailable_.notify_all();
+            spaceAvailable_.notify_all();
+        }
+
+        bool isClosed() const override
+        {
+            auto const _ = lock_guard{lock_};
+            return closed_;
+        }
+
+        void prepareParentProcess() override {}
+        void prepareChildProcess() override {}
+
+        optional<string_view> read(size_t _size, chrono::milliseconds _timeout) override
+        {
+            auto lock = unique_lock{lock_};
+            outputAvailable_.wait_for(lock, _timeout, [this]() {
+                return closed_ || wakeup_ || !output_.empty();
+            });
+
+            if (closed_)
+            {
+                errno = ENODEV;
+                return nullopt;
+            }
+
+            if (output_.empty())
+            {
+                errno = exchange(wakeup_, false) ? EINTR : EAGAIN;
+                return nullopt;
+            }
+
+            wakeup_ = false;
+            auto const n = std::min(_size, output_.size());
+            readBuffer_.assign(output_, 0, n);
+            output_.erase(0, n);
+            spaceAvailable_.notify_all();
+            return string_view(readBuffer_);
+        }
+
+        void wakeupReader() override
+        {
+            {
+                auto const _ = lock_guard{lock_};
+                wakeup_ = true;
+            }
+            outputAvailable_.notify_all();
+        }
+
+        int write(char const* _buf, size_t _size) override
+        {
+            {
+                auto const _ = lock_guard{lock_};
+                output_.append(_buf, _size);
+            }
+            outputAvailable_.notify_all();
+            return static_cast<int>(_size);
+        }
+
+        /// Appends output of the child, blocking while the PTY's buffer is full.
+        void writeOutput(string_view _data)
+        {
+            {
+                auto lock = unique_lock{lock_};
+                spaceAvailable_.wait(lock, [&]() { return closed_ || output_.size() < Capacity; });
+                output_ += _data;
+            }
+            outputAvailable_.notify_all();
+        }
+
+        terminal::PageSize screenSize() const noexcept override { return size_; }
+
+        void resizeScreen(terminal::PageSize _cells, optional<terminal::ImageSize>) override { size_ = _cells; }
+
+      private:
+        terminal::PageSize size_;
+        mutable mutex lock_;
+        condition_variable outputAvailable_;
+        condition_variable spaceAvailable_;
+        string output_;
+        string readBuffer_;
+        bool wakeup_ = false;
+        bool closed_ = false;
+    };
+
+    /// Redraws all but the last line of the screen at a given rate on a background thread
+    /// (like a busy TUI application would), in order to see how output of the application
+    /// affects input latency.
+    ///
+    /// The cursor is saved and restored around each redraw, so that echoed input keeps
+    /// appearing on the last line, rather than being scrolled off-screen by the load.
+    class OutputLoad
+    {
+      public:
+        using Writer = function<void(string_view)>;
+
+        OutputLoad(terminal::PageSize _pageSize, double _bytesPerSecond, Writer _writer):
+            bytesPerSecond_{ _bytesPerSecond },
+            writer_{ move(_writer) }
+        {
+            auto const columns = unbox<unsigned>(_pageSize.columns);
+            for (unsigned frame = 0; frame < 16; ++frame)
+            {
+                auto text = string("\0337");
+                for (int line = 1; line < *_pageSize.lines; ++line)
+                {
+                    auto const row = fmt::format("[worker {:>2}] processed request {:08x} in {} ms",
+                                                 line, (frame * 97 + line) * 2654435761u, (frame + line) % 97);
+                    text += fmt::format("\033[{};1H{:<{}}", line, row.substr(0, columns), columns);
+                }
+                text += "\0338";
+                frames_.emplace_back(move(text));
+            }
+            if (bytesPerSecond_ > 0)
+                thread_ = std::thread([this]() { run(); });
+        }
+
+        ~OutputLoad() { stop(); }
+
+        void stop()
+        {
+            quit_ = true;
+            if (thread_.joinable())
+                thread_.join();
+        }
+
+      private:
+        void run()
+        {
+            // Whole redraws are written, checking once a millisecond, without catching up
+            // on more than a few of them while the writer has been blocked.
+            auto constexpr Tick = chrono::milliseconds(1);
+            auto const frameSize = static_cast<double>(frames_.front().size());
+            auto const tickBudget = bytesPerSecond_ / 1000.0;
+            auto budget = 0.0;
+            size_t frame = 0;
+            while (!quit_)
+            {
+                budget = std::min(budget + tickBudget, 4 * std::max(tickBudget, frameSize));
+                for (; budget >= frameSize && !quit_; budget -= frameSize)
+                    writer_(frames_[frame++ % frames_.size()]);
+                this_thread::sleep_for(Tick);
+            }
+        }
+
+        double const bytesPerSecond_;
+        Writer writer_;
+        vector<string> frames_;
+        atomic<bool> quit_ = false;
+        std::thread thread_;
+    };
+
+    /// Wakes up the "render" thread whenever the screen has been updated, just like the GUI does.
+    class LatencyEvents: public terminal::Terminal::Events
+    {
+      public:
+        void screenUpdated() override
+        {
+            {
+                auto const _ = lock_guard{lock_};
+                dirty_ = true;
+            }
+            updated_.notify_one();
+        }
+
+        /// @returns whether or not the screen has been updated until @p _deadline.
+        bool waitForUpdate(LatencyClock::time_point _deadline)
+        {
+            auto lock = unique_lock{lock_};
+            updated_.wait_until(lock, _deadline, [this]() { return dirty_; });
+            return exchange(dirty_, false);
+        }
+
+      private:
+        mutex lock_;
+        condition_variable updated_;
+        bool dirty_ = false;
+    };
+
+    /// Touches everything a renderer looks at in the render buffer.
+    uint64_t renderHeadless(terminal::RenderBuffer const& _buffer)
+    {
+        auto hash = uint64_t{14695981039346656037ull};
+        auto const mix = [&](uint64_t _value) { hash = (hash ^ _value) * 1099511628211ull; };
+        for (terminal::RenderCell const& cell: _buffer.screen)
+        {
+            for (char32_t const codepoint: cell.codepoints)
+                mix(codepoint);
+            mix(static_cast<uint64_t>(cell.position.row) << 32 | static_cast<uint32_t>(cell.position.column));
+            mix(static_cast<uint64_t>(cell.flags));
+            for (terminal::RGBColor const color: {cell.foregroundColor, cell.backgroundColor, cell.decorationColor})
+                mix(uint64_t(color.red) << 16 | uint64_t(color.green) << 8 | color.blue);
+        }
+        return hash;
+    }
+
+    bool containsCodepoint(terminal::RenderBuffer const& _buffer, char32_t _codepoint)
+    {
+        return any_of(_buffer.screen.begin(), _buffer.screen.end(), [&](terminal::RenderCell const& _cell) {
+            return _cell.codepoints.size() == 1 && _cell.codepoints[0] == _codepoint;
+        });
+    }
+} // }}}
+
 namespace CLI = crispy::cli;
 
 class ContourHeadlessBench: public crispy::App
@@ -139,6 +589,12 @@ public:
         );
         link("bench-headless.parser", bind(&ContourHeadlessBench::benchParserOnly, this));
         link("bench-headless.grid", bind(&ContourHeadlessBench::benchGrid, this));
+        link("bench-headless.pipeline", bind(&ContourHeadlessBench::benchPipeline, this));
+        link("bench-headless.search", bind(&ContourHeadlessBench::benchSearch, this));
+        link("bench-headless.history", bind(&ContourHeadlessBench::benchHistory, this));
+        link("bench-headless.reflow", bind(&ContourHeadlessBench::benchReflow, this));
+        link("bench-headless.images", bind(&ContourHeadlessBench::benchImages, this));
+        link("bench-headless.latency", bind(&ContourHeadlessBench::benchLatency, this));
         link("bench-headless.meta", bind(&ContourHeadlessBench::showMetaInfo, this));
     }
 
@@ -151,6 +607,8 @@ public:
                 CLI::Option{"long", CLI::Value{false}, "Enable long-line ASCII stream test."},
                 CLI::Option{"sgr", CLI::Value{false}, "Enable SGR stream test."},
                 CLI::Option{"binary", CLI::Value{false}, "Enable binary stream test."},
+                CLI::Option{"cjk", CLI::Value{false}, "Enable CJK (double width) text stream test."},
+                CLI::Option{"box", CLI::Value{false}, "Enable box drawing TUI redraw test."},
             };
 
         return CLI::Command{
@@ -164,6 +622,60 @@ public:
                 CLI::Command{"license", "Shows the license, and project URL of the used projects and Contour."},
                 CLI::Command{"grid", "Shows the license, and project URL of the used projects and Contour.", perfOptions},
                 CLI::Command{"parser", "Shows the license, and project URL of the used projects and Contour.", perfOptions},
+                CLI::Command{"pipeline", "Compares the throughput of the parser alone (static and virtual event dispatch) with the full terminal pipeline.", perfOptions},
+                CLI::Command{
+                    "search",
+                    "Benchmarks indexing and searching a synthetic scrollback history.",
+                    CLI::OptionList{
+                        CLI::Option{"lines", CLI::Value{1000000u}, "Number of history lines to generate.", "COUNT"},
+                        CLI::Option{"pattern", CLI::Value{string("connection reset by peer")}, "Text (or regular expression) to search for.", "PATTERN"},
+                        CLI::Option{"regex", CLI::Value{false}, "Interpret the pattern as regular expression."},
+                        CLI::Option{"icase", CLI::Value{false}, "Search case insensitively."},
+                    }
+                },
+                CLI::Command{
+                    "history",
+                    "Benchmarks filling an unlimited scrollback history and reports its memory footprint.",
+                    CLI::OptionList{
+                        CLI::Option{"lines", CLI::Value{200000u}, "Number of lines to write.", "COUNT"},
+                        CLI::Option{"cold", CLI::Value{false}, "Move old history lines into disk-backed cold storage."},
+                        CLI::Option{"hot", CLI::Value{10000u}, "Number of history lines to keep in memory with cold storage enabled.", "COUNT"},
+                    }
+                },
+                CLI::Command{
+                    "reflow",
+                    "Benchmarks reflowing a synthetic scrollback history on resize, sequentially and concurrently.",
+                    CLI::OptionList{
+                        CLI::Option{"lines", CLI::Value{1000000u}, "Number of history lines to generate.", "COUNT"},
+                        CLI::Option{"columns", CLI::Value{200u}, "Number of columns to resize to, and back from to 80.", "COUNT"},
+                        CLI::Option{"threads", CLI::Value{0u}, "Maximum number of threads for the concurrent run (0 for one per hardware thread).", "COUNT"},
+                        CLI::Option{"rounds", CLI::Value{3u}, "Number of resizes forth and back per run.", "COUNT"},
+                    }
+                },
+                CLI::Command{
+                    "latency",
+                    "Measures the latency of key presses until their echo is visible in the render buffer.",
+                    CLI::OptionList{
+                        CLI::Option{"samples", CLI::Value{1000u}, "Number of key presses to measure.", "COUNT"},
+                        CLI::Option{"interval", CLI::Value{10u}, "Time between an echo and the next key press.", "MS"},
+                        CLI::Option{"timeout", CLI::Value{1000u}, "Time to wait for an echo until the key press is considered lost.", "MS"},
+                        CLI::Option{"load", CLI::Value{0u}, "Rate of concurrent output of the application.", "KB/s"},
+                        CLI::Option{"pty", CLI::Value{string("mock")}, "PTY to use: mock (echoing in-process) or real (echoing child process).", "KIND"},
+                        CLI::Option{"refresh-rate", CLI::Value{60u}, "Refresh rate of the terminal's render buffer.", "HZ"},
+                        CLI::Option{"frame-rate", CLI::Value{60u}, "Display refresh the emulated GUI thread is synchronized to (0 for none).", "HZ"},
+                        CLI::Option{"read-buffer-size", CLI::Value{16384u}, "PTY read buffer size.", "BYTES"},
+                        CLI::Option{"render", CLI::Value{false}, "Also walk the render buffer like a renderer does, before the echo counts as visible."},
+                    }
+                },
+                CLI::Command{
+                    "images",
+                    "Compares the throughput of image transmissions via Sixel, kitty graphics (direct) and kitty graphics (shared memory).",
+                    CLI::OptionList{
+                        CLI::Option{"width", CLI::Value{1920u}, "Image width in pixels.", "PIXELS"},
+                        CLI::Option{"height", CLI::Value{1080u}, "Image height in pixels.", "PIXELS"},
+                        CLI::Option{"count", CLI::Value{10u}, "Number of images to transmit per protocol.", "COUNT"},
+                    }
+                },
             }
         };
     }
@@ -187,6 +699,8 @@ public:
         opts.longLines = parameters().boolean(prefix + "long");
         opts.sgr = parameters().boolean(prefix + "sgr");
         opts.binary = parameters().boolean(prefix + "binary");
+        opts.cjk = parameters().boolean(prefix + "cjk");
+        opts.boxDrawing = parameters().boolean(prefix + "box");
         return opts;
     }
 
@@ -222,6 +736,469 @@ public:
         return rv;
     }
 
+    int benchHistory()
+    {
+        using namespace terminal;
+        using Clock = chrono::steady_clock;
+
+        auto const lineCount = parameters().uint("bench-headless.history.lines");
+        auto const pageSize = PageSize{LineCount(25), ColumnCount(80)};
+        auto eh = Terminal::Events{};
+        auto pty = std::make_unique<MockViewPty>(pageSize);
+        auto vt = Terminal{*pty, 10000, eh, nullopt};
+        vt.screen().setMode(DECMode::AutoWrap, true);
+        if (parameters().boolean("bench-headless.history.cold"))
+            vt.screen().setColdHistory(ColdHistorySettings{
+                FileSystem::temp_directory_path(),
+                LineCount::cast_from(parameters().uint("bench-headless.history.hot"))
+            });
+
+        auto const start = Clock::now();
+        string chunk;
+        for (unsigned i = 0; i < lineCount; ++i)
+        {
+            chunk += fmt::format("\033[32mINFO\033[m [worker {:>3}] request {} served in {} ms\r\n", i % 64, i, i % 997);
+            if (chunk.size() >= 64 * 1024 || i + 1 == lineCount)
+            {
+                pty->setReadData(chunk);
+                do vt.processInputOnce();
+                while (!pty->stdoutBuffer().empty());
+                chunk.clear();
+                (void) vt.screen().primaryGrid().updateHistoryIndex(); // as done when idle
+            }
+        }
+        auto const elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+        auto const& grid = vt.screen().primaryGrid();
+        auto const* cold = grid.coldHistory();
+        auto const hotLines = grid.scrollbackLines().size();
+        auto const unpackedLineBytes = sizeof(Line) + unbox<size_t>(pageSize.columns) * sizeof(Cell);
+        size_t hotBytes = 0;
+        for (Line const& line: grid.scrollbackLines())
+            hotBytes += line.memoryUsage();
+
+        cout << fmt::format("{:>16}: {}\n", "history lines", *grid.historyLineCount());
+        cout << fmt::format("{:>16}: {:.3} s ({:.1f} lines/s)\n", "elapsed", elapsed, lineCount / elapsed);
+        cout << fmt::format("{:>16}: {} ({:.1f} MB)\n", "in-memory lines", hotLines, double(hotBytes) / (1024 * 1024));
+        cout << fmt::format("{:>16}: {:.1f} bytes/line ({} bytes/line unpacked)\n", "line memory",
+                            double(hotBytes) / std::max(hotLines, size_t(1)), unpackedLineBytes);
+        if (cold)
+        {
+            cout << fmt::format("{:>16}: {}\n", "cold lines", *cold->lineCount());
+            cout << fmt::format("{:>16}: {:.1f} KB\n", "cold memory", double(cold->memoryUsage()) / 1024);
+            cout << fmt::format("{:>16}: {:.1f} MB ({:.1f} bytes/line)\n", "spill file",
+                                double(cold->diskUsage()) / (1024 * 1024),
+                                double(cold->diskUsage()) / std::max(1, *cold->lineCount()));
+        }
+        cout << fmt::format("{:>16}: {:.1f} MB in memory, {:.1f} MB on disk\n", "search index",
+                            double(grid.historyIndex().memoryUsage()) / (1024 * 1024),
+                            double(grid.historyIndex().diskUsage()) / (1024 * 1024));
+#if !defined(_WIN32)
+        auto usage = rusage{};
+        getrusage(RUSAGE_SELF, &usage);
+        cout << fmt::format("{:>16}: {:.1f} MB\n", "max RSS", double(usage.ru_maxrss) / 1024);
+#endif
+        return EXIT_SUCCESS;
+    }
+
+    int benchImages()
+    {
+        using namespace terminal;
+        using Clock = chrono::steady_clock;
+
+        auto const width = parameters().uint("bench-headless.images.width");
+        auto const height = parameters().uint("bench-headless.images.height");
+        auto const count = parameters().uint("bench-headless.images.count");
+        auto const pixels = imagePixels(width, height);
+
+        auto const pageSize = PageSize{LineCount(25), ColumnCount(80)};
+        auto eh = Terminal::Events{};
+        auto pty = std::make_unique<MockViewPty>(pageSize);
+        auto vt = Terminal{*pty, 64 * 1024, eh, LineCount(0)};
+        vt.screen().setCellPixelSize(ImageSize{Width(10), Height(20)});
+        vt.screen().setMaxImageSize(ImageSize{Width(width), Height(height)});
+
+        auto const process = [&](string_view _data) {
+            auto const start = Clock::now();
+            pty->setReadData(_data);
+            do vt.processInputOnce();
+            while (!pty->stdoutBuffer().empty());
+            return Clock::now() - start;
+        };
+
+        auto const report = [&](string_view _name, size_t _wireBytes, Clock::duration _elapsed) {
+            auto const seconds = chrono::duration<double>(_elapsed).count();
+            cout << fmt::format("{:>14}: {:>10.2f} MB sent, {:>8.2f} ms/image, {:>8.2f} MPixel/s\n",
+                                _name,
+                                double(_wireBytes) / 1024.0 / 1024.0,
+                                seconds * 1000.0 / count,
+                                double(width) * height * count / 1e6 / seconds);
+        };
+
+        cout << fmt::format("Transmitting {} images of {}x{} pixels ({:.2f} MB RGBA each)\n\n",
+                            count, width, height, double(pixels.size()) / 1024.0 / 1024.0);
+
+        auto const sixel = sixelImage(pixels, width, height);
+        auto elapsed = Clock::duration{};
+        for (unsigned i = 0; i < count; ++i)
+            elapsed += process(sixel);
+        report("sixel", sixel.size(), elapsed);
+
+        auto const kitty = kittyImage(pixels, width, height);
+        elapsed = Clock::duration{};
+        for (unsigned i = 0; i < count; ++i)
+            elapsed += process(kitty);
+        report("kitty direct", kitty.size(), elapsed);
+
+#if !defined(_WIN32)
+        // The client side (creating the shared memory object) is not accounted for.
+        auto const shmName = fmt::format("/contour-bench-{}", getpid());
+        auto const command = fmt::format("\033_Ga=T,f=32,t=s,s={},v={},i=1,q=2;{}\033\\",
+                                         width, height, crispy::base64::encode(shmName));
+        elapsed = Clock::duration{};
+        for (unsigned i = 0; i < count; ++i)
+        {
+            int const fd = shm_open(shmName.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0600);
+            if (fd < 0 || write(fd, pixels.data(), pixels.size()) != static_cast<ssize_t>(pixels.size()))
+            {
+                cerr << fmt::format("Could not create shared memory object {}.\n", shmName);
+                return EXIT_FAILURE;
+            }
+            close(fd);
+            elapsed += process(command);
+        }
+        shm_unlink(shmName.c_str());
+        report("kitty shm", command.size(), elapsed);
+#endif
+        return EXIT_SUCCESS;
+    }
+
+    int benchSearch()
+    {
+        using namespace terminal;
+        using Clock = chrono::steady_clock;
+        auto const msecs = [](auto d) { return chrono::duration<double, milli>(d).count(); };
+
+        auto const lineCount = parameters().uint("bench-headless.search.lines");
+        auto query = SearchQuery{};
+        query.pattern = parameters().str("bench-headless.search.pattern");
+        query.regularExpression = parameters().boolean("bench-headless.search.regex");
+        query.caseSensitive = !parameters().boolean("bench-headless.search.icase");
+
+        // Synthetic log-like history, with the (literal) pattern planted once near the top,
+        // which is the worst case for the default bottom-up search.
+        static constexpr array<string_view, 6> Levels{"INFO", "DEBUG", "WARN", "TRACE", "INFO", "ERROR"};
+        auto rng = mt19937{42};
+        auto index = HistoryIndex{};
+        auto line = Line(ColumnCount(80), Cell{}, Line::Flags::Wrappable);
+        auto indexTime = Clock::duration{};
+        for (unsigned i = 0; i < lineCount; ++i)
+        {
+            auto const text = i == lineCount / 10
+                ? fmt::format("{:08} ERROR worker-{}: {}", i, rng() % 16, query.pattern)
+                : fmt::format("{:08} {} worker-{}: request {:x} served in {} ms", i, Levels[rng() % Levels.size()], rng() % 16, rng(), rng() % 1000);
+            line.reset(GraphicsAttributes{});
+            line.setText(string_view(text).substr(0, 80));
+            auto const pushStart = Clock::now();
+            index.push(i, line);
+            indexTime += Clock::now() - pushStart;
+        }
+
+        auto const snapshot = SearchSnapshot{index.snapshot(), index.firstLine()};
+
+        optional<Clock::duration> firstHit;
+        auto stats = SearchStats{};
+        auto searcher = Searcher{};
+        auto const searchStart = Clock::now();
+        searcher.start(
+            snapshot,
+            query,
+            [&](SearchMatch const&) {
+                if (!firstHit)
+                    firstHit = Clock::now() - searchStart;
+                return true;
+            },
+            [&](SearchStats const& _stats) { stats = _stats; }
+        );
+        searcher.wait();
+        auto const searchTime = Clock::now() - searchStart;
+
+        cout << fmt::format("{:>16}: {}\n", "history lines", lineCount);
+        cout << fmt::format("{:>16}: {:.2f} ms ({:.1f} ns/line)\n", "indexing",
+                            msecs(indexTime), msecs(indexTime) * 1e6 / max(lineCount, 1u));
+        cout << fmt::format("{:>16}: {}\n", "first hit",
+                            firstHit ? fmt::format("{:.3f} ms", msecs(*firstHit)) : string("none"));
+        cout << fmt::format("{:>16}: {:.3f} ms\n", "full search", msecs(searchTime));
+        cout << fmt::format("{:>16}: {}\n", "matches", stats.matches);
+        cout << fmt::format("{:>16}: {} of {}\n", "skipped blocks", stats.skippedBlocks, snapshot.blocks.size());
+        cout << fmt::format("{:>16}: {}\n", "scanned lines", stats.logicalLines);
+        return EXIT_SUCCESS;
+    }
+
+    int benchReflow()
+    {
+        using namespace terminal;
+        using Clock = chrono::steady_clock;
+        auto const msecs = [](auto d) { return chrono::duration<double, milli>(d).count(); };
+
+        auto const lineCount = parameters().uint("bench-headless.reflow.lines");
+        auto const columns = ColumnCount::cast_from(parameters().uint("bench-headless.reflow.columns"));
+        auto const threadLimit = parameters().uint("bench-headless.reflow.threads");
+        auto const rounds = max(parameters().uint("bench-headless.reflow.rounds"), 1u);
+
+        // Synthetic log-like history, with about every fourth logical line wrapping.
+        static constexpr array<string_view, 6> Levels{"INFO", "DEBUG", "WARN", "TRACE", "INFO", "ERROR"};
+        auto const pageSize = PageSize{LineCount(25), ColumnCount(80)};
+        auto const margin = Margin{Margin::Range{1, 25}, Margin::Range{1, 80}};
+        auto const generate = [&]() {
+            auto rng = mt19937{42};
+            auto grid = Grid(pageSize, true, LineCount::cast_from(lineCount));
+            auto text = string{};
+            for (unsigned i = 0; i < lineCount; ++i)
+            {
+                if (text.empty())
+                {
+                    text = fmt::format("{:08} {} worker-{}: request {:x} served in {} ms", i, Levels[rng() % Levels.size()], rng() % 16, rng(), rng() % 1000);
+                    if (rng() % 4 == 0)
+                        text += fmt::format(" (headers: {:x}, {:x}, {:x}, {:x})", rng(), rng(), rng(), rng());
+                    grid.lineAt(25).setWrapped(false);
+                }
+                else
+                    grid.lineAt(25).setWrapped(true);
+                auto const lineText = string_view(text).substr(0, 80);
+                grid.lineAt(25).setText(lineText);
+                text.erase(0, lineText.size());
+                grid.scrollUp(LineCount(1), GraphicsAttributes{}, margin);
+            }
+            return grid;
+        };
+
+        cout << fmt::format("{:>16}: {}\n", "history lines", lineCount);
+        cout << fmt::format("{:>16}: {}\n", "hardware threads", thread::hardware_concurrency());
+
+        auto const run = [&](string_view _name, unsigned _threadLimit) {
+            auto grid = generate();
+            grid.setReflowThreadLimit(_threadLimit);
+            auto cursor = Coordinate{25, 1};
+            auto grow = Clock::duration{};
+            auto shrink = Clock::duration{};
+            for (unsigned i = 0; i < rounds; ++i)
+            {
+                auto start = Clock::now();
+                cursor = grid.resize(PageSize{pageSize.lines, columns}, cursor, false);
+                grow += Clock::now() - start;
+                start = Clock::now();
+                cursor = grid.resize(pageSize, cursor, false);
+                shrink += Clock::now() - start;
+            }
+            cout << fmt::format("{:>16}: 80 -> {}: {:.1f} ms, {} -> 80: {:.1f} ms ({} history lines)\n",
+                                _name, *columns, msecs(grow) / rounds, *columns, msecs(shrink) / rounds,
+                                *grid.historyLineCount());
+        };
+        run("sequential", 1);
+        run("concurrent", threadLimit);
+        return EXIT_SUCCESS;
+    }
+
+    int benchLatency()
+    {
+        using namespace terminal;
+        auto const prefix = "bench-headless.latency."s;
+        auto const sampleCount = parameters().uint(prefix + "samples");
+        auto const interval = chrono::milliseconds(parameters().uint(prefix + "interval"));
+        auto const timeout = chrono::milliseconds(parameters().uint(prefix + "timeout"));
+        auto const loadRate = parameters().uint(prefix + "load");
+        auto const frameRate = parameters().uint(prefix + "frame-rate");
+        auto const refreshRate = parameters().uint(prefix + "refresh-rate");
+        auto const readBufferSize = parameters().uint(prefix + "read-buffer-size");
+        auto const render = parameters().boolean(prefix + "render");
+        auto const ptyKind = parameters().str(prefix + "pty");
+
+        auto const pageSize = PageSize{LineCount(25), ColumnCount(80)};
+        auto pty = unique_ptr<Pty>{};
+        auto writeLoad = OutputLoad::Writer{};
+#if !defined(_WIN32)
+        PtyProcess* process = nullptr;
+        int loadFd = -1;
+#endif
+        if (ptyKind == "mock")
+        {
+            auto echoPty = make_unique<EchoPty>(pageSize);
+            writeLoad = [p = echoPty.get()](string_view _data) { p->writeOutput(_data); };
+            pty = move(echoPty);
+        }
+#if !defined(_WIN32)
+        else if (ptyKind == "real")
+        {
+            // The child echoes the input itself (like shells do), rather than the line discipline.
+            auto ptyProcess = make_unique<PtyProcess>(
+                Process::ExecInfo{"/bin/sh", {"-c", "stty raw -echo && exec cat"}, FileSystem::current_path(), {}},
+                pageSize
+            );
+            process = ptyProcess.get();
+            loadFd = open(ptsname(static_cast<UnixPty&>(process->pty()).masterFd()), O_WRONLY | O_NOCTTY);
+            if (loadFd < 0)
+            {
+                cerr << fmt::format("Could not open PTY slave for writing. {}\n", strerror(errno));
+                return EXIT_FAILURE;
+            }
+            writeLoad = [loadFd](string_view _data) {
+                while (!_data.empty())
+                {
+                    auto const rv = ::write(loadFd, _data.data(), _data.size());
+                    if (rv < 0 && errno != EINTR)
+                        break;
+                    _data.remove_prefix(static_cast<size_t>(std::max(rv, ssize_t(0))));
+                }
+            };
+            pty = move(ptyProcess);
+        }
+#endif
+        else
+        {
+            cerr << fmt::format("Unsupported PTY kind: {}\n", ptyKind);
+            return EXIT_FAILURE;
+        }
+
+        auto events = LatencyEvents{};
+        auto vt = Terminal{*pty, static_cast<int>(readBufferSize), events, LineCount(1000)};
+        vt.setRefreshRate(static_cast<double>(refreshRate));
+        vt.screen().setMode(DECMode::AutoWrap, true);
+        vt.start();
+
+        // Input is echoed on the last line.
+        writeLoad(fmt::format("\033[{};1H", *pageSize.lines));
+        auto load = OutputLoad(pageSize, loadRate * 1024.0, writeLoad);
+
+        // The GUI thread is emulated: it sends the key presses, and it refreshes (and optionally
+        // renders) the render buffer whenever the screen has been updated, at most once per frame.
+        // Each key press's (unique) echo is looked up in the front buffer after each refresh.
+        struct KeyPress {
+            char32_t codepoint;
+            LatencyClock::time_point time;
+            bool measured;
+        };
+        auto constexpr WarmupCount = 10u;
+        auto echoLatency = LatencyHistogram{};
+        auto renderLatency = LatencyHistogram{};
+        auto pending = optional<KeyPress>{};
+        unsigned sent = 0;
+        unsigned lost = 0;
+        unsigned frames = 0;
+        uint64_t renderedFrameID = 0;
+        uint64_t checksum = 0;
+        auto const frameInterval = chrono::nanoseconds(frameRate ? 1'000'000'000 / frameRate : 0);
+        auto const start = LatencyClock::now();
+        auto nextKeyPress = start;
+
+        // Pauses are jittered (by +/- 50%), so that key presses do not keep hitting
+        // the same phase of the frame interval.
+        auto rng = mt19937{42};
+        auto const typingPause = [&]() {
+            return chrono::duration_cast<chrono::microseconds>(interval) * (50 + rng() % 101) / 100;
+        };
+
+        while (sent < WarmupCount + sampleCount || pending)
+        {
+            if (!pending && LatencyClock::now() >= nextKeyPress)
+            {
+                // CJK ideographs, so that the echo cannot be mistaken for the output load.
+                auto const codepoint = static_cast<char32_t>(0x4E00 + sent % 0x5200);
+                pending = KeyPress{codepoint, LatencyClock::now(), sent >= WarmupCount};
+                ++sent;
+                vt.sendCharPressEvent(codepoint, Modifier{}, pending->time);
+            }
+
+            if (pending && LatencyClock::now() >= pending->time + timeout)
+            {
+                lost += pending->measured ? 1 : 0;
+                pending.reset();
+                nextKeyPress = LatencyClock::now() + typingPause();
+                continue;
+            }
+
+            if (!events.waitForUpdate(pending ? pending->time + timeout : nextKeyPress))
+                continue;
+
+            if (frameRate)
+                this_thread::sleep_until(start + ((LatencyClock::now() - start) / frameInterval + 1) * frameInterval);
+
+            vt.tick(LatencyClock::now());
+            vt.refreshRenderBuffer();
+            ++frames;
+
+            auto const renderBuffer = vt.renderBuffer();
+            auto const refreshed = LatencyClock::now();
+            auto const echoed = pending && containsCodepoint(renderBuffer.get(), pending->codepoint);
+            auto rendered = refreshed;
+            if (render)
+            {
+                checksum += renderHeadless(renderBuffer.get());
+                rendered = LatencyClock::now();
+                if (renderBuffer.get().frameID != renderedFrameID)
+                {
+                    renderedFrameID = renderBuffer.get().frameID;
+                    vt.latencyStats().recordDisplayed(renderBuffer.get().timestamps, rendered, rendered);
+                }
+            }
+
+            if (echoed)
+            {
+                if (pending->measured)
+                {
+                    echoLatency.record(refreshed - pending->time);
+                    renderLatency.record(rendered - pending->time);
+                }
+                pending.reset();
+                nextKeyPress = LatencyClock::now() + typingPause();
+            }
+        }
+        auto const elapsed = chrono::duration<double>(LatencyClock::now() - start).count();
+
+        load.stop();
+#if !defined(_WIN32)
+        if (process)
+        {
+            ::close(loadFd);
+            // Process::terminate() would block, as the PTY's exit watcher is waiting for the process already.
+            ::kill(process->process().nativeHandle(), SIGTERM);
+            (void) process->waitForProcessExit();
+        }
+        else
+#endif
+            pty->close();
+
+        auto const msecs = [](LatencyHistogram::Duration _value) {
+            return chrono::duration<double, milli>(_value).count();
+        };
+        auto const printRow = [&](string_view _name, LatencyHistogram const& _histogram) {
+            cout << fmt::format("{:>16}: {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}\n",
+                                _name,
+                                msecs(_histogram.min()),
+                                msecs(_histogram.percentile(50)),
+                                msecs(_histogram.percentile(99)),
+                                msecs(_histogram.percentile(99.9)),
+                                msecs(_histogram.max()));
+        };
+
+        cout << fmt::format("{:>16}: {}\n", "pty", ptyKind);
+        cout << fmt::format("{:>16}: {} ({} lost)\n", "samples", echoLatency.count(), lost);
+        cout << fmt::format("{:>16}: {} KB/s\n", "output load", loadRate);
+        cout << fmt::format("{:>16}: {} Hz\n", "refresh rate", refreshRate);
+        cout << fmt::format("{:>16}: {}\n", "read buffer", readBufferSize);
+        cout << fmt::format("{:>16}: {:.1f} frames/s\n", "frame rate", frames / elapsed);
+        cout << fmt::format("\n{:>16}  {:>9} {:>9} {:>9} {:>9} {:>9}\n", "latency (ms)", "min", "p50", "p99", "p99.9", "max");
+        printRow("echo", echoLatency);
+        if (render)
+        {
+            printRow("echo rendered", renderLatency);
+            cout << fmt::format("{:>16}: {:016x}\n", "render checksum", checksum);
+        }
+        cout << fmt::format("\nPTY output to screen:\n{}", vt.latencyStats().summary());
+
+        return lost == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     int benchParserOnly()
     {
         auto po = NullParserEvents{};
@@ -235,6 +1212,42 @@ public:
             "Parser only"
         );
     }
+
+    int benchPipeline()
+    {
+        auto const options = benchOptionsFor("pipeline");
+
+        auto po = NullParserEvents{};
+        auto staticParser = terminal::parser::Parser<NullParserEvents>{po};
+        baseBenchmark(
+            [&](char const* a, size_t b) { staticParser.parseFragment(string_view(a, b)); },
+            options,
+            "Parser only, static dispatch"
+        );
+
+        auto virtualParser = terminal::parser::Parser<terminal::ParserEvents>{po};
+        baseBenchmark(
+            [&](char const* a, size_t b) { virtualParser.parseFragment(string_view(a, b)); },
+            options,
+            "Parser only, virtual dispatch"
+        );
+
+        auto pageSize = terminal::PageSize{terminal::LineCount(25), terminal::ColumnCount(80)};
+        auto eh = terminal::Terminal::Events{};
+        auto pty = std::make_unique<terminal::MockViewPty>(pageSize);
+        auto vt = terminal::Terminal{*pty, 10000, eh, terminal::LineCount(4096)};
+        vt.screen().setMode(terminal::DECMode::AutoWrap, true);
+        return baseBenchmark(
+            [&](char const* a, size_t b)
+            {
+                pty->setReadData({a, b});
+                do vt.processInputOnce();
+                while (!pty->stdoutBuffer().empty());
+            },
+            options,
+            "Full pipeline (parser, sequencer, screen)"
+        );
+    }
 };
 
 int main(int argc, char const* argv[])
@@ -0,0 +1,284 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <terminal/LatencyStats.h>
+#include <terminal/Terminal.h>
+#include <terminal/VTCapture.h>
+#include <terminal/pty/MockViewPty.h>
+#include <terminal/Process.h>
+
+#if !defined(_WIN32)
+#include <terminal/pty/UnixPty.h>
+#endif
+
+#include <crispy/App.h>
+#include <crispy/CLI.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+using namespace std;
+
+namespace CLI = crispy::cli;
+
+namespace // {{{ helper
+{
+    using Clock = chrono::steady_clock;
+
+    double msecs(chrono::nanoseconds _value)
+    {
+        return chrono::duration<double, milli>(_value).count();
+    }
+
+    string histogramRow(string_view _name, terminal::LatencyHistogram const& _histogram)
+    {
+        return fmt::format("{:>16}: {:>8} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}\n",
+                           _name,
+                           _histogram.count(),
+                           msecs(_histogram.mean()),
+                           msecs(_histogram.percentile(50)),
+                           msecs(_histogram.percentile(99)),
+                           msecs(_histogram.percentile(99.9)),
+                           msecs(_histogram.max()));
+    }
+} // }}}
+
+class ContourReplayBench: public crispy::App
+{
+public:
+    ContourReplayBench():
+        App("bench-replay", "Contour VT Capture Replay Benchmark", CONTOUR_VERSION_STRING, "Apache-2.0")
+    {
+        using Project = crispy::cli::about::Project;
+        crispy::cli::about::registerProjects(
+            Project{"range-v3", "Boost Software License 1.0", "https://github.com/ericniebler/range-v3"},
+            Project{"fmt", "MIT", "https://github.com/fmtlib/fmt"}
+        );
+        link("bench-replay.replay", bind(&ContourReplayBench::replayCaptures, this));
+#if !defined(_WIN32)
+        link("bench-replay.record", bind(&ContourReplayBench::recordCapture, this));
+#endif
+    }
+
+    crispy::cli::Command parameterDefinition() const override
+    {
+        return CLI::Command{
+            "bench-replay",
+            "Contour Terminal Emulator " CONTOUR_VERSION_STRING " - https://github.com/contour-terminal/contour/ ;-)",
+            CLI::OptionList{},
+            CLI::CommandList{
+                CLI::Command{"help", "Shows this help and exits."},
+                CLI::Command{"version", "Shows the version and exits."},
+                CLI::Command{"license", "Shows the license, and project URL of the used projects and Contour."},
+                CLI::Command{
+                    "record",
+                    "Runs a program on a headless terminal and records a VT capture of it.",
+                    CLI::OptionList{
+                        CLI::Option{"output", CLI::Value{string("capture.vtcap")}, "VT capture file to write.", "FILE"},
+                        CLI::Option{"lines", CLI::Value{25u}, "Number of screen lines.", "COUNT"},
+                        CLI::Option{"columns", CLI::Value{80u}, "Number of screen columns.", "COUNT"},
+                    },
+                    CLI::CommandList{},
+                    CLI::CommandSelect::Explicit,
+                    CLI::Verbatim{"PROGRAM ARGS...", "Program to run."}
+                },
+                CLI::Command{
+                    "replay",
+                    "Replays VT captures (as recorded by contour terminal --vt-capture) and reports their processing cost.",
+                    CLI::OptionList{
+                        CLI::Option{"realtime", CLI::Value{false}, "Replays with the captured timing instead of as fast as possible."},
+                        CLI::Option{"frame-rate", CLI::Value{60u}, "Rate (in capture time) at which the render buffer is refreshed.", "HZ"},
+                        CLI::Option{"history", CLI::Value{1000u}, "Number of scrollback history lines.", "COUNT"},
+                    },
+                    CLI::CommandList{},
+                    CLI::CommandSelect::Implicit,
+                    CLI::Verbatim{"FILE...", "VT capture files to replay."}
+                },
+            }
+        };
+    }
+
+    int replayCaptures()
+    {
+        if (parameters().verbatim.empty())
+        {
+            cerr << "No VT capture given.\n";
+            return EXIT_FAILURE;
+        }
+
+        for (auto const path: parameters().verbatim)
+            if (auto const rv = replayCapture(string(path)); rv != EXIT_SUCCESS)
+                return rv;
+
+        return EXIT_SUCCESS;
+    }
+
+#if !defined(_WIN32)
+    int recordCapture()
+    {
+        using namespace terminal;
+
+        if (parameters().verbatim.empty())
+        {
+            cerr << "No program given.\n";
+            return EXIT_FAILURE;
+        }
+
+        auto exec = Process::ExecInfo{};
+        exec.program = string(parameters().verbatim.front());
+        for (size_t i = 1; i < parameters().verbatim.size(); ++i)
+            exec.arguments.emplace_back(parameters().verbatim.at(i));
+        exec.workingDirectory = FileSystem::current_path();
+
+        auto const outputPath = parameters().str("bench-replay.record.output");
+        auto const pageSize = PageSize{LineCount::cast_from(parameters().uint("bench-replay.record.lines")),
+                                       ColumnCount::cast_from(parameters().uint("bench-replay.record.columns"))};
+        // Not using PtyProcess, as that closes the PTY as soon as the process exited,
+        // possibly before all of its output has been read.
+        auto pty = UnixPty(pageSize);
+        auto events = Terminal::Events{};
+        auto vt = Terminal(pty, 16384, events, LineCount(0));
+        vt.setCapture(make_unique<CaptureWriter>(FileSystem::path(outputPath)));
+        auto process = Process(exec, pty);
+
+        while (vt.processInputOnce())
+            ;
+        (void) process.wait();
+
+        cout << fmt::format("{}: {} bytes\n", outputPath, vt.capture()->size());
+        return EXIT_SUCCESS;
+    }
+#endif
+
+private:
+    int replayCapture(string const& _path)
+    {
+        using namespace terminal;
+
+        auto file = ifstream(_path, ios::binary);
+        auto const speed = parameters().boolean("bench-replay.replay.realtime")
+            ? CaptureReplayer::Speed::RealTime
+            : CaptureReplayer::Speed::Unlimited;
+        auto const frameRate = parameters().uint("bench-replay.replay.frame-rate");
+        auto const frameInterval = chrono::microseconds(frameRate ? 1'000'000 / frameRate : 0);
+
+        auto pty = MockViewPty(PageSize{LineCount(25), ColumnCount(80)});
+        auto events = Terminal::Events{};
+        auto vt = Terminal(pty, 16384, events, LineCount::cast_from(parameters().uint("bench-replay.replay.history")));
+        auto replayer = CaptureReplayer(file, vt, pty, speed);
+        if (!replayer.valid())
+        {
+            cerr << fmt::format("{}: Not a VT capture.\n", _path);
+            return EXIT_FAILURE;
+        }
+
+        // The render buffer is refreshed whenever a frame's worth of capture time passed
+        // with output, like a frontend rendering at the given frame rate would do.
+        auto parseTimes = LatencyHistogram{};
+        auto refreshTimes = LatencyHistogram{};
+        auto parseTime = Clock::duration{};
+        auto refreshTime = Clock::duration{};
+        size_t outputBytes = 0;
+        size_t outputChunks = 0;
+        size_t inputEvents = 0;
+        size_t resizes = 0;
+        auto captureTime = chrono::microseconds{};
+        auto nextFrame = chrono::microseconds{};
+        bool dirty = false;
+
+        auto const refresh = [&]() {
+            auto const start = Clock::now();
+            vt.tick(start);
+            vt.refreshRenderBuffer();
+            auto const elapsed = Clock::now() - start;
+            refreshTimes.record(elapsed);
+            refreshTime += elapsed;
+            dirty = false;
+        };
+
+        auto const start = Clock::now();
+        for (;;)
+        {
+            // Only the replay is timed, not the wait for the record to become due.
+            auto const record = replayer.waitForNext();
+            if (!record)
+                break;
+            auto const replayStart = Clock::now();
+            replayer.replay(*record);
+            auto const elapsed = Clock::now() - replayStart;
+
+            captureTime = record->time;
+            if (dirty && captureTime >= nextFrame)
+                refresh();
+
+            switch (record->event)
+            {
+                case CaptureEvent::Output:
+                    ++outputChunks;
+                    outputBytes += record->data.size();
+                    parseTimes.record(elapsed);
+                    parseTime += elapsed;
+                    if (!dirty)
+                        nextFrame = captureTime + frameInterval;
+                    dirty = true;
+                    break;
+                case CaptureEvent::Input:
+                    ++inputEvents;
+                    break;
+                case CaptureEvent::Resize:
+                    ++resizes;
+                    if (!dirty)
+                        nextFrame = captureTime + frameInterval;
+                    dirty = true;
+                    break;
+            }
+        }
+        if (dirty)
+            refresh();
+        auto const wallTime = Clock::now() - start;
+
+        auto const mb = double(outputBytes) / (1024 * 1024);
+        cout << fmt::format("{}\n", _path);
+        cout << fmt::format("{:>16}: {:.3f} s\n", "capture time", chrono::duration<double>(captureTime).count());
+        cout << fmt::format("{:>16}: {:.3f} s\n", "replay time", chrono::duration<double>(wallTime).count());
+        cout << fmt::format("{:>16}: {:.2f} MB in {} chunks\n", "output", mb, outputChunks);
+        cout << fmt::format("{:>16}: {} events\n", "input", inputEvents);
+        cout << fmt::format("{:>16}: {}\n", "resizes", resizes);
+        cout << fmt::format("{:>16}: {:.3f} s ({:.2f} MB/s)\n", "processing",
+                            chrono::duration<double>(parseTime).count(),
+                            mb / std::max(chrono::duration<double>(parseTime).count(), 1e-9));
+        cout << fmt::format("{:>16}: {:.3f} s ({} frames)\n", "render buffer",
+                            chrono::duration<double>(refreshTime).count(),
+                            refreshTimes.count());
+        cout << fmt::format("\n{:>16}  {:>8} {:>9} {:>9} {:>9} {:>9} {:>9}\n",
+                            "cost (ms)", "count", "mean", "p50", "p99", "p99.9", "max");
+        cout << histogramRow("output chunk", parseTimes);
+        cout << histogramRow("render buffer", refreshTimes);
+        cout << '\n';
+        return EXIT_SUCCESS;
+    }
+};
+
+int main(int argc, char const* argv[])
+{
+    ContourReplayBench app;
+    return app.run(argc, argv);
+}
@@ -0,0 +1,188 @@
+/**
+ * This file is part of the "libterminal" project
+ *   Copyright (c) 2019-2021 Christian Parpart <christian@parpart.family>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <terminal/Terminal.h>
+#include <terminal/pty/MockViewPty.h>
+
+#include <crispy/App.h>
+#include <crispy/CLI.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+using namespace std;
+
+namespace CLI = crispy::cli;
+
+namespace // {{{ helper
+{
+    using Clock = chrono::steady_clock;
+
+    /// A screen operation, as invoked by the sequencer for a given VT sequence.
+    struct Operation
+    {
+        string_view name;
+        string_view description;
+        function<void(terminal::Screen&, unsigned)> run;
+    };
+
+    /// Picks a pseudo-random, yet reproducible, value in [1, _limit] for iteration @p _i.
+    int pick(unsigned _i, unsigned _salt, int _limit)
+    {
+        return static_cast<int>((_i * 2654435761u + _salt * 40503u) % static_cast<unsigned>(_limit)) + 1;
+    }
+
+    vector<Operation> operations(int _lines, int _columns)
+    {
+        using namespace terminal;
+
+        auto const moveCursor = [=](Screen& _screen, unsigned _i) {
+            _screen.moveCursorTo(Coordinate{pick(_i, 1, _lines), pick(_i, 2, _columns / 2)});
+        };
+
+        return {
+            Operation{"ech", "ECH, erase characters", [=](Screen& _screen, unsigned _i) {
+                moveCursor(_screen, _i);
+                _screen.eraseCharacters(ColumnCount(pick(_i, 3, _columns / 2)));
+            }},
+            Operation{"ich", "ICH, insert characters", [=](Screen& _screen, unsigned _i) {
+                moveCursor(_screen, _i);
+                _screen.insertCharacters(ColumnCount(pick(_i, 3, 8)));
+            }},
+            Operation{"dch", "DCH, delete characters", [=](Screen& _screen, unsigned _i) {
+                moveCursor(_screen, _i);
+                _screen.deleteCharacters(ColumnCount(pick(_i, 3, 8)));
+            }},
+            Operation{"deccra", "DECCRA, copy rectangular area", [=](Screen& _screen, unsigned _i) {
+                auto const top = pick(_i, 1, _lines / 2);
+                auto const left = pick(_i, 2, _columns / 2);
+                _screen.copyArea(top, left, top + _lines / 2 - 1, left + _columns / 2 - 1, 0,
+                                 pick(_i, 3, _lines / 2), pick(_i, 4, _columns / 2), 0);
+            }},
+            Operation{"decfra", "DECFRA, fill rectangular area", [=](Screen& _screen, unsigned _i) {
+                auto const top = pick(_i, 1, _lines / 2);
+                auto const left = pick(_i, 2, _columns / 2);
+                _screen.fillArea(U'a' + static_cast<char32_t>(_i % 26),
+                                 top, left, top + _lines / 2 - 1, left + _columns / 2 - 1);
+            }},
+            Operation{"decera", "DECERA, erase rectangular area", [=](Screen& _screen, unsigned _i) {
+                auto const top = pick(_i, 1, _lines / 2);
+                auto const left = pick(_i, 2, _columns / 2);
+                _screen.eraseArea(top, left, top + _lines / 2 - 1, left + _columns / 2 - 1);
+            }},
+        };
+    }
+} // }}}
+
+class ContourVTOpsBench: public crispy::App
+{
+public:
+    ContourVTOpsBench():
+        App("bench-vt-ops", "Contour VT Screen Operations Benchmark", CONTOUR_VERSION_STRING, "Apache-2.0")
+    {
+        using Project = crispy::cli::about::Project;
+        crispy::cli::about::registerProjects(
+            Project{"range-v3", "Boost Software License 1.0", "https://github.com/ericniebler/range-v3"},
+            Project{"fmt", "MIT", "https://github.com/fmtlib/fmt"}
+        );
+        link("bench-vt-ops.run", bind(&ContourVTOpsBench::benchOperations, this));
+    }
+
+    crispy::cli::Command parameterDefinition() const override
+    {
+        return CLI::Command{
+            "bench-vt-ops",
+            "Contour Terminal Emulator " CONTOUR_VERSION_STRING " - https://github.com/contour-terminal/contour/ ;-)",
+            CLI::OptionList{},
+            CLI::CommandList{
+                CLI::Command{"help", "Shows this help and exits."},
+                CLI::Command{"version", "Shows the version and exits."},
+                CLI::Command{"license", "Shows the license, and project URL of the used projects and Contour."},
+                CLI::Command{
+                    "run",
+                    "Measures the screen operations behind editing VT sequences (ech, ich, dch, deccra, decfra, decera).",
+                    CLI::OptionList{
+                        CLI::Option{"lines", CLI::Value{50u}, "Number of screen lines.", "COUNT"},
+                        CLI::Option{"columns", CLI::Value{200u}, "Number of screen columns.", "COUNT"},
+                        CLI::Option{"rounds", CLI::Value{200000u}, "Number of times each operation is invoked.", "COUNT"},
+                    },
+                    CLI::CommandList{},
+                    CLI::CommandSelect::Implicit,
+                    CLI::Verbatim{"OPERATION...", "Operations to measure (default: all)."}
+                },
+            }
+        };
+    }
+
+private:
+    int benchOperations()
+    {
+        using namespace terminal;
+
+        auto const lines = static_cast<int>(std::max(parameters().uint("bench-vt-ops.run.lines"), 2u));
+        auto const columns = static_cast<int>(std::max(parameters().uint("bench-vt-ops.run.columns"), 16u));
+        auto const rounds = parameters().uint("bench-vt-ops.run.rounds");
+        auto const& selected = parameters().verbatim;
+
+        auto const pageSize = PageSize{LineCount(lines), ColumnCount(columns)};
+        auto pty = MockViewPty(pageSize);
+        auto events = Terminal::Events{};
+        auto vt = Terminal(pty, 16384, events, LineCount(0));
+        auto& screen = vt.screen();
+        screen.setMode(DECMode::AutoWrap, true);
+
+        auto text = string{};
+        for (int line = 0; line < lines; ++line)
+            for (int column = 0; column < columns; ++column)
+                text.push_back(static_cast<char>('A' + (line + column) % 26));
+
+        cout << fmt::format("{:>8}  {:>12} {:>12}  {}\n", "op", "ns/op", "ops/s", "description");
+
+        for (auto const& operation: operations(lines, columns))
+        {
+            if (!selected.empty() && find(selected.begin(), selected.end(), operation.name) == selected.end())
+                continue;
+
+            screen.moveCursorTo(Coordinate{1, 1});
+            screen.write(text);
+
+            auto const start = Clock::now();
+            for (unsigned i = 0; i < rounds; ++i)
+                operation.run(screen, i);
+            auto const elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+            cout << fmt::format("{:>8}  {:>12.1f} {:>12.0f}  {}\n",
+                                operation.name,
+                                elapsed * 1e9 / std::max(rounds, 1u),
+                                rounds / std::max(elapsed, 1e-9),
+                                operation.description);
+        }
+
+        return EXIT_SUCCESS;
+    }
+};
+
+int main(int argc, char const* argv[])
+{
+    ContourVTOpsBench app;
+    return app.run(argc, argv);
+}
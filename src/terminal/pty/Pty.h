@@ -19,6 +19,7 @@
 #include <chrono>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 namespace terminal {
 
@@ -60,6 +61,11 @@ class Pty {
     /// @notice This is typically implemented using non-blocking I/O.
     virtual void wakeupReader() = 0;
 
+    /// @returns the file descriptors that become readable whenever read() would not block
+    ///          (including wakeups), for use with an IOReactor, or an empty list if the
+    ///          PTY cannot be polled.
+    virtual std::vector<int> pollDescriptors() const { return {}; }
+
     /// Writes to the PTY device, so the other end can read from it.
     ///
     /// @param buf    Buffer of data to be written.
@@ -71,6 +71,11 @@ void PtyProcess::wakeupReader()
     return pty_->wakeupReader();
 }
 
+std::vector<int> PtyProcess::pollDescriptors() const
+{
+    return pty_->pollDescriptors();
+}
+
 int PtyProcess::write(char const* _buf, size_t _size)
 {
     return pty_->write(_buf, _size);
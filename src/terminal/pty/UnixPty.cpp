@@ -172,6 +172,14 @@ void UnixPty::wakeupReader()
     (void) rv;
 }
 
+std::vector<int> UnixPty::pollDescriptors() const
+{
+    if (master_ < 0)
+        return {};
+
+    return {master_, pipe_[0]};
+}
+
 optional<string_view> UnixPty::read(size_t _size, std::chrono::milliseconds _timeout)
 {
     if (master_ < 0)
@@ -35,6 +35,7 @@ class UnixPty : public Pty
 
     std::optional<std::string_view> read(size_t _size, std::chrono::milliseconds _timeout) override;
     void wakeupReader() override;
+    std::vector<int> pollDescriptors() const override;
     int write(char const* buf, size_t size) override;
     PageSize screenSize() const noexcept override;
     void resizeScreen(PageSize _cells, std::optional<ImageSize> _pixels = std::nullopt) override;
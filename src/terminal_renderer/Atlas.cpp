@@ -189,4 +189,61 @@ TextureInfo const& TextureAtlasAllocator::appendTextureInfo(ImageSize _bitmapSiz
     return textureInfos_.back();
 }
 
+// {{{ RenderBatch
+void RenderBatch::add(TextureInfo const& _texture, int _x, int _y, int _z, std::array<float, 4> const& _color)
+{
+    if (empty())
+    {
+        atlas = _texture.atlas;
+        user = _texture.user;
+    }
+    assert(atlas == _texture.atlas);
+
+    x.push_back(_x);
+    y.push_back(_y);
+    z.push_back(_z);
+    width.push_back(_texture.targetSize.width.as<int>());
+    height.push_back(_texture.targetSize.height.as<int>());
+
+    atlasX.push_back(_texture.relativeX);
+    atlasY.push_back(_texture.relativeY);
+    atlasWidth.push_back(_texture.relativeWidth);
+    atlasHeight.push_back(_texture.relativeHeight);
+
+    red.push_back(_color[0]);
+    green.push_back(_color[1]);
+    blue.push_back(_color[2]);
+    alpha.push_back(_color[3]);
+}
+
+void RenderBatch::clear() noexcept
+{
+    for (auto* v: {&x, &y, &z, &width, &height})
+        v->clear();
+    for (auto* v: {&atlasX, &atlasY, &atlasWidth, &atlasHeight, &red, &green, &blue, &alpha})
+        v->clear();
+}
+// }}}
+
+// {{{ RenderBatcher
+void RenderBatcher::flush(AtlasBackend& _backend)
+{
+    for (RenderBatch& batch: batches_)
+    {
+        if (batch.empty())
+            continue;
+        _backend.renderBatch(batch);
+        batch.clear();
+    }
+}
+
+size_t RenderBatcher::size() const noexcept
+{
+    size_t count = 0;
+    for (RenderBatch const& batch: batches_)
+        count += batch.size();
+    return count;
+}
+// }}}
+
 } // end namespace
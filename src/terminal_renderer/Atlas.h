@@ -121,6 +121,50 @@ struct RenderTexture {
     int y;                          // window y coordinate to render the texture to
     int z;                          // window z coordinate to render the texture to
     std::array<float, 4> color;     // optional; a color being associated with this texture
+    int targetWidth = 0;            // optional; if non-zero, stretches the texture to this width
+    float cropWidth = 1.0f;         // optional; portion of the texture's width to render, from its left edge
+    int sourceX = 0;                // optional; if sourceWidth is non-zero, only the sub-rectangle
+    int sourceY = 0;                // at sourceX/sourceY of sourceWidth x sourceHeight bitmap pixels
+    int sourceWidth = 0;            // (in upload order, i.e. row 0 is the first uploaded row)
+    int sourceHeight = 0;           // of the texture is rendered, scaled like the full texture would be
+};
+
+/**
+ * Textures to be rendered from the same atlas, stored as a flat structure of arrays,
+ * so that a backend can turn them into vertex data in a single tight loop.
+ *
+ * Index i across all arrays describes the i-th texture to render.
+ */
+struct RenderBatch {
+    AtlasID atlas{};
+    int user = 0;                   // TextureInfo::user of the textures in this batch
+
+    // target surface position and size
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<int> z;
+    std::vector<int> width;
+    std::vector<int> height;
+
+    // coordinates into the atlas, relative to the atlas' size
+    std::vector<float> atlasX;
+    std::vector<float> atlasY;
+    std::vector<float> atlasWidth;
+    std::vector<float> atlasHeight;
+
+    // color associated with the texture
+    std::vector<float> red;
+    std::vector<float> green;
+    std::vector<float> blue;
+    std::vector<float> alpha;
+
+    size_t size() const noexcept { return x.size(); }
+    bool empty() const noexcept { return x.empty(); }
+
+    void add(TextureInfo const& _texture, int _x, int _y, int _z, std::array<float, 4> const& _color);
+
+    /// Removes all textures while retaining the allocated capacity.
+    void clear() noexcept;
 };
 
 /// Generic listener API to events from an Atlas.
@@ -141,10 +185,41 @@ class AtlasBackend {
     /// Renders given texture from the atlas with the given target position parameters.
     virtual void renderTexture(RenderTexture _texture) = 0;
 
+    /// Renders all textures of the given batch, which all belong to the same atlas.
+    ///
+    /// The batch is only valid for the duration of this call.
+    virtual void renderBatch(RenderBatch const& _batch) = 0;
+
     /// Destroys the given (3D) texture atlas.
     virtual void destroyAtlas(AtlasID _atlasID) = 0;
 };
 
+/**
+ * Collects the textures to be rendered during a frame into one RenderBatch per atlas,
+ * so that the AtlasBackend receives a few large batches rather than one call per texture.
+ *
+ * The batches' capacity is retained across frames.
+ */
+class RenderBatcher {
+  public:
+    void add(TextureInfo const& _texture, int _x, int _y, int _z, std::array<float, 4> const& _color)
+    {
+        auto const index = static_cast<size_t>(_texture.atlas.value);
+        if (index >= batches_.size())
+            batches_.resize(index + 1);
+        batches_[index].add(_texture, _x, _y, _z, _color);
+    }
+
+    /// Hands all non-empty batches over to @p _backend and clears them.
+    void flush(AtlasBackend& _backend);
+
+    /// @returns the total number of textures collected since the last flush.
+    size_t size() const noexcept;
+
+  private:
+    std::vector<RenderBatch> batches_; // indexed by AtlasID
+};
+
 /**
  * Texture Atlas API.
  *
@@ -192,6 +267,15 @@ class TextureAtlasAllocator {
 
     std::vector<AtlasID> const& activeAtlasTextures() const noexcept { return atlasIDs_; }
 
+    /// @returns the number of bytes of video memory occupied by the active atlas textures.
+    size_t memoryUsage() const noexcept
+    {
+        return atlasIDs_.size()
+             * static_cast<size_t>(*size_.width)
+             * static_cast<size_t>(*size_.height)
+             * static_cast<size_t>(element_count(format_));
+    }
+
     /// @return number of internally used 3D texture atlases.
     constexpr AtlasID currentInstance() const noexcept { return cursor_.atlas; }
 
@@ -34,21 +34,97 @@ void BackgroundRenderer::setRenderTarget(RenderTarget& _renderTarget)
     Renderable::setRenderTarget(_renderTarget);
 }
 
+void BackgroundRenderer::beginFrame()
+{
+    span_.reset();
+    lineSpans_.clear();
+    open_.clear();
+}
+
 void BackgroundRenderer::renderCell(RenderCell const& _cell)
 {
     if (_cell.backgroundColor == defaultColor_)
         return;
 
-    auto const pos = gridMetrics_.map(_cell.position);
+    auto const& pos = _cell.position;
+    if (span_
+            && span_->topLeft.row == pos.row
+            && span_->topLeft.column + span_->columns == pos.column
+            && span_->color == _cell.backgroundColor)
+    {
+        ++span_->columns;
+        return;
+    }
+
+    endSpan();
+    if (!lineSpans_.empty() && lineSpans_.back().topLeft.row != pos.row)
+        endLine();
+
+    span_ = Rectangle{pos, 1, 1, _cell.backgroundColor};
+}
+
+void BackgroundRenderer::endFrame()
+{
+    endSpan();
+    endLine();
+
+    for (Rectangle const& rect: open_)
+        renderRectangle(rect);
+    open_.clear();
+}
+
+void BackgroundRenderer::endSpan()
+{
+    if (!span_)
+        return;
+
+    lineSpans_.emplace_back(*span_);
+    span_.reset();
+}
+
+void BackgroundRenderer::endLine()
+{
+    // Both, the open rectangles and the line's spans, are ordered by column.
+    stillOpen_.clear();
+    auto open = open_.begin();
+    for (Rectangle const& span: lineSpans_)
+    {
+        while (open != open_.end() && open->topLeft.column < span.topLeft.column)
+            renderRectangle(*open++);
+
+        if (open != open_.end()
+                && open->topLeft.column == span.topLeft.column
+                && open->columns == span.columns
+                && open->color == span.color
+                && open->bottomLine() + 1 == span.topLeft.row)
+        {
+            stillOpen_.emplace_back(*open++);
+            ++stillOpen_.back().lines;
+        }
+        else
+            stillOpen_.emplace_back(span);
+    }
+
+    for (; open != open_.end(); ++open)
+        renderRectangle(*open);
+
+    std::swap(open_, stillOpen_);
+    lineSpans_.clear();
+}
+
+void BackgroundRenderer::renderRectangle(Rectangle const& _rect)
+{
+    // The target's origin is bottom left, so the rectangle's position is the one of its bottom line.
+    auto const pos = gridMetrics_.map(Coordinate{_rect.bottomLine(), _rect.topLeft.column});
 
     renderTarget().renderRectangle(
         pos.x,
         pos.y,
-        gridMetrics_.cellSize.width.as<int>(),
-        gridMetrics_.cellSize.height.as<int>(),
-        static_cast<float>(_cell.backgroundColor.red) / 255.0f,
-        static_cast<float>(_cell.backgroundColor.green) / 255.0f,
-        static_cast<float>(_cell.backgroundColor.blue) / 255.0f,
+        gridMetrics_.cellSize.width.as<int>() * _rect.columns,
+        gridMetrics_.cellSize.height.as<int>() * _rect.lines,
+        static_cast<float>(_rect.color.red) / 255.0f,
+        static_cast<float>(_rect.color.green) / 255.0f,
+        static_cast<float>(_rect.color.blue) / 255.0f,
         opacity_
     );
 }
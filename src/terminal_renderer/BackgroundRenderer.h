@@ -19,12 +19,23 @@
 #include <terminal/Screen.h>
 
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace terminal::renderer {
 
 struct GridMetrics;
 class RenderTarget;
 
+/**
+ * Renders the cells' background colors.
+ *
+ * Horizontally adjacent cells of the same background color are merged into a single span,
+ * and spans of equal extent and color on consecutive lines are merged into a single
+ * rectangle, so that typical full-screen TUIs only cost a handful of rectangles per frame.
+ * Cells with the default background color are not rendered at all,
+ * as that is what the render target is cleared with.
+ */
 class BackgroundRenderer : public Renderable {
   public:
     /// Constructs the decoration renderer.
@@ -38,17 +49,48 @@ class BackgroundRenderer : public Renderable {
 
     constexpr void setOpacity(float _value) noexcept { opacity_ = _value; }
 
+    /// Must be invoked before a new terminal frame is rendered.
+    void beginFrame();
+
     // TODO: pass background color directly (instead of whole grid cell),
     // because there is no need to detect bg/fg color more than once per grid cell!
 
-    /// Queues up a render with given background
+    /// Queues up a render with given background.
+    ///
+    /// Cells are expected in screen order, i.e. line by line, and column by column.
     void renderCell(RenderCell const& _cell);
 
+    /// Must be invoked when rendering the terminal's cells has finished for this frame.
+    void endFrame();
+
   private:
+    /// Background area of uniform color, in grid cells.
+    struct Rectangle {
+        Coordinate topLeft;
+        int columns;
+        int lines;
+        RGBColor color;
+
+        int bottomLine() const noexcept { return topLeft.row + lines - 1; }
+    };
+
+    /// Completes the current span, moving it to the current line's spans.
+    void endSpan();
+
+    /// Merges the current line's spans with the rectangles ending on the line above.
+    void endLine();
+
+    void renderRectangle(Rectangle const& _rect);
+
     // private data
     GridMetrics const& gridMetrics_;
     RGBColor const& defaultColor_;
     float opacity_ = 1.0f; // normalized opacity value between 0.0 .. 1.0
+
+    std::optional<Rectangle> span_;     //!< span currently being extended
+    std::vector<Rectangle> lineSpans_;  //!< completed spans of the current line
+    std::vector<Rectangle> open_;       //!< rectangles that may still be extended downwards
+    std::vector<Rectangle> stillOpen_;  //!< scratch buffer for endLine()
 };
 
 } // end namespace
@@ -753,7 +753,8 @@ void BoxDrawingRenderer::clearCache()
 bool BoxDrawingRenderer::render(LinePosition _line,
                                 ColumnPosition _column,
                                 char32_t _codepoint,
-                                RGBColor _color)
+                                RGBColor _color,
+                                atlas::RenderBatcher& _batcher)
 {
     auto data = getDataRef(_codepoint);
     if (!data)
@@ -770,7 +771,7 @@ bool BoxDrawingRenderer::render(LinePosition _line,
         float(_color.blue) / 255.0f,
         1.0f
     };
-    textureScheduler().renderTexture(atlas::RenderTexture{ti, x, y, z, color});
+    _batcher.add(ti, x, y, z, color);
     return true;
 }
 
@@ -48,7 +48,9 @@ class BoxDrawingRenderer : public Renderable {
     /// Renders boxdrawing character.
     ///
     /// @param _char the boxdrawing character's codepoint.
-    bool render(LinePosition _line, ColumnPosition _column, char32_t codepoint, RGBColor _color);
+    /// @param _batcher the batcher to queue the character's texture into.
+    bool render(LinePosition _line, ColumnPosition _column, char32_t codepoint, RGBColor _color,
+                atlas::RenderBatcher& _batcher);
 
   private:
     using TextureAtlas = atlas::MetadataTextureAtlas<char32_t, int>;
@@ -16,8 +16,7 @@
 #include <terminal_renderer/Atlas.h>
 #include <terminal_renderer/Pixmap.h>
 
-#include <crispy/times.h>
-
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <iostream>
@@ -83,6 +82,25 @@ void DecorationRenderer::clearCache()
 
 namespace
 {
+    /// Maximum number of cells a patterned decoration's texture spans.
+    constexpr int PatternTileCells = 8;
+
+    /// Tests whether the decoration looks the same in every column of a cell,
+    /// so that its texture can be stretched across any number of cells.
+    constexpr bool isStretchable(Decorator _decorator) noexcept
+    {
+        switch (_decorator)
+        {
+            case Decorator::Underline:
+            case Decorator::DoubleUnderline:
+            case Decorator::Overline:
+            case Decorator::CrossedOut:
+                return true;
+            default:
+                return false;
+        }
+    }
+
     constexpr bool pointVisibleInCircle(int x, int y, int r)
     {
         return x*x + y*y <= r*r;
@@ -96,6 +114,28 @@ namespace
     }
 }
 
+void DecorationRenderer::insert(Decorator _decorator, ImageSize _size, atlas::Buffer&& _image)
+{
+    if (isStretchable(_decorator))
+    {
+        atlas_->insert(_decorator, _size, _size, move(_image), 0, 1);
+        return;
+    }
+
+    // Keep the texture within reasonable bounds of the atlas for very wide cells.
+    auto const tileCells = clamp(512 / max(unbox<int>(_size.width), 1), 1, PatternTileCells);
+    auto const cellWidth = unbox<size_t>(_size.width);
+    auto const tileSize = ImageSize{Width(unbox<int>(_size.width) * tileCells), _size.height};
+    auto tile = atlas::Buffer(unbox<size_t>(tileSize.width) * unbox<size_t>(tileSize.height), 0);
+    for (size_t y = 0; y < unbox<size_t>(_size.height); ++y)
+        for (int i = 0; i < tileCells; ++i)
+            std::copy_n(_image.begin() + static_cast<ptrdiff_t>(y * cellWidth),
+                        cellWidth,
+                        tile.begin() + static_cast<ptrdiff_t>((y * static_cast<size_t>(tileCells) + static_cast<size_t>(i)) * cellWidth));
+
+    atlas_->insert(_decorator, tileSize, tileSize, move(tile), 0, tileCells);
+}
+
 void DecorationRenderer::rebuild()
 {
     auto const width = gridMetrics_.cellSize.width;
@@ -111,12 +151,7 @@ void DecorationRenderer::rebuild()
             for (int x = 0; x < *width; ++x)
                 image[(*height - y0 - y) * *width + x] = 0xFF;
 
-        atlas_->insert(
-            Decorator::Underline,
-            ImageSize{width, height},
-            ImageSize{width, height},
-            move(image)
-        );
+        insert(Decorator::Underline, ImageSize{width, height}, move(image));
     } // }}}
     { // {{{ double underline
         auto const thickness_half = max(1, int(ceil(underlineThickness() / 3.0)));
@@ -135,12 +170,7 @@ void DecorationRenderer::rebuild()
             }
         }
 
-        atlas_->insert(
-            Decorator::DoubleUnderline,
-            ImageSize{width, height},
-            ImageSize{width, height},
-            move(image)
-        );
+        insert(Decorator::DoubleUnderline, ImageSize{width, height}, move(image));
     } // }}}
     { // {{{ curly underline
         auto const height = Height::cast_from(gridMetrics_.underline.position);
@@ -162,12 +192,7 @@ void DecorationRenderer::rebuild()
             block.paintOver(x, yBase + y2, intensity);
         }
 
-        atlas_->insert(
-            Decorator::CurlyUnderline,
-            block.downsampledSize(),
-            block.downsampledSize(),
-            block.take()
-        );
+        insert(Decorator::CurlyUnderline, block.downsampledSize(), block.take());
     } // }}}
     { // {{{ dotted underline (use square dots)
         auto const dotHeight = gridMetrics_.underline.thickness;
@@ -187,12 +212,7 @@ void DecorationRenderer::rebuild()
             }
         }
 
-        atlas_->insert(
-            Decorator::DottedUnderline,
-            block.downsampledSize(),
-            block.downsampledSize(),
-            block.take()
-        );
+        insert(Decorator::DottedUnderline, block.downsampledSize(), block.take());
     } // }}}
     { // {{{ dashed underline
         // Devides a grid cell's underline in three sub-ranges and only renders first and third one,
@@ -208,12 +228,7 @@ void DecorationRenderer::rebuild()
                 if (fabsf(float(x) / float(*width) - 0.5f) >= 0.25f)
                     image[(*height - y0 - y) * *width + x] = 0xFF;
 
-        atlas_->insert(
-            Decorator::DashedUnderline,
-            ImageSize{width, height},
-            ImageSize{width, height},
-            move(image)
-        );
+        insert(Decorator::DashedUnderline, ImageSize{width, height}, move(image));
     } // }}}
     { // {{{ framed
         auto const cellHeight = gridMetrics_.cellSize.height;
@@ -237,12 +252,7 @@ void DecorationRenderer::rebuild()
                 image[y * *width + (*width - 1 - x)] = 0xFF;
             }
 
-        atlas_->insert(
-            Decorator::Framed,
-            ImageSize{width, cellHeight},
-            ImageSize{width, cellHeight},
-            move(image)
-        );
+        insert(Decorator::Framed, ImageSize{width, cellHeight}, move(image));
     } // }}}
     { // {{{ overline
         auto const cellHeight = gridMetrics_.cellSize.height;
@@ -253,12 +263,7 @@ void DecorationRenderer::rebuild()
             for (int x = 0; x < *width; ++x)
                 image[(*cellHeight - y - 1) * *width + x] = 0xFF;
 
-        atlas_->insert(
-            Decorator::Overline,
-            ImageSize{width, cellHeight},
-            ImageSize{width, cellHeight},
-            move(image)
-        );
+        insert(Decorator::Overline, ImageSize{width, cellHeight}, move(image));
     } // }}}
     { // {{{ crossed-out
         auto const height = Height(*gridMetrics_.cellSize.height / 2);
@@ -269,16 +274,17 @@ void DecorationRenderer::rebuild()
             for (int x = 0; x < *width; ++x)
                 image[(*height - y) * *width + x] = 0xFF;
 
-        atlas_->insert(
-            Decorator::CrossedOut,
-            ImageSize{width, height},
-            ImageSize{width, height},
-            move(image)
-        );
+        insert(Decorator::CrossedOut, ImageSize{width, height}, move(image));
     } // }}}
     // TODO: Encircle
 }
 
+void DecorationRenderer::beginFrame()
+{
+    for (auto& run: runs_)
+        run.reset();
+}
+
 void DecorationRenderer::renderCell(RenderCell const& _cell)
 {
     auto constexpr mappings = array{
@@ -294,8 +300,35 @@ void DecorationRenderer::renderCell(RenderCell const& _cell)
     };
 
     for (auto const& mapping: mappings)
-        if (_cell.flags & mapping.first)
-            renderDecoration(mapping.second, gridMetrics_.map(_cell.position), 1, _cell.decorationColor);
+    {
+        if (!(_cell.flags & mapping.first))
+            continue;
+
+        auto& run = runs_[static_cast<size_t>(mapping.second)];
+        if (run && run->start.row == _cell.position.row
+                && run->start.column + run->columns == _cell.position.column
+                && run->color == _cell.decorationColor)
+        {
+            ++run->columns;
+            continue;
+        }
+
+        if (run)
+            renderDecoration(mapping.second, gridMetrics_.map(run->start), run->columns, run->color);
+        run = Run{_cell.position, 1, _cell.decorationColor};
+    }
+}
+
+void DecorationRenderer::endFrame()
+{
+    for (size_t i = 0; i < runs_.size(); ++i)
+    {
+        if (!runs_[i])
+            continue;
+        auto const& run = *runs_[i];
+        renderDecoration(static_cast<Decorator>(i), gridMetrics_.map(run.start), run.columns, run.color);
+        runs_[i].reset();
+    }
 }
 
 optional<DecorationRenderer::DataRef> DecorationRenderer::getDataRef(Decorator _decoration)
@@ -347,8 +380,26 @@ void DecorationRenderer::renderDecoration(Decorator _decoration,
     };
     atlas::TextureInfo const& textureInfo = get<0>(dataRef.value()).get();
     auto const advanceX = unbox<int>(gridMetrics_.cellSize.width);
-    for (int const i : crispy::times(_columnCount))
-        textureScheduler().renderTexture({textureInfo, i * advanceX + x, y, z, color});
+
+    if (isStretchable(_decoration))
+    {
+        textureScheduler().renderTexture({textureInfo, x, y, z, color, _columnCount * advanceX});
+        return;
+    }
+
+    // Patterned decorations are tiled, with the last tile cut to the remaining cells.
+    auto const tileCells = max(get<1>(dataRef.value()).get(), 1);
+    for (int i = 0; i < _columnCount; i += tileCells)
+    {
+        auto const cells = min(tileCells, _columnCount - i);
+        textureScheduler().renderTexture({textureInfo,
+                                          x + i * advanceX,
+                                          y,
+                                          z,
+                                          color,
+                                          cells * advanceX,
+                                          float(cells) / float(tileCells)});
+    }
 }
 
 } // end namespace
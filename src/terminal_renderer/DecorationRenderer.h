@@ -19,6 +19,9 @@
 #include <terminal/RenderBuffer.h>
 #include <terminal/Screen.h>
 
+#include <array>
+#include <optional>
+
 namespace terminal::renderer {
 
 struct GridMetrics;
@@ -53,6 +56,11 @@ enum class Decorator {
 std::optional<Decorator> to_decorator(std::string const& _value);
 
 /// Renders any kind of grid cell decorations, ranging from basic underline to surrounding boxes.
+///
+/// Horizontally adjacent cells with the same decoration and decoration color are merged
+/// into runs, and each run is rendered as a single texture stretched across it.
+/// Decorations with a per-cell pattern (such as dotted or curly underlines) are rendered
+/// from textures spanning several cells instead, so that they tile across the run.
 class DecorationRenderer : public Renderable {
   public:
     /// Constructs the decoration renderer.
@@ -73,8 +81,17 @@ class DecorationRenderer : public Renderable {
         hyperlinkHover_ = _hover;
     }
 
+    /// Must be invoked before a new terminal frame is rendered.
+    void beginFrame();
+
+    /// Queues up the decorations of the given cell.
+    ///
+    /// Cells are expected in screen order, i.e. line by line, and column by column.
     void renderCell(RenderCell const& _cell);
 
+    /// Must be invoked when rendering the terminal's cells has finished for this frame.
+    void endFrame();
+
     void renderDecoration(Decorator _decoration,
                           crispy::Point _pos,
                           int _columnCount,
@@ -87,11 +104,23 @@ class DecorationRenderer : public Renderable {
     constexpr int underlinePosition() const noexcept { return gridMetrics_.underline.position; }
 
   private:
-    using Atlas = atlas::MetadataTextureAtlas<Decorator, int>; // contains various glyph decorators
+    // contains various glyph decorators, along with the number of cells each texture spans
+    using Atlas = atlas::MetadataTextureAtlas<Decorator, int>;
     using DataRef = Atlas::DataRef;
 
+    /// Consecutive cells of a line with the same decoration.
+    struct Run {
+        Coordinate start;
+        int columns;
+        RGBColor color;
+    };
+
     void rebuild();
 
+    /// Inserts the texture of a single cell's decoration, repeating it horizontally
+    /// if the decoration has a pattern that cannot be stretched.
+    void insert(Decorator _decorator, ImageSize _size, atlas::Buffer&& _image);
+
     std::optional<DataRef> getDataRef(Decorator _decorator);
 
     // private data members
@@ -102,6 +131,9 @@ class DecorationRenderer : public Renderable {
     Decorator hyperlinkHover_ = Decorator::Underline;
 
     std::unique_ptr<Atlas> atlas_;
+
+    static constexpr size_t DecoratorCount = static_cast<size_t>(Decorator::Encircle) + 1;
+    std::array<std::optional<Run>, DecoratorCount> runs_; //!< runs being extended, indexed by Decorator
 };
 
 } // end namespace
@@ -16,12 +16,14 @@
 #include <crispy/times.h>
 #include <crispy/algorithm.h>
 
+#include <algorithm>
 #include <array>
 
 using crispy::times;
 
 using std::array;
-using std::array;
+using std::max;
+using std::min;
 using std::nullopt;
 using std::optional;
 
@@ -45,12 +47,40 @@ void ImageRenderer::setCellSize(ImageSize _cellSize)
     // TODO: recompute slices here?
 }
 
-void ImageRenderer::renderImage(crispy::Point _pos, ImageFragment const& _fragment)
+namespace
 {
-    if (optional<DataRef> const dataRef = getTextureInfo(_fragment); dataRef.has_value())
+    /// Granularity (in grid cells) of tile sizes, so that tiles released along with their
+    /// image can be reused by later images of a similar size, such as an animation's frames.
+    constexpr int TileGranularity = 8;
+
+    int roundUpToGranularity(int _value) noexcept
     {
-        //std::cout << fmt::format("ImageRenderer.renderImage: {}\n", _fragment);
+        return (max(_value, 1) + TileGranularity - 1) / TileGranularity * TileGranularity;
+    }
+}
+
+void ImageRenderer::renderImage(crispy::Point _pos, ImageFragment const& _fragment)
+{
+    RasterizedImage const& image = _fragment.rasterizedImage();
+    auto const cellSize = image.cellSize();
+
+    // Images exceeding the atlas are split into tiles of the largest size fitting into it.
+    auto const maxTile = maxTileSize(cellSize);
+    auto const maxLines = unbox<int>(maxTile.lines);
+    auto const maxColumns = unbox<int>(maxTile.columns);
+    auto const tileOffset = Coordinate{
+        _fragment.offset().row / maxLines * maxLines,
+        _fragment.offset().column / maxColumns * maxColumns
+    };
 
+    // The last tile in each direction only spans the rest of the image.
+    auto const tile = GridSize{
+        LineCount(min(roundUpToGranularity(unbox<int>(image.cellSpan().lines) - tileOffset.row), maxLines)),
+        ColumnCount(min(roundUpToGranularity(unbox<int>(image.cellSpan().columns) - tileOffset.column), maxColumns))
+    };
+
+    if (optional<DataRef> const dataRef = getTextureInfo(image, tileOffset, tile); dataRef.has_value())
+    {
         auto const color = array{1.0f, 0.0f, 0.0f, 1.0f}; // not used
         atlas::TextureInfo const& textureInfo = std::get<0>(*dataRef).get();
 
@@ -58,57 +88,99 @@ void ImageRenderer::renderImage(crispy::Point _pos, ImageFragment const& _fragme
         auto const x = _pos.x;
         auto const y = _pos.y;
         auto const z = 0;
-        textureScheduler().renderTexture({textureInfo, x, y, z, color});
+
+        // The cell's sub-rectangle of the tile, whose rows are stored bottom-up.
+        auto const row = _fragment.offset().row - tileOffset.row;
+        auto const column = _fragment.offset().column - tileOffset.column;
+        auto const sourceX = column * unbox<int>(cellSize.width);
+        auto const sourceY = (unbox<int>(tile.lines) - 1 - row) * unbox<int>(cellSize.height);
+
+        textureScheduler().renderTexture({textureInfo, x, y, z, color,
+                                          0, 1.0f,
+                                          sourceX, sourceY,
+                                          unbox<int>(cellSize.width), unbox<int>(cellSize.height)});
     }
 }
 
-optional<ImageRenderer::DataRef> ImageRenderer::getTextureInfo(ImageFragment const& _fragment)
+GridSize ImageRenderer::maxTileSize(ImageSize _cellSize) const
+{
+    auto const atlasSize = atlas_->size();
+    return GridSize{
+        LineCount(max(unbox<int>(atlasSize.height) / unbox<int>(_cellSize.height), 1)),
+        ColumnCount(max(unbox<int>(atlasSize.width) / unbox<int>(_cellSize.width), 1))
+    };
+}
+
+optional<ImageRenderer::DataRef> ImageRenderer::getTextureInfo(RasterizedImage const& _image,
+                                                                Coordinate _offset,
+                                                                GridSize _tileSize)
 {
-    auto const key = ImageFragmentKey{
-        _fragment.rasterizedImage().image().id(),
-        _fragment.offset(),
-        _fragment.rasterizedImage().cellSize()
+    auto const key = ImageTileKey{
+        _image.image().id(),
+        _offset,
+        _image.cellSize()
     };
 
     if (optional<DataRef> const info = atlas_->get(key); info.has_value())
         return info;
 
+    if (failedTiles_.count(key))
+        return nullopt;
+
     auto metadata = Metadata{}; // TODO: do we want/need to fill this?
 
     auto constexpr colored = true;
 
-    // FIXME: remember if insertion failed already, don't repeat then? or how to deal with GPU atlas/GPU exhaustion?
+    auto const bitmapSize = ImageSize{
+        Width(unbox<int>(_tileSize.columns) * unbox<int>(_image.cellSize().width)),
+        Height(unbox<int>(_tileSize.lines) * unbox<int>(_image.cellSize().height))
+    };
+    auto const targetSize = ImageSize{
+        Width(unbox<int>(_tileSize.columns) * unbox<int>(cellSize_.width)),
+        Height(unbox<int>(_tileSize.lines) * unbox<int>(cellSize_.height))
+    };
 
     auto handle = atlas_->insert(key,
-                                 _fragment.rasterizedImage().cellSize(),
-                                 cellSize_,
-                                 _fragment.data(),
+                                 bitmapSize,
+                                 targetSize,
+                                 _image.fragment(_offset, _tileSize),
                                  colored,
                                  metadata);
 
-    // remember image fragment key so we can later on release the GPU memory when not needed anymore.
+    // remember image tile key so we can later on release the GPU memory when not needed anymore.
     if (handle)
-        imageFragmentsInUse_[_fragment.rasterizedImage().image().id()].emplace_back(key);
+        imageTilesInUse_[key.imageId].emplace_back(key);
+    else
+        failedTiles_.emplace(key);
 
     return handle;
 }
 
 void ImageRenderer::discardImage(Image::Id _imageId)
 {
-    auto const fragmentsIterator = imageFragmentsInUse_.find(_imageId);
-    if (fragmentsIterator != end(imageFragmentsInUse_))
+    auto const tilesIterator = imageTilesInUse_.find(_imageId);
+    if (tilesIterator != end(imageTilesInUse_))
     {
-        auto const& fragments = fragmentsIterator->second;
-        for (ImageFragmentKey const& key : fragments)
+        auto const& tiles = tilesIterator->second;
+        for (ImageTileKey const& key : tiles)
             atlas_->release(key);
 
-        imageFragmentsInUse_.erase(fragmentsIterator);
+        imageTilesInUse_.erase(tilesIterator);
+    }
+
+    for (auto i = begin(failedTiles_); i != end(failedTiles_); )
+    {
+        if (i->imageId == _imageId)
+            i = failedTiles_.erase(i);
+        else
+            ++i;
     }
 }
 
 void ImageRenderer::clearCache()
 {
-    imageFragmentsInUse_.clear();
+    imageTilesInUse_.clear();
+    failedTiles_.clear();
     atlas_ = std::make_unique<TextureAtlas>(renderTarget().coloredAtlasAllocator());
 }
 
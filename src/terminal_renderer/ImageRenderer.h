@@ -24,28 +24,31 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace terminal::renderer
 {
-    struct ImageFragmentKey
+    /// Identifies a tile of an image's texture, that is, the rectangle of grid cells
+    /// starting at the given cell offset, rasterized at the given cell size.
+    struct ImageTileKey
     {
         Image::Id const imageId;
         Coordinate const offset;
         ImageSize const size;
 
-        bool operator==(ImageFragmentKey const& b) const noexcept
+        bool operator==(ImageTileKey const& b) const noexcept
         {
             return imageId == b.imageId
                 && offset == b.offset
                 && size == b.size;
         }
 
-        bool operator!=(ImageFragmentKey const& b) const noexcept
+        bool operator!=(ImageTileKey const& b) const noexcept
         {
             return !(*this == b);
         }
 
-        bool operator<(ImageFragmentKey const& b) const noexcept
+        bool operator<(ImageTileKey const& b) const noexcept
         {
             return (imageId < b.imageId)
                 || (imageId == b.imageId && offset < b.offset);
@@ -56,9 +59,9 @@ namespace terminal::renderer
 namespace std
 {
     template<>
-    struct hash<terminal::renderer::ImageFragmentKey>
+    struct hash<terminal::renderer::ImageTileKey>
     {
-        constexpr size_t operator()(terminal::renderer::ImageFragmentKey const& _key) const noexcept
+        constexpr size_t operator()(terminal::renderer::ImageTileKey const& _key) const noexcept
         {
             using FNV = crispy::FNV<uint64_t>;
             return FNV{}(FNV{}.basis(),
@@ -76,6 +79,10 @@ namespace terminal::renderer {
 /// Image Rendering API.
 ///
 /// Can render any arbitrary RGBA image (for example Sixel Graphics images).
+///
+/// Each image is uploaded once as a single texture, or as a few large tiles if it
+/// does not fit into the atlas, and each grid cell is rendered by sampling its
+/// sub-rectangle out of it. The textures are released along with the image.
 class ImageRenderer : public Renderable
 {
   public:
@@ -89,20 +96,24 @@ class ImageRenderer : public Renderable
 
     void renderImage(crispy::Point _pos, ImageFragment const& _fragment);
 
-    /// notify underlying cache that this fragment is not going to be rendered anymore, maybe freeing up some GPU caches.
+    /// notify underlying cache that this image is not going to be rendered anymore, freeing up its GPU textures.
     void discardImage(Image::Id _imageId);
 
     struct Metadata {}; // TODO: do we want/need anything here?
-    using TextureAtlas = atlas::MetadataTextureAtlas<ImageFragmentKey, Metadata>;
+    using TextureAtlas = atlas::MetadataTextureAtlas<ImageTileKey, Metadata>;
     using DataRef = TextureAtlas::DataRef;
 
   private:
-    std::optional<DataRef> getTextureInfo(ImageFragment const& _fragment);
+    /// @returns the number of grid cells of the largest image tile fitting into the atlas.
+    GridSize maxTileSize(ImageSize _cellSize) const;
+
+    std::optional<DataRef> getTextureInfo(RasterizedImage const& _image, Coordinate _offset, GridSize _tileSize);
 
     // private data
     //
     ImagePool imagePool_;
-    std::unordered_map<Image::Id, std::vector<ImageFragmentKey>> imageFragmentsInUse_; // remember each fragment key per image for proper GPU texture GC.
+    std::unordered_map<Image::Id, std::vector<ImageTileKey>> imageTilesInUse_; // remember each tile key per image for proper GPU texture GC.
+    std::unordered_set<ImageTileKey> failedTiles_; // tiles that did not fit into the atlas, so they're not rasterized again each frame.
     ImageSize cellSize_;
     std::unique_ptr<TextureAtlas> atlas_;
 };
@@ -286,14 +286,20 @@ uint64_t Renderer::render(Terminal& _terminal, bool _pressure)
     #endif // }}}
 
     optional<terminal::RenderCursor> cursorOpt;
+    backgroundRenderer_.beginFrame();
+    decorationRenderer_.beginFrame();
     textRenderer_.beginFrame();
     textRenderer_.setPressure(_pressure && _terminal.screen().isPrimaryScreen());
     {
         RenderBufferRef const renderBuffer = _terminal.renderBuffer();
+        renderedFrameID_ = renderBuffer.get().frameID;
+        renderedFrameTimestamps_ = renderBuffer.get().timestamps;
         cursorOpt = renderBuffer.get().cursor;
         renderCells(renderBuffer.get().screen);
     }
+    decorationRenderer_.endFrame(); // before the text, so that glyphs are drawn on top
     textRenderer_.endFrame();
+    backgroundRenderer_.endFrame();
 
     if (cursorOpt && _terminal.cursorShape() != CursorShape::Block)
     {
@@ -385,6 +391,17 @@ optional<RenderCursor> Renderer::renderCursor(Terminal const& _terminal)
 void Renderer::dumpState(std::ostream& _textOutput) const
 {
     textRenderer_.debugCache(_textOutput);
+    _textOutput << "Renderer memory usage:\n" << memoryUsage().summary();
+}
+
+MemoryUsage Renderer::memoryUsage() const
+{
+    auto usage = MemoryUsage{};
+    usage[MemoryCategory::TextShaping] = textRenderer_.memoryUsage();
+    if (renderTargetAvailable())
+        for (auto const* allocator: renderTarget_->allAtlasAllocators())
+            usage[MemoryCategory::Textures] += allocator->memoryUsage();
+    return usage;
 }
 
 } // end namespace
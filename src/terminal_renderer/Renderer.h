@@ -102,6 +102,12 @@ class Renderer : public Renderable {
     uint64_t render(Terminal& _terminal,
                     bool _pressure);
 
+    /// @returns the frame ID of the render buffer drawn by the most recent render() call.
+    uint64_t renderedFrameID() const noexcept { return renderedFrameID_; }
+
+    /// @returns the timestamps of the render buffer drawn by the most recent render() call.
+    FrameTimestamps const& renderedFrameTimestamps() const noexcept { return renderedFrameTimestamps_; }
+
     // Converts given RGBColor with its given opacity to a 4D-vector of values between 0.0 and 1.0
     static constexpr std::array<float, 4> canonicalColor(RGBColor const& _rgb, Opacity _opacity = Opacity::Opaque)
     {
@@ -117,8 +123,14 @@ class Renderer : public Renderable {
 
     void clearCache();
 
+    /// Clears the text shaping cache, such as to free memory, keeping the texture atlases.
+    void clearTextShapingCache() { textRenderer_.clearShapingCache(); }
+
     void dumpState(std::ostream& _textOutput) const;
 
+    /// @returns the number of bytes occupied by the text shaping cache and the texture atlases.
+    terminal::MemoryUsage memoryUsage() const;
+
     std::array<std::reference_wrapper<Renderable>, 5> renderables()
     {
         return std::array<std::reference_wrapper<Renderable>, 5>{
@@ -155,6 +167,9 @@ class Renderer : public Renderable {
     TextRenderer textRenderer_;
     DecorationRenderer decorationRenderer_;
     CursorRenderer cursorRenderer_;
+
+    uint64_t renderedFrameID_ = 0;
+    FrameTimestamps renderedFrameTimestamps_{};
 };
 
 } // end namespace
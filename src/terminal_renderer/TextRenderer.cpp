@@ -103,9 +103,17 @@ void TextRenderer::clearCache()
     cacheKeyStorage_.clear();
     cache_.clear();
 
+    asciiGlyphs_ = {};
+
     boxDrawingRenderer_.clearCache();
 }
 
+void TextRenderer::clearShapingCache()
+{
+    cacheKeyStorage_.clear();
+    cache_.clear();
+}
+
 void TextRenderer::updateFontMetrics()
 {
     if (!renderTargetAvailable())
@@ -139,7 +147,8 @@ void TextRenderer::renderCell(RenderCell const& _cell)
             LinePosition::cast_from(_cell.position.row),
             ColumnPosition::cast_from(_cell.position.column),
             codepoints[0],
-            _cell.foregroundColor
+            _cell.foregroundColor,
+            batcher_
         );
         if (success)
         {
@@ -150,6 +159,20 @@ void TextRenderer::renderCell(RenderCell const& _cell)
         }
     }
 
+    if (AsciiGlyph const* glyph = asciiGlyph(_cell, style); glyph != nullptr)
+    {
+        if (!forceCellGroupSplit_)
+            endSequence();
+        forceCellGroupSplit_ = true;
+        if (glyph->textureInfo)
+            renderTexture(gridMetrics_.map(_cell.position),
+                          _cell.foregroundColor,
+                          *glyph->textureInfo,
+                          *glyph->metrics,
+                          glyph->glyphPosition);
+        return;
+    }
+
     if (forceCellGroupSplit_ || (_cell.flags & CellFlags::CellSequenceStart))
     {
         // fmt::print("TextRenderer.sequenceStart: {}\n", textPosition_);
@@ -169,14 +192,110 @@ void TextRenderer::beginFrame()
     Expects(codepoints_.empty());
     Expects(clusters_.empty());
 
+    for (auto const style: {TextStyle::Regular, TextStyle::Bold, TextStyle::Italic, TextStyle::BoldItalic})
+        if (AsciiGlyphTable& table = asciiGlyphs_[static_cast<size_t>(style) & 0x03]; !table.filled)
+            fillAsciiGlyphTable(table, style);
+
     auto constexpr DefaultColor = RGBColor{};
     style_ = TextStyle::Invalid;
     color_ = DefaultColor;
 }
 
+TextRenderer::AsciiGlyph const* TextRenderer::asciiGlyph(RenderCell const& _cell, TextStyle _style) const noexcept
+{
+    if (_cell.codepoints.size() != 1)
+        return nullptr;
+
+    auto const codepoint = _cell.codepoints[0];
+    if (codepoint < FirstAsciiGlyph || codepoint > LastAsciiGlyph)
+        return nullptr;
+
+    AsciiGlyphTable const& table = asciiGlyphs_[static_cast<size_t>(_style) & 0x03];
+    if (!table.usable)
+        return nullptr;
+
+    return &table.glyphs[codepoint - FirstAsciiGlyph];
+}
+
+void TextRenderer::fillAsciiGlyphTable(AsciiGlyphTable& _table, TextStyle _style)
+{
+    Expects(codepoints_.empty());
+
+    _table = AsciiGlyphTable{};
+    _table.filled = true;
+    style_ = _style;
+
+    // Shape each character on its own, just like a single cell of it would be.
+    for (char32_t codepoint = FirstAsciiGlyph; codepoint <= LastAsciiGlyph; ++codepoint)
+    {
+        codepoints_.assign(1, codepoint);
+        clusters_.assign(1, 0);
+        auto const glyphPositions = requestGlyphPositions();
+        if (glyphPositions.size() != 1)
+        {
+            codepoints_.clear();
+            clusters_.clear();
+            return;
+        }
+
+        AsciiGlyph& glyph = _table.glyphs[codepoint - FirstAsciiGlyph];
+        glyph.glyphPosition = glyphPositions[0];
+        if (optional<DataRef> const ti = getTextureInfo(glyph.glyphPosition.glyph, glyph.glyphPosition.presentation); ti.has_value())
+        {
+            glyph.textureInfo = &get<0>(*ti).get();
+            glyph.metrics = &get<1>(*ti).get();
+        }
+    }
+
+    // Shape a text containing every pair of printable characters (and some longer well known
+    // ligatures) to see whether any of them is rendered differently next to others.
+    auto static const probe = []() {
+        auto text = u32string{};
+        for (char32_t a = FirstAsciiGlyph + 1; a <= LastAsciiGlyph; ++a)
+        {
+            for (char32_t b = FirstAsciiGlyph + 1; b <= LastAsciiGlyph; ++b)
+            {
+                text += a;
+                text += b;
+            }
+        }
+        for (auto const ligature: {U"www", U"-->", U"<!--", U"===", U"!==", U"=/=", U"<=>", U"<<=", U">>=", U"..."})
+        {
+            text += U' ';
+            text += ligature;
+        }
+        return text;
+    }();
+
+    codepoints_.assign(probe.begin(), probe.end());
+    clusters_.clear();
+    for (unsigned i = 0; i < probe.size(); ++i)
+        clusters_.emplace_back(i);
+
+    auto const glyphPositions = requestGlyphPositions();
+    _table.usable = glyphPositions.size() == probe.size();
+    for (size_t i = 0; i < glyphPositions.size() && _table.usable; ++i)
+    {
+        text::glyph_position const& expected = _table.glyphs[probe[i] - FirstAsciiGlyph].glyphPosition;
+        text::glyph_position const& actual = glyphPositions[i];
+        _table.usable = actual.glyph == expected.glyph
+                     && actual.offset == expected.offset
+                     && actual.advance == expected.advance
+                     && actual.presentation == expected.presentation;
+    }
+
+    codepoints_.clear();
+    clusters_.clear();
+
+    LOGSTORE(RasterizerLog)("ASCII glyph table for text style {} is {}.",
+                            static_cast<unsigned>(_style),
+                            _table.usable ? "used" : "not used, as glyphs depend on their context");
+}
+
 void TextRenderer::endFrame()
 {
     endSequence();
+    batcher_.flush(textureScheduler());
 }
 
 void TextRenderer::renderRun(crispy::Point _pos,
@@ -413,13 +532,25 @@ void TextRenderer::renderTexture(crispy::Point const& _pos,
         float(_color.blue()) / 255.0f,
         float(_color.alpha()) / 255.0f,
     };
-    textureScheduler().renderTexture({_textureInfo, x, y, z, color});
+    batcher_.add(_textureInfo, x, y, z, color);
 }
 
 void TextRenderer::debugCache(std::ostream& _textOutput) const
 {
 }
 
+size_t TextRenderer::memoryUsage() const noexcept
+{
+    size_t bytes = 0;
+    for (auto const& key: cacheKeyStorage_)
+        bytes += sizeof(u32string) + key.capacity() * sizeof(char32_t);
+    for (auto const& [key, glyphPositions]: cache_)
+        bytes += sizeof(TextCacheKey)
+               + sizeof(text::shape_result)
+               + glyphPositions.capacity() * sizeof(text::glyph_position);
+    return bytes;
+}
+
 void TextRenderer::appendCell(gsl::span<char32_t const> _codepoints,
                                    TextStyle _style,
                                    RGBColor _color)
@@ -34,6 +34,7 @@
 #include <gsl/span>
 #include <gsl/span_ext>
 
+#include <array>
 #include <functional>
 #include <list>
 #include <memory>
@@ -179,6 +180,12 @@ public:
     void debugCache(std::ostream& _textOutput) const;
     void clearCache() override;
 
+    /// Clears the text shaping cache only, keeping the glyphs rasterized into the texture atlases.
+    void clearShapingCache();
+
+    /// @returns the number of bytes occupied by the text shaping cache.
+    size_t memoryUsage() const noexcept;
+
     void updateFontMetrics();
 
     void setPressure(bool _pressure) noexcept { pressure_ = _pressure; }
@@ -225,6 +232,33 @@ public:
     using TextureAtlas = atlas::MetadataTextureAtlas<text::glyph_key, GlyphMetrics>;
     using DataRef = TextureAtlas::DataRef;
 
+    /// Printable US-ASCII character, shaped and rasterized in advance.
+    struct AsciiGlyph
+    {
+        text::glyph_position glyphPosition{};
+        atlas::TextureInfo const* textureInfo = nullptr; // nullptr if there is nothing to render
+        GlyphMetrics const* metrics = nullptr;
+    };
+
+    static constexpr char32_t FirstAsciiGlyph = 0x20;
+    static constexpr char32_t LastAsciiGlyph = 0x7E;
+
+    /// Glyphs of all printable US-ASCII characters of one TextStyle, for cells to bypass text shaping
+    /// and the glyph lookups. It's only used if the font renders them the same regardless of the
+    /// surrounding text, i.e. without ligatures, contextual alternates or kerning.
+    struct AsciiGlyphTable
+    {
+        bool filled = false;
+        bool usable = false;
+        std::array<AsciiGlyph, LastAsciiGlyph - FirstAsciiGlyph + 1> glyphs{};
+    };
+
+    void fillAsciiGlyphTable(AsciiGlyphTable& _table, TextStyle _style);
+
+    /// @returns the ASCII glyph table entry to render the given cell with,
+    ///          or nullptr if the cell needs to go through text shaping instead.
+    AsciiGlyph const* asciiGlyph(RenderCell const& _cell, TextStyle _style) const noexcept;
+
     std::optional<DataRef> getTextureInfo(text::glyph_key const& _id,
                                           unicode::PresentationStyle _presentation);
 
@@ -268,6 +302,9 @@ public:
     //
     BoxDrawingRenderer boxDrawingRenderer_;
 
+    /// Glyph textures of the current frame, handed over to the backend at the end of the frame.
+    atlas::RenderBatcher batcher_;
+
     // render states
     TextStyle style_ = TextStyle::Invalid;
     RGBColor color_{};
@@ -279,6 +316,10 @@ public:
     bool textStartFound_ = false;
     bool forceCellGroupSplit_ = false;
 
+    // ASCII glyph tables, indexed by the lower bits of TextStyle
+    //
+    std::array<AsciiGlyphTable, 4> asciiGlyphs_{};
+
     // text shaping cache
     //
     std::list<std::u32string> cacheKeyStorage_;
@@ -263,12 +263,11 @@ namespace std { // {{{
     struct hash<text::glyph_key> {
         std::size_t operator()(text::glyph_key const& _key) const noexcept
         {
-            auto const f = _key.font.value;
-            auto const i = _key.index.value;
-            auto const s = int(_key.size.pt * 10.0);
-            return std::size_t(((size_t(f) << 32) & 0xFFFF)
-                             | ((i << 16) & 0xFFFF)
-                             |  (s & 0xFF));
+            using FNV = crispy::FNV<unsigned>;
+            return FNV{}(FNV{}.basis(),
+                         _key.font.value,
+                         _key.index.value,
+                         static_cast<unsigned>(_key.size.pt * 10.0));
         }
     };
 